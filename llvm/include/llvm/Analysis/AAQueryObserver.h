@@ -0,0 +1,76 @@
+//===- llvm/Analysis/AAQueryObserver.h - Watch the AA chain -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the AAQueryObserver interface, through which
+// AliasAnalysis::alias reports each query it chains from one alias analysis
+// implementation to the next.  Observers can tell how long each
+// implementation takes and which one settled a query, which the -profile-aa
+// pass reports per client pass.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_AAQUERYOBSERVER_H
+#define LLVM_ANALYSIS_AAQUERYOBSERVER_H
+
+#include "llvm/Analysis/AliasAnalysis.h"
+
+namespace llvm {
+
+class AAQueryObserver {
+  AAQueryObserver *Prev; // The observer installed before this one.
+  bool Installed;
+
+  /// getTop - Return the observer installed last on this thread.  Each
+  /// thread running passes has its own stack of observers.
+  static AAQueryObserver *getTop();
+
+  friend class AliasAnalysis;
+
+public:
+  AAQueryObserver() : Prev(nullptr), Installed(false) {}
+  virtual ~AAQueryObserver();
+
+  /// install - Start observing the queries chained between alias analyses,
+  /// along with the observers installed before.
+  void install();
+
+  /// uninstall - Stop observing.  Observers are uninstalled in the reverse
+  /// order of their installation.
+  void uninstall();
+
+  bool isInstalled() const { return Installed; }
+
+  /// enter - Called right before Impl answers a query chained to it.
+  virtual void enter(const AliasAnalysis &Impl) = 0;
+
+  /// leave - Called once Impl answered the query it entered with Result.
+  /// Implementations further down the chain leave before the ones above.
+  virtual void leave(const AliasAnalysis &Impl,
+                     AliasAnalysis::AliasResult Result) = 0;
+
+  /// getImplementationPass - Return the pass that implements Impl, or null if
+  /// it never called InitializeAliasAnalysis (like NoAA).
+  static const Pass *getImplementationPass(const AliasAnalysis &Impl) {
+    return Impl.ImplPass;
+  }
+
+  /// getPassArgumentName - Return the command line name of P, or its
+  /// description if it has none, for reports.
+  static StringRef getPassArgumentName(const Pass &P);
+
+  /// getImplementationName - Return the command line name of the pass that
+  /// implements Impl, for reports.
+  static StringRef getImplementationName(const AliasAnalysis &Impl) {
+    return Impl.ImplPass ? getPassArgumentName(*Impl.ImplPass) : "no-aa";
+  }
+};
+
+} // End llvm namespace
+
+#endif
@@ -37,7 +37,10 @@
 #ifndef LLVM_ANALYSIS_ALIASANALYSIS_H
 #define LLVM_ANALYSIS_ALIASANALYSIS_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Metadata.h"
 
@@ -61,6 +64,9 @@ protected:
 
 private:
   AliasAnalysis *AA;       // Previous Alias Analysis to chain to.
+  Pass *ImplPass;          // The pass implementing this interface.
+
+  friend class AAQueryObserver;
 
 protected:
   /// InitializeAliasAnalysis - Subclasses must call this method to initialize
@@ -74,9 +80,20 @@ protected:
   /// directly (using AliasAnalysis::getAnalysisUsage(AU)).
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
+public:
+  class AliasMatrix;
+  struct Location;
+
+protected:
+  /// forwardAliasBatch - Pass the pairs of Matrix that are still unknown on to
+  /// the next alias analysis in the chain.  Implementations that override
+  /// aliasBatch call this once they have settled the pairs they can.
+  void forwardAliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix);
+
 public:
   static char ID; // Class identification, replacement for typeinfo
-  AliasAnalysis() : DL(nullptr), TLI(nullptr), AA(nullptr) {}
+  AliasAnalysis()
+      : DL(nullptr), TLI(nullptr), AA(nullptr), ImplPass(nullptr) {}
   virtual ~AliasAnalysis();  // We want to be subclassed
 
   /// UnknownSize - This is a special value which can be used with the
@@ -201,6 +218,67 @@ public:
     return isNoAlias(Location(V1), Location(V2));
   }
   
+  /// AliasMatrix - The alias results of every pair of a list of locations, as
+  /// filled in by aliasBatch.  Pairs start out unknown; a pair that is still
+  /// unknown once the batch is done is a MayAlias.
+  class AliasMatrix {
+    unsigned NumLocs;
+    SmallVector<AliasResult, 16> Results;
+    SmallBitVector Known;
+    bool StopAtAlias;
+    bool FoundAlias;
+
+    unsigned getIndex(unsigned I, unsigned J) const {
+      assert(I != J && I < NumLocs && J < NumLocs && "Bad location pair!");
+      if (I < J)
+        std::swap(I, J);
+      return I * (I - 1) / 2 + J;
+    }
+
+  public:
+    /// If StopAtAlias is set, the batch may stop at the first pair that is
+    /// known not to be NoAlias, leaving other pairs unknown.
+    explicit AliasMatrix(unsigned NumLocs, bool StopAtAlias = false)
+        : NumLocs(NumLocs), Results(NumLocs * (NumLocs - 1) / 2, MayAlias),
+          Known(NumLocs * (NumLocs - 1) / 2), StopAtAlias(StopAtAlias),
+          FoundAlias(false) {}
+
+    unsigned getNumLocations() const { return NumLocs; }
+
+    bool isKnown(unsigned I, unsigned J) const {
+      return Known.test(getIndex(I, J));
+    }
+
+    AliasResult get(unsigned I, unsigned J) const {
+      return Results[getIndex(I, J)];
+    }
+
+    void set(unsigned I, unsigned J, AliasResult R) {
+      unsigned Idx = getIndex(I, J);
+      Results[Idx] = R;
+      Known.set(Idx);
+      if (R != NoAlias)
+        FoundAlias = true;
+    }
+
+    /// isComplete - Return true if no more queries are needed, either because
+    /// every pair is known or because an aliasing pair was found and the
+    /// client asked to stop there.
+    bool isComplete() const {
+      return (StopAtAlias && FoundAlias) || Known.all();
+    }
+
+    /// isNoAlias - Return true if every pair is known to be NoAlias.
+    bool isNoAlias() const { return !FoundAlias && Known.all(); }
+  };
+
+  /// aliasBatch - Batched interface to alias: fill in the pairs of Matrix that
+  /// are still unknown with the alias result of the corresponding pair of
+  /// Locs.  The default implementation makes one alias query per pair.
+  /// Implementations that can share work across the batch override it, settle
+  /// the pairs they can, and pass the rest on with forwardAliasBatch.
+  virtual void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix);
+
   /// isMustAlias - A convenience wrapper.
   bool isMustAlias(const Location &LocA, const Location &LocB) {
     return alias(LocA, LocB) == MustAlias;
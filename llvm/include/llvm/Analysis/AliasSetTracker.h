@@ -20,13 +20,13 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
+#include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
 #include <vector>
 
 namespace llvm {
 
-class AliasAnalysis;
 class LoadInst;
 class StoreInst;
 class VAArgInst;
@@ -117,6 +117,9 @@ class AliasSet : public ilist_node<AliasSet> {
   // AliasSets forwarding to it.
   unsigned RefCount : 28;
 
+  // SetSize - Number of pointers in PtrList.
+  unsigned SetSize;
+
   /// AccessType - Keep track of whether this alias set merely refers to the
   /// locations of memory, whether it modifies the memory, or whether it does
   /// both.  The lattice goes from "NoModRef" to either Refs or Mods, then to
@@ -223,7 +226,7 @@ private:
   friend struct ilist_sentinel_traits<AliasSet>;
   AliasSet()
     : PtrList(nullptr), PtrListEnd(&PtrList), Forward(nullptr), RefCount(0),
-      AccessTy(NoModRef), AliasTy(MustAlias), Volatile(false) {
+      SetSize(0), AccessTy(NoModRef), AliasTy(MustAlias), Volatile(false) {
   }
 
   AliasSet(const AliasSet &AS) LLVM_DELETED_FUNCTION;
@@ -253,7 +256,7 @@ private:
   void addPointer(AliasSetTracker &AST, PointerRec &Entry, uint64_t Size,
                   const AAMDNodes &AAInfo,
                   bool KnownMustAlias = false);
-  void addUnknownInst(Instruction *I, AliasAnalysis &AA);
+  void addUnknownInst(AliasSetTracker &AST, Instruction *I);
   void removeUnknownInst(AliasSetTracker &AST, Instruction *I) {
     bool WasEmpty = UnknownInsts.empty();
     for (size_t i = 0, e = UnknownInsts.size(); i != e; ++i)
@@ -272,7 +275,7 @@ public:
   /// alias one of the members in the set.
   ///
   bool aliasesPointer(const Value *Ptr, uint64_t Size, const AAMDNodes &AAInfo,
-                      AliasAnalysis &AA) const;
+                      const AliasSetTracker &AST) const;
   bool aliasesUnknownInst(Instruction *Inst, AliasAnalysis &AA) const;
 };
 
@@ -307,11 +310,25 @@ class AliasSetTracker {
   // Map from pointers to their node
   PointerMapType PointerMap;
 
+  // AliasAnyAS - Once the may-alias sets grow past the saturation threshold,
+  // every set is merged into this one and all later pointers and
+  // instructions go straight to it, without querying alias analysis.
+  AliasSet *AliasAnyAS;
+
+  // TotalMayAliasSetSize - Number of pointers in all the may-alias sets.
+  unsigned TotalMayAliasSetSize;
+
+  // DisjointTags - Whether alias analysis found accesses tagged with the
+  // first AAInfo to never alias those tagged with the second one, whatever
+  // their addresses.
+  mutable DenseMap<std::pair<AAMDNodes, AAMDNodes>, bool> DisjointTags;
+
 public:
   /// AliasSetTracker ctor - Create an empty collection of AliasSets, and use
   /// the specified alias analysis object to disambiguate load and store
   /// addresses.
-  explicit AliasSetTracker(AliasAnalysis &aa) : AA(aa) {}
+  explicit AliasSetTracker(AliasAnalysis &aa)
+    : AA(aa), AliasAnyAS(nullptr), TotalMayAliasSetSize(0) {}
   ~AliasSetTracker() { clear(); }
 
   /// add methods - These methods are used to add different types of
@@ -381,6 +398,16 @@ public:
   /// this tracker.
   AliasAnalysis &getAliasAnalysis() const { return AA; }
 
+  /// isSaturated - Return true if the tracker gave up on keeping its sets
+  /// apart, and now holds everything in a single may-alias set.
+  bool isSaturated() const { return AliasAnyAS != nullptr; }
+
+  /// isNoAlias - Return true if the two locations are known not to alias.
+  /// Distinct identified objects and memoized disjoint AAInfo tags are
+  /// checked before querying alias analysis.
+  bool isNoAlias(const AliasAnalysis::Location &LocA,
+                 const AliasAnalysis::Location &LocB) const;
+
   /// deleteValue method - This method is used to remove a pointer value from
   /// the AliasSetTracker entirely.  It should be used when an instruction is
   /// deleted from the program to update the AST.  If you don't use this, you
@@ -424,12 +451,10 @@ private:
 
   AliasSet &addPointer(Value *P, uint64_t Size, const AAMDNodes &AAInfo,
                        AliasSet::AccessType E,
-                       bool &NewSet) {
-    NewSet = false;
-    AliasSet &AS = getAliasSetForPointer(P, Size, AAInfo, &NewSet);
-    AS.AccessTy |= E;
-    return AS;
-  }
+                       bool &NewSet);
+  AliasSet &mergeAllAliasSets();
+  bool areTagsDisjoint(const Value *Ptr, const AAMDNodes &AAInfoA,
+                       const AAMDNodes &AAInfoB) const;
   AliasSet *findAliasSetForPointer(const Value *Ptr, uint64_t Size,
                                    const AAMDNodes &AAInfo);
 
@@ -23,6 +23,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Mutex.h"
 #include <memory>
 
 namespace llvm {
@@ -116,6 +117,10 @@ class AssumptionCacheTracker : public ImmutablePass {
                    FunctionCallbackVH::DMI> FunctionCallsMap;
   FunctionCallsMap AssumptionCaches;
 
+  /// The caches of different functions may be looked up from several threads
+  /// at once, see ImmutablePass::createConcurrentInstance.
+  sys::SmartMutex<true> CachesLock;
+
 public:
   /// \brief Get the cached assumptions for a function.
   ///
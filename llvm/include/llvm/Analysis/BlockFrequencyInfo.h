@@ -38,6 +38,10 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new BlockFrequencyInfo();
+  }
+
   bool runOnFunction(Function &F) override;
   void releaseMemory() override;
   void print(raw_ostream &O, const Module *M) const override;
@@ -37,6 +37,9 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   void releaseMemory() override;
   bool runOnFunction(Function &F) override;
+  FunctionPass *createConcurrentInstance() const override {
+    return new FunctionTargetTransformInfo();
+  }
 
   // Shimmed functions from TargetTransformInfo.
   void
@@ -639,6 +639,10 @@ public:
     initializeLoopInfoPass(*PassRegistry::getPassRegistry());
   }
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new LoopInfo();
+  }
+
   LoopInfoBase<BasicBlock, Loop>& getBase() { return LI; }
 
   /// iterator/begin/end - The interface to the top-level loops in the current
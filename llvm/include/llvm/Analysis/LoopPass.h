@@ -51,6 +51,12 @@ public:
   // loop nest is completely different.
   virtual bool doFinalization() { return false; }
 
+  /// createConcurrentInstance - Return a new instance of this pass, set up
+  /// like this one, for the instance of its loop pass manager on a thread of
+  /// its own, or null if the pass does not support it.  See
+  /// FunctionPass::createConcurrentInstance.
+  virtual LoopPass *createConcurrentInstance() const { return nullptr; }
+
   // Check if this pass is suitable for the current LPPassManager, if
   // available. This pass P is not suitable for a LPPassManager if P
   // is not preserving higher level analysis info used by other
@@ -106,6 +112,9 @@ public:
   // LPPassManager needs LoopInfo.
   void getAnalysisUsage(AnalysisUsage &Info) const override;
 
+  /// Return a manager of instances of the loop passes, if they all have one.
+  FunctionPass *createConcurrentInstance() const override;
+
   const char *getPassName() const override {
     return "Loop Pass Manager";
   }
@@ -0,0 +1,425 @@
+//===- llvm/Analysis/MemorySSA.h - Memory SSA form --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the MemorySSA analysis, which puts the memory
+// operations of a function in SSA form, treating all of memory as a single
+// variable:
+//
+//  - Each instruction that may write memory is a MemoryDef, a new version of
+//    memory defined on top of the version it clobbers.
+//  - Each instruction that may only read memory is a MemoryUse of the version
+//    it reads.
+//  - Each block where several versions meet starts with a MemoryPhi.
+//
+// The form is built once per function, with a single pass over the
+// instructions and no alias queries beyond classifying calls.  Unlike the
+// block scans of MemoryDependenceAnalysis, walking it only visits memory
+// operations, so there is no scan limit to run into.  The MemorySSAWalker
+// then finds the access actually clobbering a location, skipping the
+// definitions alias analysis proves unrelated and caching what it finds.
+//
+// Passes keep the form up to date as they delete instructions through
+// removeInstruction.  MemorySSAWrapperPass computes it for passes that do not
+// change the CFG; others build a MemorySSA themselves once the CFG is final.
+//
+// Printing looks like this:
+//
+//   entry:
+//   ; 1 = MemoryDef(liveOnEntry)
+//     store i32 0, i32* %p
+//   ; MemoryUse(1)
+//     %v = load i32* %q
+//     ...
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ilist.h"
+#include "llvm/ADT/ilist_node.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Pass.h"
+#include <memory>
+
+namespace llvm {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class MemoryAccess;
+class MemorySSAWalker;
+class raw_ostream;
+
+/// MemoryAccessUse - The use one memory access makes of another: the defining
+/// access of a MemoryUse or MemoryDef, or an incoming access of a MemoryPhi.
+/// The uses of an access are chained so that its users can be enumerated.
+class MemoryAccessUse {
+  MemoryAccess *Val;
+  MemoryAccess *User;
+  MemoryAccessUse *Next;
+  MemoryAccessUse **Prev;
+
+  MemoryAccessUse(const MemoryAccessUse &) LLVM_DELETED_FUNCTION;
+  void operator=(const MemoryAccessUse &) LLVM_DELETED_FUNCTION;
+
+  void addToList(MemoryAccessUse **List);
+  void removeFromList();
+
+  friend class MemoryAccess;
+  friend class MemoryPhi;
+
+public:
+  explicit MemoryAccessUse(MemoryAccess *User = nullptr)
+      : Val(nullptr), User(User), Next(nullptr), Prev(nullptr) {}
+  ~MemoryAccessUse() { set(nullptr); }
+
+  MemoryAccess *get() const { return Val; }
+  MemoryAccess *getUser() const { return User; }
+  MemoryAccessUse *getNext() const { return Next; }
+
+  /// set - Make this use refer to V instead, which may be null.
+  void set(MemoryAccess *V);
+};
+
+/// MemoryAccess - A node of the memory SSA form: the MemoryUse or MemoryDef of
+/// an instruction, or the MemoryPhi starting a block.
+class MemoryAccess : public ilist_node<MemoryAccess> {
+public:
+  enum AccessKind { MemoryUseKind, MemoryDefKind, MemoryPhiKind };
+
+  virtual ~MemoryAccess();
+
+  AccessKind getKind() const { return Kind; }
+  BasicBlock *getBlock() const { return Block; }
+
+  /// user_iterator - Enumerates the accesses using this one, most recently
+  /// added first.
+  class user_iterator
+      : public std::iterator<std::forward_iterator_tag, MemoryAccess *> {
+    MemoryAccessUse *U;
+
+  public:
+    explicit user_iterator(MemoryAccessUse *U = nullptr) : U(U) {}
+    bool operator==(const user_iterator &RHS) const { return U == RHS.U; }
+    bool operator!=(const user_iterator &RHS) const { return U != RHS.U; }
+    MemoryAccess *operator*() const { return U->getUser(); }
+    user_iterator &operator++() {
+      U = U->getNext();
+      return *this;
+    }
+    user_iterator operator++(int) {
+      user_iterator Tmp = *this;
+      ++*this;
+      return Tmp;
+    }
+  };
+
+  user_iterator user_begin() const { return user_iterator(UseList); }
+  user_iterator user_end() const { return user_iterator(); }
+  iterator_range<user_iterator> users() const {
+    return iterator_range<user_iterator>(user_begin(), user_end());
+  }
+  bool use_empty() const { return !UseList; }
+
+  /// replaceAllUsesWith - Make every access using this one use New instead.
+  void replaceAllUsesWith(MemoryAccess *New);
+
+  /// getID - Return the number of the memory version this access defines, or
+  /// 0 for MemoryUses and the live on entry definition.
+  virtual unsigned getID() const { return 0; }
+
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+
+  /// printID - Print how this access is referred to by its users.
+  void printID(raw_ostream &OS) const;
+
+protected:
+  MemoryAccess(AccessKind Kind, BasicBlock *BB)
+      : Kind(Kind), Block(BB), UseList(nullptr) {}
+
+private:
+  AccessKind Kind;
+  BasicBlock *Block;
+  MemoryAccessUse *UseList;
+
+  friend class MemoryAccessUse;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// MemoryUseOrDef - The access of an instruction, along with the version of
+/// memory it reads or clobbers.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  Instruction *getMemoryInst() const { return MemoryInst; }
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess.get(); }
+  void setDefiningAccess(MemoryAccess *DA) { DefiningAccess.set(DA); }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind || MA->getKind() == MemoryDefKind;
+  }
+
+protected:
+  MemoryUseOrDef(AccessKind Kind, Instruction *MI, BasicBlock *BB)
+      : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(this) {}
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccessUse DefiningAccess;
+};
+
+/// MemoryUse - The access of an instruction that may read memory but does
+/// not write it.
+class MemoryUse : public MemoryUseOrDef {
+public:
+  MemoryUse(Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(MemoryUseKind, MI, BB) {}
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind;
+  }
+};
+
+/// MemoryDef - The access of an instruction that may write memory, defining
+/// a new version of it.  The live on entry definition has no instruction.
+class MemoryDef : public MemoryUseOrDef {
+public:
+  MemoryDef(Instruction *MI, BasicBlock *BB, unsigned ID = 0)
+      : MemoryUseOrDef(MemoryDefKind, MI, BB), ID(ID) {}
+
+  unsigned getID() const override { return ID; }
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryDefKind;
+  }
+
+private:
+  unsigned ID;
+
+  friend class MemorySSA;
+};
+
+/// MemoryPhi - The version of memory at the start of a block where the
+/// versions coming from its predecessors meet.  Like a PHINode, it has an
+/// incoming access per edge into the block.
+class MemoryPhi : public MemoryAccess {
+public:
+  MemoryPhi(BasicBlock *BB, ArrayRef<BasicBlock *> Preds, unsigned ID = 0);
+
+  unsigned getNumIncomingValues() const { return Blocks.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const {
+    return Incoming[I].get();
+  }
+  void setIncomingValue(unsigned I, MemoryAccess *V) { Incoming[I].set(V); }
+  BasicBlock *getIncomingBlock(unsigned I) const { return Blocks[I]; }
+
+  unsigned getID() const override { return ID; }
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryPhiKind;
+  }
+
+private:
+  SmallVector<BasicBlock *, 4> Blocks;
+  std::unique_ptr<MemoryAccessUse[]> Incoming;
+  unsigned ID;
+
+  friend class MemorySSA;
+};
+
+template <>
+struct ilist_traits<MemoryAccess> : public ilist_default_traits<MemoryAccess> {
+private:
+  mutable ilist_half_node<MemoryAccess> Sentinel;
+
+public:
+  MemoryAccess *createSentinel() const {
+    return static_cast<MemoryAccess *>(&Sentinel);
+  }
+  static void destroySentinel(MemoryAccess *) {}
+
+  MemoryAccess *provideInitialHead() const { return createSentinel(); }
+  MemoryAccess *ensureHead(MemoryAccess *) const { return createSentinel(); }
+  static void noteHead(MemoryAccess *, MemoryAccess *) {}
+
+private:
+  static void createNode(const MemoryAccess &);
+};
+
+/// MemorySSA - The memory SSA form of a function.  Passes changing the CFG
+/// before they query it build their own rather than requiring
+/// MemorySSAWrapperPass.
+class MemorySSA {
+public:
+  typedef iplist<MemoryAccess> AccessListType;
+
+  MemorySSA(Function &F, AliasAnalysis &AA, DominatorTree &DT);
+  ~MemorySSA();
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+  /// verifyMemorySSA - Check that every access is dominated by the accesses
+  /// it uses, and that MemoryPhis match the predecessors of their block.
+  void verifyMemorySSA() const;
+
+  /// getWalker - Return the walker finding the accesses that actually clobber
+  /// a location.
+  MemorySSAWalker *getWalker() const { return Walker.get(); }
+
+  /// getMemoryAccess - Return the MemoryUse or MemoryDef of I, or null if it
+  /// does not access memory.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const;
+
+  /// getMemoryAccess - Return the MemoryPhi starting BB, if any.
+  MemoryPhi *getMemoryAccess(const BasicBlock *BB) const;
+
+  /// getBlockAccesses - Return the accesses of BB in order, starting with its
+  /// MemoryPhi if any, or null if it has none.
+  const AccessListType *getBlockAccesses(const BasicBlock *BB) const;
+
+  /// getLiveOnEntryDef - Return the definition of memory as it is on entry to
+  /// the function.  It belongs to no block list and has no instruction.
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  /// dominates - Return true if A comes before B on every path reaching B.
+  /// Accesses of a block are ordered as they appear in it, MemoryPhi first.
+  bool dominates(const MemoryAccess *A, const MemoryAccess *B) const;
+
+  /// removeInstruction - Remove I from the form before it is erased.  The
+  /// users of its MemoryDef use the access it clobbered instead.  Must be
+  /// called for every erased instruction, memory accessing or not, since
+  /// the walker caches results by pointer.
+  void removeInstruction(Instruction *I);
+
+  /// updateForSplitEdge - Update the form after the edge from Pred to Succ
+  /// was split by NewBB, which does not access memory.  Like the PHINodes of
+  /// Succ, its MemoryPhi comes in through NewBB instead of Pred on one edge.
+  void updateForSplitEdge(BasicBlock *Pred, BasicBlock *Succ,
+                          BasicBlock *NewBB);
+
+  AliasAnalysis &getAliasAnalysis() const { return *AA; }
+  DominatorTree &getDomTree() const { return *DT; }
+
+private:
+  Function &F;
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+
+  DenseMap<const Instruction *, MemoryUseOrDef *> InstructionToAccess;
+  DenseMap<const BasicBlock *, MemoryPhi *> BlockToPhi;
+  DenseMap<const BasicBlock *, std::unique_ptr<AccessListType> >
+      PerBlockAccesses;
+  std::unique_ptr<MemoryDef> LiveOnEntryDef;
+  std::unique_ptr<MemorySSAWalker> Walker;
+
+  /// Positions of the accesses within their block, computed lazily for the
+  /// blocks dominates is asked about.  Removing accesses keeps them ordered.
+  mutable DenseMap<const MemoryAccess *, unsigned> BlockOrder;
+  mutable DenseSet<const BasicBlock *> OrderedBlocks;
+
+  AccessListType *getWritableBlockAccesses(const BasicBlock *BB) const;
+  AccessListType &getOrCreateAccessList(const BasicBlock *BB);
+  MemoryUseOrDef *createMemoryAccess(Instruction *I);
+  void placePHINodes(const SmallPtrSetImpl<BasicBlock *> &DefiningBlocks);
+  void renamePass();
+  void numberAccesses();
+  bool locallyDominates(const MemoryAccess *A, const MemoryAccess *B) const;
+
+  MemorySSA(const MemorySSA &) LLVM_DELETED_FUNCTION;
+  void operator=(const MemorySSA &) LLVM_DELETED_FUNCTION;
+};
+
+/// MemorySSAWrapperPass - Builds the memory SSA form of each function, for
+/// passes that do not change the CFG before querying it, and for printing
+/// it with -analyze.
+class MemorySSAWrapperPass : public FunctionPass {
+  std::unique_ptr<MemorySSA> MSSA;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MemorySSAWrapperPass();
+
+  MemorySSA &getMSSA() const { return *MSSA; }
+
+  bool runOnFunction(Function &F) override;
+  void releaseMemory() override { MSSA.reset(); }
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+  void print(raw_ostream &OS, const Module *M = nullptr) const override;
+  void verifyAnalysis() const override;
+};
+
+/// MemorySSAWalker - Finds, for a memory location, the access that actually
+/// clobbers it, walking up the definitions that may clobber the location
+/// according to alias analysis.  Results are cached until the form changes.
+class MemorySSAWalker {
+public:
+  explicit MemorySSAWalker(MemorySSA &MSSA);
+
+  /// getClobberingMemoryAccess - Return the access clobbering the memory I
+  /// reads or writes: the nearest dominating MemoryDef that may write it, a
+  /// MemoryPhi where several such definitions meet, or the live on entry
+  /// definition.  Only simple loads and stores are walked past their defining
+  /// access.  Returns null if I does not access memory.
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *I);
+
+  /// getClobberingMemoryAccess - Return the access clobbering Loc, starting
+  /// from Start itself.
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                          const AliasAnalysis::Location &Loc);
+
+  /// invalidateInfo - Forget everything, after definitions were removed.
+  void invalidateInfo() {
+    Cache.clear();
+    CachedPointers.clear();
+  }
+
+  /// invalidatePointer - Forget the results about Ptr, which is going away.
+  void invalidatePointer(const Value *Ptr) {
+    if (CachedPointers.count(Ptr))
+      invalidateInfo();
+  }
+
+private:
+  MemorySSA &MSSA;
+  AliasAnalysis &AA;
+
+  typedef std::pair<const MemoryAccess *, AliasAnalysis::Location> CacheKey;
+  DenseMap<CacheKey, MemoryAccess *> Cache;
+  DenseSet<const Value *> CachedPointers;
+
+  /// The MemoryPhis being walked, which paths reaching back to them skip.
+  SmallPtrSet<const MemoryPhi *, 8> PhisInProgress;
+
+  MemoryAccess *walk(MemoryAccess *Start, const AliasAnalysis::Location &Loc,
+                     unsigned Depth);
+  MemoryAccess *walkPhi(MemoryPhi *Phi, const AliasAnalysis::Location &Loc,
+                        unsigned Depth);
+};
+
+} // End llvm namespace
+
+#endif
@@ -44,6 +44,13 @@ namespace llvm {
   //
   ModulePass *createAliasAnalysisCounterPass();
 
+  //===--------------------------------------------------------------------===//
+  //
+  // createAliasAnalysisProfilerPass - This pass profiles the alias queries of
+  // each client pass and the time each alias analysis spends answering them.
+  //
+  ModulePass *createAliasAnalysisProfilerPass();
+
   //===--------------------------------------------------------------------===//
   //
   // createAAEvalPass - This pass implements a simple N^2 alias analysis
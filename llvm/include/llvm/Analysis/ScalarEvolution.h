@@ -919,6 +919,9 @@ namespace llvm {
     void getAnalysisUsage(AnalysisUsage &AU) const override;
     void print(raw_ostream &OS, const Module* = nullptr) const override;
     void verifyAnalysis() const override;
+    FunctionPass *createConcurrentInstance() const override {
+      return new ScalarEvolution();
+    }
 
   private:
     /// Compute the backedge taken count knowing the interval difference, the
@@ -128,6 +128,11 @@ public:
     assert(!hasBlockInfoRecords());
     BlockInfoRecords = std::move(Other.BlockInfoRecords);
   }
+
+  /// Copies the block info of the other bitstream reader.  The abbreviations
+  /// are copied too, so that the two readers can be used on different
+  /// threads.
+  void copyBlockInfo(const BitstreamReader &Other);
 };
 
 /// When advancing through a bitstream cursor, each advance can discover a few
@@ -0,0 +1,47 @@
+//===-- llvm/CodeGen/ParallelCG.h - Parallel code generation ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header declares functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_PARALLELCG_H
+#define LLVM_CODEGEN_PARALLELCG_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Target/TargetMachine.h"
+#include <functional>
+#include <string>
+
+namespace llvm {
+
+class Module;
+class PassManagerBase;
+class raw_ostream;
+
+/// splitCodeGen - Split M into OSs.size() partitions (see SplitModule) and
+/// generate code for each of them on its own thread, writing the output of
+/// the I-th partition to OSs[I].  Linked together, the outputs are equivalent
+/// to the output generated for M, and they do not depend on the scheduling of
+/// the threads.  M is modified by the splitting.
+///
+/// Every partition is compiled in a context of its own, by a target machine
+/// returned by CreateTargetMachine, with the passes added by AddPasses ahead
+/// of the code generator.  Diagnostics are passed on to the diagnostic
+/// handler of M's context, if it has one.  Returns true and sets ErrMsg on
+/// failure.
+bool splitCodeGen(Module &M, ArrayRef<raw_ostream *> OSs,
+                  const std::function<TargetMachine *()> &CreateTargetMachine,
+                  TargetMachine::CodeGenFileType FileType, bool DisableVerify,
+                  const std::function<void(PassManagerBase &)> &AddPasses,
+                  std::string &ErrMsg);
+
+} // End llvm namespace
+
+#endif
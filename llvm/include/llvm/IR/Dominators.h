@@ -217,6 +217,10 @@ public:
   DominatorTree &getDomTree() { return DT; }
   const DominatorTree &getDomTree() const { return DT; }
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new DominatorTreeWrapperPass();
+  }
+
   bool runOnFunction(Function &F) override;
 
   void verifyAnalysis() const override;
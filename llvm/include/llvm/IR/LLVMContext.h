@@ -158,6 +158,21 @@ public:
   /// any global mutex or cannot block the execution in another LLVM context.
   void yield();
 
+  /// setThreadShared - Tell the context whether several threads may work on
+  /// different functions of its modules at the same time.  While they may, the
+  /// context serializes changes to what those functions share: type, constant,
+  /// attribute and metadata uniquing, the use lists of constants and globals,
+  /// value handles, instruction metadata, and the symbol tables of modules.
+  /// Each function must still only be used by one thread at a time, globals may
+  /// not be erased, and reads of shared use lists are not synchronized, so
+  /// answers such as whether a constant has one use may change as other
+  /// threads run.  yield() does nothing while the context is shared.
+  void setThreadShared(bool Shared);
+
+  /// isThreadShared - Return true if several threads may be working on
+  /// functions of the context, see setThreadShared.
+  bool isThreadShared() const;
+
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
   /// be prepared to drop the erroneous construct on the floor and "not crash".
@@ -118,16 +118,21 @@ class PassManagerPrettyStackEntry : public PrettyStackTraceEntry {
   Pass *P;
   Value *V;
   Module *M;
+  Pass *PrevRunningPass;
 public:
   explicit PassManagerPrettyStackEntry(Pass *p)
-    : P(p), V(nullptr), M(nullptr) {}  // When P is releaseMemory'd.
-  PassManagerPrettyStackEntry(Pass *p, Value &v)
-    : P(p), V(&v), M(nullptr) {} // When P is run on V
-  PassManagerPrettyStackEntry(Pass *p, Module &m)
-    : P(p), V(nullptr), M(&m) {} // When P is run on M
+    : P(p), V(nullptr), M(nullptr),
+      PrevRunningPass(nullptr) {}  // When P is releaseMemory'd.
+  PassManagerPrettyStackEntry(Pass *p, Value &v); // When P is run on V
+  PassManagerPrettyStackEntry(Pass *p, Module &m); // When P is run on M
+  ~PassManagerPrettyStackEntry();
 
   /// print - Emit information about this stack frame to OS.
   void print(raw_ostream &OS) const override;
+
+  /// getRunningPass - Return the innermost pass being run on the current
+  /// thread, or null if there is none.
+  static Pass *getRunningPass();
 };
 
 
@@ -201,6 +206,19 @@ public:
   /// Find analysis usage information for the pass P.
   AnalysisUsage *findAnalysisUsage(Pass *P);
 
+  /// Find the immutable pass that implements Analysis AID, without looking at
+  /// the pass managers.  If desired pass is not found then return NULL.
+  ImmutablePass *findImmutablePass(AnalysisID AID) const;
+
+  /// Set up the concurrent instances of passes, keyed by the pass they were
+  /// created from, to be run like their originals: find their analysis usage,
+  /// and make them the last users of the instances their originals are the
+  /// last user of.  See FPPassManager::runConcurrently.
+  void addConcurrentInstances(const DenseMap<Pass *, Pass *> &Instances);
+
+  /// Forget the concurrent instances again, before they are deleted.
+  void removeConcurrentInstances(const DenseMap<Pass *, Pass *> &Instances);
+
   virtual ~PMTopLevelManager();
 
   /// Add immutable pass and initialize it.
@@ -272,7 +290,9 @@ private:
 class PMDataManager {
 public:
 
-  explicit PMDataManager() : TPM(nullptr), Depth(0) {
+  explicit PMDataManager()
+      : TPM(nullptr), IsConcurrent(false), ConcurrentParent(nullptr),
+        Depth(0) {
     initializeAnalysisInfo();
   }
 
@@ -289,6 +309,10 @@ public:
   /// Remove Analysis that is not preserved by the pass
   void removeNotPreservedAnalysis(Pass *P);
 
+  /// Tell the immutable passes that F, or any function of the module if F is
+  /// null, was modified by the pass that just ran.
+  virtual void invalidateImmutablePasses(Function *F);
+
   /// Remove dead passes used by P.
   void removeDeadPasses(Pass *P, StringRef Msg,
                         enum PassDebuggingString);
@@ -335,7 +359,7 @@ public:
 
   /// Find the pass that implements Analysis AID. If desired pass is not found
   /// then return NULL.
-  Pass *findAnalysisPass(AnalysisID AID, bool Direction);
+  virtual Pass *findAnalysisPass(AnalysisID AID, bool Direction);
 
   // Access toplevel manager
   PMTopLevelManager *getTopLevelManager() { return TPM; }
@@ -344,6 +368,14 @@ public:
   unsigned getDepth() const { return Depth; }
   void setDepth(unsigned newDepth) { Depth = newDepth; }
 
+  /// Make this manager an instance running on a thread of its own, see
+  /// FPPassManager::runConcurrently.  It then only inherits the analyses of
+  /// Parent, if any, and leaves searching other managers to it.
+  void setConcurrentParent(PMDataManager *Parent) {
+    IsConcurrent = true;
+    ConcurrentParent = Parent;
+  }
+
   // Print routines used by debug-pass
   void dumpLastUses(Pass *P, unsigned Offset) const;
   void dumpPassArguments() const;
@@ -356,6 +388,8 @@ public:
     return (unsigned)PassVector.size();
   }
 
+  ArrayRef<Pass *> getContainedPasses() const { return PassVector; }
+
   virtual PassManagerType getPassManagerType() const {
     assert ( 0 && "Invalid use of getPassManagerType");
     return PMT_Unknown;
@@ -367,6 +401,13 @@ public:
 
   // Collect AvailableAnalysis from all the active Pass Managers.
   void populateInheritedAnalysis(PMStack &PMS) {
+    if (IsConcurrent) {
+      for (unsigned i = 0; i < PMT_Last; ++i)
+        InheritedAnalysis[i] = nullptr;
+      if (ConcurrentParent)
+        InheritedAnalysis[0] = ConcurrentParent->getAvailableAnalysis();
+      return;
+    }
     unsigned Index = 0;
     for (PMStack::iterator I = PMS.begin(), E = PMS.end();
          I != E; ++I)
@@ -381,6 +422,11 @@ protected:
   // Collection of pass that are managed by this manager
   SmallVector<Pass *, 16> PassVector;
 
+  // Set if this manager runs on a thread of its own, with the manager it is
+  // nested in on that thread, if any.
+  bool IsConcurrent;
+  PMDataManager *ConcurrentParent;
+
   // Collection of Analysis provided by Parent pass manager and
   // used by current pass manager. At at time there can not be more
   // then PMT_Last active pass mangers.
@@ -425,6 +471,10 @@ public:
   bool runOnFunction(Function &F);
   bool runOnModule(Module &M) override;
 
+  /// Functions are materialized one at a time, right before the passes run
+  /// on them.
+  bool materializesFunctions() const override { return true; }
+
   /// cleanup - After running all passes, clean up pass manager cache.
   void cleanup();
 
@@ -470,6 +520,13 @@ public:
   PassManagerType getPassManagerType() const override {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// runConcurrently - Run the passes on the functions of M from several
+  /// threads, each using its own instances of the passes, while the context
+  /// of M is thread shared.  Return false, without running anything, if some
+  /// pass has no concurrent instance, or requires a module level analysis.
+  bool runConcurrently(Module &M, bool &Changed);
 };
 
 Timer *getPassTimer(Pass *);
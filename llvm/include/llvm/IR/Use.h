@@ -29,6 +29,7 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
+#include <atomic>
 #include <cstddef>
 #include <iterator>
 
@@ -81,8 +82,12 @@ private:
 
   /// Destructor - Only for zap()
   ~Use() {
-    if (Val)
-      removeFromList();
+    if (Val) {
+      if (LLVM_UNLIKELY(ThreadSharedContexts.load(std::memory_order_relaxed)))
+        setLocked(nullptr);
+      else
+        removeFromList();
+    }
   }
 
   enum PrevPtrTag { zeroDigitTag, oneDigitTag, stopTag, fullStopTag };
@@ -129,6 +134,13 @@ public:
   /// a User changes.
   static void zap(Use *Start, const Use *Stop, bool del = false);
 
+  /// \brief The number of contexts that several threads may be changing at
+  /// once, see LLVMContext::setThreadShared.
+  ///
+  /// While there are any, changes to the use lists of constants, globals and
+  /// other values shared between functions take the lock of their context.
+  static std::atomic<unsigned> ThreadSharedContexts;
+
 private:
   const Use *getImpliedUser() const;
 
@@ -137,6 +149,7 @@ private:
   PointerIntPair<Use **, 2, PrevPtrTag> Prev;
 
   void setPrev(Use **NewPrev) { Prev.setPointer(NewPrev); }
+  void setLocked(Value *V);
   void addToList(Use **List) {
     Next = *List;
     if (Next)
@@ -50,6 +50,7 @@ namespace llvm {
   class GlobalValue;
   class Mangler;
   class MemoryBuffer;
+  class Target;
   class TargetLibraryInfo;
   class TargetMachine;
   class raw_ostream;
@@ -117,6 +118,19 @@ struct LTOCodeGenerator {
                       bool disableVectorization,
                       std::string &errMsg);
 
+  // Optimize the merged module.  Return true on success.
+  bool optimize(bool disableOpt,
+                bool disableInline,
+                bool disableGVNLoadPRE,
+                bool disableVectorization,
+                std::string &errMsg);
+
+  // Compile the optimized merged module into one object file per stream in
+  // Out.  With several streams, the module is split and the parts are
+  // compiled in parallel (see splitCodeGen); the resulting objects are meant
+  // to be linked together.  Return true on success.
+  bool compileOptimized(ArrayRef<raw_ostream *> Out, std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -133,6 +147,7 @@ private:
                         SmallPtrSetImpl<GlobalValue *> &AsmUsed,
                         Mangler &Mangler);
   bool determineTarget(std::string &errMsg);
+  TargetMachine *createTargetMachine();
 
   static void DiagnosticHandler(const DiagnosticInfo &DI, void *Context);
 
@@ -144,6 +159,8 @@ private:
   std::unique_ptr<LLVMContext> OwnedContext;
   LLVMContext &Context;
   Linker IRLinker;
+  const Target *MArch;
+  std::string FeatureStr;
   TargetMachine *TargetMach;
   bool EmitDwarfDebugInfo;
   bool ScopeRestrictionsDone;
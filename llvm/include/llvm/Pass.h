@@ -243,6 +243,12 @@ public:
   /// being operated on.
   virtual bool runOnModule(Module &M) = 0;
 
+  /// materializesFunctions - Return true if this pass materializes the
+  /// bodies of the functions it looks at itself, and can therefore run on a
+  /// module that is still being read lazily.  Before running any other
+  /// module pass, the pass manager materializes the whole module.
+  virtual bool materializesFunctions() const { return false; }
+
   void assignPassManager(PMStack &PMS, PassManagerType T) override;
 
   ///  Return what kind of Pass Manager can manage this pass.
@@ -269,6 +275,29 @@ public:
   ///
   virtual void initializePass();
 
+  /// invalidateCachedInfo - This method may be overriden by immutable passes
+  /// that keep information about the IR across queries.  The pass manager
+  /// calls it after a pass modified F, or with a null F after a pass that may
+  /// have modified any function of the module.
+  ///
+  virtual void invalidateCachedInfo(Function *F);
+
+  /// createConcurrentInstance - Return a new instance of this pass, set up
+  /// like this one, for a thread running function passes on some functions
+  /// while other threads run them on others, or null to have all threads share
+  /// this instance.  A shared pass answers queries from several threads at
+  /// once, and any of them may call invalidateCachedInfo.  Instances are set up
+  /// with initializePass, and queried only about the functions of their thread.
+  ///
+  virtual ImmutablePass *createConcurrentInstance() const { return nullptr; }
+
+  /// isThreadSafe - Return false if neither sharing this pass nor instances of
+  /// it would be safe while threads run function passes on different functions,
+  /// for example because it looks at other functions than it is asked about.
+  /// Function passes then stay serial while the pass is in use.
+  ///
+  virtual bool isThreadSafe() const { return true; }
+
   ImmutablePass *getAsImmutablePass() override { return this; }
 
   /// ImmutablePasses are never run.
@@ -304,6 +333,17 @@ public:
   ///
   virtual bool runOnFunction(Function &F) = 0;
 
+  /// createConcurrentInstance - Return a new instance of this pass, set up
+  /// like this one, to run on some functions of a module while other
+  /// instances run on other functions, or null if the pass does not support
+  /// it.  An instance may change the function it runs on, and create types,
+  /// constants, metadata and declarations, see LLVMContext::setThreadShared,
+  /// but must not change other functions or erase globals.  Its results may
+  /// not depend on the order it sees functions in.  The analyses it uses are
+  /// instances of their own in the same thread, or shared immutable passes.
+  /// Only this pass sees doInitialization and doFinalization.
+  virtual FunctionPass *createConcurrentInstance() const { return nullptr; }
+
   void assignPassManager(PMStack &PMS, PassManagerType T) override;
 
   ///  Return what kind of Pass Manager can manage this pass.
@@ -0,0 +1,30 @@
+//===- llvm/Support/JSONString.h - Write JSON string literals ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares writeJSONString, for the passes and tools that write
+// reports in JSON.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_JSONSTRING_H
+#define LLVM_SUPPORT_JSONSTRING_H
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+/// writeJSONString - Write S to OS as a quoted JSON string, escaping quotes,
+/// backslashes and control characters.  Other bytes are written as they are.
+void writeJSONString(raw_ostream &OS, StringRef S);
+
+} // End llvm namespace
+
+#endif
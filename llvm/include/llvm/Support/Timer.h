@@ -106,7 +106,9 @@ public:
   
   /// startTimer - Start the timer running.  Time between calls to
   /// startTimer/stopTimer is counted by the Timer class.  Note that these calls
-  /// must be correctly paired.
+  /// must be correctly paired.  Several threads may run the same timer at once,
+  /// in which case the times they measure add up, so the total may exceed the
+  /// time that elapsed.
   ///
   void startTimer();
 
@@ -14,7 +14,9 @@
 #ifndef LLVM_TRANSFORMS_INSTRUMENTATION_H
 #define LLVM_TRANSFORMS_INSTRUMENTATION_H
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include <string>
 
 #if defined(__GNUC__) && defined(__linux__) && !defined(ANDROID)
 inline void *getDFSanArgTLSPtrForJIT() {
@@ -34,6 +36,8 @@ namespace llvm {
 
 class ModulePass;
 class FunctionPass;
+class Function;
+class CallInst;
 
 // Insert GCOV profiling instrumentation
 struct GCOVOptions {
@@ -75,6 +79,23 @@ struct InstrProfOptions {
 ModulePass *createInstrProfilingPass(
     const InstrProfOptions &Options = InstrProfOptions());
 
+/// Argument overlap profiles count, for some calls of each function F, how
+/// many times the call ran and how many of those its pointer arguments
+/// overlapped. They are stored in instrumentation profiles, under
+/// getArgOverlapProfileName(F), with two counters per call returned by
+/// collectArgOverlapCallSites(F).  The names of local functions include the
+/// module identifier, as in "__arg_overlap.<module>:<function>".
+std::string getArgOverlapProfileName(const Function &F);
+
+/// Collect the calls of F that argument overlap profiles have counters for:
+/// direct calls to definitions passing two or more pointers.
+void collectArgOverlapCallSites(Function &F,
+                                SmallVectorImpl<CallInst *> &Calls);
+
+/// Attach the counts of an argument overlap profile to the calls they were
+/// collected at, as !arg.overlap metadata.
+ModulePass *createArgOverlapProfileUsePass(StringRef Filename = StringRef());
+
 // Insert AddressSanitizer (address sanity checking) instrumentation
 FunctionPass *createAddressSanitizerFunctionPass();
 ModulePass *createAddressSanitizerModulePass();
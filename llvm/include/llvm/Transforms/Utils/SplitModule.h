@@ -0,0 +1,44 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+
+/// Splits the module M into N linkable partitions and calls ModuleCallback
+/// with each of them, in order.  Linked together, the code generated for the
+/// partitions is equivalent to the code generated for M.
+///
+/// Every global definition lands in exactly one partition; the others only
+/// declare it.  Definitions that must stay together (members of a comdat,
+/// aliases and their aliasee, functions whose blocks are addressed) are kept
+/// together, and a symbol with local linkage is kept with its users as long
+/// as the partitions stay balanced.  The splitting is deterministic.
+///
+/// Local symbols that end up referenced from other partitions are given
+/// hidden visibility and a name unique to M, which is why M is modified.
+void SplitModule(
+    Module &M, unsigned N,
+    const std::function<void(std::unique_ptr<Module> MPart)> &ModuleCallback);
+
+} // End llvm namespace
+
+#endif
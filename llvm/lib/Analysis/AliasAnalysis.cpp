@@ -25,6 +25,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/AAQueryObserver.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -37,6 +38,9 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 using namespace llvm;
 
@@ -51,7 +55,34 @@ char AliasAnalysis::ID = 0;
 AliasAnalysis::AliasResult
 AliasAnalysis::alias(const Location &LocA, const Location &LocB) {
   assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
-  return AA->alias(LocA, LocB);
+  AAQueryObserver *Top = AAQueryObserver::getTop();
+  if (!Top)
+    return AA->alias(LocA, LocB);
+
+  for (AAQueryObserver *O = Top; O; O = O->Prev)
+    O->enter(*AA);
+  AliasResult R = AA->alias(LocA, LocB);
+  for (AAQueryObserver *O = Top; O; O = O->Prev)
+    O->leave(*AA, R);
+  return R;
+}
+
+void AliasAnalysis::aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) {
+  assert(Locs.size() == Matrix.getNumLocations() && "Bad matrix size!");
+  for (unsigned I = 1, E = Locs.size(); I < E; ++I)
+    for (unsigned J = 0; J != I; ++J) {
+      if (Matrix.isComplete())
+        return;
+      if (!Matrix.isKnown(I, J))
+        Matrix.set(I, J, alias(Locs[I], Locs[J]));
+    }
+}
+
+void AliasAnalysis::forwardAliasBatch(ArrayRef<Location> Locs,
+                                      AliasMatrix &Matrix) {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  if (!Matrix.isComplete())
+    AA->aliasBatch(Locs, Matrix);
 }
 
 bool AliasAnalysis::pointsToConstantMemory(const Location &Loc,
@@ -467,6 +498,43 @@ void AliasAnalysis::InitializeAliasAnalysis(Pass *P) {
   DL = DLP ? &DLP->getDataLayout() : nullptr;
   TLI = P->getAnalysisIfAvailable<TargetLibraryInfo>();
   AA = &P->getAnalysis<AliasAnalysis>();
+  ImplPass = P;
+}
+
+//===----------------------------------------------------------------------===//
+// AAQueryObserver methods
+//===----------------------------------------------------------------------===//
+
+static ManagedStatic<sys::ThreadLocal<AAQueryObserver> > TopObserver;
+
+AAQueryObserver *AAQueryObserver::getTop() {
+  return TopObserver->get();
+}
+
+AAQueryObserver::~AAQueryObserver() {
+  if (Installed)
+    uninstall();
+}
+
+void AAQueryObserver::install() {
+  assert(!Installed && "Observer installed twice!");
+  Prev = getTop();
+  TopObserver->set(this);
+  Installed = true;
+}
+
+void AAQueryObserver::uninstall() {
+  assert(getTop() == this && "Observers must be uninstalled in reverse order!");
+  TopObserver->set(Prev);
+  Prev = nullptr;
+  Installed = false;
+}
+
+StringRef AAQueryObserver::getPassArgumentName(const Pass &P) {
+  const PassInfo *PI = Pass::lookupPassInfo(P.getPassID());
+  if (PI && *PI->getPassArgument())
+    return PI->getPassArgument();
+  return P.getPassName();
 }
 
 // getAnalysisUsage - All alias analysis implementations should invoke this
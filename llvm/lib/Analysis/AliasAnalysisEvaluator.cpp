@@ -45,6 +45,8 @@ static cl::opt<bool> PrintModRef("print-modref", cl::ReallyHidden);
 
 static cl::opt<bool> EvalAAMD("evaluate-aa-metadata", cl::ReallyHidden);
 
+static cl::opt<bool> EvalBatch("evaluate-aa-batch", cl::ReallyHidden);
+
 namespace {
   class AAEval : public FunctionPass {
     unsigned NoAlias, MayAlias, PartialAlias, MustAlias;
@@ -183,44 +185,70 @@ bool AAEval::runOnFunction(Function &F) {
     errs() << "Function: " << F.getName() << ": " << Pointers.size()
            << " pointers, " << CallSites.size() << " call sites\n";
 
+  SmallVector<AliasAnalysis::Location, 16> Locs;
+  for (SetVector<Value *>::iterator I = Pointers.begin(), E = Pointers.end();
+       I != E; ++I) {
+    uint64_t Size = AliasAnalysis::UnknownSize;
+    Type *ElTy = cast<PointerType>((*I)->getType())->getElementType();
+    if (ElTy->isSized()) Size = AA.getTypeStoreSize(ElTy);
+    Locs.push_back(AliasAnalysis::Location(*I, Size));
+  }
+
+  // With -evaluate-aa-batch, answer all the queries with a single batch.
+  AliasAnalysis::AliasMatrix Matrix(EvalBatch ? Locs.size() : 0);
+  if (EvalBatch)
+    AA.aliasBatch(Locs, Matrix);
+
   // iterate over the worklist, and run the full (n^2)/2 disambiguations
-  for (SetVector<Value *>::iterator I1 = Pointers.begin(), E = Pointers.end();
-       I1 != E; ++I1) {
-    uint64_t I1Size = AliasAnalysis::UnknownSize;
-    Type *I1ElTy = cast<PointerType>((*I1)->getType())->getElementType();
-    if (I1ElTy->isSized()) I1Size = AA.getTypeStoreSize(I1ElTy);
-
-    for (SetVector<Value *>::iterator I2 = Pointers.begin(); I2 != I1; ++I2) {
-      uint64_t I2Size = AliasAnalysis::UnknownSize;
-      Type *I2ElTy =cast<PointerType>((*I2)->getType())->getElementType();
-      if (I2ElTy->isSized()) I2Size = AA.getTypeStoreSize(I2ElTy);
-
-      switch (AA.alias(*I1, I1Size, *I2, I2Size)) {
+  for (unsigned Idx1 = 0, E = Pointers.size(); Idx1 != E; ++Idx1) {
+    Value *P1 = Pointers[Idx1];
+    for (unsigned Idx2 = 0; Idx2 != Idx1; ++Idx2) {
+      Value *P2 = Pointers[Idx2];
+      switch (EvalBatch ? Matrix.get(Idx1, Idx2)
+                        : AA.alias(Locs[Idx1], Locs[Idx2])) {
       case AliasAnalysis::NoAlias:
-        PrintResults("NoAlias", PrintNoAlias, *I1, *I2, F.getParent());
+        PrintResults("NoAlias", PrintNoAlias, P1, P2, F.getParent());
         ++NoAlias; break;
       case AliasAnalysis::MayAlias:
-        PrintResults("MayAlias", PrintMayAlias, *I1, *I2, F.getParent());
+        PrintResults("MayAlias", PrintMayAlias, P1, P2, F.getParent());
         ++MayAlias; break;
       case AliasAnalysis::PartialAlias:
-        PrintResults("PartialAlias", PrintPartialAlias, *I1, *I2,
+        PrintResults("PartialAlias", PrintPartialAlias, P1, P2,
                      F.getParent());
         ++PartialAlias; break;
       case AliasAnalysis::MustAlias:
-        PrintResults("MustAlias", PrintMustAlias, *I1, *I2, F.getParent());
+        PrintResults("MustAlias", PrintMustAlias, P1, P2, F.getParent());
         ++MustAlias; break;
       }
     }
   }
 
   if (EvalAAMD) {
+    // Loads come first, then stores.
+    SmallVector<AliasAnalysis::Location, 16> MemLocs;
+    for (SetVector<Value *>::iterator I = Loads.begin(), E = Loads.end();
+         I != E; ++I)
+      MemLocs.push_back(AA.getLocation(cast<LoadInst>(*I)));
+    for (SetVector<Value *>::iterator I = Stores.begin(), E = Stores.end();
+         I != E; ++I)
+      MemLocs.push_back(AA.getLocation(cast<StoreInst>(*I)));
+
+    AliasAnalysis::AliasMatrix MemMatrix(EvalBatch ? MemLocs.size() : 0);
+    if (EvalBatch)
+      AA.aliasBatch(MemLocs, MemMatrix);
+    auto getAliasResult = [&](unsigned Idx1, unsigned Idx2) {
+      return EvalBatch ? MemMatrix.get(Idx1, Idx2)
+                       : AA.alias(MemLocs[Idx1], MemLocs[Idx2]);
+    };
+    unsigned NumLoads = Loads.size();
+
     // iterate over all pairs of load, store
     for (SetVector<Value *>::iterator I1 = Loads.begin(), E = Loads.end();
          I1 != E; ++I1) {
       for (SetVector<Value *>::iterator I2 = Stores.begin(), E2 = Stores.end();
            I2 != E2; ++I2) {
-        switch (AA.alias(AA.getLocation(cast<LoadInst>(*I1)),
-                         AA.getLocation(cast<StoreInst>(*I2)))) {
+        switch (getAliasResult(I1 - Loads.begin(),
+                               NumLoads + (I2 - Stores.begin()))) {
         case AliasAnalysis::NoAlias:
           PrintLoadStoreResults("NoAlias", PrintNoAlias, *I1, *I2,
                                 F.getParent());
@@ -245,8 +273,8 @@ bool AAEval::runOnFunction(Function &F) {
     for (SetVector<Value *>::iterator I1 = Stores.begin(), E = Stores.end();
          I1 != E; ++I1) {
       for (SetVector<Value *>::iterator I2 = Stores.begin(); I2 != I1; ++I2) {
-        switch (AA.alias(AA.getLocation(cast<StoreInst>(*I1)),
-                         AA.getLocation(cast<StoreInst>(*I2)))) {
+        switch (getAliasResult(NumLoads + (I1 - Stores.begin()),
+                               NumLoads + (I2 - Stores.begin()))) {
         case AliasAnalysis::NoAlias:
           PrintLoadStoreResults("NoAlias", PrintNoAlias, *I1, *I2,
                                 F.getParent());
@@ -0,0 +1,238 @@
+//===- AliasAnalysisProfiler.cpp - Alias Analysis Query Profiler ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass which profiles the alias queries made by each
+// client pass: how many it makes, how they are answered, how much time each
+// alias analysis implementation of the chain spends on them and which
+// implementation settled them.  The report is written as JSON.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/Passes.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/AAQueryObserver.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSONString.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+using namespace llvm;
+
+static cl::opt<std::string>
+ProfileOutput("profile-aa-output", cl::value_desc("filename"),
+              cl::desc("File to write the -profile-aa JSON report to "
+                       "(defaults to stderr)"));
+
+namespace {
+  typedef std::chrono::steady_clock Clock;
+
+  /// ImplProfile - What one implementation of the chain did for a client.
+  struct ImplProfile {
+    unsigned Queries;  // Queries chained to the implementation
+    unsigned Decisive; // Queries it settled with a definite answer
+    double Seconds;    // Time spent in it, excluding the rest of the chain
+    ImplProfile() : Queries(0), Decisive(0), Seconds(0) {}
+  };
+
+  /// ClientProfile - The alias queries made by one client pass.
+  struct ClientProfile {
+    unsigned Queries;
+    unsigned Results[4]; // Indexed by AliasResult
+    double Seconds;
+    StringMap<ImplProfile> Impls;
+    ClientProfile() : Queries(0), Seconds(0) {
+      std::fill(std::begin(Results), std::end(Results), 0);
+    }
+  };
+
+  class AliasAnalysisProfiler : public ModulePass, public AliasAnalysis,
+                                public AAQueryObserver {
+    /// Frame - A query being answered by an implementation of the chain, or
+    /// by this pass for the bottom frame.
+    struct Frame {
+      const AliasAnalysis *Impl;
+      Clock::time_point Start;
+      double ChildSeconds;           // Time spent further down the chain
+      const AliasAnalysis *Decider;  // Who settled the query, if anyone
+      Frame(const AliasAnalysis *Impl)
+          : Impl(Impl), Start(Clock::now()), ChildSeconds(0),
+            Decider(nullptr) {}
+    };
+    SmallVector<Frame, 8> Frames;
+
+    StringMap<ClientProfile> Clients;
+    ClientProfile *CurClient;
+    const Pass *CurClientPass;
+
+    ClientProfile &getClient();
+    void printReport(raw_ostream &OS);
+
+  public:
+    static char ID; // Class identification, replacement for typeinfo
+    AliasAnalysisProfiler()
+        : ModulePass(ID), CurClient(nullptr), CurClientPass(nullptr) {
+      initializeAliasAnalysisProfilerPass(*PassRegistry::getPassRegistry());
+    }
+
+    ~AliasAnalysisProfiler() {
+      if (Clients.empty())
+        return;
+      if (ProfileOutput.empty()) {
+        printReport(errs());
+        return;
+      }
+      std::error_code EC;
+      raw_fd_ostream OS(ProfileOutput, EC, sys::fs::F_Text);
+      if (EC) {
+        errs() << "error: cannot open '" << ProfileOutput
+               << "': " << EC.message() << '\n';
+        return;
+      }
+      printReport(OS);
+    }
+
+    bool runOnModule(Module &M) override {
+      InitializeAliasAnalysis(this);
+      if (!isInstalled())
+        install();
+      return false;
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AliasAnalysis::getAnalysisUsage(AU);
+      AU.addRequired<AliasAnalysis>();
+      AU.setPreservesAll();
+    }
+
+    /// getAdjustedAnalysisPointer - This method is used when a pass implements
+    /// an analysis interface through multiple inheritance.  If needed, it
+    /// should override this to adjust the this pointer as needed for the
+    /// specified pass info.
+    void *getAdjustedAnalysisPointer(AnalysisID PI) override {
+      if (PI == &AliasAnalysis::ID)
+        return (AliasAnalysis*)this;
+      return this;
+    }
+
+    AliasResult alias(const Location &LocA, const Location &LocB) override;
+
+    void enter(const AliasAnalysis &Impl) override;
+    void leave(const AliasAnalysis &Impl, AliasResult Result) override;
+  };
+}
+
+char AliasAnalysisProfiler::ID = 0;
+INITIALIZE_AG_PASS(AliasAnalysisProfiler, AliasAnalysis, "profile-aa",
+                   "Profile Alias Analysis Queries", false, true, false)
+
+ModulePass *llvm::createAliasAnalysisProfilerPass() {
+  return new AliasAnalysisProfiler();
+}
+
+static double secondsSince(Clock::time_point Start) {
+  return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+ClientProfile &AliasAnalysisProfiler::getClient() {
+  const Pass *P = PassManagerPrettyStackEntry::getRunningPass();
+  if (!CurClient || P != CurClientPass) {
+    CurClient = &Clients[P ? getPassArgumentName(*P) : "<none>"];
+    CurClientPass = P;
+  }
+  return *CurClient;
+}
+
+AliasAnalysis::AliasResult
+AliasAnalysisProfiler::alias(const Location &LocA, const Location &LocB) {
+  Frames.push_back(Frame(this));
+  AliasResult R = AliasAnalysis::alias(LocA, LocB);
+  Frame F = Frames.pop_back_val();
+
+  ClientProfile &CP = getClient();
+  ++CP.Queries;
+  ++CP.Results[R];
+  CP.Seconds += secondsSince(F.Start);
+  if (F.Decider)
+    ++CP.Impls[getImplementationName(*F.Decider)].Decisive;
+  return R;
+}
+
+void AliasAnalysisProfiler::enter(const AliasAnalysis &Impl) {
+  // Queries entering the chain above this pass are not ours to profile.
+  if (Frames.empty())
+    return;
+  Frames.push_back(Frame(&Impl));
+}
+
+void AliasAnalysisProfiler::leave(const AliasAnalysis &Impl,
+                                  AliasResult Result) {
+  if (Frames.empty())
+    return;
+  Frame F = Frames.pop_back_val();
+  assert(F.Impl == &Impl && "Unbalanced alias query profiling!");
+  double Seconds = secondsSince(F.Start);
+
+  ImplProfile &IP = getClient().Impls[getImplementationName(Impl)];
+  ++IP.Queries;
+  IP.Seconds += Seconds - F.ChildSeconds;
+
+  // A definite answer belongs to the deepest implementation that gave it;
+  // the ones above merely pass it along.
+  Frame &Parent = Frames.back();
+  Parent.ChildSeconds += Seconds;
+  if (Result != MayAlias)
+    Parent.Decider = F.Decider ? F.Decider : &Impl;
+}
+
+void AliasAnalysisProfiler::printReport(raw_ostream &OS) {
+  static const char *const ResultNames[] = {
+    "NoAlias", "MayAlias", "PartialAlias", "MustAlias"
+  };
+
+  // Sort clients and implementations by name so reports can be diffed.
+  std::vector<StringRef> ClientNames;
+  for (const auto &C : Clients)
+    ClientNames.push_back(C.getKey());
+  std::sort(ClientNames.begin(), ClientNames.end());
+
+  OS << "{\n  \"clients\": [";
+  for (unsigned I = 0, E = ClientNames.size(); I != E; ++I) {
+    const ClientProfile &CP = Clients[ClientNames[I]];
+    OS << (I ? ",\n" : "\n") << "    {\n      \"pass\": ";
+    writeJSONString(OS, ClientNames[I]);
+    OS << ",\n      \"queries\": " << CP.Queries
+       << ",\n      \"seconds\": " << format("%.9f", CP.Seconds)
+       << ",\n      \"results\": {";
+    for (unsigned R = 0; R != 4; ++R)
+      OS << (R ? ", \"" : "\"") << ResultNames[R] << "\": " << CP.Results[R];
+    OS << "},\n      \"implementations\": [";
+
+    std::vector<StringRef> ImplNames;
+    for (const auto &Impl : CP.Impls)
+      ImplNames.push_back(Impl.getKey());
+    std::sort(ImplNames.begin(), ImplNames.end());
+    for (unsigned J = 0, JE = ImplNames.size(); J != JE; ++J) {
+      const ImplProfile &IP = CP.Impls.find(ImplNames[J])->getValue();
+      OS << (J ? ",\n" : "\n") << "        {\"name\": ";
+      writeJSONString(OS, ImplNames[J]);
+      OS << ", \"queries\": " << IP.Queries << ", \"decisive\": "
+         << IP.Decisive << ", \"seconds\": " << format("%.9f", IP.Seconds)
+         << "}";
+    }
+    OS << (ImplNames.empty() ? "]" : "\n      ]") << "\n    }";
+  }
+  OS << (ClientNames.empty() ? "]" : "\n  ]") << "\n}\n";
+}
@@ -12,7 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/AliasSetTracker.h"
-#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
@@ -20,17 +21,32 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+#define DEBUG_TYPE "alias-sets"
+
+STATISTIC(NumObjectFiltered, "Number of queries answered by underlying objects");
+STATISTIC(NumTagFiltered, "Number of queries answered by disjoint AAInfo");
+STATISTIC(NumSaturated, "Number of alias set trackers that saturated");
+
+static cl::opt<unsigned>
+SaturationThreshold("alias-set-saturation-threshold", cl::Hidden,
+                    cl::init(250),
+                    cl::desc("The maximum number of pointers may-alias sets "
+                             "may contain before the tracker saturates"));
+
 /// mergeSetIn - Merge the specified alias set into this alias set.
 ///
 void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
   assert(!AS.Forward && "Alias set is already forwarding!");
   assert(!Forward && "This set is a forwarding set!!");
 
+  bool WasMayAlias = isMayAlias(), ASWasMayAlias = AS.isMayAlias();
+
   // Update the alias and access types of this set...
   AccessTy |= AS.AccessTy;
   AliasTy  |= AS.AliasTy;
@@ -55,6 +71,16 @@ void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
       AliasTy = MayAlias;
   }
 
+  // The pointers of a set that was must-alias now count as may-alias ones.
+  if (isMayAlias()) {
+    if (!WasMayAlias)
+      AST.TotalMayAliasSetSize += SetSize;
+    if (!ASWasMayAlias)
+      AST.TotalMayAliasSetSize += AS.SetSize;
+  }
+  SetSize += AS.SetSize;
+  AS.SetSize = 0;
+
   bool ASHadUnknownInsts = !AS.UnknownInsts.empty();
   if (UnknownInsts.empty()) {            // Merge call sites...
     if (ASHadUnknownInsts) {
@@ -88,6 +114,8 @@ void AliasSetTracker::removeAliasSet(AliasSet *AS) {
     Fwd->dropRef(*this);
     AS->Forward = nullptr;
   }
+  if (AS == AliasAnyAS)
+    AliasAnyAS = nullptr;
   AliasSets.erase(AS);
 }
 
@@ -100,6 +128,7 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
                           uint64_t Size, const AAMDNodes &AAInfo,
                           bool KnownMustAlias) {
   assert(!Entry.hasAliasSet() && "Entry already in set!");
+  bool WasMayAlias = isMayAlias();
 
   // Check to see if we have to downgrade to _may_ alias.
   if (isMustAlias() && !KnownMustAlias)
@@ -125,13 +154,21 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
   PtrListEnd = Entry.setPrevInList(PtrListEnd);
   assert(*PtrListEnd == nullptr && "End of list is not null?");
   addRef();               // Entry points to alias set.
+
+  ++SetSize;
+  if (isMayAlias())
+    AST.TotalMayAliasSetSize += WasMayAlias ? 1 : SetSize;
 }
 
-void AliasSet::addUnknownInst(Instruction *I, AliasAnalysis &AA) {
+void AliasSet::addUnknownInst(AliasSetTracker &AST, Instruction *I) {
   if (UnknownInsts.empty())
     addRef();
   UnknownInsts.push_back(I);
 
+  // Sets with unknown instructions are always may-alias.
+  if (isMustAlias())
+    AST.TotalMayAliasSetSize += SetSize;
+
   if (!I->mayWriteToMemory()) {
     AliasTy = MayAlias;
     AccessTy |= Refs;
@@ -148,7 +185,8 @@ void AliasSet::addUnknownInst(Instruction *I, AliasAnalysis &AA) {
 ///
 bool AliasSet::aliasesPointer(const Value *Ptr, uint64_t Size,
                               const AAMDNodes &AAInfo,
-                              AliasAnalysis &AA) const {
+                              const AliasSetTracker &AST) const {
+  AliasAnalysis &AA = AST.getAliasAnalysis();
   if (AliasTy == MustAlias) {
     assert(UnknownInsts.empty() && "Illegal must alias set!");
 
@@ -156,18 +194,22 @@ bool AliasSet::aliasesPointer(const Value *Ptr, uint64_t Size,
     // SOME value in the set.
     PointerRec *SomePtr = getSomePointer();
     assert(SomePtr && "Empty must-alias set??");
-    return AA.alias(AliasAnalysis::Location(SomePtr->getValue(),
-                                            SomePtr->getSize(),
-                                            SomePtr->getAAInfo()),
-                    AliasAnalysis::Location(Ptr, Size, AAInfo));
+    return !AST.isNoAlias(AliasAnalysis::Location(SomePtr->getValue(),
+                                                  SomePtr->getSize(),
+                                                  SomePtr->getAAInfo()),
+                          AliasAnalysis::Location(Ptr, Size, AAInfo));
   }
 
   // If this is a may-alias set, we have to check all of the pointers in the set
   // to be sure it doesn't alias the set...
+  // FIXME: This asks about one pointer against every member of the set, which
+  // AliasAnalysis::aliasBatch cannot express without also filling in every
+  // pair of members. Batch these queries once AliasMatrix can be restricted
+  // to the pairs of a single location.
   for (iterator I = begin(), E = end(); I != E; ++I)
-    if (AA.alias(AliasAnalysis::Location(Ptr, Size, AAInfo),
-                 AliasAnalysis::Location(I.getPointer(), I.getSize(),
-                                         I.getAAInfo())))
+    if (!AST.isNoAlias(AliasAnalysis::Location(Ptr, Size, AAInfo),
+                       AliasAnalysis::Location(I.getPointer(), I.getSize(),
+                                               I.getAAInfo())))
       return true;
 
   // Check the unknown instructions...
@@ -214,6 +256,53 @@ void AliasSetTracker::clear() {
   
   // The alias sets should all be clear now.
   AliasSets.clear();
+  AliasAnyAS = nullptr;
+  TotalMayAliasSetSize = 0;
+}
+
+/// areTagsDisjoint - Return true if accesses tagged with AAInfoA never alias
+/// accesses tagged with AAInfoB.  Alias analysis is asked once per pair of
+/// tags, with Ptr on both sides: only the tags can keep a pointer from
+/// aliasing itself, so the answer holds for any pair of pointers.
+bool AliasSetTracker::areTagsDisjoint(const Value *Ptr,
+                                      const AAMDNodes &AAInfoA,
+                                      const AAMDNodes &AAInfoB) const {
+  if (!AAInfoA || !AAInfoB || AAInfoA == AAInfoB)
+    return false;
+
+  auto Key = std::make_pair(AAInfoA, AAInfoB);
+  auto I = DisjointTags.find(Key);
+  if (I != DisjointTags.end())
+    return I->second;
+
+  // Null and undef pointers alias nothing, whatever their tags.
+  bool Disjoint = false;
+  if (!isa<ConstantPointerNull>(Ptr) && !isa<UndefValue>(Ptr))
+    Disjoint =
+        AA.alias(AliasAnalysis::Location(Ptr, AliasAnalysis::UnknownSize,
+                                         AAInfoA),
+                 AliasAnalysis::Location(Ptr, AliasAnalysis::UnknownSize,
+                                         AAInfoB)) == AliasAnalysis::NoAlias;
+  return DisjointTags[Key] = Disjoint;
+}
+
+bool AliasSetTracker::isNoAlias(const AliasAnalysis::Location &LocA,
+                                const AliasAnalysis::Location &LocB) const {
+  // Pointers into distinct identified objects never alias.
+  const DataLayout *DL = AA.getDataLayout();
+  const Value *ObjA = GetUnderlyingObject(LocA.Ptr, DL);
+  const Value *ObjB = GetUnderlyingObject(LocB.Ptr, DL);
+  if (ObjA != ObjB && isIdentifiedObject(ObjA) && isIdentifiedObject(ObjB)) {
+    ++NumObjectFiltered;
+    return true;
+  }
+
+  if (areTagsDisjoint(LocA.Ptr, LocA.AATags, LocB.AATags)) {
+    ++NumTagFiltered;
+    return true;
+  }
+
+  return !AA.alias(LocA, LocB);
 }
 
 
@@ -224,10 +313,15 @@ void AliasSetTracker::clear() {
 AliasSet *AliasSetTracker::findAliasSetForPointer(const Value *Ptr,
                                                   uint64_t Size,
                                                   const AAMDNodes &AAInfo) {
+  // A saturated tracker assumes everything aliases.
+  if (AliasAnyAS)
+    return AliasAnyAS;
+
   AliasSet *FoundSet = nullptr;
   for (iterator I = begin(), E = end(); I != E;) {
     iterator Cur = I++;
-    if (Cur->Forward || !Cur->aliasesPointer(Ptr, Size, AAInfo, AA)) continue;
+    if (Cur->Forward || !Cur->aliasesPointer(Ptr, Size, AAInfo, *this))
+      continue;
     
     if (!FoundSet) {      // If this is the first alias set ptr can go into.
       FoundSet = Cur;     // Remember it.
@@ -244,13 +338,17 @@ AliasSet *AliasSetTracker::findAliasSetForPointer(const Value *Ptr,
 /// alias sets.
 bool AliasSetTracker::containsPointer(Value *Ptr, uint64_t Size,
                                       const AAMDNodes &AAInfo) const {
+  if (AliasAnyAS)
+    return true;
   for (const_iterator I = begin(), E = end(); I != E; ++I)
-    if (!I->Forward && I->aliasesPointer(Ptr, Size, AAInfo, AA))
+    if (!I->Forward && I->aliasesPointer(Ptr, Size, AAInfo, *this))
       return true;
   return false;
 }
 
 bool AliasSetTracker::containsUnknown(Instruction *Inst) const {
+  if (AliasAnyAS)
+    return Inst->mayReadOrWriteMemory();
   for (const_iterator I = begin(), E = end(); I != E; ++I)
     if (!I->Forward && I->aliasesUnknownInst(Inst, AA))
       return true;
@@ -258,6 +356,9 @@ bool AliasSetTracker::containsUnknown(Instruction *Inst) const {
 }
 
 AliasSet *AliasSetTracker::findAliasSetForUnknownInst(Instruction *Inst) {
+  if (AliasAnyAS)
+    return AliasAnyAS;
+
   AliasSet *FoundSet = nullptr;
   for (iterator I = begin(), E = end(); I != E;) {
     iterator Cur = I++;
@@ -287,6 +388,12 @@ AliasSet &AliasSetTracker::getAliasSetForPointer(Value *Pointer, uint64_t Size,
     // Return the set!
     return *Entry.getAliasSet(*this)->getForwardedTarget(*this);
   }
+
+  if (AliasAnyAS) {
+    // The saturated set is may-alias, so adding to it queries nothing.
+    AliasAnyAS->addPointer(*this, Entry, Size, AAInfo);
+    return *AliasAnyAS;
+  }
   
   if (AliasSet *AS = findAliasSetForPointer(Pointer, Size, AAInfo)) {
     // Add it to the alias set it aliases.
@@ -301,6 +408,45 @@ AliasSet &AliasSetTracker::getAliasSetForPointer(Value *Pointer, uint64_t Size,
   return AliasSets.back();
 }
 
+/// mergeAllAliasSets - Merge every alias set into AliasAnyAS, which from now
+/// on holds all the pointers and instructions added to the tracker.
+AliasSet &AliasSetTracker::mergeAllAliasSets() {
+  assert(!AliasAnyAS && "Tracker is already saturated!");
+  ++NumSaturated;
+  DEBUG(dbgs() << "AliasSetTracker: saturated with " << TotalMayAliasSetSize
+               << " may-alias pointers\n");
+
+  // Collect the live sets first, as merging appends to AliasSets.  Sets that
+  // are already forwarding reach AliasAnyAS through their targets.
+  std::vector<AliasSet *> ASVector;
+  ASVector.reserve(AliasSets.size());
+  for (iterator I = begin(), E = end(); I != E; ++I)
+    if (!I->Forward)
+      ASVector.push_back(I);
+
+  AliasSets.push_back(new AliasSet());
+  AliasAnyAS = &AliasSets.back();
+  AliasAnyAS->AliasTy = AliasSet::MayAlias;
+
+  for (AliasSet *Cur : ASVector)
+    AliasAnyAS->mergeSetIn(*Cur, *this);
+  return *AliasAnyAS;
+}
+
+AliasSet &AliasSetTracker::addPointer(Value *P, uint64_t Size,
+                                      const AAMDNodes &AAInfo,
+                                      AliasSet::AccessType E, bool &NewSet) {
+  NewSet = false;
+  AliasSet &AS = getAliasSetForPointer(P, Size, AAInfo, &NewSet);
+  AS.AccessTy |= E;
+
+  // From here on, consider all pointers to alias each other rather than
+  // comparing new pointers against ever bigger may-alias sets.
+  if (!AliasAnyAS && TotalMayAliasSetSize > SaturationThreshold)
+    return mergeAllAliasSets();
+  return AS;
+}
+
 bool AliasSetTracker::add(Value *Ptr, uint64_t Size, const AAMDNodes &AAInfo) {
   bool NewPtr;
   addPointer(Ptr, Size, AAInfo, AliasSet::NoModRef, NewPtr);
@@ -358,12 +504,12 @@ bool AliasSetTracker::addUnknown(Instruction *Inst) {
 
   AliasSet *AS = findAliasSetForUnknownInst(Inst);
   if (AS) {
-    AS->addUnknownInst(Inst, AA);
+    AS->addUnknownInst(*this, Inst);
     return false;
   }
   AliasSets.push_back(new AliasSet());
   AS = &AliasSets.back();
-  AS->addUnknownInst(Inst, AA);
+  AS->addUnknownInst(*this, Inst);
   return true;
 }
 
@@ -435,6 +581,10 @@ void AliasSetTracker::remove(AliasSet &AS) {
     PointerMap.erase(ValToRemove);
   }
   
+  if (AS.isMayAlias())
+    TotalMayAliasSetSize -= AS.SetSize;
+  AS.SetSize = 0;
+
   // Stop using the alias set, removing it.
   AS.RefCount -= NumRefs;
   if (AS.RefCount == 0)
@@ -538,6 +688,10 @@ void AliasSetTracker::deleteValue(Value *PtrVal) {
 
   // Unlink and delete from the list of values.
   PtrValEnt->eraseFromList();
+
+  --AS->SetSize;
+  if (AS->isMayAlias())
+    --TotalMayAliasSetSize;
   
   // Stop using the alias set.
   AS->dropRef(*this);
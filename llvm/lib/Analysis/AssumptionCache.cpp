@@ -74,6 +74,7 @@ void AssumptionCache::registerAssumption(CallInst *CI) {
 }
 
 void AssumptionCacheTracker::FunctionCallbackVH::deleted() {
+  sys::SmartScopedLock<true> Lock(ACT->CachesLock);
   auto I = ACT->AssumptionCaches.find_as(cast<Function>(getValPtr()));
   if (I != ACT->AssumptionCaches.end())
     ACT->AssumptionCaches.erase(I);
@@ -81,6 +82,8 @@ void AssumptionCacheTracker::FunctionCallbackVH::deleted() {
 }
 
 AssumptionCache &AssumptionCacheTracker::getAssumptionCache(Function &F) {
+  sys::SmartScopedLock<true> Lock(CachesLock);
+
   // We probe the function map twice to try and avoid creating a value handle
   // around the function in common cases. This makes insertion a bit slower,
   // but if we have to insert we're going to scan the whole function so that
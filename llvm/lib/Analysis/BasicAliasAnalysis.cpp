@@ -16,6 +16,7 @@
 #include "llvm/Analysis/Passes.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CFG.h"
@@ -36,12 +37,27 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include <algorithm>
 using namespace llvm;
 
+#define DEBUG_TYPE "basicaa"
+
+STATISTIC(NumMemoHits, "Number of alias queries answered by the memo");
+STATISTIC(NumMemoMisses, "Number of alias queries missing from the memo");
+STATISTIC(NumMemoInvalidations, "Number of function memos invalidated");
+STATISTIC(NumMemoPurged, "Number of memo entries dropped for deleted values");
+
+/// Keep the results of top level alias queries across queries, until the pass
+/// manager reports that the function they were asked in was modified.
+static cl::opt<bool> EnableMemo("basicaa-memo", cl::Hidden, cl::init(false),
+                                cl::desc("Memoize BasicAA alias results until "
+                                         "their function is modified"));
+
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes we need to be
 /// careful with value equivalence. We use reachability to make sure a value
@@ -433,10 +449,17 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
 // BasicAliasAnalysis Pass
 //===----------------------------------------------------------------------===//
 
-#ifndef NDEBUG
+/// isNullInDefaultAddrSpace - Null values in the default address space don't
+/// point to any object, so they don't alias any other pointer.
+static bool isNullInDefaultAddrSpace(const Value *V) {
+  if (const ConstantPointerNull *CPN = dyn_cast<ConstantPointerNull>(V))
+    return CPN->getType()->getAddressSpace() == 0;
+  return false;
+}
+
 static const Function *getParent(const Value *V) {
   if (const Instruction *inst = dyn_cast<Instruction>(V))
-    return inst->getParent()->getParent();
+    return inst->getParent() ? inst->getParent()->getParent() : nullptr;
 
   if (const Argument *arg = dyn_cast<Argument>(V))
     return arg->getParent();
@@ -444,6 +467,8 @@ static const Function *getParent(const Value *V) {
   return nullptr;
 }
 
+#ifndef NDEBUG
+
 static bool notDifferentParent(const Value *O1, const Value *O2) {
 
   const Function *F1 = getParent(O1);
@@ -465,6 +490,12 @@ namespace {
       InitializeAliasAnalysis(this);
     }
 
+    /// createConcurrentInstance - Queries go through AliasCache and the memo,
+    /// so every thread gets an instance of its own.
+    ImmutablePass *createConcurrentInstance() const override {
+      return new BasicAliasAnalysis();
+    }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AliasAnalysis>();
       AU.addRequired<AssumptionCacheTracker>();
@@ -475,6 +506,28 @@ namespace {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+
+      // Queries between constants are cheap, and have no function to be
+      // memoized in.
+      const Function *F = nullptr;
+      if (EnableMemo) {
+        F = getParent(LocA.Ptr);
+        if (!F)
+          F = getParent(LocB.Ptr);
+      }
+      LocPair Locs(LocA, LocB);
+      if (F) {
+        if (Locs.first.Ptr > Locs.second.Ptr)
+          std::swap(Locs.first, Locs.second);
+        MemoTy &Memo = Memos[F].Results;
+        MemoTy::iterator I = Memo.find(Locs);
+        if (I != Memo.end()) {
+          ++NumMemoHits;
+          return I->second;
+        }
+        ++NumMemoMisses;
+      }
+
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.AATags,
                                      LocB.Ptr, LocB.Size, LocB.AATags);
       // AliasCache rarely has more than 1 or 2 elements, always use
@@ -483,9 +536,35 @@ namespace {
       // FIXME: This should really be shrink_to_inline_capacity_and_clear().
       AliasCache.shrink_and_clear();
       VisitedPhiBBs.clear();
+
+      // Only the final result is memoized: the entries of AliasCache may be
+      // speculative (see aliasPHI).
+      if (F)
+        memoize(F, Locs, Alias);
       return Alias;
     }
 
+    void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) override;
+
+    /// invalidateCachedInfo - Drop the memo of F, or all of them if F is null.
+    void invalidateCachedInfo(Function *F) override {
+      if (!F) {
+        NumMemoInvalidations += Memos.size();
+        Memos.clear();
+        return;
+      }
+      if (Memos.erase(F))
+        ++NumMemoInvalidations;
+    }
+
+    /// addEscapingUse - Passes report this in the middle of their run, while
+    /// the pass manager only tells us about changes at its end. A new escaping
+    /// use may turn a non-escaping local object into an escaping one.
+    void addEscapingUse(Use &U) override {
+      invalidateCachedInfo(const_cast<Function *>(getParent(U.getUser())));
+      AliasAnalysis::addEscapingUse(U);
+    }
+
     ModRefResult getModRefInfo(ImmutableCallSite CS,
                                const Location &Loc) override;
 
@@ -524,6 +603,34 @@ namespace {
     typedef SmallDenseMap<LocPair, AliasResult, 8> AliasCacheTy;
     AliasCacheTy AliasCache;
 
+    /// MemoVH - Drops the memo entries of a value when it is deleted, so that
+    /// a value later allocated at the same address does not pick them up.
+    /// Passes are not relied on to call deleteValue for this.
+    class MemoVH : public CallbackVH {
+      BasicAliasAnalysis *BAA;
+      const Function *F;
+      void deleted() override;
+
+    public:
+      MemoVH(Value *V, BasicAliasAnalysis *BAA, const Function *F)
+          : CallbackVH(V), BAA(BAA), F(F) {}
+    };
+
+    // Memos - Results of top level queries, per function, with -basicaa-memo,
+    // along with handles on the pointers they were asked about.
+    typedef DenseMap<LocPair, AliasResult> MemoTy;
+    struct FunctionMemo {
+      MemoTy Results;
+      DenseMap<const Value *, MemoVH> Handles;
+    };
+    DenseMap<const Function *, FunctionMemo> Memos;
+
+    /// memoize - Record the result of a top level query asked in F.
+    void memoize(const Function *F, const LocPair &Locs, AliasResult Alias);
+
+    /// forgetMemoizedValue - Drop the entries of F's memo that involve V.
+    void forgetMemoizedValue(const Function *F, const Value *V);
+
     /// \brief Track phi nodes we have visited. When interpret "Value" pointer
     /// equality as value equality we need to make sure that the "Value" is not
     /// part of a cycle. Otherwise, two uses could come from different
@@ -1273,6 +1380,75 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
   return Alias;
 }
 
+void BasicAliasAnalysis::memoize(const Function *F, const LocPair &Locs,
+                                 AliasResult Alias) {
+  FunctionMemo &Memo = Memos[F];
+  Memo.Results[Locs] = Alias;
+  const Value *Ptrs[] = { Locs.first.Ptr, Locs.second.Ptr };
+  for (const Value *Ptr : Ptrs)
+    if (!Memo.Handles.count(Ptr))
+      Memo.Handles.insert(std::make_pair(
+          Ptr, MemoVH(const_cast<Value *>(Ptr), this, F)));
+}
+
+void BasicAliasAnalysis::forgetMemoizedValue(const Function *F,
+                                             const Value *V) {
+  DenseMap<const Function *, FunctionMemo>::iterator MI = Memos.find(F);
+  if (MI == Memos.end())
+    return;
+  MemoTy &Results = MI->second.Results;
+  for (MemoTy::iterator I = Results.begin(), E = Results.end(); I != E;) {
+    MemoTy::iterator Cur = I++;
+    if (Cur->first.first.Ptr == V || Cur->first.second.Ptr == V) {
+      Results.erase(Cur);
+      ++NumMemoPurged;
+    }
+  }
+  MI->second.Handles.erase(V);
+}
+
+void BasicAliasAnalysis::MemoVH::deleted() {
+  BAA->forgetMemoizedValue(F, getValPtr());
+  // 'this' now dangles!
+}
+
+// aliasBatch - Settle the pairs that aliasCheck would answer from the
+// underlying objects alone, walking to the object of each location only once,
+// and query the remaining pairs one by one.
+//
+void BasicAliasAnalysis::aliasBatch(ArrayRef<Location> Locs,
+                                    AliasMatrix &Matrix) {
+  SmallVector<const Value *, 16> Ptrs, Objects;
+  for (const Location &Loc : Locs) {
+    const Value *V = Loc.Ptr->stripPointerCasts();
+    Ptrs.push_back(V);
+    Objects.push_back(V->getType()->isPointerTy()
+                          ? GetUnderlyingObject(V, DL, MaxLookupSearchDepth)
+                          : nullptr);
+  }
+
+  for (unsigned I = 1, E = Locs.size(); I < E; ++I)
+    for (unsigned J = 0; J != I; ++J) {
+      if (Matrix.isKnown(I, J))
+        continue;
+      if (Locs[I].Size == 0 || Locs[J].Size == 0) {
+        Matrix.set(I, J, NoAlias);
+        continue;
+      }
+
+      // Leave the same and non-pointer values to aliasCheck.
+      const Value *O1 = Objects[I], *O2 = Objects[J];
+      if (Ptrs[I] == Ptrs[J] || !O1 || !O2)
+        continue;
+
+      if (isNullInDefaultAddrSpace(O1) || isNullInDefaultAddrSpace(O2) ||
+          (O1 != O2 && isIdentifiedObject(O1) && isIdentifiedObject(O2)))
+        Matrix.set(I, J, NoAlias);
+    }
+
+  AliasAnalysis::aliasBatch(Locs, Matrix);
+}
+
 // aliasCheck - Provide a bunch of ad-hoc rules to disambiguate in common cases,
 // such as array references.
 //
@@ -1306,14 +1482,8 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   const Value *O1 = GetUnderlyingObject(V1, DL, MaxLookupSearchDepth);
   const Value *O2 = GetUnderlyingObject(V2, DL, MaxLookupSearchDepth);
 
-  // Null values in the default address space don't point to any object, so they
-  // don't alias any other pointer.
-  if (const ConstantPointerNull *CPN = dyn_cast<ConstantPointerNull>(O1))
-    if (CPN->getType()->getAddressSpace() == 0)
-      return NoAlias;
-  if (const ConstantPointerNull *CPN = dyn_cast<ConstantPointerNull>(O2))
-    if (CPN->getType()->getAddressSpace() == 0)
-      return NoAlias;
+  if (isNullInDefaultAddrSpace(O1) || isNullInDefaultAddrSpace(O2))
+    return NoAlias;
 
   if (O1 != O2) {
     // If V1/V2 point to two different objects we know that we have no alias.
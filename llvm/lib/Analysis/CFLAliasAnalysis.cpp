@@ -26,13 +26,28 @@
 // in order to transform the graph into sets of variables that may alias in
 // ~nlogn time (n = number of variables.), which makes queries take constant
 // time.
+//
+// Calls to functions we can see the body of are handled through summaries.
+// Once the sets of a callee are built, we record which of its parameters may
+// alias each other or the returned value, and which of them may reach globals
+// or unknown memory. Call sites then get edges for exactly these flows rather
+// than having all their arguments merged together. Callees are summarized
+// before their callers, so recursion is the only case we give up on. With
+// -cfl-aa-whole-module, this also applies to externally visible definitions
+// the linker cannot replace.
+//
+// When the pass manager reports that a function was modified, its sets are
+// updated in place rather than rebuilt: we only add the edges of the
+// instructions that are new, or that were changed since they were scanned.
 //===----------------------------------------------------------------------===//
 
 #include "StratifiedSets.h"
 #include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/IR/Constants.h"
@@ -42,6 +57,7 @@
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <algorithm>
@@ -51,6 +67,18 @@
 
 using namespace llvm;
 
+#define DEBUG_TYPE "cfl-aa"
+
+STATISTIC(NumSummarizedCalls, "Number of calls handled through summaries");
+STATISTIC(NumUpdates, "Number of functions updated incrementally");
+STATISTIC(NumUpdatedInsts, "Number of instructions added by updates");
+STATISTIC(NumSummaryChanges, "Number of updates that changed a summary");
+
+static cl::opt<bool> WholeModule(
+    "cfl-aa-whole-module", cl::init(false), cl::Hidden,
+    cl::desc("Summarize every definition the linker cannot replace, "
+             "not only the ones with local linkage (CFL-AA)"));
+
 // Try to go from a Value* to a Function*. Never returns nullptr.
 static Optional<Function *> parentFunctionOfValue(Value *);
 
@@ -88,6 +116,10 @@ LLVM_CONSTEXPR unsigned AttrMaxNumArgs = AttrLastArgIndex - AttrFirstArgIndex;
 
 LLVM_CONSTEXPR StratifiedAttr AttrNone = 0;
 LLVM_CONSTEXPR StratifiedAttr AttrAll = ~AttrNone;
+// The attributes that keep their meaning across a call: the ones of the
+// caller's own arguments are unrelated to those of the callee.
+LLVM_CONSTEXPR StratifiedAttr AttrExternal =
+    (1u << AttrAllIndex) | (1u << AttrGlobalIndex);
 
 // \brief StratifiedSets call for knowledge of "direction", so this is how we
 // represent that locally.
@@ -135,11 +167,40 @@ struct Edge {
       : From(From), To(To), Weight(W), AdditionalAttrs(A) {}
 };
 
+// \brief How values flow between the parameters and the return value of a
+// function, as seen by its callers.
+struct FunctionSummary {
+  // Pairs of parameters (I < J) that are in the same set chain.
+  SmallVector<std::pair<unsigned, unsigned>, 4> RelatedArgs;
+
+  // Parameters that are in the same set chain as some returned value.
+  SmallVector<unsigned, 4> ReturnedArgs;
+
+  // External attributes of each parameter, and of the returned values. These
+  // are set when the value, or something it points to, may escape to a
+  // global or to a function we know nothing about.
+  SmallVector<StratifiedAttrs, 4> ArgAttrs;
+  StratifiedAttrs ReturnAttrs;
+};
+
+static bool operator==(const FunctionSummary &A, const FunctionSummary &B) {
+  return A.RelatedArgs == B.RelatedArgs && A.ReturnedArgs == B.ReturnedArgs &&
+         A.ArgAttrs == B.ArgAttrs && A.ReturnAttrs == B.ReturnAttrs;
+}
+
+// \brief Maps the instructions we got edges from to a hash of what these
+// edges depend on. This tells us which instructions were added, removed or
+// changed in place since then (see getFingerprint).
+typedef DenseMap<Instruction *, hash_code> FingerprintMapT;
+
 // \brief Information we have about a function and would like to keep around
 struct FunctionInfo {
   StratifiedSets<Value *> Sets;
   // Lots of functions have < 4 returns. Adjust as necessary.
   SmallVector<Value *, 4> ReturnedValues;
+  // Missing if the function can't be summarized (i.e. too many parameters)
+  Optional<FunctionSummary> Summary;
+  FingerprintMapT Fingerprints;
 
   FunctionInfo(StratifiedSets<Value *> &&S,
                SmallVector<Value *, 4> &&RV)
@@ -198,6 +259,10 @@ public:
   /// \brief Inserts the given Function into the cache.
   void scan(Function *Fn);
 
+  /// \brief Brings the cached sets of Fn up to date with its body. Returns
+  /// true if its summary changed, in which case its callers are out of date.
+  bool update(Function *Fn);
+
   void evict(Function *Fn) { Cache.erase(Fn); }
 
   /// \brief Ensures that the given function is available in the cache.
@@ -227,13 +292,24 @@ public:
     // Comparisons between global variables and other constants should be
     // handled by BasicAA.
     if (isa<Constant>(LocA.Ptr) && isa<Constant>(LocB.Ptr)) {
-      return MayAlias;
+      return AliasAnalysis::alias(LocA, LocB);
     }
 
-    return query(LocA, LocB);
+    AliasResult QueryResult = query(LocA, LocB);
+    if (QueryResult == MayAlias)
+      return AliasAnalysis::alias(LocA, LocB);
+
+    return QueryResult;
   }
 
+  void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) override;
+
   void initializePass() override { InitializeAliasAnalysis(this); }
+
+  void invalidateCachedInfo(Function *Fn) override;
+
+  /// The graphs of all functions are built into one cache as they are queried.
+  bool isThreadSafe() const override { return false; }
 };
 
 void FunctionHandle::removeSelfFromCache() {
@@ -329,32 +405,11 @@ public:
   }
 
   static bool isFunctionExternal(Function *Fn) {
-    return Fn->isDeclaration() || !Fn->hasLocalLinkage();
-  }
-
-  // Gets whether the sets at Index1 above, below, or equal to the sets at
-  // Index2. Returns None if they are not in the same set chain.
-  static Optional<Level> getIndexRelation(const StratifiedSets<Value *> &Sets,
-                                          StratifiedIndex Index1,
-                                          StratifiedIndex Index2) {
-    if (Index1 == Index2)
-      return Level::Same;
-
-    const auto *Current = &Sets.getLink(Index1);
-    while (Current->hasBelow()) {
-      if (Current->Below == Index2)
-        return Level::Below;
-      Current = &Sets.getLink(Current->Below);
-    }
-
-    Current = &Sets.getLink(Index1);
-    while (Current->hasAbove()) {
-      if (Current->Above == Index2)
-        return Level::Above;
-      Current = &Sets.getLink(Current->Above);
-    }
-
-    return NoneType();
+    if (Fn->isDeclaration())
+      return true;
+    if (WholeModule)
+      return Fn->mayBeOverridden();
+    return !Fn->hasLocalLinkage();
   }
 
   bool
@@ -362,94 +417,55 @@ public:
                              Value *FuncValue,
                              const iterator_range<User::op_iterator> &Args) {
     const unsigned ExpectedMaxArgs = 8;
-    const unsigned MaxSupportedArgs = 50;
     assert(Fns.size() > 0);
 
-    // I put this here to give us an upper bound on time taken by IPA. Is it
-    // really (realistically) needed? Keep in mind that we do have an n^2 algo.
-    if (std::distance(Args.begin(), Args.end()) > (int) MaxSupportedArgs)
-      return false;
-
     // Exit early if we'll fail anyway
     for (auto *Fn : Fns) {
       if (isFunctionExternal(Fn) || Fn->isVarArg())
         return false;
       auto &MaybeInfo = AA.ensureCached(Fn);
-      if (!MaybeInfo.hasValue())
+      if (!MaybeInfo.hasValue() || !MaybeInfo->Summary.hasValue())
         return false;
     }
 
     SmallVector<Value *, ExpectedMaxArgs> Arguments(Args.begin(), Args.end());
-    SmallVector<StratifiedInfo, ExpectedMaxArgs> Parameters;
     for (auto *Fn : Fns) {
-      auto &Info = *AA.ensureCached(Fn);
-      auto &Sets = Info.Sets;
-      auto &RetVals = Info.ReturnedValues;
-
-      Parameters.clear();
-      for (auto &Param : Fn->args()) {
-        auto MaybeInfo = Sets.find(&Param);
-        // Did a new parameter somehow get added to the function/slip by?
-        if (!MaybeInfo.hasValue())
-          return false;
-        Parameters.push_back(*MaybeInfo);
-      }
-
-      // Adding an edge from argument -> return value for each parameter that
-      // may alias the return value
-      for (unsigned I = 0, E = Parameters.size(); I != E; ++I) {
-        auto &ParamInfo = Parameters[I];
-        auto &ArgVal = Arguments[I];
-        bool AddEdge = false;
-        StratifiedAttrs Externals;
-        for (unsigned X = 0, XE = RetVals.size(); X != XE; ++X) {
-          auto MaybeInfo = Sets.find(RetVals[X]);
-          if (!MaybeInfo.hasValue())
-            return false;
-
-          auto &RetInfo = *MaybeInfo;
-          auto RetAttrs = Sets.getLink(RetInfo.Index).Attrs;
-          auto ParamAttrs = Sets.getLink(ParamInfo.Index).Attrs;
-          auto MaybeRelation =
-              getIndexRelation(Sets, ParamInfo.Index, RetInfo.Index);
-          if (MaybeRelation.hasValue()) {
-            AddEdge = true;
-            Externals |= RetAttrs | ParamAttrs;
-          }
-        }
-        if (AddEdge)
-          Output.push_back(Edge(FuncValue, ArgVal, EdgeType::Assign,
-                            StratifiedAttrs().flip()));
-      }
-
-      if (Parameters.size() != Arguments.size())
+      auto &Summary = *AA.ensureCached(Fn)->Summary;
+      if (Summary.ArgAttrs.size() != Arguments.size())
         return false;
 
-      // Adding edges between arguments for arguments that may end up aliasing
-      // each other. This is necessary for functions such as
+      // Arguments that may end up aliasing each other. This is necessary for
+      // functions such as
       // void foo(int** a, int** b) { *a = *b; }
       // (Technically, the proper sets for this would be those below
       // Arguments[I] and Arguments[X], but our algorithm will produce
       // extremely similar, and equally correct, results either way)
-      for (unsigned I = 0, E = Arguments.size(); I != E; ++I) {
-        auto &MainVal = Arguments[I];
-        auto &MainInfo = Parameters[I];
-        auto &MainAttrs = Sets.getLink(MainInfo.Index).Attrs;
-        for (unsigned X = I + 1; X != E; ++X) {
-          auto &SubInfo = Parameters[X];
-          auto &SubVal = Arguments[X];
-          auto &SubAttrs = Sets.getLink(SubInfo.Index).Attrs;
-          auto MaybeRelation =
-              getIndexRelation(Sets, MainInfo.Index, SubInfo.Index);
-
-          if (!MaybeRelation.hasValue())
-            continue;
-
-          auto NewAttrs = SubAttrs | MainAttrs;
-          Output.push_back(Edge(MainVal, SubVal, EdgeType::Assign, NewAttrs));
-        }
+      for (const auto &Pair : Summary.RelatedArgs) {
+        auto Attrs = Summary.ArgAttrs[Pair.first] |
+                     Summary.ArgAttrs[Pair.second];
+        Output.push_back(Edge(Arguments[Pair.first], Arguments[Pair.second],
+                              EdgeType::Assign, Attrs));
       }
+
+      // Arguments that may be returned
+      for (unsigned I : Summary.ReturnedArgs) {
+        auto Attrs = Summary.ReturnAttrs | Summary.ArgAttrs[I];
+        Output.push_back(
+            Edge(FuncValue, Arguments[I], EdgeType::Assign, Attrs));
+      }
+
+      // Arguments that may escape, and returned values that may come from
+      // somewhere we can't see.
+      for (unsigned I = 0, E = Arguments.size(); I != E; ++I)
+        if (Summary.ArgAttrs[I].any())
+          Output.push_back(Edge(Arguments[I], Arguments[I], EdgeType::Assign,
+                                Summary.ArgAttrs[I]));
+      if (Summary.ReturnAttrs.any())
+        Output.push_back(Edge(FuncValue, FuncValue, EdgeType::Assign,
+                              Summary.ReturnAttrs));
     }
+
+    ++NumSummarizedCalls;
     return true;
   }
 
@@ -720,10 +736,32 @@ static void argsToEdges(CFLAliasAnalysis &, Instruction *,
 // given an EdgeType.
 static Level directionOfEdgeType(EdgeType);
 
+// Gets whether the sets at Index1 above, below, or equal to the sets at
+// Index2. Returns None if they are not in the same set chain.
+static Optional<Level> getIndexRelation(const StratifiedSets<Value *> &,
+                                        StratifiedIndex, StratifiedIndex);
+
+// Summarizes the parameter and return flows of a function whose sets are
+// built. Returns None if some of them are missing from the sets.
+static Optional<FunctionSummary> buildSummaryFrom(const FunctionInfo &,
+                                                  Function *);
+
+// Hashes the opcode, type and operands of an instruction, which are all its
+// edges depend on.
+static hash_code getFingerprint(Instruction *);
+
+// Notes the attributes of an edge between two values in the builder.
+static void noteEdgeAttributes(StratifiedSetsBuilder<Value *> &, Value *,
+                               Value *, StratifiedAttrs);
+
+// Adds a single edge to the builder of already built sets.
+static void addEdgeTo(StratifiedSetsBuilder<Value *> &, const Edge &);
+
 // Builds the graph needed for constructing the StratifiedSets for the
 // given function
 static void buildGraphFrom(CFLAliasAnalysis &, Function *,
-                           SmallVectorImpl<Value *> &, NodeMapT &, GraphT &);
+                           SmallVectorImpl<Value *> &, FingerprintMapT &,
+                           NodeMapT &, GraphT &);
 
 // Builds the graph + StratifiedSets for a function.
 static FunctionInfo buildSetsFrom(CFLAliasAnalysis &, Function *);
@@ -809,12 +847,140 @@ static Level directionOfEdgeType(EdgeType Weight) {
   llvm_unreachable("Incomplete switch coverage");
 }
 
+static Optional<Level> getIndexRelation(const StratifiedSets<Value *> &Sets,
+                                        StratifiedIndex Index1,
+                                        StratifiedIndex Index2) {
+  if (Index1 == Index2)
+    return Level::Same;
+
+  for (auto Current = Index1; Sets.hasBelow(Current);) {
+    Current = Sets.getBelow(Current);
+    if (Current == Index2)
+      return Level::Below;
+  }
+
+  for (auto Current = Index1; Sets.hasAbove(Current);) {
+    Current = Sets.getAbove(Current);
+    if (Current == Index2)
+      return Level::Above;
+  }
+
+  return NoneType();
+}
+
+// Gets the external attributes of everything in the set chain of Index.
+// Attributes are merged down, so the lowest set has all of them.
+static StratifiedAttrs getChainAttrs(const StratifiedSets<Value *> &Sets,
+                                     StratifiedIndex Index) {
+  auto Current = Index;
+  while (Sets.hasBelow(Current))
+    Current = Sets.getBelow(Current);
+  return Sets.getAttrs(Current) & StratifiedAttrs(AttrExternal);
+}
+
+static hash_code getFingerprint(Instruction *Inst) {
+  return hash_combine(Inst->getOpcode(), Inst->getType(),
+                      hash_combine_range(Inst->value_op_begin(),
+                                         Inst->value_op_end()));
+}
+
+static void noteEdgeAttributes(StratifiedSetsBuilder<Value *> &Builder,
+                               Value *From, Value *To,
+                               StratifiedAttrs Aliasing) {
+  if (auto MaybeFromIndex = valueToAttrIndex(From))
+    Aliasing.set(*MaybeFromIndex);
+  if (auto MaybeToIndex = valueToAttrIndex(To))
+    Aliasing.set(*MaybeToIndex);
+  Builder.noteAttributes(From, Aliasing);
+  Builder.noteAttributes(To, Aliasing);
+}
+
+static void addEdgeTo(StratifiedSetsBuilder<Value *> &Builder, const Edge &E) {
+  Builder.add(E.From);
+  Builder.add(E.To);
+
+  // buildSetsFrom doesn't follow edges through constants either
+  if ((isa<Constant>(E.From) && !isa<GlobalValue>(E.From)) ||
+      (isa<Constant>(E.To) && !isa<GlobalValue>(E.To)))
+    return;
+
+  switch (directionOfEdgeType(E.Weight)) {
+  case Level::Above:
+    Builder.addAbove(E.From, E.To);
+    break;
+  case Level::Below:
+    Builder.addBelow(E.From, E.To);
+    break;
+  case Level::Same:
+    Builder.addWith(E.From, E.To);
+    break;
+  }
+  noteEdgeAttributes(Builder, E.From, E.To, E.AdditionalAttrs);
+}
+
+static Optional<FunctionSummary> buildSummaryFrom(const FunctionInfo &Info,
+                                                  Function *Fn) {
+  // I put this here to give us an upper bound on time taken by IPA. Is it
+  // really (realistically) needed? Keep in mind that we do have an n^2 algo.
+  const unsigned MaxSupportedArgs = 50;
+  if (Fn->arg_size() > MaxSupportedArgs)
+    return NoneType();
+
+  auto &Sets = Info.Sets;
+  FunctionSummary Summary;
+
+  SmallVector<StratifiedIndex, 8> Params;
+  for (auto &Param : Fn->args()) {
+    auto MaybeInfo = Sets.find(&Param);
+    // Did a new parameter somehow get added to the function/slip by?
+    if (!MaybeInfo.hasValue())
+      return NoneType();
+    Params.push_back(MaybeInfo->Index);
+    Summary.ArgAttrs.push_back(getChainAttrs(Sets, MaybeInfo->Index));
+  }
+
+  SmallVector<StratifiedIndex, 4> Returns;
+  for (auto *RetVal : Info.ReturnedValues) {
+    if (auto MaybeInfo = Sets.find(RetVal)) {
+      Returns.push_back(MaybeInfo->Index);
+      Summary.ReturnAttrs |= getChainAttrs(Sets, MaybeInfo->Index);
+      continue;
+    }
+
+    // Values that never took part in an edge. Only constants can end up here,
+    // and the only ones we have to care about are the ones pointing somewhere.
+    if (!isa<Constant>(RetVal))
+      return NoneType();
+    if (!RetVal->getType()->isPointerTy() ||
+        isa<ConstantPointerNull>(RetVal) || isa<UndefValue>(RetVal))
+      continue;
+    Summary.ReturnAttrs.set(isa<GlobalValue>(RetVal) ? AttrGlobalIndex
+                                                     : AttrAllIndex);
+  }
+
+  for (unsigned I = 0, E = Params.size(); I != E; ++I) {
+    for (unsigned X = I + 1; X != E; ++X)
+      if (getIndexRelation(Sets, Params[I], Params[X]).hasValue())
+        Summary.RelatedArgs.push_back(std::make_pair(I, X));
+
+    for (auto RetIndex : Returns) {
+      if (getIndexRelation(Sets, Params[I], RetIndex).hasValue()) {
+        Summary.ReturnedArgs.push_back(I);
+        break;
+      }
+    }
+  }
+
+  return Summary;
+}
+
 // Aside: We may remove graph construction entirely, because it doesn't really
 // buy us much that we don't already have. I'd like to add interprocedural
 // analysis prior to this however, in case that somehow requires the graph
 // produced by this for efficient execution
 static void buildGraphFrom(CFLAliasAnalysis &Analysis, Function *Fn,
                            SmallVectorImpl<Value *> &ReturnedValues,
+                           FingerprintMapT &Fingerprints,
                            NodeMapT &Map, GraphT &Graph) {
   const auto findOrInsertNode = [&Map, &Graph](Value *Val) {
     auto Pair = Map.insert(std::make_pair(Val, GraphT::Node()));
@@ -832,11 +998,13 @@ static void buildGraphFrom(CFLAliasAnalysis &Analysis, Function *Fn,
       // We don't want the edges of most "return" instructions, but we *do* want
       // to know what can be returned.
       if (auto *Ret = dyn_cast<ReturnInst>(&Inst))
-        ReturnedValues.push_back(Ret);
+        if (auto *RetVal = Ret->getReturnValue())
+          ReturnedValues.push_back(RetVal);
 
       if (!hasUsefulEdges(&Inst))
         continue;
 
+      Fingerprints.insert(std::make_pair(&Inst, getFingerprint(&Inst)));
       Edges.clear();
       argsToEdges(Analysis, &Inst, Edges);
 
@@ -866,8 +1034,9 @@ static FunctionInfo buildSetsFrom(CFLAliasAnalysis &Analysis, Function *Fn) {
   NodeMapT Map;
   GraphT Graph;
   SmallVector<Value *, 4> ReturnedValues;
+  FingerprintMapT Fingerprints;
 
-  buildGraphFrom(Analysis, Fn, ReturnedValues, Map, Graph);
+  buildGraphFrom(Analysis, Fn, ReturnedValues, Fingerprints, Map, Graph);
 
   DenseMap<GraphT::Node, Value *> NodeValueMap;
   NodeValueMap.resize(Map.size());
@@ -918,16 +1087,13 @@ static FunctionInfo buildSetsFrom(CFLAliasAnalysis &Analysis, Function *Fn) {
           break;
         }
 
-        if (Added) {
-          auto Aliasing = Weight.second;
-          if (auto MaybeCurIndex = valueToAttrIndex(CurValue))
-            Aliasing.set(*MaybeCurIndex);
-          if (auto MaybeOtherIndex = valueToAttrIndex(OtherValue))
-            Aliasing.set(*MaybeOtherIndex);
-          Builder.noteAttributes(CurValue, Aliasing);
-          Builder.noteAttributes(OtherValue, Aliasing);
+        // Attributes are noted even if OtherValue was already in place, so
+        // that self edges (i.e. for landingpads) and edges between values that
+        // were merged through some other path aren't lost.
+        noteEdgeAttributes(Builder, CurValue, OtherValue, Weight.second);
+
+        if (Added)
           Worklist.push_back(OtherNode);
-        }
       }
     }
   }
@@ -940,7 +1106,10 @@ static FunctionInfo buildSetsFrom(CFLAliasAnalysis &Analysis, Function *Fn) {
     Builder.add(&Arg);
   }
 
-  return FunctionInfo(Builder.build(), std::move(ReturnedValues));
+  FunctionInfo Info(Builder.build(), std::move(ReturnedValues));
+  Info.Summary = buildSummaryFrom(Info, Fn);
+  Info.Fingerprints = std::move(Fingerprints);
+  return Info;
 }
 
 void CFLAliasAnalysis::scan(Function *Fn) {
@@ -954,6 +1123,124 @@ void CFLAliasAnalysis::scan(Function *Fn) {
   Handles.push_front(FunctionHandle(Fn, this));
 }
 
+bool CFLAliasAnalysis::update(Function *Fn) {
+  auto Iter = Cache.find(Fn);
+  if (Iter == Cache.end() || !Iter->second.hasValue())
+    return false;
+
+  // Whatever is left in Info.Fingerprints after this walk was removed, or
+  // changed in place.
+  SmallVector<Value *, 4> ReturnedValues;
+  FingerprintMapT Fingerprints;
+  SmallVector<Instruction *, 8> Added;
+  auto &OldFingerprints = Iter->second->Fingerprints;
+  for (auto &Bb : *Fn) {
+    for (auto &Inst : Bb) {
+      if (auto *Ret = dyn_cast<ReturnInst>(&Inst))
+        if (auto *RetVal = Ret->getReturnValue())
+          ReturnedValues.push_back(RetVal);
+
+      if (!hasUsefulEdges(&Inst))
+        continue;
+
+      auto Fingerprint = getFingerprint(&Inst);
+      Fingerprints.insert(std::make_pair(&Inst, Fingerprint));
+      auto OldIter = OldFingerprints.find(&Inst);
+      if (OldIter != OldFingerprints.end() && OldIter->second == Fingerprint) {
+        OldFingerprints.erase(OldIter);
+        continue;
+      }
+      Added.push_back(&Inst);
+    }
+  }
+
+  if (Added.empty() && OldFingerprints.empty()) {
+    Iter->second->Fingerprints = std::move(Fingerprints);
+    return false;
+  }
+
+  // Getting the edges of calls may scan their callees, and so move our entry
+  // of the cache around.
+  SmallVector<Edge, 8> Edges;
+  SmallVector<Value *, 4> Targets;
+  for (auto *Inst : Added) {
+    SmallVector<Edge, 8> InstEdges;
+    argsToEdges(*this, Inst, InstEdges);
+    if (InstEdges.empty())
+      Targets.push_back(*getTargetValue(Inst));
+    Edges.append(InstEdges.begin(), InstEdges.end());
+  }
+
+  auto &Info = *Cache.find(Fn)->second;
+  StratifiedSetsBuilder<Value *> Builder(std::move(Info.Sets));
+  // Removed instructions may have their address reused by added ones, so
+  // they must be forgotten first.
+  for (const auto &Pair : Info.Fingerprints)
+    Builder.remove(Pair.first);
+  for (auto *Target : Targets)
+    Builder.add(Target);
+  for (const auto &E : Edges)
+    addEdgeTo(Builder, E);
+
+  Info.Sets = Builder.build();
+  Info.ReturnedValues = std::move(ReturnedValues);
+  Info.Fingerprints = std::move(Fingerprints);
+  auto OldSummary = std::move(Info.Summary);
+  Info.Summary = buildSummaryFrom(Info, Fn);
+
+  ++NumUpdates;
+  NumUpdatedInsts += Added.size();
+  if (OldSummary.hasValue() != Info.Summary.hasValue())
+    return true;
+  return OldSummary.hasValue() && !(*OldSummary == *Info.Summary);
+}
+
+void CFLAliasAnalysis::invalidateCachedInfo(Function *Fn) {
+  bool SummaryChanged = false;
+  if (Fn) {
+    SummaryChanged = update(Fn);
+  } else {
+    SmallVector<Function *, 16> Fns;
+    for (const auto &Pair : Cache)
+      Fns.push_back(Pair.first);
+    for (auto *F : Fns)
+      SummaryChanged |= update(F);
+  }
+
+  // Callers of a function whose summary changed have edges for the old one,
+  // and we don't keep track of who they are.
+  if (SummaryChanged) {
+    ++NumSummaryChanges;
+    Cache.clear();
+    Handles.clear();
+  }
+}
+
+// Answers a query from the sets of its two values. MayAlias means the sets
+// cannot tell.
+static AliasAnalysis::AliasResult
+aliasFromSets(const StratifiedSets<Value *> &Sets, StratifiedInfo SetA,
+              StratifiedInfo SetB) {
+  if (SetA.Index == SetB.Index)
+    return AliasAnalysis::PartialAlias;
+
+  auto AttrsA = Sets.getAttrs(SetA.Index);
+  auto AttrsB = Sets.getAttrs(SetB.Index);
+  // Stratified set attributes are used as markets to signify whether a member
+  // of a StratifiedSet (or a member of a set above the current set) has 
+  // interacted with either arguments or globals. "Interacted with" meaning
+  // its value may be different depending on the value of an argument or 
+  // global. The thought behind this is that, because arguments and globals
+  // may alias each other, if AttrsA and AttrsB have touched args/globals,
+  // we must conservatively say that they alias. However, if at least one of 
+  // the sets has no values that could legally be altered by changing the value 
+  // of an argument or global, then we don't have to be as conservative.
+  if (AttrsA.any() && AttrsB.any())
+    return AliasAnalysis::MayAlias;
+
+  return AliasAnalysis::NoAlias;
+}
+
 AliasAnalysis::AliasResult
 CFLAliasAnalysis::query(const AliasAnalysis::Location &LocA,
                         const AliasAnalysis::Location &LocB) {
@@ -989,25 +1276,45 @@ CFLAliasAnalysis::query(const AliasAnalysis::Location &LocA,
   if (!MaybeB.hasValue())
     return AliasAnalysis::MayAlias;
 
-  auto SetA = *MaybeA;
-  auto SetB = *MaybeB;
+  return aliasFromSets(Sets, *MaybeA, *MaybeB);
+}
 
-  if (SetA.Index == SetB.Index)
-    return AliasAnalysis::PartialAlias;
+void CFLAliasAnalysis::aliasBatch(ArrayRef<Location> Locs,
+                                  AliasMatrix &Matrix) {
+  // The locations of a batch are all in the same function, so its sets are
+  // looked up once, and so is the set of each location.
+  const StratifiedSets<Value *> *Sets = nullptr;
+  for (const Location &Loc : Locs)
+    if (auto MaybeFn = parentFunctionOfValue(const_cast<Value *>(Loc.Ptr))) {
+      Sets = &ensureCached(*MaybeFn)->Sets;
+      break;
+    }
 
-  auto AttrsA = Sets.getLink(SetA.Index).Attrs;
-  auto AttrsB = Sets.getLink(SetB.Index).Attrs;
-  // Stratified set attributes are used as markets to signify whether a member
-  // of a StratifiedSet (or a member of a set above the current set) has 
-  // interacted with either arguments or globals. "Interacted with" meaning
-  // its value may be different depending on the value of an argument or 
-  // global. The thought behind this is that, because arguments and globals
-  // may alias each other, if AttrsA and AttrsB have touched args/globals,
-  // we must conservatively say that they alias. However, if at least one of 
-  // the sets has no values that could legally be altered by changing the value 
-  // of an argument or global, then we don't have to be as conservative.
-  if (AttrsA.any() && AttrsB.any())
-    return AliasAnalysis::MayAlias;
+  SmallVector<Optional<StratifiedInfo>, 16> Infos;
+  for (const Location &Loc : Locs)
+    Infos.push_back(Sets ? Sets->find(const_cast<Value *>(Loc.Ptr))
+                         : Optional<StratifiedInfo>());
 
-  return AliasAnalysis::NoAlias;
+  for (unsigned I = 1, E = Locs.size(); I < E; ++I)
+    for (unsigned J = 0; J != I; ++J) {
+      if (Matrix.isKnown(I, J))
+        continue;
+      const Location &LocA = Locs[I], &LocB = Locs[J];
+      if (LocA.Ptr == LocB.Ptr) {
+        Matrix.set(I, J, LocA.Size == LocB.Size ? MustAlias : PartialAlias);
+        continue;
+      }
+
+      // Like alias, leave constants to the rest of the chain.
+      if (isa<Constant>(LocA.Ptr) && isa<Constant>(LocB.Ptr))
+        continue;
+      if (!Infos[I].hasValue() || !Infos[J].hasValue())
+        continue;
+
+      AliasResult Result = aliasFromSets(*Sets, *Infos[I], *Infos[J]);
+      if (Result != MayAlias)
+        Matrix.set(I, J, Result);
+    }
+
+  AliasAnalysis::forwardAliasBatch(Locs, Matrix);
 }
@@ -416,8 +416,12 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
     Changed |= RunPassOnSCC(P, CurSCC, CG,
                             CallGraphUpToDate, DevirtualizedCall);
     
-    if (Changed)
+    // CGSCC passes may also modify or delete functions outside of the SCC,
+    // so the whole module is considered changed.
+    if (Changed) {
       dumpPassInfo(P, MODIFICATION_MSG, ON_CG_MSG, "");
+      invalidateImmutablePasses(nullptr);
+    }
     dumpPreservedSet(P);
     
     verifyPreservedAnalysis(P);      
@@ -191,6 +191,18 @@ void LPPassManager::getAnalysisUsage(AnalysisUsage &Info) const {
   Info.setPreservesAll();
 }
 
+FunctionPass *LPPassManager::createConcurrentInstance() const {
+  std::unique_ptr<LPPassManager> PM(new LPPassManager());
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    LoopPass *LP = static_cast<LoopPass *>(PassVector[Index]);
+    LoopPass *Instance = LP->createConcurrentInstance();
+    if (!Instance)
+      return nullptr;
+    PM->add(Instance, false);
+  }
+  return PM.release();
+}
+
 /// run - Execute all of the passes scheduled for execution.  Keep track of
 /// whether any of the passes modifies the function, and if so, return true.
 bool LPPassManager::runOnFunction(Function &F) {
@@ -249,10 +261,12 @@ bool LPPassManager::runOnFunction(Function &F) {
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
 
-      if (Changed)
+      if (Changed) {
         dumpPassInfo(P, MODIFICATION_MSG, ON_LOOP_MSG,
                      skipThisLoop ? "<deleted>" :
                                     CurrentLoop->getHeader()->getName());
+        invalidateImmutablePasses(&F);
+      }
       dumpPreservedSet(P);
 
       if (!skipThisLoop) {
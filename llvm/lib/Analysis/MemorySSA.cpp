@@ -0,0 +1,644 @@
+//===- MemorySSA.cpp - Memory SSA form ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file builds the memory SSA form of a function and implements the walker
+// finding the accesses that clobber a location.  MemoryPhis are placed at the
+// iterated dominance frontier of the blocks defining memory, then a walk of
+// the dominator tree links every access to the version of memory reaching it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <queue>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+static cl::opt<bool>
+VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Verify memory SSA after building or updating it"));
+
+/// MaxWalkDepth - The number of MemoryPhis the walker goes through
+/// recursively before settling for the phi itself, to bound its stack usage.
+static const unsigned MaxWalkDepth = 100;
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess and its subclasses
+//===----------------------------------------------------------------------===//
+
+void MemoryAccessUse::addToList(MemoryAccessUse **List) {
+  Next = *List;
+  if (Next)
+    Next->Prev = &Next;
+  Prev = List;
+  *List = this;
+}
+
+void MemoryAccessUse::removeFromList() {
+  *Prev = Next;
+  if (Next)
+    Next->Prev = Prev;
+}
+
+void MemoryAccessUse::set(MemoryAccess *V) {
+  if (Val)
+    removeFromList();
+  Val = V;
+  if (V)
+    addToList(&V->UseList);
+}
+
+MemoryAccess::~MemoryAccess() {
+  assert(use_empty() && "Memory access deleted while still in use!");
+}
+
+void MemoryAccess::replaceAllUsesWith(MemoryAccess *New) {
+  assert(New != this && "Memory access replaced with itself!");
+  while (UseList)
+    UseList->set(New);
+}
+
+void MemoryAccess::printID(raw_ostream &OS) const {
+  const MemoryDef *Def = dyn_cast<MemoryDef>(this);
+  if (Def && !Def->getMemoryInst())
+    OS << "liveOnEntry";
+  else
+    OS << getID();
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << "\n";
+}
+
+static void printDefiningAccess(raw_ostream &OS, const MemoryAccess *MA) {
+  if (MA)
+    MA->printID(OS);
+  else
+    OS << "null";
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  printDefiningAccess(OS, getDefiningAccess());
+  OS << ')';
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  printID(OS);
+  OS << " = MemoryDef(";
+  printDefiningAccess(OS, getDefiningAccess());
+  OS << ')';
+}
+
+MemoryPhi::MemoryPhi(BasicBlock *BB, ArrayRef<BasicBlock *> Preds, unsigned ID)
+    : MemoryAccess(MemoryPhiKind, BB), Blocks(Preds.begin(), Preds.end()),
+      Incoming(new MemoryAccessUse[Preds.size()]), ID(ID) {
+  for (unsigned I = 0, E = Preds.size(); I != E; ++I)
+    Incoming[I].User = this;
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << ID << " = MemoryPhi(";
+  for (unsigned I = 0, E = getNumIncomingValues(); I != E; ++I) {
+    if (I)
+      OS << ',';
+    OS << '{';
+    BasicBlock *BB = getIncomingBlock(I);
+    if (BB->hasName())
+      OS << BB->getName();
+    else
+      BB->printAsOperand(OS, false);
+    OS << ',';
+    printDefiningAccess(OS, getIncomingValue(I));
+    OS << '}';
+  }
+  OS << ')';
+}
+
+/// dropReferences - Make MA use no other access, so that it can be deleted
+/// in any order with the rest.
+static void dropReferences(MemoryAccess &MA) {
+  if (MemoryUseOrDef *UD = dyn_cast<MemoryUseOrDef>(&MA)) {
+    UD->setDefiningAccess(nullptr);
+    return;
+  }
+  MemoryPhi &Phi = cast<MemoryPhi>(MA);
+  for (unsigned I = 0, E = Phi.getNumIncomingValues(); I != E; ++I)
+    Phi.setIncomingValue(I, nullptr);
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &Fn, AliasAnalysis &AA, DominatorTree &DT)
+    : F(Fn), AA(&AA), DT(&DT),
+      LiveOnEntryDef(new MemoryDef(nullptr, &Fn.getEntryBlock())) {
+  SmallPtrSet<BasicBlock *, 32> DefiningBlocks;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB) {
+      MemoryUseOrDef *MA = createMemoryAccess(&I);
+      if (!MA)
+        continue;
+      getOrCreateAccessList(&BB).push_back(MA);
+      InstructionToAccess[&I] = MA;
+      if (isa<MemoryDef>(MA))
+        DefiningBlocks.insert(&BB);
+    }
+
+  placePHINodes(DefiningBlocks);
+  renamePass();
+  numberAccesses();
+  Walker.reset(new MemorySSAWalker(*this));
+
+  if (VerifyMemorySSA)
+    verifyMemorySSA();
+}
+
+MemorySSA::~MemorySSA() {
+  // Drop the links between accesses first, as none may be deleted in use.
+  for (auto &Entry : PerBlockAccesses)
+    for (MemoryAccess &MA : *Entry.second)
+      dropReferences(MA);
+  PerBlockAccesses.clear();
+}
+
+MemorySSA::AccessListType &
+MemorySSA::getOrCreateAccessList(const BasicBlock *BB) {
+  std::unique_ptr<AccessListType> &Accesses = PerBlockAccesses[BB];
+  if (!Accesses)
+    Accesses.reset(new AccessListType());
+  return *Accesses;
+}
+
+MemoryUseOrDef *MemorySSA::createMemoryAccess(Instruction *I) {
+  bool Def, Use;
+  if (ImmutableCallSite CS = I) {
+    AliasAnalysis::ModRefBehavior MRB = AA->getModRefBehavior(CS);
+    if (MRB == AliasAnalysis::DoesNotAccessMemory)
+      return nullptr;
+    Def = !AliasAnalysis::onlyReadsMemory(MRB);
+    Use = !Def;
+  } else {
+    Def = I->mayWriteToMemory();
+    Use = I->mayReadFromMemory();
+  }
+
+  if (Def)
+    return new MemoryDef(I, I->getParent());
+  if (Use)
+    return new MemoryUse(I, I->getParent());
+  return nullptr;
+}
+
+/// placePHINodes - Start each block of the iterated dominance frontier of
+/// DefiningBlocks with a MemoryPhi, the same way PromoteMemToReg places the
+/// PHI nodes of an alloca.
+void MemorySSA::placePHINodes(
+    const SmallPtrSetImpl<BasicBlock *> &DefiningBlocks) {
+  DenseMap<DomTreeNode *, unsigned> DomLevels;
+  SmallVector<DomTreeNode *, 32> Worklist;
+  DomTreeNode *Root = DT->getRootNode();
+  DomLevels[Root] = 0;
+  Worklist.push_back(Root);
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.pop_back_val();
+    unsigned ChildLevel = DomLevels[Node] + 1;
+    for (DomTreeNode *Child : *Node) {
+      DomLevels[Child] = ChildLevel;
+      Worklist.push_back(Child);
+    }
+  }
+
+  // Use a priority queue keyed on dominator tree level so that inserted nodes
+  // are handled from the bottom of the dominator tree upwards.
+  typedef std::pair<DomTreeNode *, unsigned> DomTreeNodePair;
+  typedef std::priority_queue<DomTreeNodePair, SmallVector<DomTreeNodePair, 32>,
+                              less_second> IDFPriorityQueue;
+  IDFPriorityQueue PQ;
+  for (BasicBlock *BB : DefiningBlocks)
+    if (DomTreeNode *Node = DT->getNode(BB))
+      PQ.push(std::make_pair(Node, DomLevels[Node]));
+
+  SmallVector<BasicBlock *, 32> PhiBlocks;
+  SmallPtrSet<DomTreeNode *, 32> Visited;
+  while (!PQ.empty()) {
+    DomTreeNodePair RootPair = PQ.top();
+    PQ.pop();
+    DomTreeNode *Root = RootPair.first;
+    unsigned RootLevel = RootPair.second;
+
+    // Walk all dominator tree children of Root, inspecting their CFG edges
+    // with targets elsewhere on the dominator tree.  Only targets whose level
+    // is at most Root's level are in the iterated dominance frontier.
+    Worklist.clear();
+    Worklist.push_back(Root);
+    while (!Worklist.empty()) {
+      DomTreeNode *Node = Worklist.pop_back_val();
+      BasicBlock *BB = Node->getBlock();
+
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        DomTreeNode *SuccNode = DT->getNode(*SI);
+        if (SuccNode->getIDom() == Node)
+          continue;
+
+        unsigned SuccLevel = DomLevels[SuccNode];
+        if (SuccLevel > RootLevel)
+          continue;
+
+        if (!Visited.insert(SuccNode).second)
+          continue;
+
+        BasicBlock *SuccBB = SuccNode->getBlock();
+        PhiBlocks.push_back(SuccBB);
+        if (!DefiningBlocks.count(SuccBB))
+          PQ.push(std::make_pair(SuccNode, SuccLevel));
+      }
+
+      for (DomTreeNode *Child : *Node)
+        if (!Visited.count(Child))
+          Worklist.push_back(Child);
+    }
+  }
+
+  for (BasicBlock *BB : PhiBlocks) {
+    SmallVector<BasicBlock *, 8> Preds(pred_begin(BB), pred_end(BB));
+    MemoryPhi *Phi = new MemoryPhi(BB, Preds);
+    BlockToPhi[BB] = Phi;
+    getOrCreateAccessList(BB).push_front(Phi);
+  }
+}
+
+/// renamePass - Link every access to the version of memory reaching it,
+/// walking the dominator tree with the version live at the end of each block.
+void MemorySSA::renamePass() {
+  SmallVector<std::pair<DomTreeNode *, MemoryAccess *>, 32> Worklist;
+  Worklist.push_back(std::make_pair(DT->getRootNode(), LiveOnEntryDef.get()));
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.back().first;
+    MemoryAccess *Incoming = Worklist.back().second;
+    Worklist.pop_back();
+    BasicBlock *BB = Node->getBlock();
+
+    if (AccessListType *Accesses = getWritableBlockAccesses(BB))
+      for (MemoryAccess &MA : *Accesses) {
+        if (MemoryUseOrDef *UD = dyn_cast<MemoryUseOrDef>(&MA)) {
+          UD->setDefiningAccess(Incoming);
+          if (isa<MemoryDef>(UD))
+            Incoming = UD;
+        } else {
+          Incoming = &MA;
+        }
+      }
+
+    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+         ++SI)
+      if (MemoryPhi *Phi = BlockToPhi.lookup(*SI))
+        for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+          if (Phi->getIncomingBlock(I) == BB)
+            Phi->setIncomingValue(I, Incoming);
+
+    for (DomTreeNode *Child : *Node)
+      Worklist.push_back(std::make_pair(Child, Incoming));
+  }
+
+  // Nothing reaches unreachable code, so call its memory live on entry, along
+  // with whatever it feeds into reachable MemoryPhis.
+  for (BasicBlock &BB : F) {
+    if (DT->isReachableFromEntry(&BB))
+      continue;
+    if (AccessListType *Accesses = getWritableBlockAccesses(&BB))
+      for (MemoryAccess &MA : *Accesses)
+        cast<MemoryUseOrDef>(MA).setDefiningAccess(LiveOnEntryDef.get());
+  }
+  for (auto &Entry : BlockToPhi) {
+    MemoryPhi *Phi = Entry.second;
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+      if (!Phi->getIncomingValue(I))
+        Phi->setIncomingValue(I, LiveOnEntryDef.get());
+  }
+}
+
+/// numberAccesses - Number the versions of memory in program order, for
+/// printing.
+void MemorySSA::numberAccesses() {
+  unsigned NextID = 1;
+  for (BasicBlock &BB : F)
+    if (AccessListType *Accesses = getWritableBlockAccesses(&BB))
+      for (MemoryAccess &MA : *Accesses) {
+        if (MemoryDef *Def = dyn_cast<MemoryDef>(&MA))
+          Def->ID = NextID++;
+        else if (MemoryPhi *Phi = dyn_cast<MemoryPhi>(&MA))
+          Phi->ID = NextID++;
+      }
+}
+
+MemoryUseOrDef *MemorySSA::getMemoryAccess(const Instruction *I) const {
+  return InstructionToAccess.lookup(I);
+}
+
+MemoryPhi *MemorySSA::getMemoryAccess(const BasicBlock *BB) const {
+  return BlockToPhi.lookup(BB);
+}
+
+const MemorySSA::AccessListType *
+MemorySSA::getBlockAccesses(const BasicBlock *BB) const {
+  return getWritableBlockAccesses(BB);
+}
+
+MemorySSA::AccessListType *
+MemorySSA::getWritableBlockAccesses(const BasicBlock *BB) const {
+  auto It = PerBlockAccesses.find(BB);
+  return It == PerBlockAccesses.end() ? nullptr : It->second.get();
+}
+
+bool MemorySSA::locallyDominates(const MemoryAccess *A,
+                                 const MemoryAccess *B) const {
+  const BasicBlock *BB = A->getBlock();
+  if (OrderedBlocks.insert(BB).second) {
+    unsigned N = 0;
+    for (const MemoryAccess &MA : *getBlockAccesses(BB))
+      BlockOrder[&MA] = N++;
+  }
+  return BlockOrder.lookup(A) < BlockOrder.lookup(B);
+}
+
+bool MemorySSA::dominates(const MemoryAccess *A, const MemoryAccess *B) const {
+  if (A == B || isLiveOnEntryDef(A))
+    return true;
+  if (isLiveOnEntryDef(B))
+    return false;
+  if (A->getBlock() != B->getBlock())
+    return DT->dominates(A->getBlock(), B->getBlock());
+  return locallyDominates(A, B);
+}
+
+void MemorySSA::removeInstruction(Instruction *I) {
+  Walker->invalidatePointer(I);
+
+  MemoryUseOrDef *MA = InstructionToAccess.lookup(I);
+  if (!MA)
+    return;
+
+  if (isa<MemoryDef>(MA)) {
+    MA->replaceAllUsesWith(MA->getDefiningAccess());
+    Walker->invalidateInfo();
+  }
+  assert(MA->use_empty() && "A MemoryUse has no users!");
+  MA->setDefiningAccess(nullptr);
+
+  InstructionToAccess.erase(I);
+  BlockOrder.erase(MA);
+  auto It = PerBlockAccesses.find(MA->getBlock());
+  It->second->erase(MA);
+  if (It->second->empty())
+    PerBlockAccesses.erase(It);
+}
+
+void MemorySSA::updateForSplitEdge(BasicBlock *Pred, BasicBlock *Succ,
+                                   BasicBlock *NewBB) {
+  // The version of memory leaving NewBB is the one leaving Pred, so NewBB
+  // needs no MemoryPhi and no access has to change.
+  if (MemoryPhi *Phi = getMemoryAccess(Succ)) {
+    auto It = std::find(Phi->Blocks.begin(), Phi->Blocks.end(), Pred);
+    assert(It != Phi->Blocks.end() && "Split edge does not enter the phi!");
+    *It = NewBB;
+  }
+
+  if (VerifyMemorySSA)
+    verifyMemorySSA();
+}
+
+/// print - Print the function's blocks, each access before its instruction
+/// and MemoryPhis at the start of their block.
+void MemorySSA::print(raw_ostream &OS) const {
+  OS << "MemorySSA for function: " << F.getName() << "\n";
+  for (const BasicBlock &BB : F) {
+    if (BB.hasName())
+      OS << BB.getName();
+    else
+      BB.printAsOperand(OS, false);
+    OS << ":\n";
+    if (const MemoryPhi *Phi = getMemoryAccess(&BB))
+      OS << "; " << *Phi << "\n";
+    for (const Instruction &I : BB) {
+      if (const MemoryUseOrDef *MA = getMemoryAccess(&I))
+        OS << "; " << *MA << "\n";
+      OS << I << "\n";
+    }
+  }
+}
+
+void MemorySSA::dump() const {
+  print(dbgs());
+}
+
+void MemorySSA::verifyMemorySSA() const {
+  for (const BasicBlock &BB : F) {
+    const AccessListType *Accesses = getBlockAccesses(&BB);
+    if (!Accesses)
+      continue;
+    bool Reachable = DT->isReachableFromEntry(&BB);
+
+    for (const MemoryAccess &MA : *Accesses) {
+      assert(MA.getBlock() == &BB && "Memory access in the wrong block!");
+
+      if (const MemoryUseOrDef *UD = dyn_cast<MemoryUseOrDef>(&MA)) {
+        assert(getMemoryAccess(UD->getMemoryInst()) == UD &&
+               UD->getMemoryInst()->getParent() == &BB &&
+               "Memory access out of sync with its instruction!");
+        const MemoryAccess *Def = UD->getDefiningAccess();
+        assert(Def && "Memory access without a defining access!");
+        assert((!Reachable || (Def != UD && dominates(Def, UD))) &&
+               "Defining access does not dominate its use!");
+        (void)Def;
+        continue;
+      }
+
+      const MemoryPhi *Phi = cast<MemoryPhi>(&MA);
+      assert(&MA == &Accesses->front() && getMemoryAccess(&BB) == Phi &&
+             "MemoryPhi not at the start of its block!");
+      assert(Phi->getNumIncomingValues() ==
+                 (unsigned)std::distance(pred_begin(&BB), pred_end(&BB)) &&
+             "MemoryPhi does not have an entry for each predecessor!");
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+        const MemoryAccess *In = Phi->getIncomingValue(I);
+        const BasicBlock *Pred = Phi->getIncomingBlock(I);
+        assert(In && "MemoryPhi without an incoming access!");
+        assert(std::find(pred_begin(&BB), pred_end(&BB), Pred) !=
+                   pred_end(&BB) &&
+               "MemoryPhi entry for a block that is not a predecessor!");
+        assert((isLiveOnEntryDef(In) || !DT->isReachableFromEntry(Pred) ||
+                DT->dominates(In->getBlock(), Pred)) &&
+               "Incoming access does not dominate its predecessor!");
+        (void)In;
+        (void)Pred;
+      }
+      (void)Phi;
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWrapperPass
+//===----------------------------------------------------------------------===//
+
+char MemorySSAWrapperPass::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                      true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
+                    true)
+
+MemorySSAWrapperPass::MemorySSAWrapperPass() : FunctionPass(ID) {
+  initializeMemorySSAWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
+void MemorySSAWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<AliasAnalysis>();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+}
+
+bool MemorySSAWrapperPass::runOnFunction(Function &F) {
+  MSSA.reset(new MemorySSA(F, getAnalysis<AliasAnalysis>(),
+                           getAnalysis<DominatorTreeWrapperPass>().getDomTree()));
+  return false;
+}
+
+void MemorySSAWrapperPass::print(raw_ostream &OS, const Module *) const {
+  if (MSSA)
+    MSSA->print(OS);
+}
+
+void MemorySSAWrapperPass::verifyAnalysis() const {
+  if (MSSA)
+    MSSA->verifyMemorySSA();
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWalker
+//===----------------------------------------------------------------------===//
+
+MemorySSAWalker::MemorySSAWalker(MemorySSA &MSSA)
+    : MSSA(MSSA), AA(MSSA.getAliasAnalysis()) {}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *MA = MSSA.getMemoryAccess(I);
+  if (!MA)
+    return nullptr;
+
+  MemoryAccess *Start = MA->getDefiningAccess();
+  AliasAnalysis::Location Loc;
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    if (!LI->isSimple())
+      return Start;
+    Loc = AA.getLocation(LI);
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(I)) {
+    if (!SI->isSimple())
+      return Start;
+    Loc = AA.getLocation(SI);
+  } else {
+    return Start;
+  }
+  return getClobberingMemoryAccess(Start, Loc);
+}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(MemoryAccess *Start,
+                                           const AliasAnalysis::Location &Loc) {
+  MemoryAccess *Result = walk(Start, Loc, 0);
+  assert(PhisInProgress.empty() && "Unbalanced MemoryPhi walk!");
+  return Result;
+}
+
+MemoryAccess *MemorySSAWalker::walk(MemoryAccess *Start,
+                                    const AliasAnalysis::Location &Loc,
+                                    unsigned Depth) {
+  // The definitions skipped on the way share the answer.
+  SmallVector<MemoryAccess *, 16> Skipped;
+  MemoryAccess *Cur = Start;
+  MemoryAccess *Result;
+  while (true) {
+    auto It = Cache.find(CacheKey(Cur, Loc));
+    if (It != Cache.end()) {
+      Result = It->second;
+      break;
+    }
+    if (MSSA.isLiveOnEntryDef(Cur)) {
+      Result = Cur;
+      break;
+    }
+    if (MemoryPhi *Phi = dyn_cast<MemoryPhi>(Cur)) {
+      Result = walkPhi(Phi, Loc, Depth);
+      break;
+    }
+    MemoryDef *Def = cast<MemoryDef>(Cur);
+    Skipped.push_back(Def);
+    if (AA.getModRefInfo(Def->getMemoryInst(), Loc) & AliasAnalysis::Mod) {
+      Result = Def;
+      break;
+    }
+    Cur = Def->getDefiningAccess();
+  }
+
+  if (!Skipped.empty())
+    CachedPointers.insert(Loc.Ptr);
+  for (MemoryAccess *MA : Skipped)
+    Cache[CacheKey(MA, Loc)] = Result;
+  return Result;
+}
+
+/// walkPhi - Return the access clobbering Loc on every path into Phi, or Phi
+/// itself if they differ.  Paths going around a cycle back to a MemoryPhi
+/// being walked have no clobber of their own and are left out.  Every answer
+/// is an access dominating the query with no clobber in between, so answers
+/// found within a cycle remain correct, if less precise, outside of it.
+MemoryAccess *MemorySSAWalker::walkPhi(MemoryPhi *Phi,
+                                       const AliasAnalysis::Location &Loc,
+                                       unsigned Depth) {
+  if (PhisInProgress.count(Phi) || Depth >= MaxWalkDepth)
+    return Phi;
+
+  PhisInProgress.insert(Phi);
+  MemoryAccess *Result = nullptr;
+  for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+    MemoryAccess *R = walk(Phi->getIncomingValue(I), Loc, Depth + 1);
+    if (R == Phi)
+      continue;
+    if (!Result) {
+      Result = R;
+    } else if (Result != R) {
+      Result = Phi;
+      break;
+    }
+  }
+  PhisInProgress.erase(Phi);
+
+  if (!Result)
+    Result = Phi;
+  CachedPointers.insert(Loc.Ptr);
+  Cache[CacheKey(Phi, Loc)] = Result;
+  return Result;
+}
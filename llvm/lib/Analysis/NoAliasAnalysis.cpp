@@ -44,6 +44,10 @@ namespace {
       return MayAlias;
     }
 
+    void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) override {
+      // Pairs left unknown are MayAlias.
+    }
+
     ModRefBehavior getModRefBehavior(ImmutableCallSite CS) override {
       return UnknownModRefBehavior;
     }
@@ -96,10 +96,12 @@ bool RGPassManager::runOnFunction(Function &F) {
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
-      if (Changed)
+      if (Changed) {
         dumpPassInfo(P, MODIFICATION_MSG, ON_REGION_MSG,
                      skipThisRegion ? "<deleted>" :
                                     CurrentRegion->getNameStr());
+        invalidateImmutablePasses(&F);
+      }
       dumpPreservedSet(P);
 
       if (!skipThisRegion) {
@@ -100,6 +100,7 @@ protected:
 private:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   AliasResult alias(const Location &LocA, const Location &LocB) override;
+  void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) override;
   bool pointsToConstantMemory(const Location &Loc, bool OrLocal) override;
   ModRefBehavior getModRefBehavior(ImmutableCallSite CS) override;
   ModRefBehavior getModRefBehavior(const Function *F) override;
@@ -193,6 +194,37 @@ ScopedNoAliasAA::alias(const Location &LocA, const Location &LocB) {
   return AliasAnalysis::alias(LocA, LocB);
 }
 
+void ScopedNoAliasAA::aliasBatch(ArrayRef<Location> Locs,
+                                 AliasMatrix &Matrix) {
+  if (!EnableScopedNoAlias)
+    return AliasAnalysis::forwardAliasBatch(Locs, Matrix);
+
+  // Accesses in a batch share few distinct scope lists, so compare the scopes
+  // of one with the noalias list of the other once per pair of lists.
+  SmallDenseMap<std::pair<const MDNode *, const MDNode *>, bool, 8> InScopes;
+  auto mayAlias = [&](const MDNode *Scopes, const MDNode *NoAliasList) {
+    if (!Scopes || !NoAliasList)
+      return true;
+    auto Pair = InScopes.insert(
+        std::make_pair(std::make_pair(Scopes, NoAliasList), true));
+    if (Pair.second)
+      Pair.first->second = mayAliasInScopes(Scopes, NoAliasList);
+    return Pair.first->second;
+  };
+
+  for (unsigned I = 1, E = Locs.size(); I < E; ++I)
+    for (unsigned J = 0; J != I; ++J) {
+      if (Matrix.isKnown(I, J))
+        continue;
+      const AAMDNodes &A = Locs[I].AATags, &B = Locs[J].AATags;
+      if (!mayAlias(A.Scope, B.NoAlias) || !mayAlias(B.Scope, A.NoAlias))
+        Matrix.set(I, J, NoAlias);
+    }
+
+  // Chain the pairs that may alias to the next AliasAnalysis.
+  AliasAnalysis::forwardAliasBatch(Locs, Matrix);
+}
+
 bool ScopedNoAliasAA::pointsToConstantMemory(const Location &Loc,
                                              bool OrLocal) {
   return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
@@ -13,12 +13,12 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallPtrSet.h"
-#include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Compiler.h"
 #include <bitset>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 #include <utility>
@@ -47,6 +47,11 @@ static const unsigned NumStratifiedAttrs = 32;
 // attribute in set A, then the attribute will automatically be set in set B.
 typedef std::bitset<NumStratifiedAttrs> StratifiedAttrs;
 
+// StratifiedSets keep the attributes of each set packed in one of these.
+typedef uint32_t StratifiedAttrWord;
+static_assert(NumStratifiedAttrs <= sizeof(StratifiedAttrWord) * 8,
+              "StratifiedAttrs don't fit in a StratifiedAttrWord");
+
 // \brief A "link" between two StratifiedSets.
 struct StratifiedLink {
   // \brief This is a value used to signify "does not exist" where
@@ -74,6 +79,8 @@ struct StratifiedLink {
   void clearAbove() { Above = SetSentinel; }
 };
 
+template <typename T> class StratifiedSetsBuilder;
+
 // \brief These are stratified sets, as described in "Fast algorithms for
 // Dyck-CFL-reachability with applications to Alias Analysis" by Zhang Q, Lyu M
 // R, Yuan H, and Su Z. -- in short, this is meant to represent different sets
@@ -93,19 +100,22 @@ struct StratifiedLink {
 // the variable may have had operations performed on it (modified in a function
 // call). All attributes that exist in a set A must exist in all sets marked as
 // below set A.
+//
+// Internally, sets are only numbers: the links of each set and its attributes
+// live in flat arrays indexed by set number, with the attributes packed in a
+// StratifiedAttrWord. Walking a chain only touches the link arrays, and the
+// attributes of a query take two loads from a single array.
 template <typename T> class StratifiedSets {
 public:
   StratifiedSets() {}
 
-  StratifiedSets(DenseMap<T, StratifiedInfo> Map,
-                 std::vector<StratifiedLink> Links)
-      : Values(std::move(Map)), Links(std::move(Links)) {}
-
   StratifiedSets(StratifiedSets<T> &&Other) { *this = std::move(Other); }
 
   StratifiedSets &operator=(StratifiedSets<T> &&Other) {
     Values = std::move(Other.Values);
-    Links = std::move(Other.Links);
+    Above = std::move(Other.Above);
+    Below = std::move(Other.Below);
+    Attrs = std::move(Other.Attrs);
     return *this;
   }
 
@@ -117,16 +127,44 @@ public:
     return Iter->second;
   }
 
-  const StratifiedLink &getLink(StratifiedIndex Index) const {
+  std::size_t numSets() const { return Attrs.size(); }
+
+  bool hasAbove(StratifiedIndex Index) const {
+    assert(inbounds(Index));
+    return Above[Index] != StratifiedLink::SetSentinel;
+  }
+
+  bool hasBelow(StratifiedIndex Index) const {
+    assert(inbounds(Index));
+    return Below[Index] != StratifiedLink::SetSentinel;
+  }
+
+  StratifiedIndex getAbove(StratifiedIndex Index) const {
+    assert(hasAbove(Index));
+    return Above[Index];
+  }
+
+  StratifiedIndex getBelow(StratifiedIndex Index) const {
+    assert(hasBelow(Index));
+    return Below[Index];
+  }
+
+  StratifiedAttrs getAttrs(StratifiedIndex Index) const {
     assert(inbounds(Index));
-    return Links[Index];
+    return StratifiedAttrs(Attrs[Index]);
   }
 
 private:
+  // StratifiedSetsBuilder fills these in, and takes them back when reopening
+  // the sets
+  friend class StratifiedSetsBuilder<T>;
+
   DenseMap<T, StratifiedInfo> Values;
-  std::vector<StratifiedLink> Links;
+  std::vector<StratifiedIndex> Above;
+  std::vector<StratifiedIndex> Below;
+  std::vector<StratifiedAttrWord> Attrs;
 
-  bool inbounds(StratifiedIndex Idx) const { return Idx < Links.size(); }
+  bool inbounds(StratifiedIndex Idx) const { return Idx < Attrs.size(); }
 };
 
 // \brief Generic Builder class that produces StratifiedSets instances.
@@ -210,6 +248,13 @@ private:
 // than doing this at each merge, we note in the BuilderLink structure that a
 // remap has occurred, and use this information so we can defer renumbering set
 // elements until build time.
+//
+// ==== Incremental updates ====
+// A builder may be constructed from already built StratifiedSets, so that the
+// relations of a few new elements can be added without starting over. Sets
+// can't be split again once merged, so relations are never removed: removing
+// an element only forgets about it, and the sets it caused to be merged stay
+// merged. This is conservative, but it keeps updates cheap.
 template <typename T> class StratifiedSetsBuilder {
   // \brief Represents a Stratified Set, with information about the Stratified
   // Set above it, the set below it, and whether the current set has been
@@ -221,6 +266,11 @@ template <typename T> class StratifiedSetsBuilder {
       Remap = StratifiedLink::SetSentinel;
     }
 
+    BuilderLink(StratifiedIndex N, const StratifiedLink &L)
+        : Number(N), Link(L) {
+      Remap = StratifiedLink::SetSentinel;
+    }
+
     bool hasAbove() const {
       assert(!isRemapped());
       return Link.hasAbove();
@@ -309,83 +359,82 @@ template <typename T> class StratifiedSetsBuilder {
   };
 
   // \brief This function performs all of the set unioning/value renumbering
-  // that we've been putting off, and generates a vector<StratifiedLink> that
-  // may be placed in a StratifiedSets instance.
-  void finalizeSets(std::vector<StratifiedLink> &StratLinks) {
-    DenseMap<StratifiedIndex, StratifiedIndex> Remaps;
+  // that we've been putting off, and fills in the links and attributes of
+  // the given StratifiedSets instance.
+  void finalizeSets(StratifiedSets<T> &Sets) {
+    std::vector<StratifiedIndex> Remaps(Links.size(),
+                                        StratifiedLink::SetSentinel);
     for (auto &Link : Links) {
       if (Link.isRemapped()) {
         continue;
       }
 
-      StratifiedIndex Number = StratLinks.size();
-      Remaps.insert(std::make_pair(Link.Number, Number));
-      StratLinks.push_back(Link.getLink());
+      Remaps[Link.Number] = Sets.Attrs.size();
+      const auto &Inner = Link.getLink();
+      Sets.Above.push_back(Inner.Above);
+      Sets.Below.push_back(Inner.Below);
+      Sets.Attrs.push_back(Inner.Attrs.to_ulong());
     }
 
-    for (auto &Link : StratLinks) {
-      if (Link.hasAbove()) {
-        auto &Above = linksAt(Link.Above);
-        auto Iter = Remaps.find(Above.Number);
-        assert(Iter != Remaps.end());
-        Link.Above = Iter->second;
-      }
-
-      if (Link.hasBelow()) {
-        auto &Below = linksAt(Link.Below);
-        auto Iter = Remaps.find(Below.Number);
-        assert(Iter != Remaps.end());
-        Link.Below = Iter->second;
-      }
-    }
+    const auto remapIndex = [this, &Remaps](StratifiedIndex &Index) {
+      if (Index == StratifiedLink::SetSentinel)
+        return;
+      Index = Remaps[linksAt(Index).Number];
+      assert(Index != StratifiedLink::SetSentinel);
+    };
 
-    for (auto &Pair : Values) {
-      auto &Info = Pair.second;
-      auto &Link = linksAt(Info.Index);
-      auto Iter = Remaps.find(Link.Number);
-      assert(Iter != Remaps.end());
-      Info.Index = Iter->second;
-    }
+    for (auto &Index : Sets.Above)
+      remapIndex(Index);
+    for (auto &Index : Sets.Below)
+      remapIndex(Index);
+    for (auto &Pair : Values)
+      remapIndex(Pair.second.Index);
   }
 
   // \brief There's a guarantee in StratifiedLink where all bits set in a
   // Link.externals will be set in all Link.externals "below" it.
-  static void propagateAttrs(std::vector<StratifiedLink> &Links) {
-    const auto getHighestParentAbove = [&Links](StratifiedIndex Idx) {
-      const auto *Link = &Links[Idx];
-      while (Link->hasAbove()) {
-        Idx = Link->Above;
-        Link = &Links[Idx];
-      }
-      return Idx;
-    };
-
-    SmallSet<StratifiedIndex, 16> Visited;
-    for (unsigned I = 0, E = Links.size(); I < E; ++I) {
-      auto CurrentIndex = getHighestParentAbove(I);
-      if (!Visited.insert(CurrentIndex).second) {
+  static void propagateAttrs(StratifiedSets<T> &Sets) {
+    // Each chain is walked down once, from the only set of it that has
+    // nothing above.
+    for (StratifiedIndex I = 0, E = Sets.numSets(); I != E; ++I) {
+      if (Sets.hasAbove(I))
         continue;
-      }
 
-      while (Links[CurrentIndex].hasBelow()) {
-        auto &CurrentBits = Links[CurrentIndex].Attrs;
-        auto NextIndex = Links[CurrentIndex].Below;
-        auto &NextBits = Links[NextIndex].Attrs;
-        NextBits |= CurrentBits;
-        CurrentIndex = NextIndex;
-      }
+      for (auto Current = I; Sets.hasBelow(Current);
+           Current = Sets.getBelow(Current))
+        Sets.Attrs[Sets.getBelow(Current)] |= Sets.Attrs[Current];
     }
   }
 
 public:
+  StratifiedSetsBuilder() {}
+
+  // \brief Reopens Sets, so that it may be updated and built again.
+  explicit StratifiedSetsBuilder(StratifiedSets<T> &&Sets)
+      : Values(std::move(Sets.Values)) {
+    Links.reserve(Sets.numSets());
+    for (StratifiedIndex I = 0, E = Sets.numSets(); I != E; ++I) {
+      StratifiedLink Link;
+      Link.Above = Sets.Above[I];
+      Link.Below = Sets.Below[I];
+      Link.Attrs = Sets.getAttrs(I);
+      Links.push_back(BuilderLink(I, Link));
+    }
+    Sets = StratifiedSets<T>();
+  }
+
   // \brief Builds a StratifiedSet from the information we've been given since
   // either construction or the prior build() call.
   StratifiedSets<T> build() {
-    std::vector<StratifiedLink> StratLinks;
-    finalizeSets(StratLinks);
-    propagateAttrs(StratLinks);
+    StratifiedSets<T> Sets;
+    Sets.Above.reserve(Links.size());
+    Sets.Below.reserve(Links.size());
+    Sets.Attrs.reserve(Links.size());
+    finalizeSets(Sets);
+    propagateAttrs(Sets);
     Links.clear();
-    return StratifiedSets<T>(std::move(Values), std::move(StratLinks));
+    Sets.Values = std::move(Values);
+    return Sets;
   }
 
   std::size_t size() const { return Values.size(); }
@@ -393,6 +442,10 @@ public:
 
   bool has(const T &Elem) const { return get(Elem).hasValue(); }
 
+  // \brief Forgets about Elem. Its set, and whatever was merged because of
+  // it, is left as is. Returns false if Elem wasn't there.
+  bool remove(const T &Elem) { return Values.erase(Elem); }
+
   bool add(const T &Main) {
     if (get(Main).hasValue())
       return false;
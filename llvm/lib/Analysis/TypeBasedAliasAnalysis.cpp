@@ -302,6 +302,7 @@ namespace {
   private:
     void getAnalysisUsage(AnalysisUsage &AU) const override;
     AliasResult alias(const Location &LocA, const Location &LocB) override;
+    void aliasBatch(ArrayRef<Location> Locs, AliasMatrix &Matrix) override;
     bool pointsToConstantMemory(const Location &Loc, bool OrLocal) override;
     ModRefBehavior getModRefBehavior(ImmutableCallSite CS) override;
     ModRefBehavior getModRefBehavior(const Function *F) override;
@@ -469,6 +470,35 @@ TypeBasedAliasAnalysis::alias(const Location &LocA,
   return NoAlias;
 }
 
+void TypeBasedAliasAnalysis::aliasBatch(ArrayRef<Location> Locs,
+                                        AliasMatrix &Matrix) {
+  if (!EnableTBAA)
+    return AliasAnalysis::forwardAliasBatch(Locs, Matrix);
+
+  // A batch usually holds few distinct tags, so walk the type DAG once per
+  // pair of them.
+  SmallDenseMap<std::pair<const MDNode *, const MDNode *>, bool, 8> Disjoint;
+  for (unsigned I = 1, E = Locs.size(); I < E; ++I) {
+    const MDNode *AM = Locs[I].AATags.TBAA;
+    if (!AM)
+      continue;
+    for (unsigned J = 0; J != I; ++J) {
+      const MDNode *BM = Locs[J].AATags.TBAA;
+      if (!BM || Matrix.isKnown(I, J))
+        continue;
+      auto Key = AM < BM ? std::make_pair(AM, BM) : std::make_pair(BM, AM);
+      auto Pair = Disjoint.insert(std::make_pair(Key, false));
+      if (Pair.second)
+        Pair.first->second = !Aliases(AM, BM);
+      if (Pair.first->second)
+        Matrix.set(I, J, NoAlias);
+    }
+  }
+
+  // Chain the pairs that may alias to the next AliasAnalysis.
+  AliasAnalysis::forwardAliasBatch(Locs, Matrix);
+}
+
 bool TypeBasedAliasAnalysis::pointsToConstantMemory(const Location &Loc,
                                                     bool OrLocal) {
   if (!EnableTBAA)
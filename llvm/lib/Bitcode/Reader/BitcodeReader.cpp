@@ -22,11 +22,15 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/OperandTraits.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DataStream.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace llvm;
 
@@ -34,6 +38,11 @@ enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
 
+static cl::opt<unsigned>
+ReaderThreads("bitcode-reader-threads", cl::Hidden, cl::init(1),
+              cl::desc("Read the function bodies of a module that is "
+                       "materialized as a whole on this many threads"));
+
 BitcodeDiagnosticInfo::BitcodeDiagnosticInfo(std::error_code EC,
                                              DiagnosticSeverity Severity,
                                              const Twine &Msg)
@@ -1094,8 +1103,9 @@ std::error_code BitcodeReader::ParseTypeTableBody() {
   }
 }
 
-std::error_code BitcodeReader::ParseValueSymbolTable() {
-  if (Stream.EnterSubBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
+template <typename CursorT>
+std::error_code BitcodeReader::ParseValueSymbolTable(CursorT &Cursor) {
+  if (Cursor.EnterSubBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
     return Error("Invalid record");
 
   SmallVector<uint64_t, 64> Record;
@@ -1103,7 +1113,7 @@ std::error_code BitcodeReader::ParseValueSymbolTable() {
   // Read all the records for this value table.
   SmallString<128> ValueName;
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1118,7 +1128,7 @@ std::error_code BitcodeReader::ParseValueSymbolTable() {
 
     // Read a record.
     Record.clear();
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    switch (Cursor.readRecord(Entry.ID, Record)) {
     default:  // Default behavior: unknown type.
       break;
     case bitc::VST_CODE_ENTRY: {  // VST_ENTRY: [valueid, namechar x N]
@@ -1148,17 +1158,18 @@ std::error_code BitcodeReader::ParseValueSymbolTable() {
   }
 }
 
-std::error_code BitcodeReader::ParseMetadata() {
+template <typename CursorT>
+std::error_code BitcodeReader::ParseMetadata(CursorT &Cursor) {
   unsigned NextMDValueNo = MDValueList.size();
 
-  if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+  if (Cursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
     return Error("Invalid record");
 
   SmallVector<uint64_t, 64> Record;
 
   // Read all the records.
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1174,7 +1185,7 @@ std::error_code BitcodeReader::ParseMetadata() {
 
     // Read a record.
     Record.clear();
-    unsigned Code = Stream.readRecord(Entry.ID, Record);
+    unsigned Code = Cursor.readRecord(Entry.ID, Record);
     bool IsDistinct = false;
     switch (Code) {
     default:  // Default behavior: ignore.
@@ -1183,10 +1194,10 @@ std::error_code BitcodeReader::ParseMetadata() {
       // Read name of the named metadata.
       SmallString<8> Name(Record.begin(), Record.end());
       Record.clear();
-      Code = Stream.ReadCode();
+      Code = Cursor.ReadCode();
 
       // METADATA_NAME is always followed by METADATA_NAMED_NODE.
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
+      unsigned NextBitCode = Cursor.readRecord(Code, Record);
       assert(NextBitCode == bitc::METADATA_NAMED_NODE); (void)NextBitCode;
 
       // Read named metadata elements.
@@ -1404,8 +1415,9 @@ static APInt ReadWideAPInt(ArrayRef<uint64_t> Vals, unsigned TypeBits) {
   return APInt(TypeBits, Words);
 }
 
-std::error_code BitcodeReader::ParseConstants() {
-  if (Stream.EnterSubBlock(bitc::CONSTANTS_BLOCK_ID))
+template <typename CursorT>
+std::error_code BitcodeReader::ParseConstants(CursorT &Cursor) {
+  if (Cursor.EnterSubBlock(bitc::CONSTANTS_BLOCK_ID))
     return Error("Invalid record");
 
   SmallVector<uint64_t, 64> Record;
@@ -1414,7 +1426,7 @@ std::error_code BitcodeReader::ParseConstants() {
   Type *CurTy = Type::getInt32Ty(Context);
   unsigned NextCstNo = ValueList.size();
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1436,7 +1448,7 @@ std::error_code BitcodeReader::ParseConstants() {
     // Read a record.
     Record.clear();
     Value *V = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode = Cursor.readRecord(Entry.ID, Record);
     switch (BitCode) {
     default:  // Default behavior: unknown constant
     case bitc::CST_CODE_UNDEF:     // UNDEF
@@ -1853,14 +1865,15 @@ std::error_code BitcodeReader::ParseConstants() {
   }
 }
 
-std::error_code BitcodeReader::ParseUseLists() {
-  if (Stream.EnterSubBlock(bitc::USELIST_BLOCK_ID))
+template <typename CursorT>
+std::error_code BitcodeReader::ParseUseLists(CursorT &Cursor) {
+  if (Cursor.EnterSubBlock(bitc::USELIST_BLOCK_ID))
     return Error("Invalid record");
 
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1876,7 +1889,7 @@ std::error_code BitcodeReader::ParseUseLists() {
     // Read a use list record.
     Record.clear();
     bool IsBB = false;
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    switch (Cursor.readRecord(Entry.ID, Record)) {
     default:  // Default behavior: unknown type.
       break;
     case bitc::USELIST_CODE_BB:
@@ -2010,18 +2023,18 @@ std::error_code BitcodeReader::ParseModule(bool Resume) {
           return EC;
         break;
       case bitc::VALUE_SYMTAB_BLOCK_ID:
-        if (std::error_code EC = ParseValueSymbolTable())
+        if (std::error_code EC = ParseValueSymbolTable(Stream))
           return EC;
         SeenValueSymbolTable = true;
         break;
       case bitc::CONSTANTS_BLOCK_ID:
-        if (std::error_code EC = ParseConstants())
+        if (std::error_code EC = ParseConstants(Stream))
           return EC;
         if (std::error_code EC = ResolveGlobalAndAliasInits())
           return EC;
         break;
       case bitc::METADATA_BLOCK_ID:
-        if (std::error_code EC = ParseMetadata())
+        if (std::error_code EC = ParseMetadata(Stream))
           return EC;
         break;
       case bitc::FUNCTION_BLOCK_ID:
@@ -2048,7 +2061,7 @@ std::error_code BitcodeReader::ParseModule(bool Resume) {
         }
         break;
       case bitc::USELIST_BLOCK_ID:
-        if (std::error_code EC = ParseUseLists())
+        if (std::error_code EC = ParseUseLists(Stream))
           return EC;
         break;
       }
@@ -2468,13 +2481,14 @@ ErrorOr<std::string> BitcodeReader::parseTriple() {
 }
 
 /// ParseMetadataAttachment - Parse metadata attachments.
-std::error_code BitcodeReader::ParseMetadataAttachment() {
-  if (Stream.EnterSubBlock(bitc::METADATA_ATTACHMENT_ID))
+template <typename CursorT>
+std::error_code BitcodeReader::ParseMetadataAttachment(CursorT &Cursor) {
+  if (Cursor.EnterSubBlock(bitc::METADATA_ATTACHMENT_ID))
     return Error("Invalid record");
 
   SmallVector<uint64_t, 64> Record;
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -2489,7 +2503,7 @@ std::error_code BitcodeReader::ParseMetadataAttachment() {
 
     // Read a metadata attachment record.
     Record.clear();
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    switch (Cursor.readRecord(Entry.ID, Record)) {
     default:  // Default behavior: ignore.
       break;
     case bitc::METADATA_ATTACHMENT: {
@@ -2519,8 +2533,10 @@ std::error_code BitcodeReader::ParseMetadataAttachment() {
 }
 
 /// ParseFunctionBody - Lazily parse the specified function body block.
-std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
-  if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+template <typename CursorT>
+std::error_code BitcodeReader::ParseFunctionBody(Function *F,
+                                                 CursorT &Cursor) {
+  if (Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return Error("Invalid record");
 
   InstructionList.clear();
@@ -2548,7 +2564,7 @@ std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
   while (1) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry = Cursor.advance();
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -2559,28 +2575,28 @@ std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
     case BitstreamEntry::SubBlock:
       switch (Entry.ID) {
       default:  // Skip unknown content.
-        if (Stream.SkipBlock())
+        if (Cursor.SkipBlock())
           return Error("Invalid record");
         break;
       case bitc::CONSTANTS_BLOCK_ID:
-        if (std::error_code EC = ParseConstants())
+        if (std::error_code EC = ParseConstants(Cursor))
           return EC;
         NextValueNo = ValueList.size();
         break;
       case bitc::VALUE_SYMTAB_BLOCK_ID:
-        if (std::error_code EC = ParseValueSymbolTable())
+        if (std::error_code EC = ParseValueSymbolTable(Cursor))
           return EC;
         break;
       case bitc::METADATA_ATTACHMENT_ID:
-        if (std::error_code EC = ParseMetadataAttachment())
+        if (std::error_code EC = ParseMetadataAttachment(Cursor))
           return EC;
         break;
       case bitc::METADATA_BLOCK_ID:
-        if (std::error_code EC = ParseMetadata())
+        if (std::error_code EC = ParseMetadata(Cursor))
           return EC;
         break;
       case bitc::USELIST_BLOCK_ID:
-        if (std::error_code EC = ParseUseLists())
+        if (std::error_code EC = ParseUseLists(Cursor))
           return EC;
         break;
       }
@@ -2594,7 +2610,7 @@ std::error_code BitcodeReader::ParseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode = Cursor.readRecord(Entry.ID, Record);
     switch (BitCode) {
     default: // Default behavior: reject
       return Error("Invalid value");
@@ -3461,6 +3477,234 @@ OutOfRecordLoop:
   return std::error_code();
 }
 
+namespace {
+/// The entries of a block, read ahead of time with a cursor of their own.
+/// They are played back through the part of the BitstreamCursor interface
+/// that the parsers of function bodies use.
+class ReadAheadBlock {
+  struct Entry {
+    BitstreamEntry Kind;
+    unsigned Code;
+    unsigned FirstOp;
+    unsigned NumOps;
+  };
+  std::vector<Entry> Entries;
+  SmallVector<uint64_t, 64> Ops;
+  unsigned Next;
+
+  static bool isReadInFunctionBody(unsigned BlockID) {
+    switch (BlockID) {
+    case bitc::CONSTANTS_BLOCK_ID:
+    case bitc::VALUE_SYMTAB_BLOCK_ID:
+    case bitc::METADATA_ATTACHMENT_ID:
+    case bitc::METADATA_BLOCK_ID:
+    case bitc::USELIST_BLOCK_ID:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+public:
+  ReadAheadBlock() : Next(0) {}
+
+  /// Reads the rest of the block that Cursor has just entered, sub-blocks
+  /// included.  Returns true if the block is malformed.
+  bool read(BitstreamCursor &Cursor) {
+    for (unsigned Depth = 1; Depth;) {
+      Entry E = { Cursor.advance(), 0, (unsigned)Ops.size(), 0 };
+      switch (E.Kind.Kind) {
+      case BitstreamEntry::Error:
+        return true;
+      case BitstreamEntry::EndBlock:
+        --Depth;
+        break;
+      case BitstreamEntry::SubBlock:
+        // Enter the blocks that ParseFunctionBody reads, and skip over the
+        // others as it does.
+        if (Depth == 1 && isReadInFunctionBody(E.Kind.ID)) {
+          if (Cursor.EnterSubBlock(E.Kind.ID))
+            return true;
+          ++Depth;
+          break;
+        }
+        if (Cursor.SkipBlock())
+          return true;
+        Entries.push_back(E);
+        E.Kind = BitstreamEntry::getEndBlock();
+        break;
+      case BitstreamEntry::Record:
+        E.Code = Cursor.readRecord(E.Kind.ID, Ops);
+        E.NumOps = Ops.size() - E.FirstOp;
+        break;
+      }
+      Entries.push_back(E);
+    }
+    return false;
+  }
+
+  bool EnterSubBlock(unsigned BlockID) { return false; }
+
+  BitstreamEntry advance() {
+    if (Next == Entries.size())
+      return BitstreamEntry::getError();
+    return Entries[Next++].Kind;
+  }
+
+  BitstreamEntry advanceSkippingSubblocks() {
+    while (1) {
+      BitstreamEntry Entry = advance();
+      if (Entry.Kind != BitstreamEntry::SubBlock)
+        return Entry;
+      if (SkipBlock())
+        return BitstreamEntry::getError();
+    }
+  }
+
+  bool SkipBlock() {
+    for (unsigned Depth = 1; Depth;) {
+      if (Next == Entries.size())
+        return true;
+      switch (Entries[Next++].Kind.Kind) {
+      case BitstreamEntry::SubBlock:
+        ++Depth;
+        break;
+      case BitstreamEntry::EndBlock:
+        --Depth;
+        break;
+      default:
+        break;
+      }
+    }
+    return false;
+  }
+
+  unsigned ReadCode() {
+    BitstreamEntry Entry = advance();
+    return Entry.Kind == BitstreamEntry::Record ? Entry.ID
+                                                : (unsigned)bitc::END_BLOCK;
+  }
+
+  /// Returns the record that advance has just reached.
+  unsigned readRecord(unsigned AbbrevID, SmallVectorImpl<uint64_t> &Vals) {
+    assert(Next && Entries[Next - 1].Kind.Kind == BitstreamEntry::Record &&
+           Entries[Next - 1].Kind.ID == AbbrevID && "Not at this record");
+    const Entry &E = Entries[Next - 1];
+    Vals.append(Ops.begin() + E.FirstOp, Ops.begin() + E.FirstOp + E.NumOps);
+    return E.Code;
+  }
+};
+}
+
+/// Materialize the functions that are still on disk, in order, while worker
+/// threads read the records of the functions that come next.  Only the
+/// bitstream is read concurrently: the functions, and the constants,
+/// metadata and uses they bring, are created on this thread as when they are
+/// materialized one at a time.
+std::error_code BitcodeReader::materializeFunctionsConcurrently() {
+#if LLVM_ENABLE_THREADS != 0
+  std::vector<Function *> Functions;
+  std::vector<uint64_t> Positions;
+  for (Module::iterator F = TheModule->begin(), E = TheModule->end();
+       F != E; ++F)
+    if (F->isMaterializable()) {
+      // Functions whose body was not seen in the stream are left to be
+      // materialized one at a time.
+      uint64_t Position = DeferredFunctionInfo.lookup(F);
+      if (!Position)
+        break;
+      Functions.push_back(F);
+      Positions.push_back(Position);
+    }
+
+  unsigned NumThreads = std::min<unsigned>(ReaderThreads, Functions.size());
+  if (NumThreads < 2)
+    return std::error_code();
+
+  // Each thread gets a bitstream reader of its own over the same bytes, as
+  // cursors of the same reader share its abbreviations.
+  MemoryObject &Bytes = StreamFile->getBitcodeBytes();
+  const unsigned char *Start = Bytes.getPointer(0, Bytes.getExtent());
+  std::vector<std::unique_ptr<BitstreamReader> > Readers;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Readers.push_back(llvm::make_unique<BitstreamReader>(
+        Start, Start + Bytes.getExtent()));
+    Readers.back()->copyBlockInfo(*StreamFile);
+  }
+
+  // Bound how far the threads read ahead, which bounds the memory taken by
+  // the records waiting to be turned into functions.
+  const unsigned MaxReadAhead = 64 * NumThreads;
+  std::vector<ReadAheadBlock> Blocks(Functions.size());
+  std::vector<char> Done(Functions.size(), false);
+  std::vector<char> Failed(Functions.size(), false);
+  std::mutex Mutex;
+  std::condition_variable DoneCV, ConsumedCV;
+  unsigned NextToRead = 0, NumConsumed = 0;
+  bool Stop = false;
+
+  auto Worker = [&](BitstreamReader *Reader) {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    while (1) {
+      ConsumedCV.wait(Lock, [&] {
+        return Stop || NextToRead == Functions.size() ||
+               NextToRead < NumConsumed + MaxReadAhead;
+      });
+      if (Stop || NextToRead == Functions.size())
+        return;
+      unsigned I = NextToRead++;
+      Lock.unlock();
+
+      BitstreamCursor Cursor(*Reader);
+      Cursor.JumpToBit(Positions[I]);
+      bool Error = Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID) ||
+                   Blocks[I].read(Cursor);
+
+      Lock.lock();
+      Failed[I] = Error;
+      Done[I] = true;
+      DoneCV.notify_all();
+    }
+  };
+
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.push_back(std::thread(Worker, Readers[T].get()));
+
+  std::error_code EC;
+  for (unsigned I = 0, E = Functions.size(); I != E && !EC; ++I) {
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      DoneCV.wait(Lock, [&] { return Done[I]; });
+    }
+
+    // A blockaddress may have brought the function in already.  If its block
+    // could not be read, reading it from the stream reports why.
+    Function *F = Functions[I];
+    if (Failed[I])
+      EC = materialize(F);
+    else if (F->isMaterializable())
+      EC = materializeFunction(F, Blocks[I]);
+    Blocks[I] = ReadAheadBlock();
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ++NumConsumed;
+    ConsumedCV.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Stop = true;
+  }
+  ConsumedCV.notify_all();
+  for (std::thread &Thread : Threads)
+    Thread.join();
+  return EC;
+#else
+  return std::error_code();
+#endif
+}
+
 /// Find the function body in the bitcode stream
 std::error_code BitcodeReader::FindFunctionInStream(
     Function *F,
@@ -3499,7 +3743,13 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   // Move the bit stream to the saved position of the deferred function body.
   Stream.JumpToBit(DFII->second);
 
-  if (std::error_code EC = ParseFunctionBody(F))
+  return materializeFunction(F, Stream);
+}
+
+template <typename CursorT>
+std::error_code BitcodeReader::materializeFunction(Function *F,
+                                                   CursorT &Cursor) {
+  if (std::error_code EC = ParseFunctionBody(F, Cursor))
     return EC;
   F->setIsMaterializable(false);
 
@@ -3553,6 +3803,11 @@ std::error_code BitcodeReader::MaterializeModule(Module *M) {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  // Reading the module from a stream has to be done in order.
+  if (ReaderThreads > 1 && !LazyStreamer)
+    if (std::error_code EC = materializeFunctionsConcurrently())
+      return EC;
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Module::iterator F = TheModule->begin(), E = TheModule->end();
@@ -342,16 +342,25 @@ private:
   std::error_code ParseTypeTable();
   std::error_code ParseTypeTableBody();
 
-  std::error_code ParseValueSymbolTable();
-  std::error_code ParseConstants();
+  // The blocks that can appear in a function body are read either from Stream
+  // or from records that were read ahead of time on another thread (see
+  // MaterializeModule).
+  template <typename CursorT>
+  std::error_code ParseValueSymbolTable(CursorT &Cursor);
+  template <typename CursorT> std::error_code ParseConstants(CursorT &Cursor);
   std::error_code RememberAndSkipFunctionBody();
-  std::error_code ParseFunctionBody(Function *F);
+  template <typename CursorT>
+  std::error_code ParseFunctionBody(Function *F, CursorT &Cursor);
+  template <typename CursorT>
+  std::error_code materializeFunction(Function *F, CursorT &Cursor);
+  std::error_code materializeFunctionsConcurrently();
   std::error_code GlobalCleanup();
   std::error_code ResolveGlobalAndAliasInits();
-  std::error_code ParseMetadata();
-  std::error_code ParseMetadataAttachment();
+  template <typename CursorT> std::error_code ParseMetadata(CursorT &Cursor);
+  template <typename CursorT>
+  std::error_code ParseMetadataAttachment(CursorT &Cursor);
   ErrorOr<std::string> parseModuleTriple();
-  std::error_code ParseUseLists();
+  template <typename CursorT> std::error_code ParseUseLists(CursorT &Cursor);
   std::error_code InitStream();
   std::error_code InitStreamFromBuffer();
   std::error_code InitLazyStream();
@@ -11,6 +11,25 @@
 
 using namespace llvm;
 
+//===----------------------------------------------------------------------===//
+//  BitstreamReader implementation
+//===----------------------------------------------------------------------===//
+
+void BitstreamReader::copyBlockInfo(const BitstreamReader &Other) {
+  assert(!hasBlockInfoRecords());
+  for (const BlockInfo &Info : Other.BlockInfoRecords) {
+    BlockInfo &Copy = getOrCreateBlockInfo(Info.BlockID);
+    for (const IntrusiveRefCntPtr<BitCodeAbbrev> &Abbv : Info.Abbrevs) {
+      BitCodeAbbrev *AbbvCopy = new BitCodeAbbrev();
+      for (unsigned i = 0, e = Abbv->getNumOperandInfos(); i != e; ++i)
+        AbbvCopy->Add(Abbv->getOperandInfo(i));
+      Copy.Abbrevs.push_back(AbbvCopy);
+    }
+    Copy.Name = Info.Name;
+    Copy.RecordNames = Info.RecordNames;
+  }
+}
+
 //===----------------------------------------------------------------------===//
 //  BitstreamCursor implementation
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,135 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+// The partitions of the module are handed to the threads as bitcode, so that
+// each thread reads its partition into an LLVMContext of its own: contexts
+// are not shared between threads by the code generator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <memory>
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+/// DiagnosticForwarder - Passes the diagnostics of the partitions on to the
+/// handler of the split module's context, one at a time.
+struct DiagnosticForwarder {
+  LLVMContext::DiagnosticHandlerTy Handler;
+  void *Context;
+  sys::Mutex Lock;
+};
+
+} // end anonymous namespace
+
+static void forwardDiagnostic(const DiagnosticInfo &DI, void *Context) {
+  DiagnosticForwarder *Forwarder = static_cast<DiagnosticForwarder *>(Context);
+  sys::ScopedLock Lock(Forwarder->Lock);
+  Forwarder->Handler(DI, Forwarder->Context);
+}
+
+/// codegen - Generate code for the partition of module ModuleID serialized in
+/// BC into OS.
+static bool codegen(StringRef BC, StringRef ModuleID, raw_ostream &OS,
+                    DiagnosticForwarder &Forwarder,
+                    const std::function<TargetMachine *()> &CreateTargetMachine,
+                    TargetMachine::CodeGenFileType FileType, bool DisableVerify,
+                    const std::function<void(PassManagerBase &)> &AddPasses,
+                    std::string &ErrMsg) {
+  LLVMContext Context;
+  if (Forwarder.Handler)
+    Context.setDiagnosticHandler(forwardDiagnostic, &Forwarder);
+
+  ErrorOr<Module *> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(BC, ModuleID), Context);
+  if (std::error_code EC = MOrErr.getError()) {
+    ErrMsg = EC.message();
+    return true;
+  }
+  std::unique_ptr<Module> M(MOrErr.get());
+  std::unique_ptr<TargetMachine> TM(CreateTargetMachine());
+
+  PassManager CodeGenPasses;
+  CodeGenPasses.add(new DataLayoutPass());
+  AddPasses(CodeGenPasses);
+
+  formatted_raw_ostream FOS(OS);
+  if (TM->addPassesToEmitFile(CodeGenPasses, FOS, FileType, DisableVerify)) {
+    ErrMsg = "target does not support generation of this file type";
+    return true;
+  }
+  CodeGenPasses.run(*M);
+  return false;
+}
+
+bool llvm::splitCodeGen(
+    Module &M, ArrayRef<raw_ostream *> OSs,
+    const std::function<TargetMachine *()> &CreateTargetMachine,
+    TargetMachine::CodeGenFileType FileType, bool DisableVerify,
+    const std::function<void(PassManagerBase &)> &AddPasses,
+    std::string &ErrMsg) {
+  unsigned N = OSs.size();
+  std::vector<std::string> Partitions;
+  SplitModule(M, N, [&](std::unique_ptr<Module> MPart) {
+    Partitions.push_back(std::string());
+    raw_string_ostream BCOS(Partitions.back());
+    WriteBitcodeToFile(MPart.get(), BCOS);
+  });
+
+  DiagnosticForwarder Forwarder;
+  Forwarder.Handler = M.getContext().getDiagnosticHandler();
+  Forwarder.Context = M.getContext().getDiagnosticContext();
+
+  std::vector<std::string> Errors(N);
+  std::vector<char> Failed(N);
+  auto Compile = [&](unsigned I) {
+    Failed[I] = codegen(Partitions[I], M.getModuleIdentifier(), *OSs[I],
+                        Forwarder, CreateTargetMachine, FileType,
+                        DisableVerify, AddPasses, Errors[I]);
+  };
+
+#if LLVM_ENABLE_THREADS != 0
+  // Timers are started and stopped on a stack shared by all threads, so the
+  // partitions are compiled one after another when passes are timed.
+  if (!TimePassesIsEnabled) {
+    std::vector<std::thread> Threads;
+    for (unsigned I = 1; I < N; ++I)
+      Threads.push_back(std::thread(Compile, I));
+    Compile(0);
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  } else
+#endif
+  {
+    for (unsigned I = 0; I != N; ++I)
+      Compile(I);
+  }
+
+  for (unsigned I = 0; I != N; ++I)
+    if (Failed[I]) {
+      ErrMsg = Errors[I];
+      return true;
+    }
+  return false;
+}
@@ -39,6 +39,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   if (Val) ID.AddInteger(Val);
 
   void *InsertPoint;
+  ContextLock Lock(*pImpl);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -62,6 +63,7 @@ Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   if (!Val.empty()) ID.AddString(Val);
 
   void *InsertPoint;
+  ContextLock Lock(*pImpl);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -453,6 +455,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
     I->Profile(ID);
 
   void *InsertPoint;
+  ContextLock Lock(*pImpl);
   AttributeSetNode *PA =
     pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -580,6 +583,7 @@ AttributeSet::getImpl(LLVMContext &C,
   AttributeSetImpl::Profile(ID, Attrs);
 
   void *InsertPoint;
+  ContextLock Lock(*pImpl);
   AttributeSetImpl *PA = pImpl->AttrsLists.FindNodeOrInsertPos(ID, InsertPoint);
 
   // If we didn't find any existing attributes of the same shape then
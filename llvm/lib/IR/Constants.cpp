@@ -518,6 +518,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -525,6 +526,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -558,6 +560,7 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   ConstantInt *&Slot = pImpl->IntConstants[V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
@@ -686,6 +689,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
 
   ConstantFP *&Slot = pImpl->FPConstants[V];
 
@@ -841,6 +845,7 @@ ConstantArray::ConstantArray(ArrayType *T, ArrayRef<Constant *> V)
 Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(Ty, V))
     return C;
+  ContextLock Lock(*Ty->getContext().pImpl);
   return Ty->getContext().pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantArray::getImpl(ArrayType *Ty, ArrayRef<Constant*> V) {
@@ -996,6 +1001,7 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
+  ContextLock Lock(*ST->getContext().pImpl);
   return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
 }
 
@@ -1024,6 +1030,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(V))
     return C;
   VectorType *Ty = VectorType::get(V.front()->getType(), V.size());
+  ContextLock Lock(*Ty->getContext().pImpl);
   return Ty->getContext().pImpl->VectorConstants.getOrCreate(Ty, V);
 }
 Constant *ConstantVector::getImpl(ArrayRef<Constant*> V) {
@@ -1344,6 +1351,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
+  ContextLock Lock(*Ty->getContext().pImpl);
   ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
   if (!Entry)
     Entry = new ConstantAggregateZero(Ty);
@@ -1354,6 +1362,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getContext().pImpl->CAZConstants.erase(getType());
   destroyConstantImpl();
 }
@@ -1361,6 +1370,7 @@ void ConstantAggregateZero::destroyConstant() {
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getType()->getContext().pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1372,6 +1382,7 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getType()->getContext().pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1379,6 +1390,7 @@ void ConstantStruct::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getType()->getContext().pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1424,6 +1436,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ContextLock Lock(*Ty->getContext().pImpl);
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (!Entry)
     Entry = new ConstantPointerNull(Ty);
@@ -1434,6 +1447,7 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getContext().pImpl->CPNConstants.erase(getType());
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
@@ -1444,6 +1458,7 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ContextLock Lock(*Ty->getContext().pImpl);
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (!Entry)
     Entry = new UndefValue(Ty);
@@ -1454,6 +1469,7 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   // Free the constant and any dangling references to it.
   getContext().pImpl->UVConstants.erase(getType());
   destroyConstantImpl();
@@ -1468,6 +1484,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ContextLock Lock(*F->getContext().pImpl);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
@@ -1491,6 +1508,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
+  ContextLock Lock(*F->getContext().pImpl);
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -1500,6 +1518,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getFunction()->getType()->getContext().pImpl
     ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
@@ -1558,6 +1577,7 @@ static Constant *getFoldedCast(Instruction::CastOps opc, Constant *C, Type *Ty,
   // Look up the constant in the table first to ensure uniqueness.
   ConstantExprKeyType Key(opc, C);
 
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -1915,6 +1935,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ConstantExprKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -1996,6 +2017,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2,
   ConstantExprKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -2035,6 +2057,7 @@ Constant *ConstantExpr::getGetElementPtr(Constant *C, ArrayRef<Value *> Idxs,
                                 InBounds ? GEPOperator::IsInBounds : 0);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2060,6 +2083,7 @@ Constant *ConstantExpr::getICmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2084,6 +2108,7 @@ Constant *ConstantExpr::getFCmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2106,6 +2131,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx,
   const ConstantExprKeyType Key(Instruction::ExtractElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2129,6 +2155,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ConstantExprKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -2152,6 +2179,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ConstantExprKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2176,6 +2204,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ConstantExprKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2200,6 +2229,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg, ArrayRef<unsigned> Idxs,
   const ConstantExprKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2354,6 +2384,7 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   getType()->getContext().pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
@@ -2449,6 +2480,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  ContextLock Lock(*Ty->getContext().pImpl);
   auto &Slot =
       *Ty->getContext()
            .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
@@ -2474,6 +2506,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 }
 
 void ConstantDataSequential::destroyConstant() {
+  ContextLock Lock(*getContext().pImpl);
   // Remove the constant from the StringMap.
   StringMap<ConstantDataSequential*> &CDSConstants = 
     getType()->getContext().pImpl->CDSConstants;
@@ -17,6 +17,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/DataLayout.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
@@ -519,6 +520,8 @@ DataLayout::~DataLayout() {
 }
 
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  // The layouts are cached for all threads working on the context of Ty.
+  ContextLock Lock(*Ty->getContext().pImpl);
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
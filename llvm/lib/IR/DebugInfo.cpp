@@ -840,6 +840,7 @@ DILocation DILocation::copyWithNewScope(LLVMContext &Ctx,
 
 unsigned DILocation::computeNewDiscriminator(LLVMContext &Ctx) {
   std::pair<const char *, unsigned> Key(getFilename().data(), getLineNumber());
+  ContextLock Lock(*Ctx.pImpl);
   return ++Ctx.pImpl->DiscriminatorTable[Key];
 }
 
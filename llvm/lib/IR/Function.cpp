@@ -252,8 +252,10 @@ Function::Function(FunctionType *Ty, LinkageTypes Linkage, const Twine &name,
   if (Ty->getNumParams())
     setValueSubclassData(1);   // Set the "has lazy arguments" bit.
 
-  if (ParentModule)
+  if (ParentModule) {
+    ContextLock Lock(*getContext().pImpl);
     ParentModule->getFunctionList().push_back(this);
+  }
 
   // Ensure intrinsics have the right parameter attributes.
   if (unsigned IID = getIntrinsicID())
@@ -272,11 +274,18 @@ Function::~Function() {
   clearGC();
 
   // Remove the intrinsicID from the Cache.
-  if (getValueName() && isIntrinsic())
+  if (getValueName() && isIntrinsic()) {
+    ContextLock Lock(*getContext().pImpl);
     getContext().pImpl->IntrinsicIDCache.erase(this);
+  }
 }
 
 void Function::BuildLazyArguments() const {
+  // Threads sharing the context may all be looking at a declaration.
+  ContextLock Lock(*getContext().pImpl);
+  if (!hasLazyArguments())
+    return;
+
   // Create the arguments vector, all arguments start out unnamed.
   FunctionType *FT = getFunctionType();
   for (unsigned i = 0, e = FT->getNumParams(); i != e; ++i) {
@@ -421,6 +430,7 @@ unsigned Function::getIntrinsicID() const {
   if (!ValName || !isIntrinsic())
     return 0;
 
+  ContextLock Lock(*getContext().pImpl);
   LLVMContextImpl::IntrinsicIDCacheTy &IntrinsicIDCache =
     getContext().pImpl->IntrinsicIDCache;
   if (!IntrinsicIDCache.count(this)) {
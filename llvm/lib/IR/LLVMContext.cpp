@@ -94,7 +94,10 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   assert(NonNullID == MD_nonnull && "nonnull kind id drifted");
   (void)NonNullID;
 }
-LLVMContext::~LLVMContext() { delete pImpl; }
+LLVMContext::~LLVMContext() {
+  setThreadShared(false);
+  delete pImpl;
+}
 
 void LLVMContext::addModule(Module *M) {
   pImpl->OwnedModules.insert(M);
@@ -151,10 +154,25 @@ void LLVMContext::setYieldCallback(YieldCallbackTy Callback, void *OpaqueHandle)
 }
 
 void LLVMContext::yield() {
-  if (pImpl->YieldCallback)
+  // The callback may expect to own the context, which other threads share.
+  if (pImpl->YieldCallback && !pImpl->ThreadShared)
     pImpl->YieldCallback(this, pImpl->YieldOpaqueHandle);
 }
 
+void LLVMContext::setThreadShared(bool Shared) {
+  if (Shared == pImpl->ThreadShared)
+    return;
+  pImpl->ThreadShared = Shared;
+  if (Shared)
+    ++Use::ThreadSharedContexts;
+  else
+    --Use::ThreadSharedContexts;
+}
+
+bool LLVMContext::isThreadShared() const {
+  return pImpl->ThreadShared;
+}
+
 void LLVMContext::emitError(const Twine &ErrorStr) {
   diagnose(DiagnosticInfoInlineAsm(ErrorStr));
 }
@@ -189,6 +207,9 @@ static bool isDiagnosticEnabled(const DiagnosticInfo &DI) {
 }
 
 void LLVMContext::diagnose(const DiagnosticInfo &DI) {
+  // Keep the diagnostics of threads sharing the context from interleaving.
+  ContextLock Lock(*pImpl);
+
   // If there is a report handler, use it.
   if (pImpl->DiagnosticHandler) {
     if (!pImpl->RespectDiagnosticFilters || isDiagnosticEnabled(DI))
@@ -235,6 +256,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
          "Named metadata may not start with a digit");
 
   // If this is new, assign it its ID.
+  ContextLock Lock(*pImpl);
   return pImpl->CustomMDKindNames.insert(std::make_pair(
                                              Name,
                                              pImpl->CustomMDKindNames.size()))
@@ -244,6 +266,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ContextLock Lock(*pImpl);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
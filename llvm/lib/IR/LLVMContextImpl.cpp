@@ -43,6 +43,7 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   RespectDiagnosticFilters = false;
   YieldCallback = nullptr;
   YieldOpaqueHandle = nullptr;
+  ThreadShared = false;
   NamedStructTypesUniqueID = 0;
 }
 
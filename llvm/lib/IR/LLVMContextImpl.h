@@ -32,6 +32,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/Mutex.h"
 #include <vector>
 
 namespace llvm {
@@ -273,6 +274,13 @@ public:
   LLVMContext::YieldCallbackTy YieldCallback;
   void *YieldOpaqueHandle;
 
+  /// ThreadShared - Set while several threads may work on functions of the
+  /// context at once, which then hold ContextMutex while they touch anything
+  /// shared between functions: the uniquing tables, use lists of constants and
+  /// globals, value handles, metadata and module symbol tables.
+  bool ThreadShared;
+  sys::SmartMutex<false> ContextMutex;
+
   typedef DenseMap<APInt, ConstantInt *, DenseMapAPIntKeyInfo> IntMapTy;
   IntMapTy IntConstants;
 
@@ -394,6 +402,33 @@ public:
   ~LLVMContextImpl();
 };
 
+/// ContextLock - Hold the mutex of a context while touching state shared by all
+/// of its functions, if several threads share it.  The mutex is recursive, so
+/// callbacks run under it, such as those of value handles, may take it again.
+class ContextLock {
+  LLVMContextImpl *Impl;
+
+  ContextLock(const ContextLock &) LLVM_DELETED_FUNCTION;
+  void operator=(const ContextLock &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit ContextLock(LLVMContextImpl &Impl)
+      : Impl(Impl.ThreadShared ? &Impl : nullptr) {
+    if (this->Impl)
+      this->Impl->ContextMutex.lock();
+  }
+  /// Lock nothing if Impl is null.
+  explicit ContextLock(LLVMContextImpl *Impl)
+      : Impl(Impl && Impl->ThreadShared ? Impl : nullptr) {
+    if (this->Impl)
+      this->Impl->ContextMutex.lock();
+  }
+  ~ContextLock() {
+    if (Impl)
+      Impl->ContextMutex.unlock();
+  }
+};
+
 }
 
 #endif
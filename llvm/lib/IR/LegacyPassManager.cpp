@@ -12,6 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -23,14 +25,22 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
+#include <thread>
 using namespace llvm;
 using namespace llvm::legacy;
 
+#define DEBUG_TYPE "ir"
+
+STATISTIC(NumConcurrentFunctions,
+          "Number of functions run on by concurrent function passes");
+
 // See PassManagers.h for Pass Manager infrastructure overview.
 
 //===----------------------------------------------------------------------===//
@@ -83,6 +93,18 @@ PrintAfterAll("print-after-all",
               llvm::cl::desc("Print IR after each pass"),
               cl::init(false));
 
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads", cl::Hidden, cl::init(1),
+                    cl::desc("Run the function pass managers whose passes "
+                             "all support it on this many functions at once. "
+                             "Their -time-passes times are summed over the "
+                             "threads"));
+
+static cl::opt<bool>
+DematerializeFunctions("dematerialize-functions", cl::Hidden,
+                       cl::desc("Release the bodies of lazily read functions "
+                                "that function passes did not change"));
+
 /// This is a helper to determine whether to print IR before or
 /// after a pass.
 
@@ -119,6 +141,28 @@ bool PMDataManager::isPassDebuggingExecutionsOrMore() const {
 
 
 
+// The innermost pass being run by a pass manager on each thread.
+static ManagedStatic<sys::ThreadLocal<Pass> > RunningPass;
+
+PassManagerPrettyStackEntry::PassManagerPrettyStackEntry(Pass *p, Value &v)
+    : P(p), V(&v), M(nullptr), PrevRunningPass(RunningPass->get()) {
+  RunningPass->set(p);
+}
+
+PassManagerPrettyStackEntry::PassManagerPrettyStackEntry(Pass *p, Module &m)
+    : P(p), V(nullptr), M(&m), PrevRunningPass(RunningPass->get()) {
+  RunningPass->set(p);
+}
+
+PassManagerPrettyStackEntry::~PassManagerPrettyStackEntry() {
+  if (V || M)
+    RunningPass->set(PrevRunningPass);
+}
+
+Pass *PassManagerPrettyStackEntry::getRunningPass() {
+  return RunningPass->get();
+}
+
 void PassManagerPrettyStackEntry::print(raw_ostream &OS) const {
   if (!V && !M)
     OS << "Releasing pass '";
@@ -457,6 +501,9 @@ static ManagedStatic<sys::SmartMutex<true> > TimingInfoMutex;
 
 class TimingInfo {
   DenseMap<Pass*, Timer*> TimingData;
+  /// Originals - The passes that concurrent instances were created from,
+  /// whose timers the instances share.
+  DenseMap<Pass*, Pass*> Originals;
   TimerGroup TG;
 public:
   // Use 'create' member to get this.
@@ -483,11 +530,32 @@ public:
       return nullptr;
 
     sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    DenseMap<Pass*, Pass*>::iterator I = Originals.find(P);
+    if (I != Originals.end())
+      P = I->second;
     Timer *&T = TimingData[P];
     if (!T)
       T = new Timer(P->getPassName(), TG);
     return T;
   }
+
+  /// addConcurrentInstances - Time the concurrent instances of passes, keyed
+  /// by the pass they were created from, with the timers of their originals.
+  void addConcurrentInstances(const DenseMap<Pass*, Pass*> &Instances) {
+    sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    for (DenseMap<Pass*, Pass*>::const_iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I)
+      Originals[I->second] = I->first;
+  }
+
+  /// removeConcurrentInstances - Forget the instances again, before they are
+  /// deleted.
+  void removeConcurrentInstances(const DenseMap<Pass*, Pass*> &Instances) {
+    sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    for (DenseMap<Pass*, Pass*>::const_iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I)
+      Originals.erase(I->second);
+  }
 };
 
 } // End of anon namespace
@@ -573,6 +641,40 @@ void PMTopLevelManager::collectLastUses(SmallVectorImpl<Pass *> &LastUses,
 
 }
 
+void PMTopLevelManager::addConcurrentInstances(
+    const DenseMap<Pass *, Pass *> &Instances) {
+  for (DenseMap<Pass *, Pass *>::const_iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I) {
+    Pass *Instance = I->second;
+    findAnalysisUsage(Instance);
+    findAnalysisPassInfo(Instance->getPassID());
+
+    // Passes without an instance, such as shared immutable passes, are left
+    // alone.
+    SmallVector<Pass *, 12> LastUses;
+    collectLastUses(LastUses, I->first);
+    for (Pass *LUP : LastUses) {
+      DenseMap<Pass *, Pass *>::const_iterator LUI = Instances.find(LUP);
+      if (LUI != Instances.end())
+        InversedLastUser[Instance].insert(LUI->second);
+    }
+  }
+}
+
+void PMTopLevelManager::removeConcurrentInstances(
+    const DenseMap<Pass *, Pass *> &Instances) {
+  for (DenseMap<Pass *, Pass *>::const_iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I) {
+    DenseMap<Pass *, AnalysisUsage *>::iterator DMI =
+      AnUsageMap.find(I->second);
+    if (DMI != AnUsageMap.end()) {
+      delete DMI->second;
+      AnUsageMap.erase(DMI);
+    }
+    InversedLastUser.erase(I->second);
+  }
+}
+
 AnalysisUsage *PMTopLevelManager::findAnalysisUsage(Pass *P) {
   AnalysisUsage *AnUsage = nullptr;
   DenseMap<Pass *, AnalysisUsage *>::iterator DMI = AnUsageMap.find(P);
@@ -706,9 +808,15 @@ Pass *PMTopLevelManager::findAnalysisPass(AnalysisID AID) {
     if (Pass *P = (*I)->findAnalysisPass(AID, false))
       return P;
 
+  return findImmutablePass(AID);
+}
+
+/// Find the immutable pass that implements Analysis AID. If desired pass is
+/// not found then return NULL.
+ImmutablePass *PMTopLevelManager::findImmutablePass(AnalysisID AID) const {
   // Check the immutable passes. Iterate in reverse order so that we find
   // the most recently registered passes first.
-  for (SmallVectorImpl<ImmutablePass *>::reverse_iterator I =
+  for (SmallVectorImpl<ImmutablePass *>::const_reverse_iterator I =
        ImmutablePasses.rbegin(), E = ImmutablePasses.rend(); I != E; ++I) {
     AnalysisID PI = (*I)->getPassID();
     if (PI == AID)
@@ -880,6 +988,14 @@ void PMDataManager::verifyPreservedAnalysis(Pass *P) {
   }
 }
 
+/// Tell the immutable passes that F, or the whole module, was modified
+void PMDataManager::invalidateImmutablePasses(Function *F) {
+  if (ConcurrentParent)
+    return ConcurrentParent->invalidateImmutablePasses(F);
+  for (ImmutablePass *IP : TPM->getImmutablePasses())
+    IP->invalidateCachedInfo(F);
+}
+
 /// Remove Analysis not preserved by Pass P
 void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
   AnalysisUsage *AnUsage = TPM->findAnalysisUsage(P);
@@ -1118,9 +1234,14 @@ Pass *PMDataManager::findAnalysisPass(AnalysisID AID, bool SearchParent) {
   if (I != AvailableAnalysis.end())
     return I->second;
 
-  // Search Parents through TopLevelManager
-  if (SearchParent)
+  // Search Parents through TopLevelManager, or through the manager this one
+  // is nested in on its thread.
+  if (SearchParent) {
+    if (IsConcurrent)
+      return ConcurrentParent ? ConcurrentParent->findAnalysisPass(AID, true)
+                              : nullptr;
     return TPM->findAnalysisPass(AID);
+  }
 
   return nullptr;
 }
@@ -1318,9 +1439,11 @@ bool BBPassManager::runOnFunction(Function &F) {
       }
 
       Changed |= LocalChanged;
-      if (LocalChanged)
+      if (LocalChanged) {
         dumpPassInfo(BP, MODIFICATION_MSG, ON_BASICBLOCK_MSG,
                      I->getName());
+        invalidateImmutablePasses(&F);
+      }
       dumpPreservedSet(BP);
 
       verifyPreservedAnalysis(BP);
@@ -1539,8 +1662,10 @@ bool FPPassManager::runOnFunction(Function &F) {
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+      invalidateImmutablePasses(&F);
+    }
     dumpPreservedSet(FP);
 
     verifyPreservedAnalysis(FP);
@@ -1554,12 +1679,291 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
 
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
-    Changed |= runOnFunction(*I);
+  if (FunctionPassThreads > 1 && runConcurrently(M, Changed))
+    return Changed;
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    bool WasMaterializable = I->isMaterializable();
+    if (std::error_code EC = I->materialize())
+      report_fatal_error("Error reading bitcode file: " + EC.message());
+
+    bool LocalChanged = runOnFunction(*I);
+    Changed |= LocalChanged;
+
+    // The function can be read again from the bitcode when a later pass needs
+    // it.  Its values are deleted, so immutable passes such as alias analyses
+    // must forget what they cached about them first.
+    if (DematerializeFunctions && WasMaterializable && !LocalChanged &&
+        I->isDematerializable()) {
+      invalidateImmutablePasses(I);
+      I->Dematerialize();
+    }
+  }
 
   return Changed;
 }
 
+#if LLVM_ENABLE_THREADS != 0
+namespace {
+
+/// ConcurrentFPPassManager - Runs instances of the passes of an FPPassManager
+/// on some functions of a module, while other threads run other instances on
+/// the other functions.  The passes find the analyses they need among the
+/// instances that ran before them on the same thread, and among the immutable
+/// passes, which are shared unless they have concurrent instances.
+class ConcurrentFPPassManager : public FPPassManager {
+  FPPassManager &Original;
+
+  /// Instances - The instance of each pass, including the passes of nested
+  /// managers and immutable passes, by the pass it was created from.
+  DenseMap<Pass *, Pass *> Instances;
+
+  /// The instances of immutable passes, which no manager owns.
+  std::vector<std::unique_ptr<ImmutablePass> > ImmutableInstances;
+
+  /// addInstance - Record Instance as the instance of P, and the instances of
+  /// the passes P manages as those of Instance.  Return false if they do not
+  /// match.
+  bool addInstance(Pass *P, Pass *Instance);
+
+  Pass *getInstance(Pass *P) const {
+    DenseMap<Pass *, Pass *>::const_iterator I = Instances.find(P);
+    return I != Instances.end() ? I->second : P;
+  }
+
+public:
+  explicit ConcurrentFPPassManager(FPPassManager &Original)
+      : Original(Original) {}
+
+  /// createInstances - Create the instances of the passes.  Return false if
+  /// some of them cannot run concurrently.
+  bool createInstances();
+
+  const DenseMap<Pass *, Pass *> &getInstances() const { return Instances; }
+
+  Pass *findAnalysisPass(AnalysisID AID, bool SearchParent) override;
+
+  void invalidateImmutablePasses(Function *F) override;
+};
+
+} // End of anon namespace
+
+bool ConcurrentFPPassManager::addInstance(Pass *P, Pass *Instance) {
+  Instances[P] = Instance;
+
+  PMDataManager *PM = P->getAsPMDataManager();
+  if (!PM)
+    return true;
+  PMDataManager *InstancePM = Instance->getAsPMDataManager();
+  if (!InstancePM ||
+      InstancePM->getNumContainedPasses() != PM->getNumContainedPasses())
+    return false;
+
+  InstancePM->setTopLevelManager(TPM);
+  InstancePM->setDepth(PM->getDepth());
+  InstancePM->setConcurrentParent(
+      &Instance->getResolver()->getPMDataManager());
+  for (unsigned Index = 0; Index < PM->getNumContainedPasses(); ++Index)
+    if (!addInstance(PM->getContainedPasses()[Index],
+                     InstancePM->getContainedPasses()[Index]))
+      return false;
+  return true;
+}
+
+bool ConcurrentFPPassManager::createInstances() {
+  setTopLevelManager(Original.getTopLevelManager());
+  setDepth(Original.getDepth());
+  setConcurrentParent(nullptr);
+
+  SmallVectorImpl<ImmutablePass *> &ImmutablePasses =
+    TPM->getImmutablePasses();
+  for (ImmutablePass *IP : ImmutablePasses) {
+    if (!IP->isThreadSafe())
+      return false;
+    if (ImmutablePass *Instance = IP->createConcurrentInstance()) {
+      ImmutableInstances.push_back(std::unique_ptr<ImmutablePass>(Instance));
+      Instance->setResolver(new AnalysisResolver(*this));
+      Instances[IP] = Instance;
+    }
+  }
+
+  // The instances of immutable passes use what their originals were set up
+  // with, or its instances.
+  for (ImmutablePass *IP : ImmutablePasses) {
+    Pass *Instance = getInstance(IP);
+    if (Instance == IP)
+      continue;
+    const AnalysisUsage::VectorType &RequiredSet =
+      TPM->findAnalysisUsage(IP)->getRequiredSet();
+    for (AnalysisUsage::VectorType::const_iterator I = RequiredSet.begin(),
+           E = RequiredSet.end(); I != E; ++I)
+      if (Pass *Impl = IP->getResolver()->findImplPass(*I))
+        Instance->getResolver()->addAnalysisImplsPair(*I, getInstance(Impl));
+  }
+  for (const std::unique_ptr<ImmutablePass> &Instance : ImmutableInstances)
+    Instance->initializePass();
+
+  for (unsigned Index = 0; Index < Original.getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = Original.getContainedPass(Index);
+    FunctionPass *Instance = FP->createConcurrentInstance();
+    if (!Instance)
+      return false;
+    add(Instance, false);
+    if (!addInstance(FP, Instance))
+      return false;
+  }
+
+  // Analyses that no pass of the manager provides must be immutable passes,
+  // the others stay with the module pass manager.
+  SmallPtrSet<AnalysisID, 32> Provided;
+  for (DenseMap<Pass *, Pass *>::iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I) {
+    if (I->first->getAsImmutablePass())
+      continue;
+    AnalysisID PI = I->first->getPassID();
+    Provided.insert(PI);
+    if (const PassInfo *PInf = TPM->findAnalysisPassInfo(PI)) {
+      const std::vector<const PassInfo*> &II =
+        PInf->getInterfacesImplemented();
+      for (unsigned i = 0, e = II.size(); i != e; ++i)
+        Provided.insert(II[i]->getTypeInfo());
+    }
+  }
+  for (DenseMap<Pass *, Pass *>::iterator I = Instances.begin(),
+         E = Instances.end(); I != E; ++I) {
+    if (I->first->getAsImmutablePass())
+      continue;
+    const AnalysisUsage::VectorType &RequiredSet =
+      TPM->findAnalysisUsage(I->first)->getRequiredSet();
+    for (AnalysisUsage::VectorType::const_iterator RI = RequiredSet.begin(),
+           RE = RequiredSet.end(); RI != RE; ++RI) {
+      if (Provided.count(*RI))
+        continue;
+      Pass *Impl = TPM->findAnalysisPass(*RI);
+      if (!Impl || !Impl->getAsImmutablePass())
+        return false;
+    }
+  }
+  return true;
+}
+
+Pass *ConcurrentFPPassManager::findAnalysisPass(AnalysisID AID,
+                                                bool SearchParent) {
+  if (Pass *P = PMDataManager::findAnalysisPass(AID, false))
+    return P;
+  if (!SearchParent)
+    return nullptr;
+  if (ImmutablePass *IP = TPM->findImmutablePass(AID))
+    return getInstance(IP);
+  return nullptr;
+}
+
+void ConcurrentFPPassManager::invalidateImmutablePasses(Function *F) {
+  for (ImmutablePass *IP : TPM->getImmutablePasses())
+    static_cast<ImmutablePass *>(getInstance(IP))->invalidateCachedInfo(F);
+}
+#endif
+
+bool FPPassManager::runConcurrently(Module &M, bool &Changed) {
+#if LLVM_ENABLE_THREADS != 0
+  // Pass execution is printed as it happens, which does not interleave.
+  if (PassDebugging >= Executions)
+    return false;
+
+  std::vector<Function *> Functions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Functions.push_back(I);
+
+  unsigned NumThreads =
+      std::min<unsigned>(FunctionPassThreads, Functions.size());
+  if (NumThreads < 2 || getNumContainedPasses() == 0)
+    return false;
+
+  // Give every thread its own instance of each pass, so that passes keep
+  // their per-function state to themselves.
+  std::vector<std::unique_ptr<ConcurrentFPPassManager> > Managers;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Managers.push_back(llvm::make_unique<ConcurrentFPPassManager>(*this));
+    if (!Managers.back()->createInstances())
+      return false;
+  }
+  for (const std::unique_ptr<ConcurrentFPPassManager> &PM : Managers) {
+    TPM->addConcurrentInstances(PM->getInstances());
+    if (TheTimeInfo)
+      TheTimeInfo->addConcurrentInstances(PM->getInstances());
+  }
+
+  // Reading bitcode is not thread-safe, so the functions are materialized up
+  // front.
+  std::vector<char> WasMaterializable(Functions.size(), false);
+  for (unsigned N = 0; N != Functions.size(); ++N) {
+    WasMaterializable[N] = Functions[N]->isMaterializable();
+    if (std::error_code EC = Functions[N]->materialize())
+      report_fatal_error("Error reading bitcode file: " + EC.message());
+  }
+
+  LLVMContext &Context = M.getContext();
+  bool WasThreadShared = Context.isThreadShared();
+  Context.setThreadShared(true);
+
+  std::atomic<unsigned> NextFunction(0);
+  std::vector<char> FunctionChanged(Functions.size(), false);
+  auto Worker = [&](ConcurrentFPPassManager *PM) {
+    for (unsigned N = NextFunction++; N < Functions.size();
+         N = NextFunction++)
+      FunctionChanged[N] = PM->runOnFunction(*Functions[N]);
+  };
+
+  std::vector<std::thread> Threads;
+  for (unsigned T = 1; T != NumThreads; ++T)
+    Threads.push_back(std::thread(Worker, Managers[T].get()));
+  Worker(Managers[0].get());
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  Context.setThreadShared(WasThreadShared);
+
+  for (const std::unique_ptr<ConcurrentFPPassManager> &PM : Managers) {
+    TPM->removeConcurrentInstances(PM->getInstances());
+    if (TheTimeInfo)
+      TheTimeInfo->removeConcurrentInstances(PM->getInstances());
+  }
+  Managers.clear();
+
+  // The immutable passes that the threads had instances of may still hold
+  // what they knew about the functions before.
+  NumConcurrentFunctions += Functions.size();
+  for (unsigned N = 0; N != Functions.size(); ++N)
+    if (FunctionChanged[N]) {
+      Changed = true;
+      invalidateImmutablePasses(Functions[N]);
+    }
+
+  // Leave the bookkeeping of the passes as a serial run would have.
+  populateInheritedAnalysis(TPM->activeStack);
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    removeNotPreservedAnalysis(FP);
+    recordAvailableAnalysis(FP);
+    removeDeadPasses(FP, M.getModuleIdentifier(), ON_MODULE_MSG);
+  }
+
+  if (DematerializeFunctions)
+    for (unsigned N = 0; N != Functions.size(); ++N) {
+      Function *F = Functions[N];
+      if (WasMaterializable[N] && !FunctionChanged[N] &&
+          F->isDematerializable()) {
+        invalidateImmutablePasses(F);
+        F->Dematerialize();
+      }
+    }
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1609,6 +2013,14 @@ MPPassManager::runOnModule(Module &M) {
 
     initializeAnalysisImpl(MP);
 
+    if (!MP->materializesFunctions())
+      for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+        if (I->isMaterializable()) {
+          if (std::error_code EC = M.materializeAll())
+            report_fatal_error("Error reading bitcode file: " + EC.message());
+          break;
+        }
+
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
@@ -1617,9 +2029,11 @@ MPPassManager::runOnModule(Module &M) {
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(MP, MODIFICATION_MSG, ON_MODULE_MSG,
                    M.getModuleIdentifier());
+      invalidateImmutablePasses(nullptr);
+    }
     dumpPreservedSet(MP);
 
     verifyPreservedAnalysis(MP);
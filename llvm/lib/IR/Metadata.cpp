@@ -33,6 +33,7 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
+  ContextLock Lock(*getContext().pImpl);
   getType()->getContext().pImpl->MetadataAsValues.erase(MD);
   untrack();
 }
@@ -72,6 +73,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -81,6 +83,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->MetadataAsValues;
   auto I = Store.find(MD);
   return I == Store.end() ? nullptr : I->second;
@@ -89,6 +92,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
   MD = canonicalizeMetadataForValue(Context, MD);
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->MetadataAsValues;
 
   // Stop tracking the old metadata.
@@ -250,6 +254,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  ContextLock Lock(*Context.pImpl);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -268,12 +273,14 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
+  ContextLock Lock(*V->getContext().pImpl);
   return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
+  ContextLock Lock(*V->getContext().pImpl);
   auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
@@ -297,6 +304,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -356,6 +364,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.find(Str);
   if (I != Store.end())
@@ -523,6 +532,7 @@ static const Metadata *get_hashable_data(const MDOperand &X) { return X.get(); }
 void UniquableMDNode::handleChangedOperand(void *Ref, Metadata *New) {
   unsigned Op = static_cast<MDOperand *>(Ref) - op_begin();
   assert(Op < getNumOperands() && "Expected valid operand");
+  ContextLock Lock(*getContext().pImpl);
 
   if (isStoredDistinctInContext()) {
     assert(isResolved() && "Expected distinct node to be resolved");
@@ -610,6 +620,7 @@ MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           bool ShouldCreate) {
   MDTupleInfo::KeyTy Key(MDs);
 
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->MDTuples;
   auto I = Store.find_as(Key);
   if (I != Store.end())
@@ -634,6 +645,7 @@ MDTuple *MDTuple::uniquifyImpl() {
   recalculateHash();
   MDTupleInfo::KeyTy Key(this);
 
+  ContextLock Lock(*getContext().pImpl);
   auto &Store = getContext().pImpl->MDTuples;
   auto I = Store.find_as(Key);
   if (I == Store.end()) {
@@ -643,7 +655,10 @@ MDTuple *MDTuple::uniquifyImpl() {
   return *I;
 }
 
-void MDTuple::eraseFromStoreImpl() { getContext().pImpl->MDTuples.erase(this); }
+void MDTuple::eraseFromStoreImpl() {
+  ContextLock Lock(*getContext().pImpl);
+  getContext().pImpl->MDTuples.erase(this);
+}
 
 MDLocation::MDLocation(LLVMContext &C, unsigned Line, unsigned Column,
                        ArrayRef<Metadata *> MDs, bool AllowRAUW)
@@ -690,6 +705,7 @@ MDLocation *MDLocation::getImpl(LLVMContext &Context, unsigned Line,
 
   MDLocationInfo::KeyTy Key(Line, Column, Scope, InlinedAt);
 
+  ContextLock Lock(*Context.pImpl);
   auto &Store = Context.pImpl->MDLocations;
   auto I = Store.find_as(Key);
   if (I != Store.end())
@@ -719,6 +735,7 @@ MDLocation *MDLocation::getDistinct(LLVMContext &Context, unsigned Line,
 MDLocation *MDLocation::uniquifyImpl() {
   MDLocationInfo::KeyTy Key(this);
 
+  ContextLock Lock(*getContext().pImpl);
   auto &Store = getContext().pImpl->MDLocations;
   auto I = Store.find_as(Key);
   if (I == Store.end()) {
@@ -729,6 +746,7 @@ MDLocation *MDLocation::uniquifyImpl() {
 }
 
 void MDLocation::eraseFromStoreImpl() {
+  ContextLock Lock(*getContext().pImpl);
   getContext().pImpl->MDLocations.erase(this);
 }
 
@@ -744,6 +762,7 @@ void UniquableMDNode::storeDistinctInContext() {
   IsDistinctInContext = true;
   if (auto *T = dyn_cast<MDTuple>(this))
     T->setHash(0);
+  ContextLock Lock(*getContext().pImpl);
   getContext().pImpl->DistinctMDNodes.insert(this);
 }
 
@@ -1039,6 +1058,7 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  ContextLock Lock(*getContext().pImpl);
   DenseMap<const Instruction *, LLVMContextImpl::MDMapTy> &MetadataStore =
       getContext().pImpl->MetadataStore;
 
@@ -1085,6 +1105,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     return;
   }
   
+  // The attachments of all instructions are kept in one table.
+  ContextLock Lock(*getContext().pImpl);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
@@ -1146,6 +1169,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
   if (!hasMetadataHashEntry()) return nullptr;
   
+  ContextLock Lock(*getContext().pImpl);
   LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -1166,6 +1190,7 @@ void Instruction::getAllMetadataImpl(
     if (!hasMetadataHashEntry()) return;
   }
   
+  ContextLock Lock(*getContext().pImpl);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -1185,6 +1210,7 @@ void Instruction::getAllMetadataImpl(
 void Instruction::getAllMetadataOtherThanDebugLocImpl(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const {
   Result.clear();
+  ContextLock Lock(*getContext().pImpl);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -1204,6 +1230,7 @@ void Instruction::getAllMetadataOtherThanDebugLocImpl(
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextLock Lock(*getContext().pImpl);
   getContext().pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
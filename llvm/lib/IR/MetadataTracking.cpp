@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/MetadataTracking.h"
+#include "LLVMContextImpl.h"
 #include "llvm/IR/Metadata.h"
 
 using namespace llvm;
@@ -25,10 +26,21 @@ ReplaceableMetadataImpl *ReplaceableMetadataImpl::get(Metadata &MD) {
   return dyn_cast<ValueAsMetadata>(&MD);
 }
 
+/// getContextImpl - Return the context of metadata that may track its uses,
+/// whose lock guards them while threads share the context.
+static LLVMContextImpl *getContextImpl(Metadata &MD) {
+  if (auto *N = dyn_cast<MDNode>(&MD))
+    return N->getContext().pImpl;
+  if (auto *V = dyn_cast<ValueAsMetadata>(&MD))
+    return V->getValue()->getContext().pImpl;
+  return nullptr;
+}
+
 bool MetadataTracking::track(void *Ref, Metadata &MD, OwnerTy Owner) {
   assert(Ref && "Expected live reference");
   assert((Owner || *static_cast<Metadata **>(Ref) == &MD) &&
          "Reference without owner must be direct");
+  ContextLock Lock(getContextImpl(MD));
   if (auto *R = ReplaceableMetadataImpl::get(MD)) {
     R->addRef(Ref, Owner);
     return true;
@@ -38,6 +50,7 @@ bool MetadataTracking::track(void *Ref, Metadata &MD, OwnerTy Owner) {
 
 void MetadataTracking::untrack(void *Ref, Metadata &MD) {
   assert(Ref && "Expected live reference");
+  ContextLock Lock(getContextImpl(MD));
   if (auto *R = ReplaceableMetadataImpl::get(MD))
     R->dropRef(Ref);
 }
@@ -46,6 +59,7 @@ bool MetadataTracking::retrack(void *Ref, Metadata &MD, void *New) {
   assert(Ref && "Expected live reference");
   assert(New && "Expected live reference");
   assert(Ref != New && "Expected change");
+  ContextLock Lock(getContextImpl(MD));
   if (auto *R = ReplaceableMetadataImpl::get(MD)) {
     R->moveRef(Ref, New, MD);
     return true;
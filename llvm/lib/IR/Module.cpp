@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Module.h"
+#include "LLVMContextImpl.h"
 #include "SymbolTableListTraitsImpl.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
@@ -86,6 +87,7 @@ RandomNumberGenerator *Module::createRNG(const Pass* P) const {
 /// the specified name, of arbitrary type.  This method returns null
 /// if a global with the specified name is not found.
 GlobalValue *Module::getNamedValue(StringRef Name) const {
+  ContextLock Lock(*Context.pImpl);
   return cast_or_null<GlobalValue>(getValueSymbolTable().lookup(Name));
 }
 
@@ -116,6 +118,7 @@ Constant *Module::getOrInsertFunction(StringRef Name,
                                       FunctionType *Ty,
                                       AttributeSet AttributeList) {
   // See if we have a definition for the specified function already.
+  ContextLock Lock(*Context.pImpl);
   GlobalValue *F = getNamedValue(Name);
   if (!F) {
     // Nope, add it
@@ -216,6 +219,7 @@ GlobalVariable *Module::getGlobalVariable(StringRef Name, bool AllowLocal) {
 ///      existing global.
 Constant *Module::getOrInsertGlobal(StringRef Name, Type *Ty) {
   // See if we have a definition for the specified global already.
+  ContextLock Lock(*Context.pImpl);
   GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(getNamedValue(Name));
   if (!GV) {
     // Nope, add it
@@ -253,6 +257,7 @@ GlobalAlias *Module::getNamedAlias(StringRef Name) const {
 NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
   SmallString<256> NameData;
   StringRef NameRef = Name.toStringRef(NameData);
+  ContextLock Lock(*Context.pImpl);
   return static_cast<StringMap<NamedMDNode*> *>(NamedMDSymTab)->lookup(NameRef);
 }
 
@@ -260,6 +265,7 @@ NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
 /// with the specified name. This method returns a new NamedMDNode if a
 /// NamedMDNode with the specified name is not found.
 NamedMDNode *Module::getOrInsertNamedMetadata(StringRef Name) {
+  ContextLock Lock(*Context.pImpl);
   NamedMDNode *&NMD =
     (*static_cast<StringMap<NamedMDNode *> *>(NamedMDSymTab))[Name];
   if (!NMD) {
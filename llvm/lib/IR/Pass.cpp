@@ -127,6 +127,10 @@ void ImmutablePass::initializePass() {
   // By default, don't do anything.
 }
 
+void ImmutablePass::invalidateCachedInfo(Function *) {
+  // By default, there is nothing cached.
+}
+
 //===----------------------------------------------------------------------===//
 // FunctionPass Implementation
 //
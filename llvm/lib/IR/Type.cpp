@@ -315,6 +315,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
+  ContextLock Lock(*C.pImpl);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
@@ -360,6 +361,7 @@ FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
+  ContextLock Lock(*pImpl);
   auto I = pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
 
@@ -403,6 +405,7 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
+  ContextLock Lock(*pImpl);
   auto I = pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
 
@@ -427,6 +430,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
+  ContextLock Lock(*getContext().pImpl);
   Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
@@ -437,6 +441,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 void StructType::setName(StringRef Name) {
   if (Name == getName()) return;
 
+  ContextLock Lock(*getContext().pImpl);
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
   typedef StringMap<StructType *>::MapEntryTy EntryTy;
 
@@ -486,6 +491,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  ContextLock Lock(*Context.pImpl);
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -573,6 +579,7 @@ bool StructType::isSized(SmallPtrSetImpl<const Type*> *Visited) const {
   // Here we cheat a bit and cast away const-ness. The goal is to memoize when
   // we find a sized type, as types can only move from opaque to sized, not the
   // other way.
+  ContextLock Lock(*getContext().pImpl);
   const_cast<StructType*>(this)->setSubclassData(
     getSubclassData() | SCDB_IsSized);
   return true;
@@ -618,6 +625,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
+  ContextLock Lock(*getContext().pImpl);
   return getContext().pImpl->NamedStructTypes.lookup(Name);
 }
 
@@ -683,6 +691,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -713,6 +722,7 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
                                             "pointer type.");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
 
@@ -735,7 +745,8 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
-  
+  ContextLock Lock(*CImpl);
+
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
      : CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
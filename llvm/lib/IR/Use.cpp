@@ -8,16 +8,45 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Use.h"
+#include "LLVMContextImpl.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
 #include <new>
 
 namespace llvm {
 
+std::atomic<unsigned> Use::ThreadSharedContexts(0);
+
+/// getSharedContext - Return the context of V if its use list is shared by
+/// the functions of the context and several threads may be changing it.
+static LLVMContextImpl *getSharedContext(const Value *V) {
+  if (!V || !(isa<Constant>(V) || isa<MetadataAsValue>(V) || isa<InlineAsm>(V)))
+    return nullptr;
+  LLVMContextImpl *Impl = V->getContext().pImpl;
+  return Impl->ThreadShared ? Impl : nullptr;
+}
+
+void Use::setLocked(Value *V) {
+  LLVMContextImpl *Impl = getSharedContext(Val);
+  ContextLock Lock(Impl ? Impl : getSharedContext(V));
+  if (Val) removeFromList();
+  Val = V;
+  if (V) V->addUse(*this);
+}
+
 void Use::swap(Use &RHS) {
   if (Val == RHS.Val)
     return;
 
+  LLVMContextImpl *Impl = nullptr;
+  if (LLVM_UNLIKELY(ThreadSharedContexts.load(std::memory_order_relaxed))) {
+    Impl = getSharedContext(Val);
+    if (!Impl)
+      Impl = getSharedContext(RHS.Val);
+  }
+  ContextLock Lock(Impl);
+
   if (Val)
     removeFromList();
 
@@ -186,6 +186,9 @@ void Value::setName(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
+  // Globals share the symbol table of their module, and functions the cache of
+  // their intrinsic IDs.
+  ContextLock Lock(isa<GlobalValue>(this) ? getContext().pImpl : nullptr);
   if (Function *F = dyn_cast<Function>(this))
     getContext().pImpl->IntrinsicIDCache.erase(F);
 
@@ -335,6 +338,8 @@ void Value::replaceAllUsesWith(Value *New) {
     // constant because they are uniqued.
     if (auto *C = dyn_cast<Constant>(U.getUser())) {
       if (!isa<GlobalValue>(C)) {
+        // Constants are shared by all functions of the context.
+        ContextLock Lock(*getContext().pImpl);
         C->replaceUsesOfWithOnConstant(this, New, &U);
         continue;
       }
@@ -651,6 +656,7 @@ void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
 
 void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
   assert(List && "Must insert after existing node");
+  ContextLock Lock(*List->V->getContext().pImpl);
 
   Next = List->Next;
   setPrevPtr(&List->Next);
@@ -663,6 +669,9 @@ void ValueHandleBase::AddToUseList() {
   assert(V && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  // Growing the map moves the heads of the handle lists of all values, so
+  // threads sharing the context change any of the lists under its lock.
+  ContextLock Lock(*pImpl);
 
   if (V->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -705,6 +714,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(V && V->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ContextLock Lock(*V->getContext().pImpl);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -735,6 +745,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[V];
   assert(Entry && "Value bit set but no entries exist");
 
@@ -795,6 +806,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[Old];
 
   assert(Entry && "Value bit set but no entries exist");
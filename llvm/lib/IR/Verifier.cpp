@@ -2333,6 +2333,20 @@ void Verifier::visitInstruction(Instruction &I) {
   InstsInThisBlock.insert(&I);
 }
 
+/// isIntWithElementsLike - Return true if Ty is an integer type of BitWidth
+/// bits, or a vector of such integers with as many elements as Ref if Ref is a
+/// vector.  This compares the types instead of creating the expected one, which
+/// would take the lock of the context while functions are verified on several
+/// threads at once (see createConcurrentInstance).
+static bool isIntWithElementsLike(Type *Ty, Type *Ref, unsigned BitWidth) {
+  if (VectorType *RefVTy = dyn_cast<VectorType>(Ref)) {
+    VectorType *VTy = dyn_cast<VectorType>(Ty);
+    return VTy && VTy->getNumElements() == RefVTy->getNumElements() &&
+           VTy->getElementType()->isIntegerTy(BitWidth);
+  }
+  return Ty->isIntegerTy(BitWidth);
+}
+
 /// VerifyIntrinsicType - Verify that the specified type (which comes from an
 /// intrinsic argument or return value) matches the type constraints specified
 /// by the .td file (e.g. an "any integer" argument really is an integer).
@@ -2403,37 +2417,34 @@ bool Verifier::VerifyIntrinsicType(Type *Ty,
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
 
-    Type *NewTy = ArgTys[D.getArgumentNumber()];
-    if (VectorType *VTy = dyn_cast<VectorType>(NewTy))
-      NewTy = VectorType::getExtendedElementVectorType(VTy);
-    else if (IntegerType *ITy = dyn_cast<IntegerType>(NewTy))
-      NewTy = IntegerType::get(ITy->getContext(), 2 * ITy->getBitWidth());
-    else
+    Type *RefTy = ArgTys[D.getArgumentNumber()];
+    if (!isa<VectorType>(RefTy) && !isa<IntegerType>(RefTy))
       return true;
 
-    return Ty != NewTy;
+    return !isIntWithElementsLike(Ty, RefTy, 2 * RefTy->getScalarSizeInBits());
   }
   case IITDescriptor::TruncArgument: {
     // This may only be used when referring to a previous vector argument.
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
 
-    Type *NewTy = ArgTys[D.getArgumentNumber()];
-    if (VectorType *VTy = dyn_cast<VectorType>(NewTy))
-      NewTy = VectorType::getTruncatedElementVectorType(VTy);
-    else if (IntegerType *ITy = dyn_cast<IntegerType>(NewTy))
-      NewTy = IntegerType::get(ITy->getContext(), ITy->getBitWidth() / 2);
-    else
+    Type *RefTy = ArgTys[D.getArgumentNumber()];
+    if (!isa<VectorType>(RefTy) && !isa<IntegerType>(RefTy))
       return true;
 
-    return Ty != NewTy;
+    return !isIntWithElementsLike(Ty, RefTy, RefTy->getScalarSizeInBits() / 2);
   }
-  case IITDescriptor::HalfVecArgument:
+  case IITDescriptor::HalfVecArgument: {
     // This may only be used when referring to a previous vector argument.
-    return D.getArgumentNumber() >= ArgTys.size() ||
-           !isa<VectorType>(ArgTys[D.getArgumentNumber()]) ||
-           VectorType::getHalfElementsVectorType(
-                         cast<VectorType>(ArgTys[D.getArgumentNumber()])) != Ty;
+    if (D.getArgumentNumber() >= ArgTys.size())
+      return true;
+    VectorType *ReferenceType =
+      dyn_cast<VectorType>(ArgTys[D.getArgumentNumber()]);
+    VectorType *ThisArgType = dyn_cast<VectorType>(Ty);
+    return !ReferenceType || !ThisArgType ||
+           ThisArgType->getElementType() != ReferenceType->getElementType() ||
+           ThisArgType->getNumElements() != ReferenceType->getNumElements() / 2;
+  }
   case IITDescriptor::SameVecWidthArgument: {
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
@@ -2819,13 +2830,26 @@ void DebugInfoVerifier::verifyDebugInfo() {
 }
 
 void DebugInfoVerifier::processInstructions(DebugInfoFinder &Finder) {
-  for (const Function &F : *M)
+  for (const Function &F : *M) {
+    // Functions that are still to be read from bitcode are read one at a time
+    // and released again once they have been looked at.
+    bool WasMaterializable = F.isMaterializable();
+    if (WasMaterializable)
+      if (std::error_code EC = const_cast<Function &>(F).materialize()) {
+        CheckFailed("Error reading bitcode file: " + EC.message());
+        continue;
+      }
+
     for (auto I = inst_begin(&F), E = inst_end(&F); I != E; ++I) {
       if (MDNode *MD = I->getMetadata(LLVMContext::MD_dbg))
         Finder.processLocation(*M, DILocation(MD));
       if (const CallInst *CI = dyn_cast<CallInst>(&*I))
         processCallInst(Finder, *CI);
     }
+
+    if (WasMaterializable && F.isDematerializable())
+      const_cast<Function &>(F).Dematerialize();
+  }
 }
 
 void DebugInfoVerifier::processCallInst(DebugInfoFinder &Finder,
@@ -2897,6 +2921,10 @@ struct VerifierLegacyPass : public FunctionPass {
     return false;
   }
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new VerifierLegacyPass(FatalErrors);
+  }
+
   bool doFinalization(Module &M) override {
     if (!V.verify(M) && FatalErrors)
       report_fatal_error("Broken module found, compilation aborted!");
@@ -2929,6 +2957,8 @@ struct DebugInfoVerifierLegacyPass : public ModulePass {
     return false;
   }
 
+  bool materializesFunctions() const override { return true; }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.setPreservesAll();
   }
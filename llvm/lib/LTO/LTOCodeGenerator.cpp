@@ -16,6 +16,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -75,6 +76,7 @@ LTOCodeGenerator::LTOCodeGenerator(std::unique_ptr<LLVMContext> Context)
 }
 
 void LTOCodeGenerator::initialize() {
+  MArch = nullptr;
   TargetMach = nullptr;
   EmitDwarfDebugInfo = false;
   ScopeRestrictionsDone = false;
@@ -282,10 +284,32 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   llvm::Triple Triple(TripleStr);
 
   // create target machine from info for merged modules
-  const Target *march = TargetRegistry::lookupTarget(TripleStr, errMsg);
-  if (!march)
+  MArch = TargetRegistry::lookupTarget(TripleStr, errMsg);
+  if (!MArch)
     return false;
 
+  // Construct LTOModule, hand over ownership of module and target. Use MAttr as
+  // the default set of features.
+  SubtargetFeatures Features(MAttr);
+  Features.getDefaultSubtargetFeatures(Triple);
+  FeatureStr = Features.getString();
+  // Set a default CPU for Darwin triples.
+  if (MCpu.empty() && Triple.isOSDarwin()) {
+    if (Triple.getArch() == llvm::Triple::x86_64)
+      MCpu = "core2";
+    else if (Triple.getArch() == llvm::Triple::x86)
+      MCpu = "yonah";
+    else if (Triple.getArch() == llvm::Triple::aarch64)
+      MCpu = "cyclone";
+  }
+
+  TargetMach = createTargetMachine();
+  return true;
+}
+
+/// createTargetMachine - Create a target machine for the merged module, once
+/// determineTarget found its target.
+TargetMachine *LTOCodeGenerator::createTargetMachine() {
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
   Reloc::Model RelocModel = Reloc::Default;
@@ -304,25 +328,12 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
     break;
   }
 
-  // Construct LTOModule, hand over ownership of module and target. Use MAttr as
-  // the default set of features.
-  SubtargetFeatures Features(MAttr);
-  Features.getDefaultSubtargetFeatures(Triple);
-  std::string FeatureStr = Features.getString();
-  // Set a default CPU for Darwin triples.
-  if (MCpu.empty() && Triple.isOSDarwin()) {
-    if (Triple.getArch() == llvm::Triple::x86_64)
-      MCpu = "core2";
-    else if (Triple.getArch() == llvm::Triple::x86)
-      MCpu = "yonah";
-    else if (Triple.getArch() == llvm::Triple::aarch64)
-      MCpu = "cyclone";
-  }
-
-  TargetMach = march->createTargetMachine(TripleStr, MCpu, FeatureStr, Options,
-                                          RelocModel, CodeModel::Default,
-                                          CodeGenOpt::Aggressive);
-  return true;
+  std::string TripleStr = IRLinker.getModule()->getTargetTriple();
+  if (TripleStr.empty())
+    TripleStr = sys::getDefaultTargetTriple();
+  return MArch->createTargetMachine(TripleStr, MCpu, FeatureStr, Options,
+                                    RelocModel, CodeModel::Default,
+                                    CodeGenOpt::Aggressive);
 }
 
 void LTOCodeGenerator::
@@ -456,13 +467,23 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   ScopeRestrictionsDone = true;
 }
 
-/// Optimize merged modules using various IPO passes
 bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
                                           bool DisableOpt,
                                           bool DisableInline,
                                           bool DisableGVNLoadPRE,
                                           bool DisableVectorization,
                                           std::string &errMsg) {
+  return optimize(DisableOpt, DisableInline, DisableGVNLoadPRE,
+                  DisableVectorization, errMsg) &&
+         compileOptimized(&out, errMsg);
+}
+
+/// Optimize merged modules using various IPO passes
+bool LTOCodeGenerator::optimize(bool DisableOpt,
+                                bool DisableInline,
+                                bool DisableGVNLoadPRE,
+                                bool DisableVectorization,
+                                std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -492,25 +513,46 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
 
   PMB.populateLTOPassManager(passes, TargetMach);
 
-  PassManager codeGenPasses;
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
 
-  codeGenPasses.add(new DataLayoutPass());
+  return true;
+}
 
-  formatted_raw_ostream Out(out);
+bool LTOCodeGenerator::compileOptimized(ArrayRef<raw_ostream *> Out,
+                                        std::string &errMsg) {
+  if (!this->determineTarget(errMsg))
+    return false;
+
+  Module *mergedModule = IRLinker.getModule();
+  mergedModule->setDataLayout(TargetMach->getSubtargetImpl()->getDataLayout());
 
   // If the bitcode files contain ARC code and were compiled with optimization,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
-  codeGenPasses.add(createObjCARCContractPass());
+  auto AddPasses = [](PassManagerBase &PM) {
+    PM.add(createObjCARCContractPass());
+  };
+
+  if (Out.size() > 1)
+    return !splitCodeGen(*mergedModule, Out,
+                         [this]() { return createTargetMachine(); },
+                         TargetMachine::CGFT_ObjectFile, false, AddPasses,
+                         errMsg);
+
+  PassManager codeGenPasses;
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
+  codeGenPasses.add(new DataLayoutPass());
+
+  formatted_raw_ostream FOut(*Out[0]);
+
+  AddPasses(codeGenPasses);
+
+  if (TargetMach->addPassesToEmitFile(codeGenPasses, FOut,
                                       TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
   codeGenPasses.run(*mergedModule);
 
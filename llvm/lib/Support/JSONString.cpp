@@ -0,0 +1,27 @@
+//===- JSONString.cpp - Write JSON string literals ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/JSONString.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+void llvm::writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if ((unsigned char)C < 0x20)
+      OS << format("\\u%04x", (unsigned char)C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
@@ -147,13 +147,17 @@ TimeRecord TimeRecord::getCurrentTime(bool Start) {
 static ManagedStatic<std::vector<Timer*> > ActiveTimers;
 
 void Timer::startTimer() {
+  TimeRecord Now = TimeRecord::getCurrentTime(true);
+  sys::SmartScopedLock<true> L(*TimerLock);
   Started = true;
   ActiveTimers->push_back(this);
-  Time -= TimeRecord::getCurrentTime(true);
+  Time -= Now;
 }
 
 void Timer::stopTimer() {
-  Time += TimeRecord::getCurrentTime(false);
+  TimeRecord Now = TimeRecord::getCurrentTime(false);
+  sys::SmartScopedLock<true> L(*TimerLock);
+  Time += Now;
 
   if (ActiveTimers->back() == this) {
     ActiveTimers->pop_back();
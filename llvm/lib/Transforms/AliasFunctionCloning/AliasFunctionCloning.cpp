@@ -18,136 +18,783 @@ STATISTIC(NumFuncsCompletelyReplaced,
 STATISTIC(NumPointerFuncs, "Number of functions that take pointer arguments");
 STATISTIC(NumPointerFuncsAtLeastOneCall,
           "Number of functions with at least one call");
+STATISTIC(NumDynamicCInsts,
+          "Number of CallInsts replaced by a runtime-guarded clone");
+STATISTIC(NumDynamicChecks, "Number of pointer-overlap checks emitted");
+STATISTIC(NumPartialClonedFuncs, "Number of partially restrictified clones");
+STATISTIC(NumPartialCInsts,
+          "Number of CallInsts replaced by a partially restrictified clone");
+STATISTIC(NumPartialIInsts,
+          "Number of InvokeInsts replaced by a partially restrictified clone");
+STATISTIC(NumAliasCacheHits, "Number of alias queries answered by the cache");
+STATISTIC(NumAliasCacheMisses, "Number of alias queries missing the cache");
+STATISTIC(NumUnprofitableFuncs,
+          "Number of functions not cloned by the profitability model");
+STATISTIC(NumClonesRemoved, "Number of clones removed for having no callers");
+STATISTIC(NumReusedClones, "Number of clones already present in the module");
+STATISTIC(NumColdFuncs, "Number of functions not cloned for being cold");
+STATISTIC(NumColdCallSites,
+          "Number of call sites denied a partial clone or an overlap check "
+          "for being cold");
+STATISTIC(NumOverlappingCallSites,
+          "Number of call sites denied an overlap check for overlapping too "
+          "often at run time");
+STATISTIC(NumOverlapCounters,
+          "Number of calls instrumented to count argument overlaps");
+
+static cl::opt<bool>
+    AFCDynamic("afc-dynamic", cl::init(false), cl::Hidden,
+               cl::desc("Guard calls that cannot be statically "
+                        "restrictified by a runtime pointer-overlap check"));
+
+static cl::opt<bool>
+    AFCCloneAll("afc-clone-all", cl::init(false), cl::Hidden,
+                cl::desc("Clone every function with two or more pointer "
+                         "arguments, regardless of profitability"));
+
+static cl::opt<unsigned> AFCMinBlockedPairs(
+    "afc-min-blocked-pairs", cl::init(2), cl::Hidden,
+    cl::desc("Minimum number of possibly aliasing access pairs outside of "
+             "loops for a function to be worth cloning"));
+
+static cl::opt<unsigned> AFCProfitabilityMaxQueries(
+    "afc-profitability-max-queries", cl::init(1000), cl::Hidden,
+    cl::desc("Maximum number of alias queries spent deciding whether a "
+             "function is worth cloning"));
+
+static cl::opt<unsigned> AFCMaxPartialClones(
+    "afc-max-partial-clones", cl::init(4), cl::Hidden,
+    cl::desc("Maximum number of partially restrictified variants created "
+             "per function"));
+
+static cl::opt<unsigned> AFCThreads(
+    "afc-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads used to analyze the functions to clone"));
+
+static cl::opt<bool> AFCMergeableClones(
+    "afc-mergeable-clones", cl::init(true), cl::Hidden,
+    cl::desc("Name the clones of functions that may be defined in several "
+             "modules after their contents, so that identical clones merge"));
+
+static cl::opt<unsigned> AFCDynamicMaxChecks(
+    "afc-dynamic-max-checks", cl::init(8), cl::Hidden,
+    cl::desc("Maximum number of pointer pairs checked at a single call site"));
+
+static cl::opt<std::string> AFCRemarksOutput(
+    "afc-remarks-output", cl::Hidden, cl::value_desc("filename"),
+    cl::desc("File to write every restrictification decision to, as JSON"));
+
+static cl::opt<std::string> AFCSampleProfile(
+    "afc-sample-profile", cl::Hidden, cl::value_desc("filename"),
+    cl::desc("Sample profile restricting cloning to hot functions, and "
+             "partial clones and overlap checks to hot call sites"));
+
+static cl::opt<unsigned> AFCHotPercent(
+    "afc-hot-percent", cl::init(1), cl::Hidden,
+    cl::desc("Percentage of the samples of the hottest function (call site) "
+             "of the profile that makes a function (call site) hot"));
+
+static cl::opt<bool> AFCOverlapProfileGen(
+    "afc-overlap-profile-gen", cl::init(false), cl::Hidden,
+    cl::desc("Instrument calls to count how often their pointer arguments "
+             "overlap at run time, instead of cloning anything"));
+
+static cl::opt<unsigned> AFCMaxOverlapPercent(
+    "afc-max-overlap-percent", cl::init(10), cl::Hidden,
+    cl::desc("Maximum percentage of the profiled runs of a call in which its "
+             "arguments overlapped for it to get an overlap check"));
+
+namespace {
+// Re-materializes a SCEV computed in the callee at a call site, replacing
+// the callee's formal arguments by the actual ones. All pointer-typed
+// values are handled as integers of the pointer size.
+class CallSiteSCEVEmitter
+    : public SCEVVisitor<CallSiteSCEVEmitter, Value *> {
+  CallSite CS;
+  IRBuilder<> &Builder;
+  Type *IntPtrTy;
+
+  Type *getType(const SCEV *S) const {
+    return S->getType()->isPointerTy() ? IntPtrTy : S->getType();
+  }
+
+  Value *emitNAry(const SCEVNAryExpr *S, Instruction::BinaryOps Op) {
+    Value *V = visit(S->getOperand(0));
+    for (unsigned i = 1, e = S->getNumOperands(); V && i != e; ++i) {
+      Value *W = visit(S->getOperand(i));
+      V = W ? Builder.CreateBinOp(Op, V, W) : nullptr;
+    }
+    return V;
+  }
+
+  Value *emitMax(const SCEVNAryExpr *S, bool Signed) {
+    Value *V = visit(S->getOperand(0));
+    for (unsigned i = 1, e = S->getNumOperands(); V && i != e; ++i) {
+      Value *W = visit(S->getOperand(i));
+      if (!W)
+        return nullptr;
+      Value *Cmp = Signed ? Builder.CreateICmpSGT(V, W)
+                          : Builder.CreateICmpUGT(V, W);
+      V = Builder.CreateSelect(Cmp, V, W);
+    }
+    return V;
+  }
+
+public:
+  CallSiteSCEVEmitter(CallSite CS, IRBuilder<> &Builder, Type *IntPtrTy)
+      : CS(CS), Builder(Builder), IntPtrTy(IntPtrTy) {}
+
+  Value *visitConstant(const SCEVConstant *S) {
+    return ConstantInt::get(getType(S), S->getValue()->getValue());
+  }
+
+  Value *visitTruncateExpr(const SCEVTruncateExpr *S) {
+    Value *V = visit(S->getOperand());
+    return V ? Builder.CreateTrunc(V, getType(S)) : nullptr;
+  }
+
+  Value *visitZeroExtendExpr(const SCEVZeroExtendExpr *S) {
+    Value *V = visit(S->getOperand());
+    return V ? Builder.CreateZExt(V, getType(S)) : nullptr;
+  }
+
+  Value *visitSignExtendExpr(const SCEVSignExtendExpr *S) {
+    Value *V = visit(S->getOperand());
+    return V ? Builder.CreateSExt(V, getType(S)) : nullptr;
+  }
+
+  Value *visitAddExpr(const SCEVAddExpr *S) {
+    return emitNAry(S, Instruction::Add);
+  }
+
+  Value *visitMulExpr(const SCEVMulExpr *S) {
+    return emitNAry(S, Instruction::Mul);
+  }
+
+  Value *visitUDivExpr(const SCEVUDivExpr *S) {
+    // Only divide by non-zero constants, so that the check itself can never
+    // trap where the original call would not.
+    const SCEVConstant *RHS = dyn_cast<SCEVConstant>(S->getRHS());
+    if (!RHS || RHS->getValue()->isZero())
+      return nullptr;
+    Value *V = visit(S->getLHS());
+    return V ? Builder.CreateUDiv(V, visitConstant(RHS)) : nullptr;
+  }
+
+  // Recurrences are resolved into ranges before reaching the emitter.
+  Value *visitAddRecExpr(const SCEVAddRecExpr *S) { return nullptr; }
+
+  Value *visitSMaxExpr(const SCEVSMaxExpr *S) { return emitMax(S, true); }
+
+  Value *visitUMaxExpr(const SCEVUMaxExpr *S) { return emitMax(S, false); }
+
+  Value *visitUnknown(const SCEVUnknown *S) {
+    Value *V = S->getValue();
+    if (const Argument *A = dyn_cast<Argument>(V))
+      V = CS.getArgument(A->getArgNo());
+    else if (!isa<Constant>(V))
+      return nullptr;
+
+    if (V->getType()->isPointerTy())
+      return Builder.CreatePtrToInt(V, IntPtrTy);
+    return V;
+  }
+
+  Value *visitCouldNotCompute(const SCEVCouldNotCompute *S) { return nullptr; }
+};
+}
+
+namespace {
+// Checks that a SCEV only refers to the callee's arguments and to operations
+// CallSiteSCEVEmitter knows how to emit.
+struct CallSiteExpandable {
+  bool Expandable;
+
+  CallSiteExpandable() : Expandable(true) {}
+
+  bool follow(const SCEV *S) {
+    switch (S->getSCEVType()) {
+    case scAddRecExpr:
+    case scCouldNotCompute:
+      Expandable = false;
+      break;
+    case scUnknown: {
+      const Value *V = cast<SCEVUnknown>(S)->getValue();
+      Expandable = isa<Argument>(V) || isa<Constant>(V);
+      break;
+    }
+    case scUDivExpr: {
+      const SCEVConstant *RHS =
+          dyn_cast<SCEVConstant>(cast<SCEVUDivExpr>(S)->getRHS());
+      Expandable = RHS && !RHS->getValue()->isZero();
+      break;
+    }
+    default:
+      break;
+    }
+    return Expandable;
+  }
+
+  bool isDone() { return !Expandable; }
+};
+}
+
+static bool isExpandableAtCallSite(const SCEV *S) {
+  CallSiteExpandable Check;
+  SCEVTraversal<CallSiteExpandable> T(Check);
+  T.visitAll(S);
+  return Check.Expandable;
+}
+
+// Returns the step of AR as a constant. ScalarEvolution may have been
+// computed without a DataLayout, in which case type sizes are left as
+// constant expressions that we fold here.
+static const SCEVConstant *getConstantStep(const SCEVAddRecExpr *AR,
+                                           ScalarEvolution &SE,
+                                           const DataLayout *DL) {
+  const SCEV *Step = AR->getStepRecurrence(SE);
+  if (const SCEVConstant *C = dyn_cast<SCEVConstant>(Step))
+    return C;
+
+  if (const SCEVUnknown *U = dyn_cast<SCEVUnknown>(Step))
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(U->getValue()))
+      if (ConstantInt *CI = dyn_cast_or_null<ConstantInt>(
+              ConstantFoldConstantExpression(CE, DL)))
+        return cast<SCEVConstant>(SE.getConstant(CI));
+
+  return nullptr;
+}
+
+// Computes the [Lo, Hi] range of offsets S may take over all iterations of
+// the loops it varies in, as seen from instruction I. Only affine recurrences
+// with a constant step and a computable trip count are handled.
+static bool getOffsetRange(const SCEV *S, const Instruction *I,
+                           ScalarEvolution &SE, const DataLayout *DL,
+                           const SCEV *&Lo, const SCEV *&Hi) {
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR) {
+    Lo = Hi = S;
+    return true;
+  }
+
+  // Outside of its loop the recurrence may have stepped past the last value
+  // seen by the body.
+  if (!AR->isAffine() || !AR->getLoop()->contains(I))
+    return false;
+
+  const SCEVConstant *Step = getConstantStep(AR, SE, DL);
+  const SCEV *BTC = SE.getBackedgeTakenCount(AR->getLoop());
+  if (!Step || isa<SCEVCouldNotCompute>(BTC))
+    return false;
+
+  const SCEV *StartLo, *StartHi;
+  if (!getOffsetRange(AR->getStart(), I, SE, DL, StartLo, StartHi))
+    return false;
+
+  BTC = SE.getTruncateOrZeroExtend(BTC, Step->getType());
+  const SCEV *Dist = SE.getMulExpr(Step, BTC);
+  if (Step->getValue()->isNegative()) {
+    Lo = SE.getAddExpr(StartLo, Dist);
+    Hi = StartHi;
+  } else {
+    Lo = StartLo;
+    Hi = SE.getAddExpr(StartHi, Dist);
+  }
+  return true;
+}
 
 void AliasFunctionCloning::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesCFG();
   AU.addRequiredTransitive<AliasAnalysis>();
   AU.addRequiredTransitive<DataLayoutPass>();
+  AU.addRequired<CallGraphWrapperPass>();
+  if (AFCDynamic || AFCOverlapProfileGen)
+    AU.addRequired<ScalarEvolution>();
 }
 
-void AliasFunctionCloning::createNoAliasFunctionClones(Module &M) {
-  Module::iterator Mit, Mend;
+bool AliasFunctionCloning::isCloningCandidate(Function &F) const {
+  /*
+   * TODO: discuss whether we should clone "available externally"
+   * functions. They are not dumped into the object file, but have
+   * their definition available to the optimizer for it to perform
+   * inlining.
+   */
+  if (F.isDeclaration() || F.isVarArg())
+    return false;
+
+  Function::arg_iterator I, E;
+
+  // first we check if this function has any pointer arguments at all
+  unsigned numPointerArg = 0;
+  for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I) {
+    const Argument *A = I;
+    if (A->getType()->isPointerTy()) {
+      ++numPointerArg;
+    }
+  }
 
-  // check every function in module
-  for (Mit = M.begin(), Mend = M.end(); Mit != Mend; ++Mit) {
-    Function &F = *Mit;
-
-    /*
-     * TODO: discuss whether we should clone "available externally"
-     * functions. They are not dumped into the object file, but have
-     * their definition available to the optimizer for it to perform
-     * inlining.
-     */
-    if (F.isDeclaration() || F.isVarArg())
-      continue;
+  if (numPointerArg < 2) {
+    return false;
+  }
+
+  ++NumPointerFuncs;
+
+  // How many arguments were already noalias?
+  // If all of them, the original function is already
+  // restrictified, so we don't need to create a clone
+  unsigned numAlreadyNoAlias = 0;
+  for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I) {
+    const Argument *A = I;
+    if (A->getType()->isPointerTy() && A->hasNoAliasAttr())
+      ++numAlreadyNoAlias;
+  }
 
-    // errs() << F.getName() << "\n";
+  return numPointerArg != numAlreadyNoAlias;
+}
+
+void AliasFunctionCloning::createNoAliasFunctionClones(Module &M) {
+  CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  SmallVector<Function *, 16> toClone;
+  SmallPtrSet<const Function *, 16> willClone;
+
+  // Visit the call graph bottom-up, so that the callees of a function are
+  // chosen before we decide whether the function itself is worth cloning.
+  for (scc_iterator<CallGraph *> SCCI = scc_begin(&CG); !SCCI.isAtEnd();
+       ++SCCI) {
+    SmallVector<Function *, 4> pending;
+
+    for (CallGraphNode *N : *SCCI) {
+      Function *F = N->getFunction();
+      if (!F || !isCloningCandidate(*F))
+        continue;
 
-    Function::arg_iterator I, E;
+      if (!isHotFunction(*F)) {
+        ++NumColdFuncs;
+        continue;
+      }
 
-    // first we check if this function has any pointer arguments at all
-    unsigned numPointerArg = 0;
-    for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I) {
-      const Argument *A = I;
-      if (A->getType()->isPointerTy()) {
-        ++numPointerArg;
+      if (AFCCloneAll || isCloningProfitable(*F)) {
+        toClone.push_back(F);
+        willClone.insert(F);
+      } else {
+        pending.push_back(F);
       }
     }
 
-    if (numPointerArg < 2) {
-      continue;
+    // A function that is not profitable on its own may still be worth
+    // cloning if it forwards its arguments to a clone. Within a recursive
+    // SCC, each new clone may enable another one, so iterate to a fixpoint.
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto I = pending.begin(); I != pending.end();) {
+        if (feedsNoAliasClone(**I, willClone)) {
+          toClone.push_back(*I);
+          willClone.insert(*I);
+          I = pending.erase(I);
+          changed = true;
+        } else {
+          ++I;
+        }
+      }
     }
 
-    ++NumPointerFuncs;
+    NumUnprofitableFuncs += pending.size();
+  }
 
-    FunctionType *FTy = F.getFunctionType();
-    SmallVector<Type *, 4> Params;
-    SmallVector<AttributeSet, 4> AttributesVec;
+  // The alias scope analysis only reads the original bodies, so it can be
+  // done for every function up front, possibly in parallel. The clones are
+  // then created and annotated one at a time.
+  std::vector<AliasScopePlan> plans(toClone.size());
+  planAliasScopesInParallel(toClone, plans);
 
-    const AttributeSet &PAL = F.getAttributes();
-    SmallVector<Argument *, 4> already_noalias;
+  for (unsigned i = 0, e = toClone.size(); i != e; ++i)
+    createNoAliasClone(*toClone[i], &plans[i]);
+}
 
-    // promote all pointer arguments to noalias
-    unsigned ArgIndex = 1;
+void AliasFunctionCloning::planAliasScopesInParallel(
+    ArrayRef<Function *> Fns, std::vector<AliasScopePlan> &Plans) const {
+  // Alias analysis is not thread-safe, so whatever the planning needs from
+  // it is gathered beforehand.
+  std::vector<SmallPtrSet<const Instruction *, 8> > argMemOnlyCalls(
+      Fns.size());
+  for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+    collectArgMemOnlyCalls(*Fns[i], argMemOnlyCalls[i]);
+
+  auto planOne = [&](unsigned i) {
+    Function &F = *Fns[i];
+    SmallBitVector NoAliasArgs(F.arg_size());
+    for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E;
+         ++I)
+      if (I->getType()->isPointerTy())
+        NoAliasArgs.set(I->getArgNo());
+    planAliasScopes(F, NoAliasArgs, argMemOnlyCalls[i], Plans[i]);
+  };
+
+  unsigned numThreads = std::min<unsigned>(AFCThreads, Fns.size());
+  if (numThreads <= 1 || !llvm_is_multithreaded()) {
+    for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+      planOne(i);
+    return;
+  }
 
-    for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I, ++ArgIndex) {
-      Argument *A = I;
+  // Workers pull functions off a shared counter, since their sizes vary
+  // wildly.
+  std::atomic<unsigned> next(0);
+  auto worker = [&]() {
+    for (unsigned i = next++; i < Fns.size(); i = next++)
+      planOne(i);
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < numThreads; ++t)
+    threads.push_back(std::thread(worker));
+  worker();
+  for (std::thread &T : threads)
+    T.join();
+}
+
+void AliasFunctionCloning::createNoAliasClone(Function &F,
+                                              const AliasScopePlan *Plan) {
+  SmallBitVector NoAliasArgs(F.arg_size());
+  for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E;
+       ++I) {
+    const Argument *A = I;
+    if (A->getType()->isPointerTy())
+      NoAliasArgs.set(A->getArgNo());
+  }
 
-      Params.push_back(A->getType());
-      AttributeSet attrs = PAL.getParamAttributes(ArgIndex);
+  Function *newfunc =
+      createClone(F, NoAliasArgs, F.getName() + "_noalias", Plan);
 
-      // argument is not pointer
-      if (!A->getType()->isPointerTy()) {
-        AttrBuilder B(attrs, ArgIndex);
-        AttributesVec.push_back(
-            AttributeSet::get(F.getContext(), Params.size(), B));
-      } else {
-        if (attrs.hasAttribute(ArgIndex, Attribute::NoAlias)) {
-          already_noalias.push_back(A);
+  // Insert cloned function into the map of clones
+  const auto &it = this->clonesMap.insert(std::make_pair(&F, newfunc));
+  assert(it.second);
+
+  ++NumClonedFuncs;
+}
+
+bool AliasFunctionCloning::feedsNoAliasClone(
+    Function &F, const SmallPtrSetImpl<const Function *> &Cloned) const {
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    CallSite CS(&*I);
+    if (!CS || !Cloned.count(CS.getCalledFunction()))
+      continue;
+
+    // The call benefits from restrictifying F if at least two of its
+    // pointer arguments come from distinct arguments of F.
+    SmallPtrSet<const Argument *, 4> Sources;
+    for (CallSite::arg_iterator AI = CS.arg_begin(), AE = CS.arg_end();
+         AI != AE; ++AI) {
+      if (!(*AI)->getType()->isPointerTy())
+        continue;
+      const Argument *A =
+          dyn_cast<Argument>(GetUnderlyingObject(*AI, DL, 0));
+      if (A && A->getParent() == &F && !A->hasNoAliasAttr())
+        Sources.insert(A);
+    }
+
+    if (Sources.size() >= 2)
+      return true;
+  }
+
+  return false;
+}
+
+// Determines if C refers to a symbol that only means something inside its
+// own module
+static bool refersToLocalSymbol(const Constant *C,
+                                SmallPtrSetImpl<const Constant *> &Visited) {
+  if (!Visited.insert(C).second)
+    return false;
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C))
+    return GV->hasLocalLinkage();
+  for (const Use &U : C->operands())
+    if (refersToLocalSymbol(cast<Constant>(U.get()), Visited))
+      return true;
+  return false;
+}
+
+static void writeAttributes(const AttributeSet &AS, raw_ostream &OS) {
+  for (unsigned i = 0, e = AS.getNumSlots(); i != e; ++i) {
+    unsigned Index = AS.getSlotIndex(i);
+    OS << " [" << Index << ": " << AS.getAsString(Index) << "]";
+  }
+}
+
+// Writes a rendering of F that only depends on what F computes, so that
+// copies of the same code in distinct modules are written the same way.
+// Value names and metadata are left out, since they differ from one module
+// to another. Returns false if F refers to local symbols, whose meaning
+// depends on the module. The special state written for each instruction is
+// the one compared by Instruction::isIdenticalTo.
+static bool writeFunctionContents(const Function &F, raw_ostream &OS) {
+  if (F.hasPrefixData() || F.hasPrologueData())
+    return false;
+
+  DenseMap<const Value *, unsigned> Slots;
+  unsigned NumSlots = 0;
+  for (Function::const_arg_iterator I = F.arg_begin(), E = F.arg_end();
+       I != E; ++I)
+    Slots[I] = NumSlots++;
+  for (const BasicBlock &BB : F) {
+    Slots[&BB] = NumSlots++;
+    for (const Instruction &I : BB)
+      Slots[&I] = NumSlots++;
+  }
+
+  OS << *F.getFunctionType() << " cc" << F.getCallingConv() << " align"
+     << F.getAlignment();
+  if (F.hasSection())
+    OS << " section " << F.getSection();
+  if (F.hasGC())
+    OS << " gc " << F.getGC();
+  writeAttributes(F.getAttributes(), OS);
+  OS << "\n";
+
+  SmallPtrSet<const Constant *, 16> Visited;
+  for (const BasicBlock &BB : F) {
+    OS << Slots[&BB] << ":\n";
+    for (const Instruction &I : BB) {
+      OS << I.getOpcodeName() << " " << *I.getType() << " "
+         << unsigned(I.getRawSubclassOptionalData());
+
+      for (const Use &U : I.operands()) {
+        const Value *V = U.get();
+        OS << ", ";
+        auto It = Slots.find(V);
+        if (It != Slots.end()) {
+          OS << "%" << It->second;
+        } else if (isa<MetadataAsValue>(V)) {
+          OS << "metadata";
+        } else if (const InlineAsm *IA = dyn_cast<InlineAsm>(V)) {
+          OS << "asm " << *IA->getType() << " \"" << IA->getAsmString()
+             << "\" \"" << IA->getConstraintString() << "\" "
+             << IA->hasSideEffects() << IA->isAlignStack()
+             << IA->getDialect();
+        } else if (const Constant *C = dyn_cast<Constant>(V)) {
+          if (refersToLocalSymbol(C, Visited))
+            return false;
+          C->printAsOperand(OS);
         } else {
-          AttrBuilder B(attrs, ArgIndex);
-          // add noalias tag
-          B.addAttribute(Attribute::get(F.getContext(), Attribute::NoAlias));
-          AttributesVec.push_back(
-              AttributeSet::get(F.getContext(), Params.size(), B));
+          return false;
         }
       }
-    }
 
-    // How many arguments were already noalias?
-    // If all of them, the original function is already
-    // restrictified, so we don't need to create a clone
-    if (numPointerArg == already_noalias.size()) {
-      continue;
+      if (const LoadInst *LI = dyn_cast<LoadInst>(&I))
+        OS << " " << LI->isVolatile() << " " << LI->getAlignment() << " "
+           << LI->getOrdering() << " " << LI->getSynchScope();
+      else if (const StoreInst *SI = dyn_cast<StoreInst>(&I))
+        OS << " " << SI->isVolatile() << " " << SI->getAlignment() << " "
+           << SI->getOrdering() << " " << SI->getSynchScope();
+      else if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I))
+        OS << " " << AI->getAlignment() << " " << AI->isUsedWithInAlloca();
+      else if (const CmpInst *CI = dyn_cast<CmpInst>(&I))
+        OS << " " << CI->getPredicate();
+      else if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+        OS << " " << CI->isTailCall() << " " << CI->getCallingConv();
+        writeAttributes(CI->getAttributes(), OS);
+      } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
+        OS << " " << II->getCallingConv();
+        writeAttributes(II->getAttributes(), OS);
+      } else if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(&I)) {
+        for (unsigned Idx : IVI->getIndices())
+          OS << " " << Idx;
+      } else if (const ExtractValueInst *EVI =
+                     dyn_cast<ExtractValueInst>(&I)) {
+        for (unsigned Idx : EVI->getIndices())
+          OS << " " << Idx;
+      } else if (const FenceInst *FI = dyn_cast<FenceInst>(&I))
+        OS << " " << FI->getOrdering() << " " << FI->getSynchScope();
+      else if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(&I))
+        OS << " " << CXI->isVolatile() << " " << CXI->isWeak() << " "
+           << CXI->getSuccessOrdering() << " " << CXI->getFailureOrdering()
+           << " " << CXI->getSynchScope();
+      else if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(&I))
+        OS << " " << RMWI->getOperation() << " " << RMWI->isVolatile() << " "
+           << RMWI->getOrdering() << " " << RMWI->getSynchScope();
+      else if (const LandingPadInst *LPI = dyn_cast<LandingPadInst>(&I))
+        OS << " " << LPI->isCleanup();
+      else if (const PHINode *PN = dyn_cast<PHINode>(&I)) {
+        for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+          OS << " %" << Slots[PN->getIncomingBlock(i)];
+      }
+      OS << "\n";
     }
+  }
 
-    // Function attributes
-    if (PAL.hasAttributes(AttributeSet::FunctionIndex)) {
-      AttributesVec.push_back(
-          AttributeSet::get(FTy->getContext(), PAL.getFnAttributes()));
-    }
+  return true;
+}
+
+std::string
+AliasFunctionCloning::getContentHash(const Function &F,
+                                     const SmallBitVector &NoAliasArgs) const {
+  std::string Contents;
+  raw_string_ostream OS(Contents);
+  if (!writeFunctionContents(F, OS))
+    return "";
+  OS << "noalias";
+  for (unsigned i = 0, e = NoAliasArgs.size(); i != e; ++i)
+    if (NoAliasArgs.test(i))
+      OS << " " << i;
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(Contents);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.substr(0, 16);
+}
+
+Function *AliasFunctionCloning::createClone(Function &F,
+                                            const SmallBitVector &NoAliasArgs,
+                                            const Twine &Name,
+                                            const AliasScopePlan *Plan) {
+  Function::arg_iterator I, E;
+  FunctionType *FTy = F.getFunctionType();
+  SmallVector<Type *, 4> Params;
+  SmallVector<AttributeSet, 4> AttributesVec;
+
+  const AttributeSet &PAL = F.getAttributes();
 
-    // create our function clone
-    Type *RTy = FTy->getReturnType();
-    FunctionType *NFTy = FunctionType::get(RTy, Params, FTy->isVarArg());
+  // promote the requested pointer arguments to noalias
+  unsigned ArgIndex = 1;
 
-    Function *newfunc = Function::Create(NFTy, F.getLinkage(), F.getName());
-    newfunc->copyAttributesFrom(&F);
-    newfunc->setAttributes(AttributeSet::get(F.getContext(), AttributesVec));
+  for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I, ++ArgIndex) {
+    Argument *A = I;
 
-    // "Available externally" are functions whose definition is not
-    // dumped into the object file, but is known to the compiler for
-    // optimizations (e.g. inlining). When we find one of these functions
-    // we change its clone's type to a suitable one, that is, one that
-    // makes the clone get dumped into the object file. Otherwise,
-    // the clone wouldn't exist, leading to undefined reference when
-    // linking.
-    if (F.hasAvailableExternallyLinkage()) {
-      newfunc->setLinkage(GlobalValue::LinkOnceODRLinkage);
+    Params.push_back(A->getType());
+    AttributeSet attrs = PAL.getParamAttributes(ArgIndex);
+
+    AttrBuilder B(attrs, ArgIndex);
+    if (NoAliasArgs.test(A->getArgNo())) {
+      assert(A->getType()->isPointerTy() && "noalias on a non-pointer");
+      // add noalias tag
+      B.addAttribute(Attribute::get(F.getContext(), Attribute::NoAlias));
     }
+    if (B.hasAttributes())
+      AttributesVec.push_back(
+          AttributeSet::get(F.getContext(), Params.size(), B));
+  }
 
-    ValueToValueMapTy VMap;
-    SmallVector<ReturnInst *, 4> Returns;
+  // Function attributes
+  if (PAL.hasAttributes(AttributeSet::FunctionIndex)) {
+    AttributesVec.push_back(
+        AttributeSet::get(FTy->getContext(), PAL.getFnAttributes()));
+  }
 
-    Function::arg_iterator NI = newfunc->arg_begin();
-    for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I, ++NI) {
-      VMap[I] = NI;
-      NI->setName(I->getName());
+  // create our function clone
+  Type *RTy = FTy->getReturnType();
+  FunctionType *NFTy = FunctionType::get(RTy, Params, FTy->isVarArg());
+
+  // Code that may be defined in several modules, like inline functions of
+  // headers, gets clones named after their contents. Identical clones made
+  // in distinct modules then merge when linked, and the clone may already
+  // be here if the module was restrictified before.
+  std::string CloneName = Name.str(), Hash;
+  if (AFCMergeableClones &&
+      (F.hasLocalLinkage() || F.isWeakForLinker() ||
+       F.hasAvailableExternallyLinkage()))
+    Hash = getContentHash(F, NoAliasArgs);
+  if (!Hash.empty()) {
+    CloneName += "." + Hash;
+    Function *Existing = F.getParent()->getFunction(CloneName);
+    if (Existing && !Existing->isDeclaration() &&
+        (F.hasLocalLinkage() ? Existing->hasLocalLinkage()
+                             : Existing->hasLinkOnceODRLinkage()) &&
+        Existing->getFunctionType() == NFTy) {
+      ++NumReusedClones;
+      cloneOrigins[Existing] = &F;
+      return Existing;
     }
+  }
+
+  Function *newfunc = Function::Create(NFTy, F.getLinkage(), F.getName());
+  newfunc->copyAttributesFrom(&F);
+  newfunc->setAttributes(AttributeSet::get(F.getContext(), AttributesVec));
+
+  // "Available externally" are functions whose definition is not
+  // dumped into the object file, but is known to the compiler for
+  // optimizations (e.g. inlining). When we find one of these functions
+  // we change its clone's type to a suitable one, that is, one that
+  // makes the clone get dumped into the object file. Otherwise,
+  // the clone wouldn't exist, leading to undefined reference when
+  // linking.
+  if (F.hasAvailableExternallyLinkage()) {
+    newfunc->setLinkage(GlobalValue::LinkOnceODRLinkage);
+  }
 
-    CloneFunctionInto(newfunc, &F, VMap, false, Returns);
+  ValueToValueMapTy VMap;
+  SmallVector<ReturnInst *, 4> Returns;
 
-    F.getParent()->getFunctionList().insert(&F, newfunc);
-    newfunc->setName(F.getName() + "_noalias");
+  Function::arg_iterator NI = newfunc->arg_begin();
+  for (I = F.arg_begin(), E = F.arg_end(); I != E; ++I, ++NI) {
+    VMap[I] = NI;
+    NI->setName(I->getName());
+  }
+
+  CloneFunctionInto(newfunc, &F, VMap, false, Returns);
 
-    AddAliasScopeMetadata(VMap, DL, AA, &F, newfunc);
+  // Any copy of a content-named clone can stand for the others, and its
+  // address is never taken. This must follow CloneFunctionInto, which copies
+  // F's unnamed_addr. Clones of local functions cannot be shared with other
+  // modules, so they stay local.
+  if (!Hash.empty() && !F.hasLocalLinkage()) {
+    newfunc->setLinkage(GlobalValue::LinkOnceODRLinkage);
+    newfunc->setUnnamedAddr(true);
+  }
 
-    // Insert cloned function into the map of clones
-    const auto &it = this->clonesMap.insert(std::make_pair(&F, newfunc));
-    assert(it.second);
+  F.getParent()->getFunctionList().insert(&F, newfunc);
+  newfunc->setName(CloneName);
 
-    ++NumClonedFuncs;
+  // Plan the metadata now, unless it was done ahead of time.
+  AliasScopePlan LocalPlan;
+  if (!Plan) {
+    SmallPtrSet<const Instruction *, 8> ArgMemOnlyCalls;
+    collectArgMemOnlyCalls(F, ArgMemOnlyCalls);
+    planAliasScopes(F, NoAliasArgs, ArgMemOnlyCalls, LocalPlan);
+    Plan = &LocalPlan;
   }
+  applyAliasScopes(*Plan, VMap, newfunc);
+
+  cloneOrigins[newfunc] = &F;
+  createdClones.insert(newfunc);
+  return newfunc;
+}
+
+Function *AliasFunctionCloning::getPartialClone(Function &F,
+                                                uint64_t DisjointArgs) {
+  auto Key = std::make_pair(&F, DisjointArgs);
+  auto It = partialClonesMap.find(Key);
+  if (It != partialClonesMap.end())
+    return It->second;
+
+  // Only worth a new variant if it tells something F does not already say.
+  SmallBitVector NoAliasArgs(F.arg_size());
+  std::string Name = F.getName().str() + "_noalias";
+  bool AddsNoAlias = false;
+  for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E;
+       ++I) {
+    const Argument *A = I;
+    if (!(DisjointArgs & (UINT64_C(1) << A->getArgNo())))
+      continue;
+    NoAliasArgs.set(A->getArgNo());
+    Name += "." + utostr(A->getArgNo());
+    AddsNoAlias |= !A->hasNoAliasAttr();
+  }
+
+  if (!AddsNoAlias || numPartialClones[&F] >= AFCMaxPartialClones)
+    return nullptr;
+
+  Function *Clone = createClone(F, NoAliasArgs, Name);
+  partialClonesMap[Key] = Clone;
+  pendingClones.push_back(std::make_pair(Clone, visitedCallees.size()));
+  ++numPartialClones[&F];
+
+  ++NumPartialClonedFuncs;
+  return Clone;
 }
 
 // This code is based in Argument Promotion pass
@@ -156,18 +803,165 @@ bool AliasFunctionCloning::runOnModule(Module &M) {
   this->AA = &getAnalysis<AliasAnalysis>();
   this->DL = &getAnalysis<DataLayoutPass>().getDataLayout();
 
+  if (!AFCSampleProfile.empty() && !loadProfile(M.getContext()))
+    return false;
+
+  if (AFCOverlapProfileGen) {
+    instrumentArgOverlaps(M);
+    aliasCache.clear();
+    aliasCacheKeys.clear();
+    profile.reset();
+    return true;
+  }
+
   createNoAliasFunctionClones(M);
   staticRestrictification(M);
+  if (AFCDynamic)
+    dynamicRestrictification(M);
+  removeUnusedClones(M);
+
+  if (!AFCRemarksOutput.empty()) {
+    writeRemarks(AFCRemarksOutput);
+    remarks.clear();
+  }
+
+  // The keys may refer to values of the clones that were just erased.
+  aliasCache.clear();
+  aliasCacheKeys.clear();
+  cloneOrigins.clear();
+  createdClones.clear();
+  profile.reset();
 
   return true;
 }
 
+bool AliasFunctionCloning::isCloningProfitable(Function &F) const {
+  DominatorTree DT;
+  DT.recalculate(F);
+  LoopInfoBase<BasicBlock, Loop> LI;
+  LI.Analyze(DT);
+
+  // Gather the loads and stores made through pointer arguments that are not
+  // noalias yet, along with the argument each one is based on.
+  SmallVector<std::pair<Instruction *, const Argument *>, 16> Accesses;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    Value *Ptr;
+    if (LoadInst *Load = dyn_cast<LoadInst>(&*I))
+      Ptr = Load->getPointerOperand();
+    else if (StoreInst *Store = dyn_cast<StoreInst>(&*I))
+      Ptr = Store->getPointerOperand();
+    else
+      continue;
+
+    const Argument *A = dyn_cast<Argument>(GetUnderlyingObject(Ptr, DL, 0));
+    if (A && !A->hasNoAliasAttr())
+      Accesses.push_back(std::make_pair(&*I, A));
+  }
+
+  // A store and another access through distinct arguments that may alias
+  // is what keeps LICM, GVN and the vectorizer from touching them. Inside a
+  // loop a single such pair is enough to make the clone worth it.
+  unsigned NumQueries = 0, NumBlockedPairs = 0;
+  for (auto &S : Accesses) {
+    StoreInst *SI = dyn_cast<StoreInst>(S.first);
+    if (!SI)
+      continue;
+
+    for (auto &X : Accesses) {
+      if (X.second == S.second)
+        continue;
+
+      // Give up deciding and keep the old behavior for huge functions.
+      if (++NumQueries > AFCProfitabilityMaxQueries)
+        return true;
+
+      AliasAnalysis::Location XLoc =
+          isa<LoadInst>(X.first) ? AA->getLocation(cast<LoadInst>(X.first))
+                                 : AA->getLocation(cast<StoreInst>(X.first));
+      if (AA->alias(AA->getLocation(SI), XLoc) == AliasAnalysis::NoAlias)
+        continue;
+
+      if (LI.getLoopFor(SI->getParent()) ||
+          LI.getLoopFor(X.first->getParent()))
+        return true;
+
+      if (++NumBlockedPairs >= AFCMinBlockedPairs)
+        return true;
+    }
+  }
+
+  return false;
+}
+
+void AliasFunctionCloning::removeUnusedClones(Module &M) {
+  if (AFCCloneAll)
+    return;
+
+  // Clones that were already in the module, and were only reused, may have
+  // callers in other modules.
+  SmallPtrSet<Function *, 16> clones(createdClones.begin(),
+                                     createdClones.end());
+  SmallPtrSet<Function *, 16> removed;
+
+  // Erasing a clone may leave the clones it called without callers, so
+  // repeat until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    for (Module::iterator Mit = M.begin(), Mend = M.end(); Mit != Mend;) {
+      Function *Clone = Mit++;
+      if (!clones.count(Clone))
+        continue;
+
+      // Recursive calls inside the clone itself do not keep it alive.
+      bool HasCallers = false;
+      for (User *U : Clone->users()) {
+        Instruction *I = dyn_cast<Instruction>(U);
+        if (!I || I->getParent()->getParent() != Clone) {
+          HasCallers = true;
+          break;
+        }
+      }
+
+      if (HasCallers)
+        continue;
+
+      Clone->replaceAllUsesWith(UndefValue::get(Clone->getType()));
+      Clone->eraseFromParent();
+      clones.erase(Clone);
+      removed.insert(Clone);
+      changed = true;
+
+      ++NumClonesRemoved;
+    }
+  }
+
+  for (auto It = clonesMap.begin(), E = clonesMap.end(); It != E; ++It)
+    if (removed.count(It->second))
+      clonesMap.erase(It);
+  for (auto It = partialClonesMap.begin(), E = partialClonesMap.end();
+       It != E; ++It)
+    if (removed.count(It->second))
+      partialClonesMap.erase(It);
+}
+
 void AliasFunctionCloning::staticRestrictification(Module &M) {
-  Module::iterator Mit, Mend;
+  CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+
+  // Visit callers before their callees. When the call sites of a function
+  // are analyzed, every clone of its callers, whose bodies hold call sites
+  // with stronger noalias facts, already exists.
+  SmallVector<Function *, 16> order;
+  for (scc_iterator<CallGraph *> SCCI = scc_begin(&CG); !SCCI.isAtEnd();
+       ++SCCI)
+    for (CallGraphNode *N : *SCCI)
+      if (Function *F = N->getFunction())
+        order.push_back(F);
 
   // For every function, get all calls
-  for (Mit = M.begin(), Mend = M.end(); Mit != Mend; ++Mit) {
-    Function *F = Mit;
+  for (auto FI = order.rbegin(), FE = order.rend(); FI != FE; ++FI) {
+    Function *F = *FI;
 
     if (clonesMap.count(F) == false)
       continue;
@@ -191,6 +985,9 @@ void AliasFunctionCloning::staticRestrictification(Module &M) {
       }
     }
 
+    // Calls to F in clones made from now on are not among those collected.
+    visitedCallees.insert(std::make_pair(F, visitedCallees.size()));
+
     // For every call site, try to replace it with the noalias version
     // of the callee.
     // We decide whether the replacement is valid using a static approach,
@@ -200,107 +997,1038 @@ void AliasFunctionCloning::staticRestrictification(Module &M) {
 
     SmallVector<Instruction *, 4>::iterator cit, cend;
     for (cit = callSites.begin(), cend = callSites.end(); cit != cend; ++cit) {
-      Instruction *call = *cit;
-      CallSite CS(call);
+      // Statistics
+      ++numTotalCalls;
 
-      CallInst *cinst = dyn_cast<CallInst>(call);
-      InvokeInst *iinst = dyn_cast<InvokeInst>(call);
+      if (restrictifyCallSite(*cit, F))
+        ++numReplacedCalls;
+    }
 
-      if (cinst) {
-        ++NumCInsts;
-      } else if (iinst) {
-        ++NumIInsts;
+    // Statistics
+    if (numTotalCalls > 0) {
+      if (numReplacedCalls == numTotalCalls) {
+        ++NumFuncsCompletelyReplaced;
       }
+      ++NumPointerFuncsAtLeastOneCall;
+    }
+  }
 
-      // Statistics
-      ++numTotalCalls;
-
-      bool noalias = areArgsNoAlias(CS);
+  // Partial clones created along the way may call functions that were
+  // already visited, so those call sites are handled here, until no new
+  // clone shows up. Calls to functions visited after the clone was made
+  // were among their users, and have been handled already.
+  while (!pendingClones.empty()) {
+    Function *Clone = pendingClones.back().first;
+    unsigned numVisited = pendingClones.back().second;
+    pendingClones.pop_back();
 
-      if (!noalias)
+    SmallVector<Instruction *, 4> callSites;
+    for (inst_iterator I = inst_begin(Clone), E = inst_end(Clone); I != E;
+         ++I) {
+      CallSite CS(&*I);
+      if (!CS || !clonesMap.count(CS.getCalledFunction()))
         continue;
+      auto V = visitedCallees.find(CS.getCalledFunction());
+      if (V != visitedCallees.end() && V->second < numVisited)
+        callSites.push_back(&*I);
+    }
 
-      // Statistics
-      ++numReplacedCalls;
+    for (Instruction *call : callSites)
+      restrictifyCallSite(call, CallSite(call).getCalledFunction());
+  }
+  visitedCallees.clear();
+}
+
+bool AliasFunctionCloning::restrictifyCallSite(Instruction *call,
+                                               Function *F) {
+  CallSite CS(call);
+
+  CallInst *cinst = dyn_cast<CallInst>(call);
+  InvokeInst *iinst = dyn_cast<InvokeInst>(call);
+
+  if (cinst) {
+    ++NumCInsts;
+  } else if (iinst) {
+    ++NumIInsts;
+  }
+
+  // Argument positions are only tracked up to 64 for partial clones.
+  uint64_t disjointArgs = 0;
+  bool canSpecialize = AFCMaxPartialClones > 0 && F->arg_size() <= 64;
+  if (canSpecialize && !isHotCallSite(call)) {
+    ++NumColdCallSites;
+    canSpecialize = false;
+  }
+  bool explain = wantsRemarkDetails(*call->getParent()->getParent());
+  SmallVector<AliasingArgPair, 4> aliasing;
+  bool noalias = areArgsNoAlias(CS, canSpecialize ? &disjointArgs : nullptr,
+                                explain ? &aliasing : nullptr);
+
+  // When only some arguments are disjoint from all the others, fall
+  // back to a clone that is noalias on just those.
+  Function *target = nullptr;
+  if (noalias)
+    target = clonesMap[F];
+  else if (disjointArgs)
+    target = getPartialClone(*F, disjointArgs);
+
+  if (!target) {
+    if (explain)
+      emitCallSiteRemark(call, *F, /*Missed=*/true, "NotRestrictified",
+                         "call to '" + F->getName() + "' not restrictified",
+                         aliasing);
+    if (cinst)
+      failedCallSites[F].insert(call);
+    return false;
+  }
+
+  if (noalias)
+    emitCallSiteRemark(call, *F, /*Missed=*/false, "Restrictified",
+                       "call to '" + F->getName() +
+                           "' replaced by its noalias clone",
+                       aliasing);
+  else if (explain)
+    emitCallSiteRemark(call, *F, /*Missed=*/true, "PartiallyRestrictified",
+                       "call to '" + F->getName() +
+                           "' only partially restrictified",
+                       aliasing);
+
+  SmallVector<Value *, 4> RealArgs;
+
+  for (CallSite::arg_iterator ait = CS.arg_begin(), aend = CS.arg_end();
+       ait != aend; ++ait) {
+    Value *V = *ait;
+    RealArgs.push_back(V);
+  }
 
-      SmallVector<Value *, 4> RealArgs;
+  if (cinst) {
+    CallInst *cloneCinst =
+        CallInst::Create(target, RealArgs, cinst->getName(), cinst);
+    cinst->replaceAllUsesWith(cloneCinst);
+    forgetAliasCacheEntries(cinst);
+    cinst->eraseFromParent();
 
-      for (CallSite::arg_iterator ait = CS.arg_begin(), aend = CS.arg_end();
-           ait != aend; ++ait) {
-        Value *V = *ait;
-        RealArgs.push_back(V);
+    // Statistics
+    if (noalias)
+      ++NumStaticCInsts;
+    else
+      ++NumPartialCInsts;
+  } else if (iinst) {
+    InvokeInst *cloneIinst =
+        InvokeInst::Create(target, iinst->getNormalDest(),
+                           iinst->getUnwindDest(), RealArgs, iinst->getName(),
+                           iinst);
+    iinst->replaceAllUsesWith(cloneIinst);
+    forgetAliasCacheEntries(iinst);
+    iinst->eraseFromParent();
+
+    // Statistics
+    if (noalias)
+      ++NumStaticIInsts;
+    else
+      ++NumPartialIInsts;
+  }
+
+  return noalias;
+}
+
+bool AliasFunctionCloning::wantsRemarkDetails(const Function &Caller) const {
+  if (!AFCRemarksOutput.empty())
+    return true;
+  Twine Empty;
+  return DiagnosticInfoOptimizationRemarkMissed(DEBUG_TYPE, Caller, DebugLoc(),
+                                                Empty)
+      .isEnabled();
+}
+
+namespace {
+// Finds the deepest alias analysis of the chain that gave a definite answer
+// to the queries it observes
+struct DecidingAnalysisObserver : public AAQueryObserver {
+  const AliasAnalysis *Decider;
+
+  DecidingAnalysisObserver() : Decider(nullptr) {}
+
+  void enter(const AliasAnalysis &Impl) override {}
+
+  void leave(const AliasAnalysis &Impl,
+             AliasAnalysis::AliasResult Result) override {
+    // Implementations leave deepest first
+    if (!Decider && Result != AliasAnalysis::MayAlias)
+      Decider = &Impl;
+  }
+};
+}
+
+std::string AliasFunctionCloning::getDecidingAnalysis(const Value *V1,
+                                                      const Value *V2) const {
+  // The batch query of areArgsNoAlias is not chained through
+  // AliasAnalysis::alias, so the pair is asked about again, alone.
+  DecidingAnalysisObserver Observer;
+  Observer.install();
+  AliasAnalysis::AliasResult Res = AA->alias(V1, V2);
+  Observer.uninstall();
+
+  if (Res == AliasAnalysis::MayAlias)
+    return std::string();
+  // A definite answer that was never chained came from the top of the chain
+  return AAQueryObserver::getImplementationName(
+             Observer.Decider ? *Observer.Decider : *AA).str();
+}
+
+static const char *getAliasResultName(AliasAnalysis::AliasResult Res) {
+  switch (Res) {
+  case AliasAnalysis::NoAlias:
+    return "NoAlias";
+  case AliasAnalysis::MayAlias:
+    return "MayAlias";
+  case AliasAnalysis::PartialAlias:
+    return "PartialAlias";
+  case AliasAnalysis::MustAlias:
+    return "MustAlias";
+  }
+  llvm_unreachable("Unknown alias result");
+}
+
+void AliasFunctionCloning::emitCallSiteRemark(
+    Instruction *call, const Function &Callee, bool Missed, StringRef Name,
+    const Twine &Msg, ArrayRef<AliasingArgPair> Aliasing) {
+  CallSite CS(call);
+  const Function &Caller = *call->getParent()->getParent();
+
+  CallSiteRemark R;
+  R.Missed = Missed;
+  R.Name = Name;
+  R.Caller = Caller.getName();
+  R.Callee = Callee.getName();
+  R.Line = R.Column = 0;
+  for (const AliasingArgPair &P : Aliasing) {
+    CallSiteRemark::Pair RP;
+    RP.ArgA = P.ArgA;
+    RP.ArgB = P.ArgB;
+    RP.Result = P.Result;
+    RP.Analysis = getDecidingAnalysis(CS.getArgument(P.ArgA),
+                                      CS.getArgument(P.ArgB));
+    R.Pairs.push_back(RP);
+  }
+
+  // Name the first blocking pair in the message itself
+  std::string Text;
+  raw_string_ostream OS(Text);
+  OS << Msg;
+  if (!R.Pairs.empty()) {
+    const CallSiteRemark::Pair &P = R.Pairs.front();
+    OS << ": arguments " << P.ArgA << " and " << P.ArgB << ' '
+       << (P.Result == AliasAnalysis::MustAlias
+               ? "must alias"
+               : P.Result == AliasAnalysis::PartialAlias ? "partially alias"
+                                                         : "may alias");
+    if (!P.Analysis.empty())
+      OS << " according to " << P.Analysis;
+  }
+  OS.flush();
+
+  Twine Message(Text);
+  LLVMContext &Ctx = Caller.getContext();
+  StringRef File;
+  if (Missed) {
+    DiagnosticInfoOptimizationRemarkMissed DI(DEBUG_TYPE, Caller,
+                                              call->getDebugLoc(), Message);
+    Ctx.diagnose(DI);
+    if (DI.isLocationAvailable())
+      DI.getLocation(&File, &R.Line, &R.Column);
+  } else {
+    DiagnosticInfoOptimizationRemark DI(DEBUG_TYPE, Caller,
+                                        call->getDebugLoc(), Message);
+    Ctx.diagnose(DI);
+    if (DI.isLocationAvailable())
+      DI.getLocation(&File, &R.Line, &R.Column);
+  }
+  R.File = File;
+
+  if (!AFCRemarksOutput.empty())
+    remarks.push_back(R);
+}
+
+void AliasFunctionCloning::writeRemarks(StringRef Path) const {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "error: cannot open '" << Path << "': " << EC.message() << '\n';
+    return;
+  }
+
+  // One remark per line, so that reports of several modules can be
+  // concatenated and filtered with line-based tools
+  OS << "[";
+  for (unsigned i = 0, e = remarks.size(); i != e; ++i) {
+    const CallSiteRemark &R = remarks[i];
+    OS << (i ? ",\n " : "\n ") << "{\"Pass\": \"" DEBUG_TYPE "\", \"Kind\": "
+       << (R.Missed ? "\"Missed\"" : "\"Passed\"") << ", \"Name\": ";
+    writeJSONString(OS, R.Name);
+    OS << ", \"Caller\": ";
+    writeJSONString(OS, R.Caller);
+    OS << ", \"Callee\": ";
+    writeJSONString(OS, R.Callee);
+    OS << ", \"DebugLoc\": ";
+    if (R.File.empty() && !R.Line) {
+      OS << "null";
+    } else {
+      OS << "{\"File\": ";
+      writeJSONString(OS, R.File);
+      OS << ", \"Line\": " << R.Line << ", \"Column\": " << R.Column << "}";
+    }
+    OS << ", \"AliasingArgs\": [";
+    for (unsigned j = 0, je = R.Pairs.size(); j != je; ++j) {
+      const CallSiteRemark::Pair &P = R.Pairs[j];
+      OS << (j ? ", " : "") << "{\"ArgA\": " << P.ArgA << ", \"ArgB\": "
+         << P.ArgB << ", \"Result\": \"" << getAliasResultName(P.Result)
+         << "\", \"Analysis\": ";
+      if (P.Analysis.empty())
+        OS << "null";
+      else
+        writeJSONString(OS, P.Analysis);
+      OS << "}";
+    }
+    OS << "]}";
+  }
+  OS << (remarks.empty() ? "]\n" : "\n]\n");
+}
+
+void AliasFunctionCloning::dynamicRestrictification(Module &M) {
+  Module::iterator Mit, Mend;
+
+  for (Mit = M.begin(), Mend = M.end(); Mit != Mend; ++Mit) {
+    Function *F = Mit;
+
+    auto FIt = failedCallSites.find(F);
+    if (FIt == failedCallSites.end())
+      continue;
+
+    // The extents are SCEVs owned by F's ScalarEvolution, so they are only
+    // valid until the analysis is requested for another function.
+    ScalarEvolution &SE = getAnalysis<ScalarEvolution>(*F);
+    DenseMap<const Argument *, ArgExtent> Extents;
+    if (!computeArgExtents(*F, SE, Extents))
+      continue;
+
+    for (Instruction *call : FIt->second) {
+      if (!isHotCallSite(call)) {
+        ++NumColdCallSites;
+        continue;
       }
+      if (!isWorthGuarding(call, *F)) {
+        ++NumOverlappingCallSites;
+        continue;
+      }
+
+      CallInst *cinst = cast<CallInst>(call);
+      CallSite CS(cinst);
+
+      unsigned NumPairs;
+      Value *NoOverlap = emitOverlapCheck(CS, F, Extents, NumPairs);
+      if (!NoOverlap)
+        continue;
 
-      if (cinst) {
-        CallInst *cloneCinst =
-            CallInst::Create(clonesMap[F], RealArgs, cinst->getName(), cinst);
-        cinst->replaceAllUsesWith(cloneCinst);
-        cinst->eraseFromParent();
-
-        // Statistics
-        ++NumStaticCInsts;
-      } else if (iinst) {
-        InvokeInst *cloneIinst = InvokeInst::Create(
-            clonesMap[F], iinst->getNormalDest(), iinst->getUnwindDest(),
-            RealArgs, iinst->getName(), iinst);
-        iinst->replaceAllUsesWith(cloneIinst);
-        iinst->eraseFromParent();
-
-        // Statistics
-        ++NumStaticIInsts;
+      // Statistics
+      NumDynamicChecks += NumPairs;
+
+      emitCallSiteRemark(cinst, *F, /*Missed=*/false, "OverlapCheck",
+                         "call to '" + F->getName() +
+                             "' guarded by a runtime overlap check",
+                         None);
+
+      TerminatorInst *ThenTerm, *ElseTerm;
+      SplitBlockAndInsertIfThenElse(NoOverlap, cinst, &ThenTerm, &ElseTerm);
+      BasicBlock *Tail = cinst->getParent();
+
+      SmallVector<Value *, 4> RealArgs(CS.arg_begin(), CS.arg_end());
+      CallInst *cloneCinst =
+          CallInst::Create(clonesMap[F], RealArgs, cinst->getName(), ThenTerm);
+      cloneCinst->setCallingConv(cinst->getCallingConv());
+      cloneCinst->setAttributes(cinst->getAttributes());
+      cloneCinst->setDebugLoc(cinst->getDebugLoc());
+
+      cinst->moveBefore(ElseTerm);
+
+      if (!cinst->getType()->isVoidTy()) {
+        PHINode *PN = PHINode::Create(cinst->getType(), 2, cinst->getName(),
+                                      &Tail->front());
+        cinst->replaceAllUsesWith(PN);
+        PN->addIncoming(cloneCinst, cloneCinst->getParent());
+        PN->addIncoming(cinst, cinst->getParent());
       }
+
+      // Statistics
+      ++NumDynamicCInsts;
     }
+  }
+}
 
-    // Statistics
-    if (numTotalCalls > 0) {
-      if (numReplacedCalls == numTotalCalls) {
-        ++NumFuncsCompletelyReplaced;
+bool AliasFunctionCloning::isWorthGuarding(Instruction *call,
+                                           const Function &Callee) {
+  // Set by -arg-overlap-profile-use as !{i64 runs, i64 overlaps}
+  MDNode *MD = call->getMetadata("arg.overlap");
+  if (!MD || MD->getNumOperands() != 2)
+    return true;
+  auto *Runs = mdconst::dyn_extract<ConstantInt>(MD->getOperand(0));
+  auto *Overlaps = mdconst::dyn_extract<ConstantInt>(MD->getOperand(1));
+  if (!Runs || !Overlaps)
+    return true;
+
+  uint64_t R = Runs->getZExtValue(), O = Overlaps->getZExtValue();
+  if (R == 0) {
+    emitCallSiteRemark(call, Callee, /*Missed=*/true, "OverlapCheck",
+                       "call to '" + Callee.getName() +
+                           "' not guarded by a runtime overlap check: it "
+                           "never ran in the argument overlap profile",
+                       None);
+    return false;
+  }
+  if (O * 100 > R * AFCMaxOverlapPercent) {
+    emitCallSiteRemark(call, Callee, /*Missed=*/true, "OverlapCheck",
+                       "call to '" + Callee.getName() +
+                           "' not guarded by a runtime overlap check: its "
+                           "arguments overlapped in " + Twine(O) + " of " +
+                           Twine(R) + " profiled runs",
+                       None);
+    return false;
+  }
+  return true;
+}
+
+void AliasFunctionCloning::instrumentArgOverlaps(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Function *Increment =
+      Intrinsic::getDeclaration(&M, Intrinsic::instrprof_increment);
+
+  // Where the counters of a call live: two per call, in the order of
+  // collectArgOverlapCallSites, the first counting its runs and the second
+  // the runs in which its arguments overlapped
+  struct CallCounters {
+    CallInst *Call;
+    Constant *Name;
+    unsigned NumCalls;
+    unsigned Index;
+  };
+  DenseMap<Function *, SmallVector<CallCounters, 4> > CallsByCallee;
+
+  SmallVector<Function *, 16> Callers;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Callers.push_back(&F);
+
+  for (Function *F : Callers) {
+    SmallVector<CallInst *, 8> Calls;
+    collectArgOverlapCallSites(*F, Calls);
+    if (Calls.empty())
+      continue;
+
+    std::string ProfName = getArgOverlapProfileName(*F);
+    Constant *Init = ConstantDataArray::getString(Ctx, ProfName, false);
+    auto *NameVar =
+        new GlobalVariable(M, Init->getType(), true,
+                           GlobalValue::PrivateLinkage, Init,
+                           "__llvm_profile_name_" + ProfName);
+    Constant *Name = ConstantExpr::getBitCast(NameVar, Int8PtrTy);
+
+    for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+      CallCounters C = {Calls[i], Name, e, 2 * i};
+      CallsByCallee[Calls[i]->getCalledFunction()].push_back(C);
+    }
+  }
+
+  for (Function *Callee : Callers) {
+    auto It = CallsByCallee.find(Callee);
+    if (It == CallsByCallee.end())
+      continue;
+
+    // Calls whose extents cannot be bounded will never get a check, but
+    // still have their runs counted so the profile matches.
+    ScalarEvolution &SE = getAnalysis<ScalarEvolution>(*Callee);
+    DenseMap<const Argument *, ArgExtent> Extents;
+    bool HasExtents = computeArgExtents(*Callee, SE, Extents);
+
+    for (CallCounters &C : It->second) {
+      Value *RunArgs[] = {C.Name, ConstantInt::get(Int64Ty, C.NumCalls),
+                          ConstantInt::get(Int32Ty, 2 * C.NumCalls),
+                          ConstantInt::get(Int32Ty, C.Index)};
+      CallInst::Create(Increment, RunArgs, "", C.Call);
+      ++NumOverlapCounters;
+
+      // The probe is not a check guarding the call, so it is not counted.
+      unsigned NumPairs;
+      Value *NoOverlap =
+          HasExtents
+              ? emitOverlapCheck(CallSite(C.Call), Callee, Extents, NumPairs)
+              : nullptr;
+      if (!NoOverlap)
+        continue;
+
+      IRBuilder<> Builder(C.Call);
+      TerminatorInst *ThenTerm = SplitBlockAndInsertIfThen(
+          Builder.CreateNot(NoOverlap, "afc.overlap"), C.Call, false);
+      Value *OverlapArgs[] = {C.Name, ConstantInt::get(Int64Ty, C.NumCalls),
+                              ConstantInt::get(Int32Ty, 2 * C.NumCalls),
+                              ConstantInt::get(Int32Ty, C.Index + 1)};
+      CallInst::Create(Increment, OverlapArgs, "", ThenTerm);
+    }
+  }
+}
+
+bool AliasFunctionCloning::computeArgExtents(
+    Function &F, ScalarEvolution &SE,
+    DenseMap<const Argument *, ArgExtent> &Extents) const {
+  Type *IntPtrTy = DL->getIntPtrType(F.getContext());
+
+  for (Function::arg_iterator I = F.arg_begin(), E = F.arg_end(); I != E;
+       ++I) {
+    const Argument *A = I;
+    if (!A->getType()->isPointerTy())
+      continue;
+
+    // Once the pointer escapes we cannot see every access made through it.
+    if (PointerMayBeCaptured(A, /* ReturnCaptures */ true,
+                             /* StoreCaptures */ true))
+      return false;
+
+    Extents[A] = ArgExtent();
+  }
+
+  // Returns the tracked argument V is based on, or nullptr if none. Fails
+  // if V may be based on a tracked argument among other objects.
+  auto getBaseArg = [&](Value *V, Argument *&Base) {
+    SmallVector<Value *, 4> Objects;
+    GetUnderlyingObjects(V, Objects, DL, 0);
+    Base = nullptr;
+    for (Value *O : Objects) {
+      Argument *A = dyn_cast<Argument>(O);
+      if (A && Extents.count(A))
+        Base = A;
+    }
+    return !Base || Objects.size() == 1;
+  };
+
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    Instruction *Inst = &*I;
+    Value *Ptr = nullptr;
+    Type *AccessTy = nullptr;
+    bool IsWrite = false;
+    Argument *A;
+
+    if (LoadInst *LI = dyn_cast<LoadInst>(Inst)) {
+      Ptr = LI->getPointerOperand();
+      AccessTy = LI->getType();
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(Inst)) {
+      Ptr = SI->getPointerOperand();
+      AccessTy = SI->getValueOperand()->getType();
+      IsWrite = true;
+    } else if (isa<DbgInfoIntrinsic>(Inst)) {
+      continue;
+    } else if (Inst->mayReadOrWriteMemory()) {
+      // Any other memory access based on an argument (calls, atomics, etc.)
+      // has an extent we cannot describe.
+      for (Use &U : Inst->operands()) {
+        if (!getBaseArg(U.get(), A) || A)
+          return false;
       }
-      ++NumPointerFuncsAtLeastOneCall;
+      continue;
+    } else {
+      continue;
     }
+
+    if (!getBaseArg(Ptr, A))
+      return false;
+    if (!A)
+      continue;
+
+    const SCEV *Offset = SE.getMinusSCEV(SE.getSCEV(Ptr), SE.getSCEV(A));
+    const SCEV *Lo, *Hi;
+    if (Offset->getType()->isPointerTy() ||
+        !getOffsetRange(Offset, Inst, SE, DL, Lo, Hi))
+      return false;
+
+    Lo = SE.getTruncateOrSignExtend(Lo, IntPtrTy);
+    Hi = SE.getAddExpr(SE.getTruncateOrSignExtend(Hi, IntPtrTy),
+                       SE.getConstant(IntPtrTy,
+                                      DL->getTypeStoreSize(AccessTy)));
+
+    ArgExtent &Ext = Extents[A];
+    Ext.Lo = Ext.Lo ? SE.getSMinExpr(Ext.Lo, Lo) : Lo;
+    Ext.Hi = Ext.Hi ? SE.getSMaxExpr(Ext.Hi, Hi) : Hi;
+    Ext.IsWritten |= IsWrite;
   }
+
+  return true;
 }
 
-bool AliasFunctionCloning::areArgsNoAlias(const CallSite &CS) const {
+Value *AliasFunctionCloning::emitOverlapCheck(
+    CallSite CS, Function *F,
+    DenseMap<const Argument *, ArgExtent> &Extents, unsigned &NumPairs) const {
+  SmallVector<const Argument *, 4> Args;
+  for (Function::arg_iterator I = F->arg_begin(), E = F->arg_end(); I != E;
+       ++I) {
+    const Argument *A = I;
+    // Arguments that are never dereferenced cannot take part in a conflict.
+    if (Extents.count(A) && Extents[A].Lo)
+      Args.push_back(A);
+  }
+
+  // Pick the pairs that actually need a check: the ones alias analysis
+  // cannot disprove and through which at least one side writes.
+  SmallVector<std::pair<const Argument *, const Argument *>, 4> Pairs;
+  for (unsigned i = 0, e = Args.size(); i < e; ++i) {
+    for (unsigned j = i + 1; j < e; ++j) {
+      const Argument *A = Args[i], *B = Args[j];
+      if (!Extents[A].IsWritten && !Extents[B].IsWritten)
+        continue;
+      if (cachedAlias(CS.getArgument(A->getArgNo()),
+                      CS.getArgument(B->getArgNo())) == AliasAnalysis::NoAlias)
+        continue;
+      Pairs.push_back(std::make_pair(A, B));
+    }
+  }
+
+  if (Pairs.empty() || Pairs.size() > AFCDynamicMaxChecks)
+    return nullptr;
+
+  // Materialize the bounds of every argument involved. If one of them
+  // depends on something other than the callee's arguments, give up before
+  // anything is inserted.
+  SmallPtrSet<const Argument *, 8> Involved;
+  for (auto &P : Pairs) {
+    Involved.insert(P.first);
+    Involved.insert(P.second);
+  }
+
+  for (const Argument *A : Involved) {
+    if (!isExpandableAtCallSite(Extents[A].Lo) ||
+        !isExpandableAtCallSite(Extents[A].Hi))
+      return nullptr;
+  }
+
+  Instruction *InsertPt = CS.getInstruction();
+  IRBuilder<> Builder(InsertPt);
+  Type *IntPtrTy = DL->getIntPtrType(InsertPt->getContext());
+  CallSiteSCEVEmitter Emitter(CS, Builder, IntPtrTy);
+
+  DenseMap<const Argument *, std::pair<Value *, Value *> > Bounds;
+  for (const Argument *A : Involved) {
+    Value *Base =
+        Builder.CreatePtrToInt(CS.getArgument(A->getArgNo()), IntPtrTy);
+    Value *Lo = Emitter.visit(Extents[A].Lo);
+    Value *Hi = Emitter.visit(Extents[A].Hi);
+    assert(Lo && Hi && "Extent was checked to be expandable");
+    Bounds[A] = std::make_pair(Builder.CreateAdd(Base, Lo, "afc.lo"),
+                               Builder.CreateAdd(Base, Hi, "afc.hi"));
+  }
+
+  Value *NoOverlap = nullptr;
+  for (auto &P : Pairs) {
+    std::pair<Value *, Value *> &BA = Bounds[P.first];
+    std::pair<Value *, Value *> &BB = Bounds[P.second];
+    Value *Disjoint =
+        Builder.CreateOr(Builder.CreateICmpULE(BA.second, BB.first),
+                         Builder.CreateICmpULE(BB.second, BA.first),
+                         "afc.disjoint");
+    NoOverlap = NoOverlap ? Builder.CreateAnd(NoOverlap, Disjoint) : Disjoint;
+  }
+
+  NumPairs = Pairs.size();
+  return NoOverlap;
+}
+
+bool AliasFunctionCloning::loadProfile(LLVMContext &Ctx) {
+  auto ReaderOrErr = sampleprof::SampleProfileReader::create(AFCSampleProfile,
+                                                             Ctx);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    std::string Msg = "Could not open profile: " + EC.message();
+    Ctx.diagnose(DiagnosticInfoSampleProfile(AFCSampleProfile.data(), Msg));
+    return false;
+  }
+  profile = std::move(ReaderOrErr.get());
+  if (profile->read() != sampleprof_error::success) {
+    profile.reset();
+    return false;
+  }
+
+  // Hotness is relative to the hottest function and call site, so that it
+  // does not depend on the sampling period
+  unsigned maxFunctionSamples = 0, maxCallSiteSamples = 0;
+  for (const auto &P : profile->getProfiles()) {
+    const sampleprof::FunctionSamples &FS = P.getValue();
+    maxFunctionSamples = std::max(maxFunctionSamples, FS.getTotalSamples());
+    for (const auto &B : FS.getBodySamples())
+      maxCallSiteSamples =
+          std::max(maxCallSiteSamples, B.second.getSamples());
+  }
+  hotFunctionSamples = std::max<uint64_t>(
+      1, (uint64_t)maxFunctionSamples * AFCHotPercent / 100);
+  hotCallSiteSamples = std::max<uint64_t>(
+      1, (uint64_t)maxCallSiteSamples * AFCHotPercent / 100);
+  return true;
+}
+
+sampleprof::FunctionSamples *
+AliasFunctionCloning::getSamples(const Function &F) const {
+  const Function *Origin = cloneOrigins.lookup(&F);
+  return profile->getSamplesFor(Origin ? *Origin : F);
+}
+
+bool AliasFunctionCloning::isHotFunction(const Function &F) const {
+  if (!profile)
+    return true;
+  // Functions the profile never saw running are cold
+  sampleprof::FunctionSamples *FS = getSamples(F);
+  return FS && FS->getTotalSamples() >= hotFunctionSamples;
+}
+
+bool AliasFunctionCloning::isHotCallSite(const Instruction *call) const {
+  if (!profile)
+    return true;
+
+  // Samples are keyed by their line offset from the start of the function,
+  // like in the SampleProfile pass
+  const Function *Caller = call->getParent()->getParent();
+  sampleprof::FunctionSamples *FS = getSamples(*Caller);
+  DISubprogram S = getDISubprogram(Caller);
+  DebugLoc DLoc = call->getDebugLoc();
+  if (!FS || !S.isSubprogram() || DLoc.isUnknown() ||
+      DLoc.getLine() < S.getLineNumber())
+    return false;
+
+  DILocation DIL(DLoc.getAsMDNode(Caller->getContext()));
+  sampleprof::LineLocation Loc(DLoc.getLine() - S.getLineNumber(),
+                               DIL.getDiscriminator());
+  auto It = FS->getBodySamples().find(Loc);
+  return It != FS->getBodySamples().end() &&
+         It->second.getSamples() >= hotCallSiteSamples;
+}
+
+bool AliasFunctionCloning::getAliasCacheKey(const Value *V1, uint64_t V1Size,
+                                            const Value *V2, uint64_t V2Size,
+                                            AliasCacheKey &Key) const {
+  // Only sides resolving to a single object can be keyed. Values based on
+  // the same object are never NoAlias, so there is nothing to share there.
+  SmallVector<Value *, 4> Objects1, Objects2;
+  GetUnderlyingObjects(const_cast<Value *>(V1), Objects1, DL, 0);
+  GetUnderlyingObjects(const_cast<Value *>(V2), Objects2, DL, 0);
+  if (Objects1.size() != 1 || Objects2.size() != 1 ||
+      Objects1[0] == Objects2[0])
+    return false;
+
+  // The query is symmetric, so order the key to share both directions.
+  AliasCacheLoc L1(Objects1[0], V1Size), L2(Objects2[0], V2Size);
+  if (L2 < L1)
+    std::swap(L1, L2);
+  Key = std::make_pair(L1, L2);
+  return true;
+}
+
+bool AliasFunctionCloning::addAliasCacheEntry(
+    const AliasCacheKey &Key, AliasAnalysis::AliasResult Res) const {
+  if (!aliasCache.insert(std::make_pair(Key, Res)).second)
+    return false;
+  aliasCacheKeys[Key.first.first].push_back(Key);
+  aliasCacheKeys[Key.second.first].push_back(Key);
+  return true;
+}
+
+void AliasFunctionCloning::forgetAliasCacheEntries(const Value *V) {
+  auto It = aliasCacheKeys.find(V);
+  if (It == aliasCacheKeys.end())
+    return;
+
+  // The keys stay listed under the other object of each pair, where erasing
+  // them again later does nothing.
+  for (const AliasCacheKey &Key : It->second)
+    aliasCache.erase(Key);
+  aliasCacheKeys.erase(It);
+}
+
+AliasAnalysis::AliasResult
+AliasFunctionCloning::cachedAlias(const Value *V1, const Value *V2,
+                                  uint64_t V1Size, uint64_t V2Size) const {
+  AliasCacheKey Key;
+  if (!getAliasCacheKey(V1, V1Size, V2, V2Size, Key))
+    return AA->alias(V1, V1Size, V2, V2Size);
+
+  auto It = aliasCache.find(Key);
+  if (It != aliasCache.end()) {
+    ++NumAliasCacheHits;
+    return It->second;
+  }
+
+  ++NumAliasCacheMisses;
+  AliasAnalysis::AliasResult Res = AA->alias(V1, V1Size, V2, V2Size);
+  addAliasCacheEntry(Key, Res);
+  return Res;
+}
+
+bool AliasFunctionCloning::areArgsNoAlias(
+    const CallSite &CS, uint64_t *DisjointArgs,
+    SmallVectorImpl<AliasingArgPair> *Aliasing) const {
   SmallVector<Value *, 4> argsVector;
+  SmallVector<unsigned, 4> argNos;
 
   for (CallSite::arg_iterator ait = CS.arg_begin(), aend = CS.arg_end();
        ait != aend; ++ait) {
     Value *V = *ait;
     if (V->getType()->isPointerTy()) {
       argsVector.push_back(V);
+      argNos.push_back(ait - CS.arg_begin());
     }
   }
 
+  // Without DisjointArgs we can stop at the first aliasing pair. Otherwise
+  // every pair is needed to find the arguments that alias no other one.
   int i, j, n = argsVector.size();
-  for (i = 0; i < (n - 1); ++i) {
-    for (j = i + 1; j < n; ++j) {
-      AliasAnalysis::AliasResult res = AA->alias(argsVector[i], argsVector[j]);
-      switch (res) {
-      case AliasAnalysis::NoAlias:
-        break;
-      default:
-        return false;
+  SmallVector<AliasAnalysis::Location, 4> locs;
+  for (i = 0; i < n; ++i)
+    locs.push_back(AliasAnalysis::Location(argsVector[i]));
+  AliasAnalysis::AliasMatrix matrix(n, /*StopAtAlias=*/!DisjointArgs);
+
+  // Seed the batch with what other call sites found out about the same
+  // objects, and let AA settle the remaining pairs all at once.
+  SmallVector<std::pair<AliasCacheKey, bool>, 8> keys;
+  for (i = 1; i < n; ++i) {
+    for (j = 0; j < i; ++j) {
+      AliasCacheKey key;
+      bool hasKey = getAliasCacheKey(argsVector[i], AliasAnalysis::UnknownSize,
+                                     argsVector[j], AliasAnalysis::UnknownSize,
+                                     key);
+      keys.push_back(std::make_pair(key, hasKey));
+      if (!hasKey)
+        continue;
+      auto it = aliasCache.find(key);
+      if (it != aliasCache.end()) {
+        ++NumAliasCacheHits;
+        matrix.set(i, j, it->second);
+      }
+    }
+  }
+  AA->aliasBatch(locs, matrix);
+
+  // Pairs left unknown when the batch stopped early are may-alias.
+  SmallBitVector aliased(n);
+  unsigned k = 0;
+  for (i = 1; i < n; ++i) {
+    for (j = 0; j < i; ++j, ++k) {
+      if (keys[k].second && matrix.isKnown(i, j) &&
+          addAliasCacheEntry(keys[k].first, matrix.get(i, j)))
+        ++NumAliasCacheMisses;
+      if (matrix.get(i, j) != AliasAnalysis::NoAlias) {
+        aliased.set(i);
+        aliased.set(j);
+        if (Aliasing && matrix.isKnown(i, j)) {
+          AliasingArgPair pair = {argNos[j], argNos[i], matrix.get(i, j)};
+          Aliasing->push_back(pair);
+        }
       }
     }
   }
 
-  return true;
+  if (DisjointArgs) {
+    *DisjointArgs = 0;
+    for (i = 0; i < n; ++i)
+      if (!aliased.test(i))
+        *DisjointArgs |= UINT64_C(1) << argNos[i];
+  }
+
+  return aliased.none();
 }
 
-/// Taken almost entirely from Transforms/Utils/InlineFunction.cpp
-void AliasFunctionCloning::AddAliasScopeMetadata(ValueToValueMapTy &VMap,
-                                                 const DataLayout *DL,
-                                                 AliasAnalysis *AA,
-                                                 const Function *F,
-                                                 Function *NF) {
-  const Function *CalledFunc = NF;
-  SmallVector<const Argument *, 4> FunArgs;
+// Collects the objects V may be based on, looking through the same
+// instructions as GetUnderlyingObjects. Unlike it, this never calls into
+// InstructionSimplify, which may create constants, so it is safe to run
+// concurrently on functions of the same LLVMContext.
+static void collectUnderlyingObjects(const Value *V,
+                                     SmallVectorImpl<const Value *> &Objects) {
+  SmallPtrSet<const Value *, 4> Visited;
+  SmallVector<const Value *, 4> Worklist;
+  Worklist.push_back(V);
+  do {
+    const Value *P = Worklist.pop_back_val();
+    if (!Visited.insert(P).second)
+      continue;
+
+    if (!P->getType()->isPointerTy()) {
+      Objects.push_back(P);
+    } else if (const GEPOperator *GEP = dyn_cast<GEPOperator>(P)) {
+      Worklist.push_back(GEP->getPointerOperand());
+    } else if (Operator::getOpcode(P) == Instruction::BitCast ||
+               Operator::getOpcode(P) == Instruction::AddrSpaceCast) {
+      Worklist.push_back(cast<Operator>(P)->getOperand(0));
+    } else if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(P)) {
+      if (GA->mayBeOverridden())
+        Objects.push_back(P);
+      else
+        Worklist.push_back(GA->getAliasee());
+    } else if (const SelectInst *SI = dyn_cast<SelectInst>(P)) {
+      Worklist.push_back(SI->getTrueValue());
+      Worklist.push_back(SI->getFalseValue());
+    } else if (const PHINode *PN = dyn_cast<PHINode>(P)) {
+      for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+        Worklist.push_back(PN->getIncomingValue(i));
+    } else {
+      Objects.push_back(P);
+    }
+  } while (!Worklist.empty());
+}
+
+namespace {
+// Records every instruction through which a pointer may be captured, instead
+// of stopping at the first one like the trackers of CaptureTracking.cpp
+struct CapturePointCollector : public CaptureTracker {
+  SmallVector<const Instruction *, 4> Points;
+  bool TooManyUses;
+
+  CapturePointCollector() : TooManyUses(false) {}
+
+  void tooManyUses() override { TooManyUses = true; }
+
+  bool captured(const Use *U) override {
+    // Returning the pointer does not make it visible to the callee's body
+    if (isa<ReturnInst>(U->getUser()))
+      return false;
+    Points.push_back(cast<Instruction>(U->getUser()));
+    return false;
+  }
+};
+
+// Answers "may A be captured before I" for the noalias arguments of a
+// function without walking A's uses once per query. The capture points of an
+// argument are collected the first time it is asked about, together with
+// the region they reach: the blocks that may be entered after a capture has
+// executed. A is captured before I iff I's block is in that region or a
+// capture point precedes I in its own block. Captures in unreachable blocks
+// are ignored, as PointerMayBeCapturedBefore does.
+class ArgCaptureSummary {
+  struct ArgInfo {
+    bool Computed;
+    bool AlwaysCaptured;
+    // Blocks that may be entered after a capture, by block number
+    BitVector Region;
+    // Position of the earliest capture point of each block that has one
+    DenseMap<const BasicBlock *, unsigned> FirstCapture;
+
+    ArgInfo() : Computed(false), AlwaysCaptured(false) {}
+  };
+
+  DenseMap<const BasicBlock *, unsigned> BlockNums;
+  DenseMap<const Instruction *, unsigned> InstNums;
+  BitVector Reachable;
+  SmallVector<ArgInfo, 4> Infos;
+  ArrayRef<const Argument *> Args;
+
+  void compute(unsigned i) {
+    ArgInfo &AI = Infos[i];
+    AI.Computed = true;
+
+    CapturePointCollector CPC;
+    PointerMayBeCaptured(Args[i], &CPC);
+    if (CPC.TooManyUses) {
+      AI.AlwaysCaptured = true;
+      return;
+    }
+
+    AI.Region.resize(BlockNums.size());
+    SmallVector<const BasicBlock *, 8> Worklist;
+    for (const Instruction *C : CPC.Points) {
+      const BasicBlock *BB = C->getParent();
+      if (!Reachable.test(BlockNums[BB]))
+        continue;
+
+      unsigned Pos = InstNums[C];
+      auto Ins = AI.FirstCapture.insert(std::make_pair(BB, Pos));
+      if (!Ins.second) {
+        Ins.first->second = std::min(Ins.first->second, Pos);
+        continue;
+      }
+      Worklist.append(succ_begin(BB), succ_end(BB));
+    }
+
+    while (!Worklist.empty()) {
+      const BasicBlock *BB = Worklist.pop_back_val();
+      unsigned N = BlockNums[BB];
+      if (AI.Region.test(N))
+        continue;
+      AI.Region.set(N);
+      Worklist.append(succ_begin(BB), succ_end(BB));
+    }
+  }
 
-  for (Function::const_arg_iterator I = CalledFunc->arg_begin(),
-                                    E = CalledFunc->arg_end();
+public:
+  ArgCaptureSummary(const Function &F, ArrayRef<const Argument *> Args)
+      : Infos(Args.size()), Args(Args) {
+    unsigned NumBlocks = 0;
+    for (const BasicBlock &BB : F) {
+      BlockNums[&BB] = NumBlocks++;
+      unsigned Pos = 0;
+      for (const Instruction &I : BB)
+        InstNums[&I] = Pos++;
+    }
+
+    Reachable.resize(NumBlocks);
+    for (const BasicBlock *BB : depth_first(&F.getEntryBlock()))
+      Reachable.set(BlockNums[BB]);
+  }
+
+  // Whether Args[i] may be captured before I. Unlike
+  // PointerMayBeCapturedBefore, a capture only counts when it can reach I,
+  // which includes I itself capturing Args[i] inside a cycle
+  bool capturedBefore(unsigned i, const Instruction *I) {
+    if (!Infos[i].Computed)
+      compute(i);
+
+    const ArgInfo &AI = Infos[i];
+    if (AI.AlwaysCaptured)
+      return true;
+
+    const BasicBlock *BB = I->getParent();
+    if (AI.Region.test(BlockNums.lookup(BB)))
+      return true;
+
+    auto It = AI.FirstCapture.find(BB);
+    return It != AI.FirstCapture.end() && It->second < InstNums.lookup(I);
+  }
+};
+}
+
+void AliasFunctionCloning::collectArgMemOnlyCalls(
+    const Function &F, SmallPtrSetImpl<const Instruction *> &Calls) const {
+  if (!AA)
+    return;
+
+  for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    ImmutableCallSite ICS(&*I);
+    if (!ICS)
+      continue;
+
+    AliasAnalysis::ModRefBehavior MRB = AA->getModRefBehavior(ICS);
+    if (MRB == AliasAnalysis::OnlyAccessesArgumentPointees ||
+        MRB == AliasAnalysis::OnlyReadsArgumentPointees)
+      Calls.insert(&*I);
+  }
+}
+
+/// Taken almost entirely from Transforms/Utils/InlineFunction.cpp
+void AliasFunctionCloning::planAliasScopes(
+    const Function &F, const SmallBitVector &NoAliasArgs,
+    const SmallPtrSetImpl<const Instruction *> &ArgMemOnlyCalls,
+    AliasScopePlan &Plan) {
+  SmallVector<const Argument *, 4> &FunArgs = Plan.ScopedArgs;
+  SmallPtrSet<const Argument *, 4> NoAliasArgSet;
+
+  for (Function::const_arg_iterator I = F.arg_begin(), E = F.arg_end();
        I != E; ++I) {
-    if (!I->hasNUses(0) && I->getType()->isPointerTy())
+    if (!NoAliasArgs.test(I->getArgNo()) && !I->hasNoAliasAttr())
+      continue;
+    NoAliasArgSet.insert(I);
+    if (!I->hasNUses(0))
       FunArgs.push_back(I);
   }
 
@@ -308,9 +2036,9 @@ void AliasFunctionCloning::AddAliasScopeMetadata(ValueToValueMapTy &VMap,
     return;
 
   // To do a good job, if a noalias variable is captured, we need to know if
-  // the capture point dominates the particular use we're considering.
-  DominatorTree DT;
-  DT.recalculate(const_cast<Function &>(*CalledFunc));
+  // the capture point may execute before the particular use we're
+  // considering. The capture points are summarized once per argument.
+  ArgCaptureSummary Captures(F, FunArgs);
 
   // noalias indicates that pointer values based on the argument do not alias
   // pointer values which are not based on it. So we add a new "scope" for each
@@ -318,7 +2046,169 @@ void AliasFunctionCloning::AddAliasScopeMetadata(ValueToValueMapTy &VMap,
   // become part of that alias scope, accesses using pointers not based on that
   // argument are tagged as noalias with that scope.
 
-  DenseMap<const Argument *, MDNode *> NewScopes;
+  // Iterate over all instructions of the function; for all memory-access
+  // instructions, decide on the alias scope metadata.
+  for (const_inst_iterator II = inst_begin(F), IE = inst_end(F); II != IE;
+       ++II) {
+    const Instruction *I = &*II;
+
+    bool IsArgMemOnlyCall = false, IsFuncCall = false;
+    SmallVector<const Value *, 2> PtrArgs;
+
+    if (const LoadInst *LI = dyn_cast<LoadInst>(I))
+      PtrArgs.push_back(LI->getPointerOperand());
+    else if (const StoreInst *SI = dyn_cast<StoreInst>(I))
+      PtrArgs.push_back(SI->getPointerOperand());
+    else if (const VAArgInst *VAAI = dyn_cast<VAArgInst>(I))
+      PtrArgs.push_back(VAAI->getPointerOperand());
+    else if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(I))
+      PtrArgs.push_back(CXI->getPointerOperand());
+    else if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(I))
+      PtrArgs.push_back(RMWI->getPointerOperand());
+    else if (ImmutableCallSite ICS = ImmutableCallSite(I)) {
+      // If we know that the call does not access memory, then we'll still
+      // know that about the inlined clone of this call site, and we don't
+      // need to add metadata.
+      if (ICS.doesNotAccessMemory())
+        continue;
+
+      IsFuncCall = true;
+      IsArgMemOnlyCall = ArgMemOnlyCalls.count(I);
+
+      for (ImmutableCallSite::arg_iterator AI = ICS.arg_begin(),
+                                           AE = ICS.arg_end();
+           AI != AE; ++AI) {
+        // We need to check the underlying objects of all arguments, not just
+        // the pointer arguments, because we might be passing pointers as
+        // integers, etc.
+        // However, if we know that the call only accesses pointer arguments,
+        // then we only need to check the pointer arguments.
+        if (IsArgMemOnlyCall && !(*AI)->getType()->isPointerTy())
+          continue;
+
+        PtrArgs.push_back(*AI);
+      }
+    }
+
+    // If we found no pointers, then this instruction is not suitable for
+    // pairing with an instruction to receive aliasing metadata.
+    // However, if this is a call, this we might just alias with none of the
+    // noalias arguments.
+    if (PtrArgs.empty() && !IsFuncCall)
+      continue;
+
+    // It is possible that there is only one underlying object, but you
+    // need to go through several PHIs to see it, and thus could be
+    // repeated in the Objects list.
+    SmallPtrSet<const Value *, 4> ObjSet;
+
+    for (unsigned i = 0, ie = PtrArgs.size(); i != ie; ++i) {
+      SmallVector<const Value *, 4> Objects;
+      collectUnderlyingObjects(PtrArgs[i], Objects);
+
+      for (const Value *O : Objects)
+        ObjSet.insert(O);
+    }
+
+    // Figure out if we're derived from anything that is not a noalias
+    // argument.
+    bool CanDeriveViaCapture = false, UsesAliasingPtr = false;
+    for (const Value *V : ObjSet) {
+      // Is this value a constant that cannot be derived from any pointer
+      // value (we need to exclude constant expressions, for example, that
+      // are formed from arithmetic on global symbols).
+      bool IsNonPtrConst = isa<ConstantInt>(V) || isa<ConstantFP>(V) ||
+                           isa<ConstantPointerNull>(V) ||
+                           isa<ConstantDataVector>(V) || isa<UndefValue>(V);
+      if (IsNonPtrConst)
+        continue;
+
+      // If this is anything other than a noalias argument, then we cannot
+      // completely describe the aliasing properties using alias.scope
+      // metadata (and, thus, won't add any).
+      if (const Argument *A = dyn_cast<Argument>(V)) {
+        if (!NoAliasArgSet.count(A))
+          UsesAliasingPtr = true;
+      } else {
+        UsesAliasingPtr = true;
+      }
+
+      // If this is not some identified function-local object (which cannot
+      // directly alias a noalias argument), or some other argument (which,
+      // by definition, also cannot alias a noalias argument), then we could
+      // alias a noalias argument that has been captured).
+      if (!isa<Argument>(V) &&
+          !isIdentifiedFunctionLocal(const_cast<Value *>(V)))
+        CanDeriveViaCapture = true;
+    }
+
+    // A function call can always get captured noalias pointers (via other
+    // parameters, globals, etc.).
+    if (IsFuncCall && !IsArgMemOnlyCall)
+      CanDeriveViaCapture = true;
+
+    AliasScopePlan::Access Acc;
+    Acc.I = I;
+    Acc.NoAliases.resize(FunArgs.size());
+    Acc.Scopes.resize(FunArgs.size());
+
+    // First, we want to figure out all of the sets with which we definitely
+    // don't alias. Iterate over all noalias set, and add those for which:
+    //   1. The noalias argument is not in the set of objects from which we
+    //      definitely derive.
+    //   2. The noalias argument has not yet been captured.
+    // An arbitrary function that might load pointers could see captured
+    // noalias arguments via other noalias arguments or globals, and so we
+    // must always check for prior capture.
+    for (unsigned i = 0, e = FunArgs.size(); i != e; ++i) {
+      const Argument *A = FunArgs[i];
+      if (!ObjSet.count(A) &&
+          (!CanDeriveViaCapture ||
+           // It might be tempting to skip the
+           // PointerMayBeCapturedBefore check if
+           // A->hasNoCaptureAttr() is true, but this is
+           // incorrect because nocapture only guarantees
+           // that no copies outlive the function, not
+           // that the value cannot be locally captured.
+           !Captures.capturedBefore(i, I)))
+        Acc.NoAliases.set(i);
+    }
+
+    // Next, we want to figure out all of the sets to which we might belong.
+    // We might belong to a set if the noalias argument is in the set of
+    // underlying objects. If there is some non-noalias argument in our list
+    // of underlying objects, then we cannot add a scope because the fact
+    // that some access does not alias with any set of our noalias arguments
+    // cannot itself guarantee that it does not alias with this access
+    // (because there is some pointer of unknown origin involved and the
+    // other access might also depend on this pointer). We also cannot add
+    // scopes to arbitrary functions unless we know they don't access any
+    // non-parameter pointer-values.
+    bool CanAddScopes = !UsesAliasingPtr;
+    if (CanAddScopes && IsFuncCall)
+      CanAddScopes = IsArgMemOnlyCall;
+
+    if (CanAddScopes)
+      for (unsigned i = 0, e = FunArgs.size(); i != e; ++i) {
+        if (ObjSet.count(FunArgs[i]))
+          Acc.Scopes.set(i);
+      }
+
+    if (Acc.NoAliases.any() || Acc.Scopes.any())
+      Plan.Accesses.push_back(Acc);
+  }
+}
+
+void AliasFunctionCloning::applyAliasScopes(const AliasScopePlan &Plan,
+                                            ValueToValueMapTy &VMap,
+                                            Function *NF) {
+  const Function *CalledFunc = NF;
+  const SmallVectorImpl<const Argument *> &FunArgs = Plan.ScopedArgs;
+
+  if (FunArgs.empty())
+    return;
+
+  SmallVector<MDNode *, 4> NewScopes;
   MDBuilder MDB(CalledFunc->getContext());
 
   // Create a new scope domain for this function.
@@ -339,181 +2229,35 @@ void AliasFunctionCloning::AddAliasScopeMetadata(ValueToValueMapTy &VMap,
     // Note: We always create a new anonymous root here. This is true regardless
     // of the linkage of the callee because the aliasing "scope" is not just a
     // property of the callee, but also all control dependencies in the caller.
-    MDNode *NewScope = MDB.createAnonymousAliasScope(NewDomain, Name);
-    NewScopes.insert(std::make_pair(A, NewScope));
+    NewScopes.push_back(MDB.createAnonymousAliasScope(NewDomain, Name));
   }
 
-  // Iterate over all new instructions in the map; for all memory-access
-  // instructions, add the alias scope metadata.
-  for (ValueToValueMapTy::iterator VMI = VMap.begin(), VMIE = VMap.end();
-       VMI != VMIE; ++VMI) {
-    if (const Instruction *I = dyn_cast<Instruction>(VMI->first)) {
-      if (!VMI->second)
-        continue;
-
-      Instruction *NI = dyn_cast<Instruction>(VMI->second);
-      if (!NI)
-        continue;
-
-      bool IsArgMemOnlyCall = false, IsFuncCall = false;
-      SmallVector<const Value *, 2> PtrArgs;
-
-      if (const LoadInst *LI = dyn_cast<LoadInst>(I))
-        PtrArgs.push_back(LI->getPointerOperand());
-      else if (const StoreInst *SI = dyn_cast<StoreInst>(I))
-        PtrArgs.push_back(SI->getPointerOperand());
-      else if (const VAArgInst *VAAI = dyn_cast<VAArgInst>(I))
-        PtrArgs.push_back(VAAI->getPointerOperand());
-      else if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(I))
-        PtrArgs.push_back(CXI->getPointerOperand());
-      else if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(I))
-        PtrArgs.push_back(RMWI->getPointerOperand());
-      else if (ImmutableCallSite ICS = ImmutableCallSite(I)) {
-        // If we know that the call does not access memory, then we'll still
-        // know that about the inlined clone of this call site, and we don't
-        // need to add metadata.
-        if (ICS.doesNotAccessMemory())
-          continue;
-
-        IsFuncCall = true;
-        if (AA) {
-          AliasAnalysis::ModRefBehavior MRB = AA->getModRefBehavior(ICS);
-          if (MRB == AliasAnalysis::OnlyAccessesArgumentPointees ||
-              MRB == AliasAnalysis::OnlyReadsArgumentPointees)
-            IsArgMemOnlyCall = true;
-        }
-
-        for (ImmutableCallSite::arg_iterator AI = ICS.arg_begin(),
-                                             AE = ICS.arg_end();
-             AI != AE; ++AI) {
-          // We need to check the underlying objects of all arguments, not just
-          // the pointer arguments, because we might be passing pointers as
-          // integers, etc.
-          // However, if we know that the call only accesses pointer arguments,
-          // then we only need to check the pointer arguments.
-          if (IsArgMemOnlyCall && !(*AI)->getType()->isPointerTy())
-            continue;
-
-          PtrArgs.push_back(*AI);
-        }
-      }
-
-      // If we found no pointers, then this instruction is not suitable for
-      // pairing with an instruction to receive aliasing metadata.
-      // However, if this is a call, this we might just alias with none of the
-      // noalias arguments.
-      if (PtrArgs.empty() && !IsFuncCall)
-        continue;
-
-      // It is possible that there is only one underlying object, but you
-      // need to go through several PHIs to see it, and thus could be
-      // repeated in the Objects list.
-      SmallPtrSet<const Value *, 4> ObjSet;
-      SmallVector<Metadata *, 4> Scopes, NoAliases;
-
-      SmallSetVector<const Argument *, 4> NAPtrArgs;
-      for (unsigned i = 0, ie = PtrArgs.size(); i != ie; ++i) {
-        SmallVector<Value *, 4> Objects;
-        GetUnderlyingObjects(const_cast<Value *>(PtrArgs[i]), Objects,
-                             DL, /* MaxLookup = */
-                             0);
-
-        for (Value *O : Objects)
-          ObjSet.insert(O);
-      }
-
-      // Figure out if we're derived from anything that is not a noalias
-      // argument.
-      bool CanDeriveViaCapture = false, UsesAliasingPtr = false;
-      for (const Value *V : ObjSet) {
-        // Is this value a constant that cannot be derived from any pointer
-        // value (we need to exclude constant expressions, for example, that
-        // are formed from arithmetic on global symbols).
-        bool IsNonPtrConst = isa<ConstantInt>(V) || isa<ConstantFP>(V) ||
-                             isa<ConstantPointerNull>(V) ||
-                             isa<ConstantDataVector>(V) || isa<UndefValue>(V);
-        if (IsNonPtrConst)
-          continue;
-
-        // If this is anything other than a noalias argument, then we cannot
-        // completely describe the aliasing properties using alias.scope
-        // metadata (and, thus, won't add any).
-        if (const Argument *A = dyn_cast<Argument>(V)) {
-          if (!A->hasNoAliasAttr())
-            UsesAliasingPtr = true;
-        } else {
-          UsesAliasingPtr = true;
-        }
-
-        // If this is not some identified function-local object (which cannot
-        // directly alias a noalias argument), or some other argument (which,
-        // by definition, also cannot alias a noalias argument), then we could
-        // alias a noalias argument that has been captured).
-        if (!isa<Argument>(V) &&
-            !isIdentifiedFunctionLocal(const_cast<Value *>(V)))
-          CanDeriveViaCapture = true;
-      }
-
-      // A function call can always get captured noalias pointers (via other
-      // parameters, globals, etc.).
-      if (IsFuncCall && !IsArgMemOnlyCall)
-        CanDeriveViaCapture = true;
-
-      // First, we want to figure out all of the sets with which we definitely
-      // don't alias. Iterate over all noalias set, and add those for which:
-      //   1. The noalias argument is not in the set of objects from which we
-      //      definitely derive.
-      //   2. The noalias argument has not yet been captured.
-      // An arbitrary function that might load pointers could see captured
-      // noalias arguments via other noalias arguments or globals, and so we
-      // must always check for prior capture.
-      for (const Argument *A : FunArgs) {
-        if (!ObjSet.count(A) &&
-            (!CanDeriveViaCapture ||
-             // It might be tempting to skip the
-             // PointerMayBeCapturedBefore check if
-             // A->hasNoCaptureAttr() is true, but this is
-             // incorrect because nocapture only guarantees
-             // that no copies outlive the function, not
-             // that the value cannot be locally captured.
-             !PointerMayBeCapturedBefore(A,
-                                         /* ReturnCaptures */ false,
-                                         /* StoreCaptures */ false, I, &DT)))
-          NoAliases.push_back(NewScopes[A]);
-      }
-
-      if (!NoAliases.empty())
-        NI->setMetadata(LLVMContext::MD_noalias,
-                        MDNode::concatenate(
-                            NI->getMetadata(LLVMContext::MD_noalias),
-                            MDNode::get(CalledFunc->getContext(), NoAliases)));
-
-      // Next, we want to figure out all of the sets to which we might belong.
-      // We might belong to a set if the noalias argument is in the set of
-      // underlying objects. If there is some non-noalias argument in our list
-      // of underlying objects, then we cannot add a scope because the fact
-      // that some access does not alias with any set of our noalias arguments
-      // cannot itself guarantee that it does not alias with this access
-      // (because there is some pointer of unknown origin involved and the
-      // other access might also depend on this pointer). We also cannot add
-      // scopes to arbitrary functions unless we know they don't access any
-      // non-parameter pointer-values.
-      bool CanAddScopes = !UsesAliasingPtr;
-      if (CanAddScopes && IsFuncCall)
-        CanAddScopes = IsArgMemOnlyCall;
-
-      if (CanAddScopes)
-        for (const Argument *A : FunArgs) {
-          if (ObjSet.count(A))
-            Scopes.push_back(NewScopes[A]);
-        }
+  // Attach the planned metadata to the copies of the original accesses.
+  for (const AliasScopePlan::Access &Acc : Plan.Accesses) {
+    Value *V = VMap.lookup(Acc.I);
+    Instruction *NI = dyn_cast_or_null<Instruction>(V);
+    if (!NI)
+      continue;
 
-      if (!Scopes.empty())
-        NI->setMetadata(
-            LLVMContext::MD_alias_scope,
-            MDNode::concatenate(NI->getMetadata(LLVMContext::MD_alias_scope),
-                                MDNode::get(CalledFunc->getContext(), Scopes)));
+    SmallVector<Metadata *, 4> Scopes, NoAliases;
+    for (unsigned i = 0, e = FunArgs.size(); i != e; ++i) {
+      if (Acc.NoAliases.test(i))
+        NoAliases.push_back(NewScopes[i]);
+      if (Acc.Scopes.test(i))
+        Scopes.push_back(NewScopes[i]);
     }
+
+    if (!NoAliases.empty())
+      NI->setMetadata(LLVMContext::MD_noalias,
+                      MDNode::concatenate(
+                          NI->getMetadata(LLVMContext::MD_noalias),
+                          MDNode::get(CalledFunc->getContext(), NoAliases)));
+
+    if (!Scopes.empty())
+      NI->setMetadata(
+          LLVMContext::MD_alias_scope,
+          MDNode::concatenate(NI->getMetadata(LLVMContext::MD_alias_scope),
+                              MDNode::get(CalledFunc->getContext(), Scopes)));
   }
 }
 
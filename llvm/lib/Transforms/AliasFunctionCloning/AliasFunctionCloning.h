@@ -8,16 +8,25 @@
  *
  *===========================================================================*/
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AAQueryObserver.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/CallSite.h"
@@ -26,46 +35,287 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSONString.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace llvm;
 
 namespace {
+// Byte range [Lo, Hi) accessed through a pointer argument, expressed as
+// offsets from the argument itself. Both bounds are SCEVs over the callee's
+// formal arguments, so they can be re-materialized at any call site.
+struct ArgExtent {
+  const SCEV *Lo;
+  const SCEV *Hi;
+  bool IsWritten;
+
+  ArgExtent() : Lo(nullptr), Hi(nullptr), IsWritten(false) {}
+};
+
+// Two pointer arguments of a call site that AA could not tell apart
+struct AliasingArgPair {
+  unsigned ArgA;
+  unsigned ArgB;
+  AliasAnalysis::AliasResult Result;
+};
+
+// Why a call site was or was not restrictified, kept for -afc-remarks-output
+struct CallSiteRemark {
+  struct Pair {
+    unsigned ArgA;
+    unsigned ArgB;
+    AliasAnalysis::AliasResult Result;
+    // The alias analysis that gave Result, empty when none could tell
+    std::string Analysis;
+  };
+
+  bool Missed;
+  std::string Name;
+  std::string Caller;
+  std::string Callee;
+  std::string File;
+  unsigned Line;
+  unsigned Column;
+  std::vector<Pair> Pairs;
+};
+
+// Alias scope metadata to attach to a clone, decided on the original body
+struct AliasScopePlan {
+  // Original arguments that get a scope of their own
+  SmallVector<const Argument *, 4> ScopedArgs;
+
+  // Scopes of an original access, as bit sets over ScopedArgs
+  struct Access {
+    const Instruction *I;
+    SmallBitVector NoAliases;
+    SmallBitVector Scopes;
+  };
+  std::vector<Access> Accesses;
+};
+
 class AliasFunctionCloning : public ModulePass {
 public:
   static char ID;
 
   DenseMap<Function *, Function *> clonesMap;
+  // Alias results shared by all the call sites of the module, keyed by the
+  // (underlying object, query size) pair of each side
+  typedef std::pair<const Value *, uint64_t> AliasCacheLoc;
+  typedef std::pair<AliasCacheLoc, AliasCacheLoc> AliasCacheKey;
+  mutable DenseMap<AliasCacheKey, AliasAnalysis::AliasResult> aliasCache;
+  // The aliasCache keys each underlying object appears in
+  mutable DenseMap<const Value *, SmallVector<AliasCacheKey, 4> >
+      aliasCacheKeys;
+  // Partially restrictified clones, keyed by the mask of noalias arguments
+  DenseMap<std::pair<Function *, uint64_t>, Function *> partialClonesMap;
+  DenseMap<Function *, unsigned> numPartialClones;
+  // Callees whose call sites restrictification has collected, numbered in
+  // the order it did so
+  DenseMap<const Function *, unsigned> visitedCallees;
+  // Clones created during restrictification, along with the number of
+  // callees visited by then. Their calls to those callees still need to be
+  // visited
+  SmallVector<std::pair<Function *, unsigned>, 4> pendingClones;
+  // Call sites for which the static approach failed, grouped by callee
+  DenseMap<Function *, SmallSetVector<Instruction *, 4> > failedCallSites;
+  // Decisions recorded for -afc-remarks-output
+  std::vector<CallSiteRemark> remarks;
+  // The function each clone was made from
+  DenseMap<const Function *, const Function *> cloneOrigins;
+  // Clones created by this run, as opposed to those found in the module
+  SmallPtrSet<Function *, 16> createdClones;
+  // Sample profile given by -afc-sample-profile, if any, along with the
+  // sample counts that make a function or a call site hot
+  std::unique_ptr<sampleprof::SampleProfileReader> profile;
+  unsigned hotFunctionSamples;
+  unsigned hotCallSiteSamples;
   AliasAnalysis *AA;
   const DataLayout *DL;
 
-  AliasFunctionCloning() : ModulePass(ID), AA(0), DL(0) {}
+  AliasFunctionCloning()
+      : ModulePass(ID), hotFunctionSamples(0), hotCallSiteSamples(0), AA(0),
+        DL(0) {}
 
   void getAnalysisUsage(AnalysisUsage &AU) const;
   bool runOnModule(Module &M);
 
-  // Determines if all CS's real parameters are noalias among themselves
-  bool areArgsNoAlias(const CallSite &CS) const;
+  // Reads the profile given by -afc-sample-profile and computes the hotness
+  // thresholds from it. Returns false if it could not be read
+  bool loadProfile(LLVMContext &Ctx);
+
+  // Returns the samples of the function F was cloned from, or of F itself
+  sampleprof::FunctionSamples *getSamples(const Function &F) const;
+
+  // Determines if F is hot enough to be cloned. Without a profile, every
+  // function is
+  bool isHotFunction(const Function &F) const;
+
+  // Determines if call is hot enough to get a partial clone or an overlap
+  // check. Without a profile, every call site is
+  bool isHotCallSite(const Instruction *call) const;
+
+  // Computes the aliasCache key of a query about V1 and V2. Returns false if
+  // its answer cannot be shared with other call sites
+  bool getAliasCacheKey(const Value *V1, uint64_t V1Size, const Value *V2,
+                        uint64_t V2Size, AliasCacheKey &Key) const;
+
+  // Records Res as the answer for Key in aliasCache, unless it already has
+  // one. Returns true if it was recorded
+  bool addAliasCacheEntry(const AliasCacheKey &Key,
+                          AliasAnalysis::AliasResult Res) const;
+
+  // Drops the aliasCache entries keyed on V, which is about to be erased.
+  // Otherwise a value later allocated at the same address would get them
+  void forgetAliasCacheEntries(const Value *V);
+
+  // Queries AA about V1 and V2 through aliasCache. With unknown sizes the
+  // answer only depends on the underlying objects, so call sites passing
+  // values derived from the same objects share their queries
+  AliasAnalysis::AliasResult
+  cachedAlias(const Value *V1, const Value *V2,
+              uint64_t V1Size = AliasAnalysis::UnknownSize,
+              uint64_t V2Size = AliasAnalysis::UnknownSize) const;
+
+  // Determines if all CS's real parameters are noalias among themselves.
+  // If DisjointArgs is given, it receives a mask of the argument positions
+  // that are noalias with respect to every other pointer argument. If
+  // Aliasing is given, it receives the argument pairs found to alias
+  bool areArgsNoAlias(const CallSite &CS, uint64_t *DisjointArgs = nullptr,
+                      SmallVectorImpl<AliasingArgPair> *Aliasing =
+                          nullptr) const;
+
+  // Determines if the decision taken for calls in Caller should be explained,
+  // either through missed-optimization remarks or -afc-remarks-output
+  bool wantsRemarkDetails(const Function &Caller) const;
+
+  // Returns the name of the alias analysis of the chain that settles whether
+  // V1 and V2 alias, or an empty string if none could tell
+  std::string getDecidingAnalysis(const Value *V1, const Value *V2) const;
+
+  // Reports the restrictification decision taken for call, whose pointer
+  // arguments in Aliasing kept it from reaching the noalias clone of Callee.
+  // Must be called before call is replaced
+  void emitCallSiteRemark(Instruction *call, const Function &Callee,
+                          bool Missed, StringRef Name, const Twine &Msg,
+                          ArrayRef<AliasingArgPair> Aliasing);
+
+  // Writes the recorded remarks as JSON to Path
+  void writeRemarks(StringRef Path) const;
 
   // Creates a noalias version of every function in M given that it
   // contains at least one pointer argument
   void createNoAliasFunctionClones(Module &M);
 
+  // Determines if F is defined, not vararg, and takes at least two pointer
+  // arguments that are not already noalias
+  bool isCloningCandidate(Function &F) const;
+
+  // Creates the clone of F in which every pointer argument is noalias
+  void createNoAliasClone(Function &F, const AliasScopePlan *Plan = nullptr);
+
+  // Determines if F passes two or more of its distinct pointer arguments
+  // to a function in Cloned
+  bool feedsNoAliasClone(Function &F,
+                         const SmallPtrSetImpl<const Function *> &Cloned) const;
+
+  // Creates a copy of F named Name in which the arguments set in
+  // NoAliasArgs are marked noalias. Plan holds the alias scopes computed
+  // ahead of time, if any
+  Function *createClone(Function &F, const SmallBitVector &NoAliasArgs,
+                        const Twine &Name,
+                        const AliasScopePlan *Plan = nullptr);
+
+  // Hashes the contents of F along with the NoAliasArgs it is cloned for.
+  // Returns an empty string if F refers to symbols local to its module
+  std::string getContentHash(const Function &F,
+                             const SmallBitVector &NoAliasArgs) const;
+
+  // Returns the clone of F which is noalias only on the arguments in the
+  // DisjointArgs mask, creating it if needed. Returns nullptr when the
+  // variant would be useless or F already has too many of them
+  Function *getPartialClone(Function &F, uint64_t DisjointArgs);
+
+  // Determines if F has memory accesses through distinct pointer arguments
+  // whose optimization is blocked by their possible aliasing
+  bool isCloningProfitable(Function &F) const;
+
+  // Erases the clones created by this run that ended up with no callers,
+  // unless -afc-clone-all asks to keep every clone
+  void removeUnusedClones(Module &M);
+
   // Replaces call sites by their noalias versions whenever possible
   // according to the static approach of using alias analysis
   void staticRestrictification(Module &M);
-  void AddAliasScopeMetadata(ValueToValueMapTy &VMap, const DataLayout *DL,
-                             AliasAnalysis *AA, const Function *F,
-                             Function *NF);
+
+  // Redirects a single call to F to the best clone AA allows. Returns true
+  // if it was replaced by the fully restrictified clone
+  bool restrictifyCallSite(Instruction *call, Function *F);
+
+  // Replaces the remaining call sites by a runtime pointer-overlap check that
+  // branches between the noalias clone and the original function
+  void dynamicRestrictification(Module &M);
+
+  // Determines if the argument overlap profile of call, if any, shows it
+  // rarely enough overlaps for an overlap check to pay off
+  bool isWorthGuarding(Instruction *call, const Function &Callee);
+
+  // Instruments the calls of M that may get an overlap check to count how
+  // often their arguments actually overlap, instead of cloning anything
+  void instrumentArgOverlaps(Module &M);
+
+  // Computes the extent of memory accessed through each pointer argument of
+  // F. Returns false if some argument may be accessed in a way we cannot
+  // bound (escapes, calls, non-affine accesses)
+  bool computeArgExtents(Function &F, ScalarEvolution &SE,
+                         DenseMap<const Argument *, ArgExtent> &Extents) const;
+
+  // Emits the overlap check for CS right before it. Returns nullptr if no
+  // check could be built, otherwise sets NumPairs to the number of argument
+  // pairs it compares
+  Value *emitOverlapCheck(CallSite CS, Function *F,
+                          DenseMap<const Argument *, ArgExtent> &Extents,
+                          unsigned &NumPairs) const;
+
+  // Collects the calls in F that only access their pointer arguments
+  void collectArgMemOnlyCalls(const Function &F,
+                              SmallPtrSetImpl<const Instruction *> &Calls) const;
+
+  // Decides the alias scope metadata of the accesses in F for a clone that
+  // is noalias on NoAliasArgs. Only reads the IR and never queries alias
+  // analysis, so it may run concurrently on distinct functions
+  static void
+  planAliasScopes(const Function &F, const SmallBitVector &NoAliasArgs,
+                  const SmallPtrSetImpl<const Instruction *> &ArgMemOnlyCalls,
+                  AliasScopePlan &Plan);
+
+  // Runs planAliasScopes for the full clones of Fns, on -afc-threads threads
+  void planAliasScopesInParallel(ArrayRef<Function *> Fns,
+                                 std::vector<AliasScopePlan> &Plans) const;
+
+  // Creates the scopes of Plan and attaches them to NF's instructions
+  void applyAliasScopes(const AliasScopePlan &Plan, ValueToValueMapTy &VMap,
+                        Function *NF);
 };
 }
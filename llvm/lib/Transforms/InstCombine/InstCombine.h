@@ -123,6 +123,10 @@ public:
 public:
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new InstCombiner();
+  }
+
   bool DoOneIteration(Function &F, unsigned ItNum);
 
   void getAnalysisUsage(AnalysisUsage &AU) const override;
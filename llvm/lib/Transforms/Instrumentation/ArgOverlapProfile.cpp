@@ -0,0 +1,164 @@
+//===-- ArgOverlapProfile.cpp - Argument overlap profile read-back --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Argument overlap profiles record, for calls passing several pointers, how
+// often the pointed-to memory actually overlapped at run time.  They are
+// gathered through instrprof_increment intrinsics, lowered by -instrprof like
+// frontend counters, so the raw profiles are merged by llvm-profdata into the
+// indexed format.
+//
+// This pass reads an indexed profile back and attaches its counts to the
+// calls as !arg.overlap metadata, a pair of i64 holding the number of times
+// the call ran and the number of those where its arguments overlapped.
+// Transformations specializing calls on disjoint arguments use it to tell
+// where a runtime overlap check pays off.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Instrumentation.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "arg-overlap-profile"
+
+STATISTIC(NumAnnotatedCalls, "Number of calls given argument overlap counts");
+
+static cl::opt<std::string>
+ArgOverlapProfileFile("arg-overlap-profile", cl::init(""),
+                      cl::value_desc("filename"),
+                      cl::desc("Indexed profile holding the argument overlap "
+                               "counts read by -arg-overlap-profile-use"));
+
+std::string llvm::getArgOverlapProfileName(const Function &F) {
+  if (!F.hasLocalLinkage())
+    return ("__arg_overlap." + F.getName()).str();
+
+  // Local functions of different modules may share a name.  Like frontend
+  // profiles do with the main file name, tell them apart by the module.
+  StringRef ModuleName = F.getParent()->getModuleIdentifier();
+  if (ModuleName.empty())
+    ModuleName = "<unknown>";
+  return ("__arg_overlap." + ModuleName + ":" + F.getName()).str();
+}
+
+void llvm::collectArgOverlapCallSites(Function &F,
+                                      SmallVectorImpl<CallInst *> &Calls) {
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    CallInst *CI = dyn_cast<CallInst>(&*I);
+    if (!CI)
+      continue;
+    Function *Callee = CI->getCalledFunction();
+    if (!Callee || Callee->isDeclaration() || Callee->isVarArg())
+      continue;
+
+    unsigned NumPointers = 0;
+    for (const Argument &A : Callee->args())
+      if (A.getType()->isPointerTy())
+        ++NumPointers;
+    if (NumPointers >= 2)
+      Calls.push_back(CI);
+  }
+}
+
+namespace {
+
+class ArgOverlapProfileUse : public ModulePass {
+public:
+  static char ID;
+
+  ArgOverlapProfileUse(StringRef Filename = StringRef())
+      : ModulePass(ID), Filename(Filename) {
+    if (this->Filename.empty())
+      this->Filename = ArgOverlapProfileFile;
+    initializeArgOverlapProfileUsePass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override {
+    return "Argument overlap profile read-back";
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+private:
+  std::string Filename;
+
+  /// Attach the counts of F's profile, if any, to its calls.
+  bool annotateFunction(Function &F, IndexedInstrProfReader &Reader);
+};
+
+} // end anonymous namespace
+
+char ArgOverlapProfileUse::ID = 0;
+INITIALIZE_PASS(ArgOverlapProfileUse, "arg-overlap-profile-use",
+                "Attach argument overlap profile counts to calls", false,
+                false)
+
+ModulePass *llvm::createArgOverlapProfileUsePass(StringRef Filename) {
+  return new ArgOverlapProfileUse(Filename);
+}
+
+bool ArgOverlapProfileUse::runOnModule(Module &M) {
+  if (Filename.empty())
+    return false;
+
+  std::unique_ptr<IndexedInstrProfReader> Reader;
+  if (std::error_code EC = IndexedInstrProfReader::create(Filename, Reader)) {
+    M.getContext().emitError("Could not open argument overlap profile '" +
+                             Filename + "': " + EC.message());
+    return false;
+  }
+
+  bool Changed = false;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Changed |= annotateFunction(F, *Reader);
+  return Changed;
+}
+
+bool ArgOverlapProfileUse::annotateFunction(Function &F,
+                                            IndexedInstrProfReader &Reader) {
+  SmallVector<CallInst *, 8> Calls;
+  collectArgOverlapCallSites(F, Calls);
+  if (Calls.empty())
+    return false;
+
+  // The hash is the number of calls profiled, so a profile of an older
+  // version of F is rejected by the reader rather than misattributed.
+  std::vector<uint64_t> Counts;
+  if (Reader.getFunctionCounts(getArgOverlapProfileName(F), Calls.size(),
+                               Counts) ||
+      Counts.size() != 2 * Calls.size())
+    return false;
+
+  LLVMContext &Ctx = F.getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  for (unsigned I = 0, E = Calls.size(); I != E; ++I) {
+    Metadata *Ops[] = {
+      ConstantAsMetadata::get(ConstantInt::get(Int64Ty, Counts[2 * I])),
+      ConstantAsMetadata::get(ConstantInt::get(Int64Ty, Counts[2 * I + 1]))
+    };
+    Calls[I]->setMetadata("arg.overlap", MDNode::get(Ctx, Ops));
+    ++NumAnnotatedCalls;
+  }
+  return true;
+}
@@ -26,6 +26,7 @@ void llvm::initializeInstrumentation(PassRegistry &Registry) {
   initializeBoundsCheckingPass(Registry);
   initializeGCOVProfilerPass(Registry);
   initializeInstrProfilingPass(Registry);
+  initializeArgOverlapProfileUsePass(Registry);
   initializeMemorySanitizerPass(Registry);
   initializeThreadSanitizerPass(Registry);
   initializeSanitizerCoverageModulePass(Registry);
@@ -52,6 +52,10 @@ struct AlignmentFromAssumptions : public FunctionPass {
 
   bool runOnFunction(Function &F);
 
+  virtual FunctionPass *createConcurrentInstance() const {
+    return new AlignmentFromAssumptions();
+  }
+
   virtual void getAnalysisUsage(AnalysisUsage &AU) const {
     AU.addRequired<AssumptionCacheTracker>();
     AU.addRequired<ScalarEvolution>();
@@ -23,6 +23,7 @@
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -32,6 +33,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -42,15 +44,25 @@ using namespace llvm;
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<bool>
+EnableMemorySSA("enable-dse-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Look up the stores memory dependence analysis gives "
+                         "up on in the memory SSA form of the function"));
+
+// Maximum number of memory accesses walked past in the memory SSA form.
+static const unsigned MemorySSAScanLimit = 100;
+
 namespace {
   struct DSE : public FunctionPass {
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
+    MemorySSA *MSSA;
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
 
     static char ID; // Pass identification, replacement for typeid
-    DSE() : FunctionPass(ID), AA(nullptr), MD(nullptr), DT(nullptr) {
+    DSE() : FunctionPass(ID), AA(nullptr), MD(nullptr), MSSA(nullptr),
+            DT(nullptr) {
       initializeDSEPass(*PassRegistry::getPassRegistry());
     }
 
@@ -60,6 +72,8 @@ namespace {
 
       AA = &getAnalysis<AliasAnalysis>();
       MD = &getAnalysis<MemoryDependenceAnalysis>();
+      if (EnableMemorySSA)
+        MSSA = &getAnalysis<MemorySSAWrapperPass>().getMSSA();
       DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
       TLI = AA->getTargetLibraryInfo();
 
@@ -70,11 +84,14 @@ namespace {
         if (DT->isReachableFromEntry(I))
           Changed |= runOnBasicBlock(*I);
 
-      AA = nullptr; MD = nullptr; DT = nullptr;
+      AA = nullptr; MD = nullptr; MSSA = nullptr; DT = nullptr;
       return Changed;
     }
 
     bool runOnBasicBlock(BasicBlock &BB);
+    MemDepResult getMemorySSADependency(const AliasAnalysis::Location &Loc,
+                                        Instruction *ScanIt, BasicBlock &BB);
+    bool isSettledByMemorySSA(MemDepResult Dep) const;
     bool HandleFree(CallInst *F);
     bool handleEndBlock(BasicBlock &BB);
     void RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
@@ -85,6 +102,8 @@ namespace {
       AU.addRequired<DominatorTreeWrapperPass>();
       AU.addRequired<AliasAnalysis>();
       AU.addRequired<MemoryDependenceAnalysis>();
+      if (EnableMemorySSA)
+        AU.addRequired<MemorySSAWrapperPass>();
       AU.addPreserved<AliasAnalysis>();
       AU.addPreserved<DominatorTreeWrapperPass>();
       AU.addPreserved<MemoryDependenceAnalysis>();
@@ -96,6 +115,7 @@ char DSE::ID = 0;
 INITIALIZE_PASS_BEGIN(DSE, "dse", "Dead Store Elimination", false, false)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(DSE, "dse", "Dead Store Elimination", false, false)
 
@@ -110,9 +130,11 @@ FunctionPass *llvm::createDeadStoreEliminationPass() { return new DSE(); }
 /// dead, delete them and the computation tree that feeds them.
 ///
 /// If ValueSet is non-null, remove any deleted instructions from it as well.
+/// If MSSA is non-null, remove their memory accesses from it.
 ///
 static void DeleteDeadInstruction(Instruction *I,
                                MemoryDependenceAnalysis &MD,
+                               MemorySSA *MSSA,
                                const TargetLibraryInfo *TLI,
                                SmallSetVector<Value*, 16> *ValueSet = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
@@ -129,6 +151,8 @@ static void DeleteDeadInstruction(Instruction *I,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSA)
+      MSSA->removeInstruction(DeadInst);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -500,7 +524,17 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
     if (!hasMemoryWrite(Inst, TLI))
       continue;
 
-    MemDepResult InstDep = MD->getDependency(Inst);
+    MemDepResult InstDep = MemDepResult::getUnknown();
+    if (MSSA) {
+      AliasAnalysis::Location InstLoc = getLocForWrite(Inst, *AA);
+      if (InstLoc.Ptr)
+        InstDep = getMemorySSADependency(InstLoc, Inst, BB);
+    }
+    if (!isSettledByMemorySSA(InstDep)) {
+      MemDepResult MDDep = MD->getDependency(Inst);
+      if (!MDDep.isUnknown() || InstDep.isUnknown())
+        InstDep = MDDep;
+    }
 
     // Ignore any store where we can't find a local dependence.
     // FIXME: cross-block DSE would be fun. :)
@@ -520,7 +554,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
           // in case we need it.
           WeakVH NextInst(BBI);
 
-          DeleteDeadInstruction(SI, *MD, TLI);
+          DeleteDeadInstruction(SI, *MD, MSSA, TLI);
 
           if (!NextInst)  // Next instruction deleted.
             BBI = BB.begin();
@@ -567,7 +601,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          DeleteDeadInstruction(DepWrite, *MD, TLI);
+          DeleteDeadInstruction(DepWrite, *MD, MSSA, TLI);
           ++NumFastStores;
           MadeChange = true;
 
@@ -619,7 +653,14 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
       if (AA->getModRefInfo(DepWrite, Loc) & AliasAnalysis::Ref)
         break;
 
-      InstDep = MD->getPointerDependencyFrom(Loc, false, DepWrite, &BB);
+      InstDep = MSSA ? getMemorySSADependency(Loc, DepWrite, BB)
+                     : MemDepResult::getUnknown();
+      if (!isSettledByMemorySSA(InstDep)) {
+        MemDepResult MDDep =
+            MD->getPointerDependencyFrom(Loc, false, DepWrite, &BB);
+        if (!MDDep.isUnknown() || InstDep.isUnknown())
+          InstDep = MDDep;
+      }
     }
   }
 
@@ -631,6 +672,60 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
   return MadeChange;
 }
 
+/// getMemorySSADependency - Find an access in BB above ScanIt that reads or
+/// writes Loc, with no write to Loc in between.  The memory SSA form links
+/// each definition to the previous one, so the walk only visits the writes in
+/// between and the reads of each.  Like MemDep, returns a Def for a read or a
+/// must-aliased store, a Clobber for other writes and NonLocal when the walk
+/// leaves BB.  Returns Unknown when the walk runs too long, leaving the query
+/// to MemDep.
+MemDepResult DSE::getMemorySSADependency(const AliasAnalysis::Location &Loc,
+                                         Instruction *ScanIt,
+                                         BasicBlock &BB) {
+  MemoryUseOrDef *Start = MSSA->getMemoryAccess(ScanIt);
+  if (!Start)
+    return MemDepResult::getUnknown();
+
+  unsigned Limit = MemorySSAScanLimit;
+  for (MemoryAccess *MA = Start->getDefiningAccess(); MA;) {
+    // The reads of MA come after it and before the next write.  Those of a
+    // definition from outside BB come before the first write in BB.
+    for (MemoryAccess *U : MA->users()) {
+      if (--Limit == 0)
+        return MemDepResult::getUnknown();
+      MemoryUse *Use = dyn_cast<MemoryUse>(U);
+      if (Use && Use->getBlock() == &BB &&
+          (AA->getModRefInfo(Use->getMemoryInst(), Loc) & AliasAnalysis::Ref))
+        return MemDepResult::getDef(Use->getMemoryInst());
+    }
+
+    MemoryDef *Def = dyn_cast<MemoryDef>(MA);
+    if (!Def || MSSA->isLiveOnEntryDef(Def) || Def->getBlock() != &BB)
+      break;
+
+    Instruction *DefInst = Def->getMemoryInst();
+    if (AA->getModRefInfo(DefInst, Loc) != AliasAnalysis::NoModRef) {
+      StoreInst *SI = dyn_cast<StoreInst>(DefInst);
+      if (SI && AA->alias(AA->getLocation(SI), Loc) == AliasAnalysis::MustAlias)
+        return MemDepResult::getDef(SI);
+      return MemDepResult::getClobber(DefInst);
+    }
+    if (--Limit == 0)
+      return MemDepResult::getUnknown();
+    MA = Def->getDefiningAccess();
+  }
+  return MemDepResult::getNonLocal();
+}
+
+/// isSettledByMemorySSA - Return true if Dep, as found in the memory SSA form,
+/// needs no second opinion from MemDep: nothing in the block accesses the
+/// location, or a store overwrites it exactly.  MemDep looks past more kinds
+/// of accesses, such as atomic operations on other locations and loads from
+/// constant memory, so it has the last word on others unless it gives up.
+bool DSE::isSettledByMemorySSA(MemDepResult Dep) const {
+  return Dep.isNonLocal() || (Dep.isDef() && isa<StoreInst>(Dep.getInst()));
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
@@ -677,7 +772,7 @@ bool DSE::HandleFree(CallInst *F) {
       Instruction *Next = std::next(BasicBlock::iterator(Dependency));
 
       // DCE instructions only used to calculate that store
-      DeleteDeadInstruction(Dependency, *MD, TLI);
+      DeleteDeadInstruction(Dependency, *MD, MSSA, TLI);
       ++NumFastStores;
       MadeChange = true;
 
@@ -761,7 +856,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects);
+        DeleteDeadInstruction(Dead, *MD, MSSA, TLI, &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -771,7 +866,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(BBI, TLI)) {
       Instruction *Inst = BBI++;
-      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects);
+      DeleteDeadInstruction(Inst, *MD, MSSA, TLI, &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -32,6 +32,7 @@
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/PHITransAddr.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
@@ -66,6 +67,14 @@ STATISTIC(NumPRELoad,   "Number of loads PRE'd");
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+static cl::opt<bool>
+EnableMemorySSA("enable-gvn-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Look up the loads memory dependence analysis gives "
+                         "up on in the memory SSA form of the function"));
+
+// Maximum number of memory accesses looked at for an earlier load of the
+// same location, when walking the memory SSA form.
+static const unsigned MemorySSAScanLimit = 100;
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -590,6 +599,9 @@ namespace {
   class GVN : public FunctionPass {
     bool NoLoads;
     MemoryDependenceAnalysis *MD;
+    /// MSSA - The memory SSA form of the function, built on the first load
+    /// with -enable-gvn-memoryssa, and kept up to date as edges are split.
+    std::unique_ptr<MemorySSA> MSSA;
     DominatorTree *DT;
     const DataLayout *DL;
     const TargetLibraryInfo *TLI;
@@ -634,6 +646,7 @@ namespace {
     DominatorTree &getDominatorTree() const { return *DT; }
     AliasAnalysis *getAliasAnalysis() const { return VN.getAliasAnalysis(); }
     MemoryDependenceAnalysis &getMemDep() const { return *MD; }
+    MemorySSA *getMemorySSA() const { return MSSA.get(); }
   private:
     /// addToLeaderTable - Push a new Value to the LeaderTable onto the list for
     /// its value number.
@@ -698,6 +711,7 @@ namespace {
     // Helper fuctions of redundant load elimination 
     bool processLoad(LoadInst *L);
     bool processNonLocalLoad(LoadInst *L);
+    MemDepResult getMemorySSADependency(LoadInst *L);
     void AnalyzeLoadAvailability(LoadInst *LI, LoadDepVect &Deps, 
                                  AvailValInBlkVect &ValuesPerBlock,
                                  UnavailBlkVect &UnavailableBlocks);
@@ -1205,6 +1219,8 @@ static Value *GetLoadValueForLoad(LoadInst *SrcVal, unsigned Offset,
     // but then there all of the operations based on it would need to be
     // rehashed.  Just leave the dead load around.
     gvn.getMemDep().removeInstruction(SrcVal);
+    if (MemorySSA *MSSA = gvn.getMemorySSA())
+      MSSA->removeInstruction(SrcVal);
     SrcVal = NewLoad;
   }
 
@@ -1644,6 +1660,7 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
     while (!NewInsts.empty()) {
       Instruction *I = NewInsts.pop_back_val();
       if (MD) MD->removeInstruction(I);
+      if (MSSA) MSSA->removeInstruction(I);
       I->eraseFromParent();
     }
     // HINT: Don't revert the edge-splitting as following transformation may
@@ -1817,6 +1834,60 @@ static void patchAndReplaceAllUsesWith(Instruction *I, Value *Repl) {
   I->replaceAllUsesWith(Repl);
 }
 
+/// getMemorySSADependency - Find the dependence of L by walking the memory
+/// SSA form of the function.  The walk only visits the definitions between L
+/// and its clobber, rather than every instruction in between.  Returns
+/// Unknown when the clobber is neither a store nor a memory intrinsic, such
+/// as a MemoryPhi or a call.
+MemDepResult GVN::getMemorySSADependency(LoadInst *L) {
+  if (!MSSA)
+    MSSA.reset(new MemorySSA(*L->getParent()->getParent(),
+                             *VN.getAliasAnalysis(), *DT));
+
+  MemoryUseOrDef *MA = MSSA->getMemoryAccess(L);
+  if (!MA)
+    return MemDepResult::getUnknown();
+  MemoryDef *Clobber = dyn_cast_or_null<MemoryDef>(
+      MSSA->getWalker()->getClobberingMemoryAccess(L));
+  if (!Clobber || !MSSA->dominates(Clobber, MA))
+    return MemDepResult::getUnknown();
+
+  // An earlier load of the same location, below the clobber, already has the
+  // value.  Look for one among the users of the definitions walked past, as
+  // long as they form a straight chain.
+  AliasAnalysis *AA = VN.getAliasAnalysis();
+  AliasAnalysis::Location Loc = AA->getLocation(L);
+  unsigned Limit = MemorySSAScanLimit;
+  for (MemoryAccess *Def = MA->getDefiningAccess(); Def;) {
+    for (MemoryAccess *U : Def->users()) {
+      if (--Limit == 0)
+        return MemDepResult::getUnknown();
+      MemoryUse *Use = dyn_cast<MemoryUse>(U);
+      if (!Use || Use == MA)
+        continue;
+      LoadInst *DepLI = dyn_cast<LoadInst>(Use->getMemoryInst());
+      if (DepLI && DepLI->isSimple() &&
+          AA->alias(AA->getLocation(DepLI), Loc) == AliasAnalysis::MustAlias &&
+          MSSA->dominates(Use, MA))
+        return MemDepResult::getDef(DepLI);
+    }
+    if (Def == Clobber)
+      break;
+    MemoryDef *D = dyn_cast<MemoryDef>(Def);
+    Def = D ? D->getDefiningAccess() : nullptr;
+  }
+
+  Instruction *DepInst = Clobber->getMemoryInst();
+  if (StoreInst *DepSI = dyn_cast_or_null<StoreInst>(DepInst)) {
+    if (AA->alias(AA->getLocation(DepSI), Loc) == AliasAnalysis::MustAlias)
+      return MemDepResult::getDef(DepSI);
+    return MemDepResult::getClobber(DepSI);
+  }
+  if (DepInst && isa<MemIntrinsic>(DepInst))
+    return MemDepResult::getClobber(DepInst);
+  return MemDepResult::getUnknown();
+}
+
 /// processLoad - Attempt to eliminate a load, first by eliminating it
 /// locally, and then attempting non-local elimination if that fails.
 bool GVN::processLoad(LoadInst *L) {
@@ -1831,8 +1902,18 @@ bool GVN::processLoad(LoadInst *L) {
     return true;
   }
 
-  // ... to a pointer that has been loaded from before...
-  MemDepResult Dep = MD->getDependency(L);
+  // ... to a pointer that has been loaded from before...  The memory SSA
+  // form, if enabled, is asked first: walking it skips the instructions that
+  // do not touch memory, which MemDep would scan one by one.  A value it
+  // finds is used right away.  Otherwise MemDep, which looks past more kinds
+  // of clobbers, has the last word unless it gives up.
+  MemDepResult Dep = EnableMemorySSA ? getMemorySSADependency(L)
+                                     : MemDepResult::getUnknown();
+  if (!Dep.isDef()) {
+    MemDepResult MDDep = MD->getDependency(L);
+    if (!MDDep.isUnknown() || Dep.isUnknown())
+      Dep = MDDep;
+  }
 
   // If we have a clobber and target data is around, see if this is a clobber
   // that we can fix up through code synthesis.
@@ -2383,6 +2464,7 @@ bool GVN::runOnFunction(Function& F) {
     Changed |= ShouldContinue;
     ++Iteration;
   }
+  MSSA.reset();
 
   if (EnablePRE) {
     // Fabricate val-num for dead-code in order to suppress assertion in
@@ -2439,6 +2521,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      if (MSSA) MSSA->removeInstruction(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2644,6 +2727,8 @@ BasicBlock *GVN::splitCriticalEdges(BasicBlock *Pred, BasicBlock *Succ) {
   BasicBlock *BB = SplitCriticalEdge(Pred, Succ, this);
   if (MD)
     MD->invalidateCachedPredecessors();
+  if (MSSA && BB)
+    MSSA->updateForSplitEdge(Pred, Succ, BB);
   return BB;
 }
 
@@ -2654,7 +2739,11 @@ bool GVN::splitCriticalEdges() {
     return false;
   do {
     std::pair<TerminatorInst*, unsigned> Edge = toSplit.pop_back_val();
-    SplitCriticalEdge(Edge.first, Edge.second, this);
+    BasicBlock *Pred = Edge.first->getParent();
+    BasicBlock *Succ = Edge.first->getSuccessor(Edge.second);
+    BasicBlock *BB = SplitCriticalEdge(Edge.first, Edge.second, this);
+    if (MSSA && BB)
+      MSSA->updateForSplitEdge(Pred, Succ, BB);
   } while (!toSplit.empty());
   if (MD) MD->invalidateCachedPredecessors();
   return true;
@@ -100,6 +100,19 @@ namespace {
 
     bool runOnLoop(Loop *L, LPPassManager &LPM) override;
 
+    LoopPass *createConcurrentInstance() const override {
+      LoopUnroll *LU = new LoopUnroll();
+      LU->CurrentCount = CurrentCount;
+      LU->CurrentThreshold = CurrentThreshold;
+      LU->CurrentAllowPartial = CurrentAllowPartial;
+      LU->CurrentRuntime = CurrentRuntime;
+      LU->UserCount = UserCount;
+      LU->UserThreshold = UserThreshold;
+      LU->UserAllowPartial = UserAllowPartial;
+      LU->UserRuntime = UserRuntime;
+      return LU;
+    }
+
     /// This transformation requires natural loop information & requires that
     /// loop preheaders be inserted into the CFG...
     ///
@@ -57,6 +57,10 @@ struct CFGSimplifyPass : public FunctionPass {
   }
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new CFGSimplifyPass(BonusInstThreshold);
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<AssumptionCacheTracker>();
     AU.addRequired<TargetTransformInfo>();
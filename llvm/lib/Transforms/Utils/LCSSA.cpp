@@ -287,6 +287,10 @@ struct LCSSA : public FunctionPass {
 
   bool runOnFunction(Function &F) override;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new LCSSA();
+  }
+
   /// This transformation requires natural loop information & requires that
   /// loop preheaders be inserted into the CFG.  It maintains both of these,
   /// as well as the CFG.  It also requires dominator information.
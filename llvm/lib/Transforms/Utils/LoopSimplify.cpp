@@ -755,6 +755,10 @@ namespace {
 
     bool runOnFunction(Function &F) override;
 
+    FunctionPass *createConcurrentInstance() const override {
+      return new LoopSimplify();
+    }
+
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AssumptionCacheTracker>();
 
@@ -0,0 +1,380 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+// Definitions are first grouped into clusters that must, or should, end up in
+// the same partition.  The clusters are then handed out largest first to the
+// least loaded partition, and every partition is produced as a copy of the
+// module in which the definitions of the other partitions are turned into
+// declarations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/IntEqClasses.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/// isFilteredArray - Return true if GV is one of the special arrays whose
+/// entries are distributed among the partitions along with the definitions
+/// they refer to.
+static bool isFilteredArray(const GlobalValue *GV) {
+  if (!GV->hasAppendingLinkage())
+    return false;
+  StringRef Name = GV->getName();
+  return Name == "llvm.global_ctors" || Name == "llvm.global_dtors" ||
+         Name == "llvm.used" || Name == "llvm.compiler.used";
+}
+
+/// getArrayEntryTarget - Return the global value an entry of one of the
+/// filtered arrays refers to, or null.
+static const GlobalValue *getArrayEntryTarget(const Constant *Entry) {
+  // Constructors and destructors are { priority, function[, data] }.
+  if (isa<ConstantStruct>(Entry))
+    Entry = cast<Constant>(Entry->getOperand(1));
+  return dyn_cast<GlobalValue>(Entry->stripPointerCasts());
+}
+
+/// findUserDefinitions - Add to Owners the global definitions that refer to
+/// V, looking through constants.
+static void findUserDefinitions(const Value *V,
+                                SmallSetVector<const GlobalValue *, 8> &Owners,
+                                SmallPtrSetImpl<const Constant *> &Visited) {
+  for (const User *U : V->users()) {
+    if (const Instruction *I = dyn_cast<Instruction>(U))
+      Owners.insert(I->getParent()->getParent());
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U))
+      Owners.insert(GV);
+    else if (const Constant *C = dyn_cast<Constant>(U))
+      if (Visited.insert(C).second)
+        findUserDefinitions(C, Owners, Visited);
+  }
+}
+
+/// getUniqueSuffix - Return a suffix to rename the local symbols of M that
+/// become visible to the other partitions.  It is derived from the symbols M
+/// defines for the rest of the program, which no other module can define.
+static std::string getUniqueSuffix(const Module &M) {
+  MD5 Hash;
+  Hash.update(M.getModuleIdentifier());
+  auto AddDefinition = [&](const GlobalValue &GV) {
+    if (!GV.isDeclaration() && !GV.hasLocalLinkage()) {
+      Hash.update(GV.getName());
+      Hash.update(StringRef("", 1));
+    }
+  };
+  for (const Function &F : M)
+    AddDefinition(F);
+  for (const GlobalVariable &GV : M.globals())
+    AddDefinition(GV);
+  for (const GlobalAlias &GA : M.aliases())
+    AddDefinition(GA);
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return (".llvmsplit." + Str.str().substr(0, 16)).str();
+}
+
+/// makeDeclaration - Turn the copy GV of a definition that belongs to another
+/// partition into a declaration.  Aliases cannot be declarations, so they are
+/// replaced by a function or variable declaration.
+static void makeDeclaration(GlobalValue *GV) {
+  if (Function *F = dyn_cast<Function>(GV)) {
+    F->deleteBody();
+    F->setComdat(nullptr);
+  } else if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+    Var->setInitializer(nullptr);
+    Var->setLinkage(GlobalValue::ExternalLinkage);
+    Var->setComdat(nullptr);
+  } else {
+    GlobalAlias *GA = cast<GlobalAlias>(GV);
+    Module &M = *GA->getParent();
+    PointerType *PTy = GA->getType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+    else
+      Decl = new GlobalVariable(M, PTy->getElementType(), false,
+                                GlobalValue::ExternalLinkage, nullptr, "",
+                                nullptr, GA->getThreadLocalMode(),
+                                PTy->getAddressSpace());
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    Decl->setDLLStorageClass(GA->getDLLStorageClass());
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+  }
+}
+
+/// filterArray - Keep in the special array GV only the entries that refer to
+/// symbols defined by the partition, as decided by IsKept.
+static void filterArray(GlobalVariable *GV,
+                        const std::function<bool(const GlobalValue *)> &IsKept) {
+  SmallVector<Constant *, 8> Kept;
+  const ConstantArray *Init = dyn_cast<ConstantArray>(GV->getInitializer());
+  if (Init)
+    for (const Use &Op : Init->operands()) {
+      Constant *Entry = cast<Constant>(Op);
+      const GlobalValue *Target = getArrayEntryTarget(Entry);
+      if (!Target || IsKept(Target))
+        Kept.push_back(Entry);
+    }
+  if (Init && Kept.size() == Init->getNumOperands())
+    return;
+
+  if (Kept.empty()) {
+    GV->eraseFromParent();
+    return;
+  }
+  ArrayType *ATy =
+      ArrayType::get(GV->getType()->getElementType()->getArrayElementType(),
+                     Kept.size());
+  GlobalVariable *NewGV = new GlobalVariable(
+      *GV->getParent(), ATy, GV->isConstant(), GV->getLinkage(),
+      ConstantArray::get(ATy, Kept), "", GV);
+  NewGV->takeName(GV);
+  NewGV->setSection(GV->getSection());
+  GV->eraseFromParent();
+}
+
+void llvm::SplitModule(
+    Module &M, unsigned N,
+    const std::function<void(std::unique_ptr<Module> MPart)> &ModuleCallback) {
+  // Number the definitions in module order.  Appending arrays other than the
+  // filtered ones cannot be split and stay whole in the first partition.
+  std::vector<GlobalValue *> Defs;
+  std::vector<unsigned> Sizes;
+  DenseMap<const GlobalValue *, unsigned> DefIndex;
+  std::vector<GlobalVariable *> FilteredArrays;
+  auto AddDefinition = [&](GlobalValue &GV, unsigned Size) {
+    DefIndex[&GV] = Defs.size();
+    Defs.push_back(&GV);
+    Sizes.push_back(Size);
+  };
+  for (Function &F : M)
+    if (!F.isDeclaration()) {
+      unsigned Size = 1;
+      for (const BasicBlock &BB : F)
+        Size += BB.size();
+      AddDefinition(F, Size);
+    }
+  for (GlobalVariable &GV : M.globals()) {
+    if (isFilteredArray(&GV))
+      FilteredArrays.push_back(&GV);
+    else if (!GV.isDeclaration())
+      AddDefinition(GV, 1);
+  }
+  for (GlobalAlias &GA : M.aliases())
+    AddDefinition(GA, 0);
+
+  unsigned TotalSize = 0;
+  for (unsigned Size : Sizes)
+    TotalSize += Size;
+  unsigned Budget = (TotalSize + N - 1) / N;
+
+  // The definitions referring to each local symbol, in module order.
+  DenseMap<const GlobalValue *, SmallVector<unsigned, 4> > LocalUsers;
+  for (GlobalValue *GV : Defs) {
+    if (!GV->hasLocalLinkage())
+      continue;
+    SmallSetVector<const GlobalValue *, 8> Owners;
+    SmallPtrSet<const Constant *, 8> Visited;
+    findUserDefinitions(GV, Owners, Visited);
+    SmallVector<unsigned, 4> &Users = LocalUsers[GV];
+    for (const GlobalValue *Owner : Owners) {
+      auto It = DefIndex.find(Owner);
+      if (It != DefIndex.end())
+        Users.push_back(It->second);
+    }
+    std::sort(Users.begin(), Users.end());
+  }
+
+  // Form the clusters.  Leaders track the size of their cluster.
+  IntEqClasses Clusters(Defs.size());
+  auto Join = [&](unsigned A, unsigned B, bool Bounded) {
+    unsigned LA = Clusters.findLeader(A), LB = Clusters.findLeader(B);
+    if (LA == LB)
+      return;
+    if (Bounded && Sizes[LA] + Sizes[LB] > Budget)
+      return;
+    Clusters.join(LA, LB);
+    Sizes[Clusters.findLeader(LA)] = Sizes[LA] + Sizes[LB];
+  };
+
+  DenseMap<const Comdat *, unsigned> ComdatMembers;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    GlobalValue *GV = Defs[I];
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      auto It = DefIndex.find(GA->getBaseObject());
+      if (It != DefIndex.end())
+        Join(I, It->second, false);
+    }
+    if (const Comdat *C = GV->getComdat()) {
+      auto Ins = ComdatMembers.insert(std::make_pair(C, I));
+      if (!Ins.second)
+        Join(I, Ins.first->second, false);
+    }
+    // A block address must be taken in the module defining the function.
+    if (Function *F = dyn_cast<Function>(GV))
+      for (const User *U : F->users())
+        if (isa<BlockAddress>(U)) {
+          SmallSetVector<const GlobalValue *, 8> Owners;
+          SmallPtrSet<const Constant *, 8> Visited;
+          findUserDefinitions(U, Owners, Visited);
+          for (const GlobalValue *Owner : Owners) {
+            auto It = DefIndex.find(Owner);
+            if (It != DefIndex.end())
+              Join(I, It->second, false);
+          }
+        }
+  }
+  // So must the frame of a function be recovered.
+  if (Function *Recover =
+          M.getFunction(Intrinsic::getName(Intrinsic::framerecover)))
+    for (User *U : Recover->users())
+      if (CallInst *CI = dyn_cast<CallInst>(U)) {
+        auto Caller = DefIndex.find(CI->getParent()->getParent());
+        const GlobalValue *Fn =
+            dyn_cast<GlobalValue>(CI->getArgOperand(0)->stripPointerCasts());
+        auto Callee = DefIndex.find(Fn);
+        if (Caller != DefIndex.end() && Callee != DefIndex.end())
+          Join(Caller->second, Callee->second, false);
+      }
+
+  // Keep local symbols with their users while the clusters stay within the
+  // size of a partition.
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    auto It = LocalUsers.find(Defs[I]);
+    if (It != LocalUsers.end())
+      for (unsigned User : It->second)
+        Join(I, User, true);
+  }
+
+  // Hand the clusters out, largest first, to the least loaded partition.  The
+  // unsplittable appending arrays go to the first partition.
+  std::vector<unsigned> Leaders;
+  std::vector<bool> Pinned(Defs.size());
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    if (Clusters.findLeader(I) == I)
+      Leaders.push_back(I);
+    if (Defs[I]->hasAppendingLinkage())
+      Pinned[Clusters.findLeader(I)] = true;
+  }
+  std::stable_sort(Leaders.begin(), Leaders.end(),
+                   [&](unsigned A, unsigned B) { return Sizes[A] > Sizes[B]; });
+
+  std::vector<unsigned> LeaderPartition(Defs.size());
+  std::vector<unsigned> Load(N);
+  for (unsigned Leader : Leaders) {
+    unsigned Part =
+        Pinned[Leader]
+            ? 0
+            : std::min_element(Load.begin(), Load.end()) - Load.begin();
+    LeaderPartition[Leader] = Part;
+    Load[Part] += Sizes[Leader];
+  }
+
+  std::vector<unsigned> Partition(Defs.size());
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    Partition[I] = LeaderPartition[Clusters.findLeader(I)];
+
+  // Local symbols referred to from another partition must become visible to
+  // it.
+  std::string Suffix;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    auto It = LocalUsers.find(Defs[I]);
+    if (It == LocalUsers.end())
+      continue;
+    bool Shared = false;
+    for (unsigned User : It->second)
+      Shared |= Partition[User] != Partition[I];
+    if (!Shared)
+      continue;
+
+    if (Suffix.empty())
+      Suffix = getUniqueSuffix(M);
+    GlobalValue *GV = Defs[I];
+    StringRef Name = GV->hasName() ? GV->getName() : "__llvmsplit_unnamed";
+    GV->setName(Name + Suffix);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  for (unsigned Part = 0; Part != N; ++Part) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(CloneModule(&M, VMap));
+
+    // Entries of the special arrays follow the definitions they refer to;
+    // the entries naming declarations are kept once.
+    DenseMap<const Value *, unsigned> CopyIndex;
+    for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+      CopyIndex[VMap[Defs[I]]] = I;
+    auto IsKept = [&](const GlobalValue *Target) {
+      auto It = CopyIndex.find(Target);
+      if (It != CopyIndex.end())
+        return Partition[It->second] == Part;
+      return Part == 0;
+    };
+    for (GlobalVariable *GV : FilteredArrays)
+      filterArray(cast<GlobalVariable>(VMap[GV]), IsKept);
+
+    // Drop the definitions of the other partitions.  The local ones are no
+    // longer referenced once the others are gone, and are deleted.
+    std::vector<GlobalValue *> DeadLocals;
+    for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+      if (Partition[I] == Part)
+        continue;
+      GlobalValue *GV = cast<GlobalValue>(VMap[Defs[I]]);
+      if (Function *F = dyn_cast<Function>(GV))
+        F->dropAllReferences();
+      else if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV))
+        Var->setInitializer(nullptr);
+      if (GV->hasLocalLinkage() || GV->hasAppendingLinkage())
+        DeadLocals.push_back(GV);
+    }
+    for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+      GlobalValue *GV = cast<GlobalValue>(VMap[Defs[I]]);
+      if (Partition[I] != Part && !GV->hasLocalLinkage() &&
+          !GV->hasAppendingLinkage())
+        makeDeclaration(GV);
+    }
+    // Aliases go first, as they refer to the other symbols.
+    std::stable_partition(DeadLocals.begin(), DeadLocals.end(),
+                          [](GlobalValue *GV) { return isa<GlobalAlias>(GV); });
+    for (GlobalValue *GV : DeadLocals) {
+      GV->removeDeadConstantUsers();
+      assert(GV->use_empty() && "Local symbol used by another partition!");
+      GV->eraseFromParent();
+    }
+
+    if (Part != 0)
+      MPart->setModuleInlineAsm("");
+
+    ModuleCallback(std::move(MPart));
+  }
+}
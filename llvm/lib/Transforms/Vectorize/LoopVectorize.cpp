@@ -44,6 +44,7 @@
 
 #include "llvm/Transforms/Vectorize.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
@@ -104,6 +105,11 @@ using namespace llvm::PatternMatch;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(LoopsVectorizedByScopes,
+          "Number of loops vectorized only because alias scopes removed "
+          "runtime checks");
+STATISTIC(RuntimeChecksPrunedByScopes,
+          "Number of runtime pointer checks removed by alias scopes");
 
 static cl::opt<unsigned>
 VectorizationFactor("force-vector-width", cl::init(0), cl::Hidden,
@@ -661,25 +667,47 @@ public:
   /// This struct holds information about the memory runtime legality
   /// check that a group of pointers do not overlap.
   struct RuntimePointerCheck {
-    RuntimePointerCheck() : Need(false) {}
+    RuntimePointerCheck() : Need(false), NeedsScopes(false) {}
 
     /// Reset the state of the pointer runtime information.
     void reset() {
       Need = false;
+      NeedsScopes = false;
       Pointers.clear();
       Starts.clear();
       Ends.clear();
       IsWritePtr.clear();
       DependencySetId.clear();
       AliasSetId.clear();
+      AATags.clear();
+      ScopedNoAlias.clear();
     }
 
     /// Insert a pointer and calculate the start and end SCEVs.
     void insert(ScalarEvolution *SE, Loop *Lp, Value *Ptr, bool WritePtr,
-                unsigned DepSetId, unsigned ASId, ValueToValueMap &Strides);
+                unsigned DepSetId, unsigned ASId, const AAMDNodes &Tags,
+                ValueToValueMap &Strides);
+
+    /// Decide whether the pointers at index \p I and \p J, with I < J, must
+    /// be checked at runtime to prove their independence.
+    bool needsChecking(unsigned I, unsigned J) const {
+      // No need to check if two readonly pointers intersect.
+      if (!IsWritePtr[I] && !IsWritePtr[J])
+        return false;
+      // Only need to check pointers between two different dependency sets.
+      if (DependencySetId[I] == DependencySetId[J])
+        return false;
+      // Only need to check pointers in the same alias set.
+      if (AliasSetId[I] != AliasSetId[J])
+        return false;
+      return !ScopedNoAlias.count(std::make_pair(I, J));
+    }
 
     /// This flag indicates if we need to add the runtime check.
     bool Need;
+    /// This flag indicates that there would be too many checks to emit
+    /// without the pairs in ScopedNoAlias.
+    bool NeedsScopes;
     /// Holds the pointers that we need to check.
     SmallVector<TrackingVH<Value>, 2> Pointers;
     /// Holds the pointer value at the beginning of the loop.
@@ -693,6 +721,11 @@ public:
     SmallVector<unsigned, 2> DependencySetId;
     /// Holds the id of the disjoint alias set to which this pointer belongs.
     SmallVector<unsigned, 2> AliasSetId;
+    /// Holds the AA metadata common to the accesses through this pointer.
+    SmallVector<AAMDNodes, 2> AATags;
+    /// Holds the pairs of pointers of an alias set that alias scope metadata
+    /// proves not to overlap.
+    DenseSet<std::pair<unsigned, unsigned> > ScopedNoAlias;
   };
 
   /// A struct for saving information about induction variables.
@@ -1273,6 +1306,10 @@ struct LoopVectorize : public FunctionPass {
 
   BlockFrequency ColdEntryFreq;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new LoopVectorize(DisableUnrolling, AlwaysVectorize);
+  }
+
   bool runOnFunction(Function &F) override {
     SE = &getAnalysis<ScalarEvolution>();
     DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
@@ -1474,6 +1511,10 @@ struct LoopVectorize : public FunctionPass {
       InnerLoopVectorizer LB(L, SE, LI, DT, DL, TLI, VF.Width, UF);
       LB.vectorize(&LVL);
       ++LoopsVectorized;
+      RuntimeChecksPrunedByScopes +=
+          LVL.getRuntimePointerCheck()->ScopedNoAlias.size();
+      if (LVL.getRuntimePointerCheck()->NeedsScopes)
+        ++LoopsVectorizedByScopes;
 
       // Report the vectorization decision.
       emitOptimizationRemark(
@@ -1557,7 +1598,7 @@ static const SCEV *replaceSymbolicStrideSCEV(ScalarEvolution *SE,
 
 void LoopVectorizationLegality::RuntimePointerCheck::insert(
     ScalarEvolution *SE, Loop *Lp, Value *Ptr, bool WritePtr, unsigned DepSetId,
-    unsigned ASId, ValueToValueMap &Strides) {
+    unsigned ASId, const AAMDNodes &Tags, ValueToValueMap &Strides) {
   // Get the stride replaced scev.
   const SCEV *Sc = replaceSymbolicStrideSCEV(SE, Strides, Ptr);
   const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(Sc);
@@ -1570,6 +1611,7 @@ void LoopVectorizationLegality::RuntimePointerCheck::insert(
   IsWritePtr.push_back(WritePtr);
   DependencySetId.push_back(DepSetId);
   AliasSetId.push_back(ASId);
+  AATags.push_back(Tags);
 }
 
 Value *InnerLoopVectorizer::getBroadcastInstrs(Value *V) {
@@ -2123,15 +2165,7 @@ InnerLoopVectorizer::addRuntimeCheck(Instruction *Loc) {
   Value *MemoryRuntimeCheck = nullptr;
   for (unsigned i = 0; i < NumPointers; ++i) {
     for (unsigned j = i+1; j < NumPointers; ++j) {
-      // No need to check if two readonly pointers intersect.
-      if (!PtrRtCheck->IsWritePtr[i] && !PtrRtCheck->IsWritePtr[j])
-        continue;
-
-      // Only need to check pointers between two different dependency sets.
-      if (PtrRtCheck->DependencySetId[i] == PtrRtCheck->DependencySetId[j])
-       continue;
-      // Only need to check pointers in the same alias set.
-      if (PtrRtCheck->AliasSetId[i] != PtrRtCheck->AliasSetId[j])
+      if (!PtrRtCheck->needsChecking(i, j))
         continue;
 
       unsigned AS0 = Starts[i]->getType()->getPointerAddressSpace();
@@ -4182,7 +4216,8 @@ bool AccessAnalysis::canCheckPtrAtRT(
           // Each access has its own dependence set.
           DepId = RunningDepId++;
 
-        RtCheck.insert(SE, TheLoop, Ptr, IsWrite, DepId, ASId, StridesMap);
+        RtCheck.insert(SE, TheLoop, Ptr, IsWrite, DepId, ASId, A.getAAInfo(),
+                       StridesMap);
 
         DEBUG(dbgs() << "LV: Found a runtime check ptr:" << *Ptr << '\n');
       } else {
@@ -4200,6 +4235,46 @@ bool AccessAnalysis::canCheckPtrAtRT(
     ++ASId;
   }
 
+  // An alias set holds every pointer that may alias one of its members, so
+  // two pointers that do not alias each other share a set when both may
+  // alias a third one. Alias scopes, as added by the inliner and by alias
+  // function cloning to the bodies of functions with noalias arguments,
+  // often prove such pairs disjoint. They need no runtime check.
+  if (CanDoRT) {
+    AliasAnalysis &AA = AST.getAliasAnalysis();
+    unsigned NumChecks = 0, NumPruned = 0;
+    unsigned NumPointers = RtCheck.Pointers.size();
+    for (unsigned i = 0; i < NumPointers; ++i) {
+      const AAMDNodes &TagsI = RtCheck.AATags[i];
+      for (unsigned j = i + 1; j < NumPointers; ++j) {
+        if (!RtCheck.needsChecking(i, j))
+          continue;
+
+        const AAMDNodes &TagsJ = RtCheck.AATags[j];
+        if ((TagsI.Scope || TagsI.NoAlias) && (TagsJ.Scope || TagsJ.NoAlias) &&
+            AA.alias(AliasAnalysis::Location(RtCheck.Pointers[i],
+                                             AliasAnalysis::UnknownSize,
+                                             TagsI),
+                     AliasAnalysis::Location(RtCheck.Pointers[j],
+                                             AliasAnalysis::UnknownSize,
+                                             TagsJ)) ==
+                AliasAnalysis::NoAlias) {
+          RtCheck.ScopedNoAlias.insert(std::make_pair(i, j));
+          ++NumPruned;
+        } else
+          ++NumChecks;
+      }
+    }
+
+    if (NumPruned) {
+      DEBUG(dbgs() << "LV: Alias scopes removed " << NumPruned
+                   << " runtime checks\n");
+      RtCheck.NeedsScopes = NumComparisons > RuntimeMemoryCheckThreshold &&
+                            NumChecks <= RuntimeMemoryCheckThreshold;
+      NumComparisons = NumChecks;
+    }
+  }
+
   // If the pointers that we would use for the bounds comparison have different
   // address spaces, assume the values aren't directly comparable, so we can't
   // use them for the runtime check. We also have to assume they could
@@ -2896,6 +2896,10 @@ struct SLPVectorizer : public FunctionPass {
   DominatorTree *DT;
   AssumptionCache *AC;
 
+  FunctionPass *createConcurrentInstance() const override {
+    return new SLPVectorizer();
+  }
+
   bool runOnFunction(Function &F) override {
     if (skipOptnoneFunction(F))
       return false;
@@ -0,0 +1,23 @@
+; RUN: opt -basicaa -tbaa -print-alias-sets -stats -disable-output < %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Alias analysis is asked once whether int and float accesses may alias. The
+; other pointer pairs with those tags are kept apart without querying it.
+
+; CHECK: Alias Set Tracker: 2 alias sets for 4 pointer values.
+; CHECK: may alias, Mod Pointers: (i32* %a, 4), (i32* %c, 4)
+; CHECK: may alias, Mod Pointers: (float* %b, 4), (float* %d, 4)
+; CHECK: 4 alias-sets - Number of queries answered by disjoint AAInfo
+define void @tags(i32* %a, float* %b, i32* %c, float* %d) {
+  store i32 1, i32* %a, !tbaa !1
+  store float 1.0, float* %b, !tbaa !2
+  store i32 2, i32* %c, !tbaa !1
+  store float 2.0, float* %d, !tbaa !2
+  ret void
+}
+
+!0 = !{!"root"}
+!1 = !{!"int", !0}
+!2 = !{!"float", !0}
@@ -0,0 +1,27 @@
+; RUN: opt -basicaa -print-alias-sets -alias-set-saturation-threshold=2 -S -o - < %s 2>&1 | FileCheck %s --check-prefix=LIMIT
+; RUN: opt -basicaa -print-alias-sets -S -o - < %s 2>&1 | FileCheck %s --check-prefix=NOLIMIT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The arguments may alias each other, the allocas are known apart from
+; everything else. Once the may-alias set holds more pointers than the
+; threshold, the tracker puts everything in a single may-alias set.
+
+; LIMIT-LABEL: Alias Set Tracker: 4 alias sets for 5 pointer values.
+; LIMIT-NOT: Pointers:
+; LIMIT: may alias, Mod/Ref [volatile] Pointers: (i32* %x, 4), (i32* %y, 4), (i32* %a, 4), (i32* %b, 4), (i32* %c, 4)
+
+; NOLIMIT-LABEL: Alias Set Tracker: 3 alias sets for 5 pointer values.
+; NOLIMIT: must alias, Mod [volatile] Pointers: (i32* %x, 4)
+; NOLIMIT: must alias, Ref [volatile] Pointers: (i32* %y, 4)
+; NOLIMIT: may alias, Mod Pointers: (i32* %a, 4), (i32* %b, 4), (i32* %c, 4)
+define i32 @saturate(i32* %a, i32* %b, i32* %c) {
+  %x = alloca i32
+  %y = alloca i32
+  store volatile i32 0, i32* %x
+  %v = load volatile i32* %y
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  store i32 3, i32* %c
+  ret i32 %v
+}
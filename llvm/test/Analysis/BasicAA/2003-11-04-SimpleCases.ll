@@ -2,6 +2,7 @@
 ; resolvable by basicaa.
 
 ; RUN: opt < %s -basicaa -aa-eval -print-may-aliases -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -aa-eval -evaluate-aa-batch -print-may-aliases -disable-output 2>&1 | FileCheck %s
 
 %T = type { i32, [10 x i8] }
 
@@ -0,0 +1,15 @@
+; RUN: opt < %s -basicaa -basicaa-memo -aa-eval -die -disable-output -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; -die erases %dead without telling alias analysis about it. The memo entries
+; of %dead go with it, rather than lingering for a new value at its address.
+
+; CHECK: 2 basicaa - Number of memo entries dropped for deleted values
+
+define void @f(i32* %p) {
+  %a = alloca i32
+  %dead = getelementptr i32* %p, i32 1
+  store i32 0, i32* %p
+  store i32 1, i32* %a
+  ret void
+}
@@ -0,0 +1,17 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -lazy-load -dematerialize-functions -basicaa -basicaa-memo -aa-eval -disable-output -stats %t.bc 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Releasing the body of @f drops its memo as a whole before its values are
+; deleted, rather than leaving entries for values that were read again.
+
+; CHECK-NOT: dropped for deleted values
+; CHECK: 1 basicaa - Number of function memos invalidated
+; CHECK-NOT: dropped for deleted values
+
+define void @f(i32* %p) {
+  %a = alloca i32
+  store i32 0, i32* %p
+  store i32 1, i32* %a
+  ret void
+}
@@ -0,0 +1,31 @@
+; RUN: opt < %s -basicaa -basicaa-memo -aa-eval -simplifycfg -aa-eval -die -print-no-aliases -disable-output -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; The second -aa-eval is answered by the memo, since -simplifycfg leaves @f
+; alone. -die deletes the dead add, which invalidates the memo of @f.
+
+; CHECK: Function: f: 3 pointers
+; CHECK-DAG: NoAlias: i32* %a, i32* %p
+; CHECK-DAG: NoAlias: i32* %b, i32* %p
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+; CHECK: Function: f: 3 pointers
+; CHECK-DAG: NoAlias: i32* %a, i32* %p
+; CHECK-DAG: NoAlias: i32* %b, i32* %p
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+
+; CHECK: 3 basicaa - Number of alias queries answered by the memo
+; CHECK: 3 basicaa - Number of alias queries missing from the memo
+; CHECK: 1 basicaa - Number of function memos invalidated
+
+define i32 @f(i32* %p, i32 %x) {
+  %a = alloca i32
+  %b = alloca i32
+  store i32 0, i32* %p
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  %dead = add i32 %x, 1
+  %l = load i32* %a
+  %m = load i32* %b
+  %s = add i32 %l, %m
+  ret i32 %s
+}
@@ -4,6 +4,7 @@
 ; aliasing sets should of args+alloca+global should be combined)
 
 ; RUN: opt < %s -cfl-aa -aa-eval -print-may-aliases -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -cfl-aa -aa-eval -evaluate-aa-batch -print-may-aliases -disable-output 2>&1 | FileCheck %s
 
 ; CHECK:     Function: test
 
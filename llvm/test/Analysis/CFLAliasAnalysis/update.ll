@@ -0,0 +1,31 @@
+; This testcase ensures that CFL AA updates the sets of a function modified
+; by a pass, instead of answering from stale sets.
+
+; RUN: opt < %s -cfl-aa -aa-eval -instcombine -aa-eval -print-no-aliases -disable-output -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; -instcombine folds %a1 into a new getelementptr of %a, which the first sets
+; know nothing about, and changes the pointer operands of its users in place.
+
+; CHECK: Function: test: 5 pointers
+; CHECK: NoAlias: i32* %a1, i32* %b0
+; CHECK: Function: test: 4 pointers
+; CHECK: NoAlias: i32* %a1, i32* %b0
+
+; CHECK: 1 cfl-aa - Number of functions updated incrementally
+; CHECK: 3 cfl-aa - Number of instructions added by updates
+
+define i32 @test() {
+  %a = alloca [4 x i32], align 4
+  %b = alloca [4 x i32], align 4
+  %a0 = getelementptr [4 x i32]* %a, i64 0, i64 1
+  %a1 = getelementptr i32* %a0, i64 1
+  %b0 = getelementptr [4 x i32]* %b, i64 0, i64 1
+  store i32 0, i32* %a1
+  store volatile i32 1, i32* %b0
+  br label %next
+
+next:
+  %x = load i32* %a1
+  ret i32 %x
+}
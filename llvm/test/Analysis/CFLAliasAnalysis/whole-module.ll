@@ -0,0 +1,93 @@
+; This testcase ensures that calls to functions defined in the module are
+; handled through summaries of their parameter/return flows, and that
+; -cfl-aa-whole-module extends this to externally visible definitions.
+
+; RUN: opt < %s -cfl-aa -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s --check-prefix=LOCAL
+; RUN: opt < %s -cfl-aa -cfl-aa-whole-module -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s --check-prefix=MODULE
+
+@G = global i32* null
+
+define void @init(i32* %p, i32* %q) {
+  store i32 0, i32* %p
+  store i32 0, i32* %q
+  ret void
+}
+
+define internal void @init.local(i32* %p, i32* %q) {
+  store i32 0, i32* %p
+  store i32 0, i32* %q
+  ret void
+}
+
+define weak void @init.weak(i32* %p, i32* %q) {
+  store i32 0, i32* %p
+  store i32 0, i32* %q
+  ret void
+}
+
+define i32* @pick(i32* %p, i32* %q) {
+  ret i32* %q
+}
+
+define void @escape(i32* %p, i32* %q) {
+  store i32* %p, i32** @G
+  ret void
+}
+
+; LOCAL-LABEL: Function: test_init
+; LOCAL: PartialAlias: i32* %a, i32* %b
+; MODULE-LABEL: Function: test_init
+; MODULE: NoAlias: i32* %a, i32* %b
+define void @test_init() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  call void @init(i32* %a, i32* %b)
+  ret void
+}
+
+; LOCAL-LABEL: Function: test_init_local
+; LOCAL: NoAlias: i32* %a, i32* %b
+; MODULE-LABEL: Function: test_init_local
+; MODULE: NoAlias: i32* %a, i32* %b
+define void @test_init_local() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  call void @init.local(i32* %a, i32* %b)
+  ret void
+}
+
+; The definition of a weak function may be replaced at link time.
+; MODULE-LABEL: Function: test_init_weak
+; MODULE: PartialAlias: i32* %a, i32* %b
+define void @test_init_weak() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  call void @init.weak(i32* %a, i32* %b)
+  ret void
+}
+
+; MODULE-LABEL: Function: test_pick
+; MODULE-DAG: NoAlias: i32* %a, i32* %b
+; MODULE-DAG: NoAlias: i32* %a, i32* %r
+; MODULE-DAG: PartialAlias: i32* %b, i32* %r
+define void @test_pick() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %r = call i32* @pick(i32* %a, i32* %b)
+  store i32 0, i32* %r
+  ret void
+}
+
+; %a escapes to @G through @escape, so it may be what %l loads.
+; MODULE-LABEL: Function: test_escape
+; MODULE-DAG: NoAlias: i32* %a, i32* %b
+; MODULE-DAG: MayAlias: i32* %a, i32* %l
+; MODULE-DAG: NoAlias: i32* %b, i32* %l
+define void @test_escape() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  call void @escape(i32* %a, i32* %b)
+  %l = load i32** @G
+  store i32 0, i32* %l
+  ret void
+}
@@ -0,0 +1,48 @@
+; RUN: opt < %s -basicaa -memoryssa -analyze -verify-memoryssa | FileCheck %s
+
+; Stores define new versions of memory, loads use the current one.
+
+define i32 @straight(i32* %p, i32* %q) {
+entry:
+  store i32 1, i32* %p
+  %a = load i32* %q
+  store i32 2, i32* %q
+  %b = load i32* %p
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+; CHECK-LABEL: MemorySSA for function: straight
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %p
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: %a = load i32* %q
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 2, i32* %q
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: %b = load i32* %p
+; CHECK-NOT: {{Memory(Use|Def|Phi)}}
+
+; Calls are classified by what they may do to memory.
+
+declare i32 @readnone(i32) readnone
+declare i32 @readonly(i32*) readonly
+declare void @unknown(i32*)
+
+define i32 @calls(i32* %p) {
+entry:
+  %a = call i32 @readnone(i32 0)
+  %b = call i32 @readonly(i32* %p)
+  call void @unknown(i32* %p)
+  %c = load i32* %p
+  %r = add i32 %b, %c
+  ret i32 %r
+}
+; CHECK-LABEL: MemorySSA for function: calls
+; CHECK-NOT: {{Memory(Use|Def|Phi)}}
+; CHECK: %a = call i32 @readnone(i32 0)
+; CHECK: ; MemoryUse(liveOnEntry)
+; CHECK-NEXT: %b = call i32 @readonly(i32* %p)
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: call void @unknown(i32* %p)
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: %c = load i32* %p
@@ -0,0 +1,60 @@
+; RUN: opt < %s -basicaa -memoryssa -analyze -verify-memoryssa | FileCheck %s
+
+; Where stores on different paths meet, a MemoryPhi merges them.
+
+define i32 @diamond(i32* %p, i1 %c) {
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %p
+  br label %join
+
+else:
+  store i32 2, i32* %p
+  br label %join
+
+join:
+  %v = load i32* %p
+  ret i32 %v
+}
+; CHECK-LABEL: MemorySSA for function: diamond
+; CHECK: then:
+; CHECK-NEXT: ; 1 = MemoryDef(liveOnEntry)
+; CHECK: else:
+; CHECK-NEXT: ; 2 = MemoryDef(liveOnEntry)
+; CHECK: join:
+; CHECK-NEXT: ; 3 = MemoryPhi({else,2},{then,1})
+; CHECK-NEXT: ; MemoryUse(3)
+; CHECK-NEXT: %v = load i32* %p
+
+; A store in a loop needs a MemoryPhi at the loop header, and at the exit
+; reached both from inside and around the loop.
+
+define void @loop(i32* %p, i32 %n, i1 %c) {
+entry:
+  br i1 %c, label %header, label %exit
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %header ]
+  %v = load i32* %p
+  store i32 %i, i32* %p
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  %w = load i32* %p
+  ret void
+}
+; CHECK-LABEL: MemorySSA for function: loop
+; CHECK: header:
+; CHECK-NEXT: ; 1 = MemoryPhi({header,2},{entry,liveOnEntry})
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: %v = load i32* %p
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 %i, i32* %p
+; CHECK: exit:
+; CHECK-NEXT: ; 3 = MemoryPhi({header,2},{entry,liveOnEntry})
+; CHECK-NEXT: ; MemoryUse(3)
+; CHECK-NEXT: %w = load i32* %p
@@ -0,0 +1,36 @@
+; RUN: opt -basicaa -profile-aa -aa-eval -disable-output < %s 2>&1 | FileCheck %s
+; RUN: opt -basicaa -tbaa -profile-aa -profile-aa-output=%t -aa-eval -disable-output < %s
+; RUN: FileCheck %s --check-prefix=CHAIN < %t
+
+; The arguments may alias each other, the allocas are known apart from
+; everything else: BasicAA settles five of the six queries of -aa-eval and
+; passes the last one on to the end of the chain.
+
+; CHECK:      "clients": [
+; CHECK-NEXT:   {
+; CHECK-NEXT:     "pass": "aa-eval",
+; CHECK-NEXT:     "queries": 6,
+; CHECK-NEXT:     "seconds": {{[0-9.]+}},
+; CHECK-NEXT:     "results": {"NoAlias": 5, "MayAlias": 1, "PartialAlias": 0, "MustAlias": 0},
+; CHECK-NEXT:     "implementations": [
+; CHECK-NEXT:       {"name": "basicaa", "queries": 6, "decisive": 5, "seconds": {{[0-9.]+}}},
+; CHECK-NEXT:       {"name": "no-aa", "queries": 1, "decisive": 0, "seconds": {{[0-9.]+}}}
+; CHECK-NEXT:     ]
+; CHECK-NEXT:   }
+; CHECK-NEXT: ]
+
+; CHAIN:      "pass": "aa-eval",
+; CHAIN:      "queries": 6,
+; CHAIN:      {"name": "basicaa", "queries": 6, "decisive": 5,
+; CHAIN-NEXT: {"name": "no-aa", "queries": 1, "decisive": 0,
+; CHAIN-NEXT: {"name": "tbaa", "queries": 6, "decisive": 0,
+
+define void @f(i32* %a, i32* %b) {
+  %x = alloca i32
+  %y = alloca i32
+  store i32 0, i32* %a
+  store i32 0, i32* %b
+  store i32 0, i32* %x
+  store i32 0, i32* %y
+  ret void
+}
@@ -0,0 +1,65 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -S %t.bc > %t.serial
+; RUN: opt -bitcode-reader-threads=3 -S %t.bc > %t.threads
+; RUN: diff %t.serial %t.threads
+; RUN: FileCheck %s < %t.threads
+; RUN: verify-uselistorder -bitcode-reader-threads=3 < %s -preserve-bc-use-list-order -num-shuffles=5
+
+; Function bodies read ahead on other threads come out as when they are read
+; one at a time, function-local constants, metadata and names included.
+
+@g = global i32 0
+@addr = global i8* blockaddress(@late, %target)
+
+declare void @llvm.dbg.value(metadata, i64, metadata, metadata)
+
+; CHECK-LABEL: define i32 @constants(
+; CHECK: store i32 add (i32 ptrtoint (i32* @g to i32), i32 7), i32* @g
+; CHECK: fadd <2 x double> %v, <double 1.000000e+00, double 2.000000e+00>
+define i32 @constants(<2 x double> %v) {
+entry:
+  store i32 add (i32 ptrtoint (i32* @g to i32), i32 7), i32* @g
+  %w = fadd <2 x double> %v, <double 1.0, double 2.0>
+  %e = extractelement <2 x double> %w, i32 1
+  %r = fptosi double %e to i32
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i8* @early(
+; CHECK: ret i8* blockaddress(@late, %target)
+define i8* @early() {
+  ret i8* blockaddress(@late, %target)
+}
+
+; CHECK-LABEL: define i32 @metadata(
+; CHECK: call void @llvm.dbg.value(metadata i32 %x, i64 0, metadata !{{[0-9]+}}, metadata !{{[0-9]+}})
+; CHECK: %y = add i32 %x, 1, !attached !{{[0-9]+}}
+define i32 @metadata(i32 %x) {
+  call void @llvm.dbg.value(metadata i32 %x, i64 0, metadata !0, metadata !1)
+  %y = add i32 %x, 1, !attached !2
+  ret i32 %y
+}
+
+; CHECK-LABEL: define i32 @late(
+; CHECK: switch i32 %n, label %target [
+; CHECK: %p = phi i32 [ 0, %entry ], [ 1, %other ]
+define i32 @late(i32 %n) {
+entry:
+  switch i32 %n, label %target [
+    i32 1, label %other
+  ]
+
+other:
+  br label %target
+
+target:
+  %p = phi i32 [ 0, %entry ], [ 1, %other ]
+  ret i32 %p
+}
+
+!llvm.module.flags = !{!3}
+
+!0 = !{!"variable"}
+!1 = !{!"0x102"}
+!2 = !{i32 42}
+!3 = !{i32 2, !"Debug Info Version", i32 2}
@@ -0,0 +1,69 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -codegen-threads=2 -o %t %s
+; RUN: FileCheck --check-prefix=PART0 %s < %t.0
+; RUN: FileCheck --check-prefix=PART1 %s < %t.1
+
+; The module is split in two parts.  @helper stays local to its caller, while
+; @counter, which both parts use, is made hidden and renamed.  Constructors,
+; aliases and the other definitions appear exactly once.
+
+; PART0: {{^}}helper:
+; PART0-NOT: .globl helper
+; PART0: {{^}}big:
+; PART0: movl counter.llvmsplit.[[HASH:[0-9a-f]+]](%rip)
+; PART0: callq helper
+; PART0: .hidden counter.llvmsplit.[[HASH]]
+; PART0: big_alias = big
+; PART0-NOT: {{^}}init:
+; PART0-NOT: {{^}}small:
+; PART0-NOT: init_array
+
+; PART1: {{^}}init:
+; PART1: {{^}}small:
+; PART1: {{^}}user:
+; PART1: callq big_alias
+; PART1: .globl counter.llvmsplit.[[HASH:[0-9a-f]+]]
+; PART1: {{^}}counter.llvmsplit.[[HASH]]:
+; PART1: {{^}}table:
+; PART1: .init_array
+; PART1: .quad init
+; PART1-NOT: {{^}}big:
+
+@counter = internal global i32 0
+@table = global [2 x i32] [i32 1, i32 2]
+@.str = private unnamed_addr constant [4 x i8] c"abc\00"
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init, i8* null }]
+
+@big_alias = alias i32 (i32)* @big
+
+define internal void @init() {
+  store i32 7, i32* @counter
+  ret void
+}
+
+define internal i32 @helper(i32 %x) {
+  %y = mul i32 %x, %x
+  %z = add i32 %y, 1
+  ret i32 %z
+}
+
+define i32 @big(i32 %a) {
+  %c = load i32* @counter
+  %b = add i32 %a, %c
+  %d = call i32 @helper(i32 %b)
+  %e = mul i32 %d, 3
+  %f = sub i32 %e, %a
+  %g = xor i32 %f, %d
+  %h = add i32 %g, %e
+  ret i32 %h
+}
+
+define i8* @small() {
+  %v = load i32* getelementptr ([2 x i32]* @table, i32 0, i32 1)
+  store i32 %v, i32* @counter
+  ret i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0)
+}
+
+define i32 @user() {
+  %r = call i32 @big_alias(i32 2)
+  ret i32 %r
+}
@@ -0,0 +1,52 @@
+;; Check that argument overlap counts are attached to the calls they were
+;; gathered at, that stale profiles are ignored, and that local functions are
+;; only given the profile recorded under their module.
+
+; RUN: llvm-profdata merge %S/Inputs/arg-overlap.proftext -o %t.profdata
+; RUN: opt < %s -arg-overlap-profile-use -arg-overlap-profile=%t.profdata -S \
+; RUN:   | FileCheck %s
+
+define void @copy(i32* %d, i32* %s) {
+  %v = load i32* %s
+  store i32 %v, i32* %d
+  ret void
+}
+
+declare void @external(i32*, i32*)
+
+define void @single(i32* %p, i64 %n) {
+  ret void
+}
+
+; CHECK-LABEL: define void @caller(
+; CHECK: call void @copy(i32* %a, i32* %b), !arg.overlap [[FIRST:![0-9]+]]
+; CHECK: call void @external(i32* %a, i32* %b){{$}}
+; CHECK: call void @single(i32* %a, i64 0){{$}}
+; CHECK: call void @copy(i32* %b, i32* %a), !arg.overlap [[SECOND:![0-9]+]]
+define void @caller(i32* %a, i32* %b) {
+  call void @copy(i32* %a, i32* %b)
+  call void @external(i32* %a, i32* %b)
+  call void @single(i32* %a, i64 0)
+  call void @copy(i32* %b, i32* %a)
+  ret void
+}
+
+;; The profile was gathered when @stale made three calls.
+; CHECK-LABEL: define void @stale(
+; CHECK: call void @copy(i32* %a, i32* %b){{$}}
+define void @stale(i32* %a, i32* %b) {
+  call void @copy(i32* %a, i32* %b)
+  ret void
+}
+
+;; The profile has records for a @local of "<stdin>" and of another module.
+; CHECK-LABEL: define internal void @local(
+; CHECK: call void @copy(i32* %a, i32* %b), !arg.overlap [[LOCAL:![0-9]+]]
+define internal void @local(i32* %a, i32* %b) {
+  call void @copy(i32* %a, i32* %b)
+  ret void
+}
+
+; CHECK-DAG: [[FIRST]] = !{i64 100, i64 3}
+; CHECK-DAG: [[SECOND]] = !{i64 40, i64 40}
+; CHECK-DAG: [[LOCAL]] = !{i64 7, i64 1}
@@ -0,0 +1,32 @@
+; RUN: llvm-as < %s >%t1
+; RUN: llvm-lto -j2 -o %t2 -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -disable-opt %t1
+; RUN: llvm-nm %t2.0 | FileCheck --check-prefix=PART0 %s
+; RUN: llvm-nm %t2.1 | FileCheck --check-prefix=PART1 %s
+
+; Each part defines one of the exported functions and refers to the other
+; one's definitions through hidden symbols.
+
+; PART0-DAG: T foo
+; PART0-DAG: U shared.llvmsplit.{{[0-9a-f]+}}
+
+; PART1-DAG: T bar
+; PART1-DAG: B shared.llvmsplit.{{[0-9a-f]+}}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@shared = global i32 0
+
+define i32 @foo(i32 %a) {
+  %s = load i32* @shared
+  %b = mul i32 %a, %s
+  %c = add i32 %b, 7
+  %d = mul i32 %c, %c
+  ret i32 %d
+}
+
+define void @bar(i32 %a) {
+  store i32 %a, i32* @shared
+  ret void
+}
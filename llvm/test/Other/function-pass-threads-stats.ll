@@ -0,0 +1,21 @@
+; RUN: opt < %s -O2 -function-pass-threads=2 -stats -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -O2 -stats -disable-output 2>&1 | FileCheck %s --check-prefix=SERIAL
+; RUN: opt < %s -early-cse -function-pass-threads=2 -stats -disable-output 2>&1 | FileCheck %s --check-prefix=SERIAL
+; REQUIRES: asserts
+
+; Each of the three function pass managers of -O2 outside the call graph pass
+; manager runs the two functions concurrently.  Without threads, or with a
+; pass that has no concurrent instance, nothing does.
+
+; CHECK: 6 ir - Number of functions run on by concurrent function passes
+; SERIAL-NOT: concurrent function passes
+
+define i32 @f(i32 %a) {
+  %x = add i32 %a, 0
+  ret i32 %x
+}
+
+define i32 @g(i32 %a) {
+  %x = mul i32 %a, 1
+  ret i32 %x
+}
@@ -0,0 +1,101 @@
+; RUN: opt < %s -O2 -S > %t.serial
+; RUN: opt < %s -O2 -function-pass-threads=4 -S > %t.threads
+; RUN: diff %t.serial %t.threads
+; RUN: opt < %s -O2 -function-pass-threads=4 -time-passes -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -early-cse -instcombine -S > %t.serial
+; RUN: opt < %s -early-cse -instcombine -function-pass-threads=4 -S > %t.threads
+; RUN: diff %t.serial %t.threads
+
+; The function pass managers of -O2 outside the call graph pass manager run on
+; several functions at once, and leave them as a serial run would.  Their
+; passes' times are still accounted to their timers.  Passes without a
+; concurrent instance keep the manager serial.
+
+; CHECK-DAG: Loop Vectorization
+; CHECK-DAG: SLP Vectorizer
+; CHECK-DAG: Unroll loops
+; CHECK-DAG: Combine redundant instructions
+; CHECK-DAG: Module Verifier
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @saxpy(float* noalias %x, float* noalias %y, float %a, i64 %n) {
+entry:
+  %empty = icmp eq i64 %n, 0
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float* %x, i64 %i
+  %py = getelementptr inbounds float* %y, i64 %i
+  %vx = load float* %px, align 4
+  %vy = load float* %py, align 4
+  %mul = fmul float %vx, %a
+  %add = fadd float %mul, %vy
+  store float %add, float* %py, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @sum4(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %pi = getelementptr inbounds i32* %p, i64 %i
+  %v = load i32* %pi, align 4
+  %s.next = add i32 %s, %v
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 4
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
+
+define void @pairs(i64* noalias %a, i64* noalias %b) {
+  %a1 = getelementptr inbounds i64* %a, i64 1
+  %b1 = getelementptr inbounds i64* %b, i64 1
+  %x0 = load i64* %a, align 8
+  %x1 = load i64* %a1, align 8
+  %y0 = mul i64 %x0, 3
+  %y1 = mul i64 %x1, 3
+  store i64 %y0, i64* %b, align 8
+  store i64 %y1, i64* %b1, align 8
+  ret void
+}
+
+define i32 @diamond(i1 %c, i32 %a, i32 %b) {
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %t = add i32 %a, 0
+  br label %join
+
+else:
+  %e = xor i32 %b, 0
+  br label %join
+
+join:
+  %r = phi i32 [ %t, %then ], [ %e, %else ]
+  %m = mul i32 %r, 8
+  ret i32 %m
+}
+
+define i32 @straight(i32 %a) {
+  %x = mul i32 %a, %a
+  %y = add i32 %x, 3
+  %z = sub i32 %y, 3
+  ret i32 %z
+}
+
+define void @empty() {
+  ret void
+}
@@ -0,0 +1,52 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -instcombine -S %t.bc > %t.ref
+; RUN: opt -lazy-load -dematerialize-functions -instcombine -S %t.bc > %t.lazy
+; RUN: diff %t.ref %t.lazy
+; RUN: opt -lazy-load -dematerialize-functions -instcombine -function-pass-threads=2 -S %t.bc > %t.lazy
+; RUN: diff %t.ref %t.lazy
+; RUN: opt -lazy-load -dematerialize-functions -instcombine -globaldce -instcombine -S %t.bc | FileCheck %s --check-prefix=DCE
+; RUN: opt -lazy-load -dematerialize-functions -verify -function-pass-threads=2 -disable-output %t.bc
+; RUN: opt -lazy-load -dematerialize-functions -domtree -verify -verify-debug-info -disable-output %t.bc
+; RUN: FileCheck %s < %t.lazy
+
+; Function bodies are read from the bitcode as the function passes get to
+; them, and those that the passes leave alone are released again.  Passes
+; that need the whole module read it in.
+
+@fp = global i32 (i32)* @unused
+
+; CHECK-LABEL: define i32 @simplified(
+; CHECK-NEXT: ret i32 %a
+define i32 @simplified(i32 %a) {
+  %x = add i32 %a, 0
+  ret i32 %x
+}
+
+; CHECK-LABEL: define i32 @unchanged(
+; CHECK-NEXT: %x = mul i32 %a, %a
+define i32 @unchanged(i32 %a) {
+  %x = mul i32 %a, %a
+  ret i32 %x
+}
+
+; DCE-NOT: define internal i32 @dead(
+; DCE: define i32 @unused(
+define internal i32 @dead(i32 %a) {
+  %x = call i32 @unchanged(i32 %a)
+  ret i32 %x
+}
+
+; CHECK-LABEL: define i32 @unused(
+define i32 @unused(i32 %a) {
+  %x = sub i32 %a, 1
+  ret i32 %x
+}
+
+; CHECK-LABEL: define i8* @addressed(
+; CHECK: blockaddress(@addressed, %target)
+define i8* @addressed() {
+  br label %target
+
+target:
+  ret i8* blockaddress(@addressed, %target)
+}
@@ -0,0 +1,48 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@counter = external global i32
+
+define linkonce_odr void @copy(i32* %to, i32* %from, i64 %len) {
+entry:
+  br label %body
+
+body:
+  %idx = phi i64 [ 0, %entry ], [ %idx.next, %body ]
+  %from.addr = getelementptr inbounds i32* %from, i64 %idx
+  %val = load i32* %from.addr
+  %to.addr = getelementptr inbounds i32* %to, i64 %idx
+  store i32 %val, i32* %to.addr
+  store i32 %val, i32* @counter
+  %idx.next = add nsw i64 %idx, 1
+  %end = icmp eq i64 %idx.next, %len
+  br i1 %end, label %done, label %body
+
+done:
+  ret void
+}
+
+define internal void @scopy(i32* %to, i32* %from, i64 %len) {
+entry:
+  br label %body
+
+body:
+  %idx = phi i64 [ 0, %entry ], [ %idx.next, %body ]
+  %from.addr = getelementptr inbounds i32* %from, i64 %idx
+  %val = load i32* %from.addr
+  %to.addr = getelementptr inbounds i32* %to, i64 %idx
+  store i32 %val, i32* %to.addr
+  %idx.next = add nsw i64 %idx, 1
+  %end = icmp eq i64 %idx.next, %len
+  br i1 %end, label %done, label %body
+
+done:
+  ret void
+}
+
+define void @other_caller(i64 %n) {
+  %x = alloca i32, i64 32
+  %y = alloca i32, i64 32
+  call void @copy(i32* %x, i32* %y, i64 %n)
+  call void @scopy(i32* %y, i32* %x, i64 %n)
+  ret void
+}
@@ -0,0 +1,39 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: loadable_module, asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Both call sites pass pointers into the same two allocas, so only the first
+; one reaches alias analysis.
+; CHECK: 2 afc - Number of CallInsts statically replaced by a clone
+; CHECK: 1 afc - Number of alias queries answered by the cache
+; CHECK: 1 afc - Number of alias queries missing the cache
+
+define void @copy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller(i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  call void @copy(i32* %a, i32* %b, i64 %n)
+  %a.hi = getelementptr inbounds i32* %a, i64 32
+  %b.hi = getelementptr inbounds i32* %b, i64 32
+  call void @copy(i32* %b.hi, i32* %a.hi, i64 %n)
+  ret void
+}
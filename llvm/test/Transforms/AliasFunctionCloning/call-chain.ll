@@ -0,0 +1,47 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S | FileCheck %s
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; @wrapper does no memory accesses itself, but cloning it lets the call to
+; @kernel in its clone be restrictified too.
+; CHECK-LABEL: define void @kernel_noalias(
+; CHECK-LABEL: define void @wrapper_noalias(
+; CHECK: call void @kernel_noalias(i32* %dst, i32* %src, i64 %n)
+; CHECK-LABEL: define void @wrapper(
+; CHECK: call void @kernel(i32* %dst, i32* %src, i64 %n)
+; CHECK-LABEL: define void @top(
+; CHECK: call void @wrapper_noalias(i32* %a, i32* %b, i64 %n)
+; CHECK: call void @wrapper(i32* %p, i32* %p, i64 %n)
+
+define void @kernel(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @wrapper(i32* %dst, i32* %src, i64 %n) {
+  call void @kernel(i32* %dst, i32* %src, i64 %n)
+  ret void
+}
+
+define void @top(i32* %p, i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  call void @wrapper(i32* %a, i32* %b, i64 %n)
+  call void @wrapper(i32* %p, i32* %p, i64 %n)
+  ret void
+}
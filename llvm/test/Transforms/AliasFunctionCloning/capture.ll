@@ -0,0 +1,75 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S | FileCheck %s
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@g = global i32* null
+@h = global i32* null
+
+; Pointers loaded from globals may only alias an argument after the argument
+; has been captured, i.e. when a capture point can execute before them.
+; CHECK-LABEL: define void @copy_noalias(i32* noalias %dst, i32* noalias %src, i64 %n)
+; CHECK: %w = load i32* %q, !noalias [[BOTH:![0-9]+]]
+; CHECK: store i32* %dst, i32** @g
+; CHECK: store i32 0, i32* %r, !noalias [[SRC:![0-9]+]]
+; CHECK-LABEL: define void @copy(
+
+; A capture inside a loop reaches every access of the loop, including
+; itself on the next iteration.
+; CHECK-LABEL: define void @leak_noalias(i32* noalias %dst, i32* noalias %src, i64 %n)
+; CHECK: %w = load i32* %q, !noalias [[SRC2:![0-9]+]]
+; CHECK: store i32* %dst, i32** @h, !noalias [[SRC2]]
+; CHECK-LABEL: define void @leak(
+
+define void @copy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %q = load i32** @g
+  %w = load i32* %q
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  store i32* %dst, i32** @g
+  %r = load i32** @g
+  store i32 0, i32* %r
+  ret void
+}
+
+define void @leak(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %q = load i32** @h
+  %w = load i32* %q
+  store i32* %dst, i32** @h
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller(i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  call void @copy(i32* %a, i32* %b, i64 %n)
+  call void @leak(i32* %a, i32* %b, i64 %n)
+  ret void
+}
@@ -0,0 +1,66 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -S | FileCheck %s
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The accessed extents of %x and %y are [0, 4 * %n), so calls that may pass
+; overlapping buffers are guarded by a runtime range check.
+define void @axpy(float* %x, float* %y, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float* %x, i64 %i
+  %vx = load float* %px
+  %py = getelementptr inbounds float* %y, i64 %i
+  %vy = load float* %py
+  %s = fadd float %vx, %vy
+  store float %s, float* %py
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define void @guarded(
+; CHECK: %afc.disjoint = or i1
+; CHECK: br i1 %afc.disjoint
+; CHECK: call void @axpy_noalias(float* %a, float* %b, i64 %n)
+; CHECK: call void @axpy(float* %a, float* %b, i64 %n)
+define void @guarded(float* %a, float* %b, i64 %n) {
+  call void @axpy(float* %a, float* %b, i64 %n)
+  ret void
+}
+
+; Distinct allocas are handled statically and need no check.
+; CHECK-LABEL: define void @static(
+; CHECK-NOT: afc.disjoint
+; CHECK: call void @axpy_noalias(
+define void @static(i64 %n) {
+  %a = alloca float, i64 16
+  %b = alloca float, i64 16
+  call void @axpy(float* %a, float* %b, i64 %n)
+  ret void
+}
+
+declare void @use(i32*)
+
+; %p is handed to an unknown function, so its extent cannot be bounded.
+define void @escapes(i32* %p, i32* %q) {
+  call void @use(i32* %p)
+  store i32 0, i32* %q
+  ret void
+}
+
+; CHECK-LABEL: define void @unguarded(
+; CHECK-NOT: afc.disjoint
+; CHECK: call void @escapes(
+define void @unguarded(i32* %a, i32* %b) {
+  call void @escapes(i32* %a, i32* %b)
+  ret void
+}
@@ -0,0 +1,108 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -o %t1.bc
+; RUN: opt < %p/Inputs/mergeable-clones.ll \
+; RUN:   -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa -afc \
+; RUN:   -o %t2.bc
+; RUN: llvm-link %t1.bc %t2.bc -S | FileCheck %s --check-prefix=LINK
+; RUN: opt %t1.bc -load=%llvmshlibdir/AliasFunctionCloning%shlibext \
+; RUN:   -basicaa -afc -S | FileCheck %s --check-prefix=AGAIN
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@counter = global i32 0
+@local = internal global i32 0
+
+; Clones of functions that other modules may define too are named after
+; their contents, so the copies made for each module merge when linked.
+; Clones of local functions are named the same way but stay local.
+; CHECK: define linkonce_odr void @copy_noalias.[[COPY:[0-9a-f]+]](i32* noalias %dst, i32* noalias %src, i64 %n) unnamed_addr
+; CHECK: define internal void @scopy_noalias.[[SCOPY:[0-9a-f]+]](i32* noalias %dst, i32* noalias %src, i64 %n) {
+; CHECK: define internal void @lcopy_noalias(i32* noalias %dst, i32* noalias %src, i64 %n) {
+; CHECK: call void @copy_noalias.[[COPY]](
+; CHECK: call void @scopy_noalias.[[SCOPY]](
+; CHECK: call void @lcopy_noalias(
+
+; The other module has the same functions under other value names.
+; LINK-NOT: define {{.*}}_noalias.
+; LINK: define linkonce_odr void @copy_noalias.{{[0-9a-f]+}}(
+; LINK: define internal void @scopy_noalias.{{[0-9a-f]+}}(
+; LINK-NOT: define {{.*}}_noalias.
+; LINK: define void @other_caller(
+; LINK-NOT: define linkonce_odr {{.*}}_noalias.
+; LINK: define internal void @scopy_noalias.{{[0-9a-f]+}}(
+; LINK-NOT: define {{.*}}_noalias.
+
+; Restrictifying the module again reuses the clones that are already there.
+; AGAIN: define linkonce_odr void @copy_noalias.{{[0-9a-f]+}}(
+; AGAIN-NOT: define {{.*}}@copy_noalias
+; AGAIN: define internal void @scopy_noalias.{{[0-9a-f]+}}(
+; AGAIN-NOT: define {{.*}}@scopy_noalias
+
+define linkonce_odr void @copy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  store i32 %v, i32* @counter
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define internal void @scopy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Refers to a global of this module, so its clone cannot be shared.
+define internal void @lcopy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  store i32 %v, i32* @local
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller(i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  call void @copy(i32* %a, i32* %b, i64 %n)
+  call void @scopy(i32* %a, i32* %b, i64 %n)
+  call void @lcopy(i32* %a, i32* %b, i64 %n)
+  ret void
+}
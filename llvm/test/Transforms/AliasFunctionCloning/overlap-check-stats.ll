@@ -0,0 +1,38 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-overlap-profile-gen -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=GEN
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: loadable_module, asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The overlap probes of profile generation do not guard the call, so they are
+; not counted as overlap checks.
+; GEN: 1 afc {{.*}} Number of calls instrumented to count argument overlaps
+; GEN-NOT: Number of pointer-overlap checks emitted
+; CHECK: 1 afc {{.*}} Number of pointer-overlap checks emitted
+
+define void @copy(i32* %x, i32* %y, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds i32* %x, i64 %i
+  %v = load i32* %px
+  %py = getelementptr inbounds i32* %y, i64 %i
+  store i32 %v, i32* %py
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @caller(i32* %a, i32* %b, i64 %n) {
+  call void @copy(i32* %a, i32* %b, i64 %n)
+  ret void
+}
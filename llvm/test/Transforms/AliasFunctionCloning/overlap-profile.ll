@@ -0,0 +1,85 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-overlap-profile-gen -S | FileCheck %s --check-prefix=GEN
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-overlap-profile-gen -instrprof -S \
+; RUN:   | FileCheck %s --check-prefix=LOWER
+; RUN: llvm-profdata merge %S/Inputs/overlap-profile.proftext -o %t.profdata
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -arg-overlap-profile-use -arg-overlap-profile=%t.profdata \
+; RUN:   -afc -afc-dynamic -S | FileCheck %s --check-prefix=USE
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+define void @axpy(float* %x, float* %y, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float* %x, i64 %i
+  %vx = load float* %px
+  %py = getelementptr inbounds float* %y, i64 %i
+  %vy = load float* %py
+  %s = fadd float %vx, %vy
+  store float %s, float* %py
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+declare void @use(i32*)
+
+; %p is handed to an unknown function, so its extent cannot be bounded.
+define void @escapes(i32* %p, i32* %q) {
+  call void @use(i32* %p)
+  store i32 0, i32* %q
+  ret void
+}
+
+; Every call counts its runs, and the ones an overlap check can be built for
+; also count the runs in which their arguments overlapped. Nothing is cloned.
+; GEN-NOT: @axpy_noalias
+; GEN-LABEL: define void @calls(
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}@__llvm_profile_name___arg_overlap.calls{{.*}}, i64 4, i32 8, i32 0)
+; GEN: br i1 %afc.overlap
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 1)
+; GEN: call void @axpy(float* %a, float* %b, i64 %n)
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 2)
+; GEN: br i1 %afc.overlap
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 3)
+; GEN: call void @axpy(float* %b, float* %a, i64 %n)
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 4)
+; GEN: br i1 %afc.overlap
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 5)
+; GEN: call void @axpy(float* %b, float* %a, i64 %n)
+; GEN: call void @llvm.instrprof.increment(i8* {{.*}}, i64 4, i32 8, i32 6)
+; GEN-NOT: afc.overlap
+; GEN: call void @escapes(i32* %p, i32* %q)
+; GEN-NOT: i32 7)
+
+; The counters are lowered like the ones of the frontend.
+; LOWER: @__llvm_profile_counters___arg_overlap.calls = private global [8 x i64] zeroinitializer
+; LOWER-NOT: call void @llvm.instrprof.increment
+
+; The first call rarely overlapped, the second often did and the third never
+; ran, so only the first is guarded.
+; USE-LABEL: define void @calls(
+; USE: br i1 %afc.disjoint
+; USE: call void @axpy_noalias(float* %a, float* %b, i64 %n)
+; USE: call void @axpy(float* %a, float* %b, i64 %n)
+; USE-NOT: afc.disjoint
+; USE: call void @axpy(float* %b, float* %a, i64 %n)
+; USE-NOT: afc.disjoint
+; USE: call void @axpy(float* %b, float* %a, i64 %n)
+define void @calls(float* %a, float* %b, i64 %n, i32* %p, i32* %q) {
+  call void @axpy(float* %a, float* %b, i64 %n)
+  call void @axpy(float* %b, float* %a, i64 %n)
+  call void @axpy(float* %b, float* %a, i64 %n)
+  call void @escapes(i32* %p, i32* %q)
+  ret void
+}
@@ -0,0 +1,54 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -disable-output -stats 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; REQUIRES: loadable_module, asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; @main gets @f to make a partial clone, before the call to @g in @f's body
+; is visited.  The call to @g in the clone is then handled once, along with
+; the one in @f, and guarded by a single overlap check.
+
+define void @g(i32* %x, i32* %y, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %py = getelementptr inbounds i32* %y, i64 %i
+  %v = load i32* %py
+  %px = getelementptr inbounds i32* %x, i64 %i
+  store i32 %v, i32* %px
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define void @f_noalias.0(
+; CHECK: br i1 %afc.disjoint
+; CHECK-NOT: afc.disjoint
+; CHECK: call void @g_noalias(i32* %b, i32* %c, i64 %n)
+; CHECK-NOT: call void @g_noalias(
+; CHECK: call void @g(i32* %b, i32* %c, i64 %n)
+; CHECK-NOT: call void @g
+; CHECK: ret void
+define void @f(i32* %a, i32* %b, i32* %c, i64 %n) {
+  store i32 0, i32* %a
+  call void @g(i32* %b, i32* %c, i64 %n)
+  ret void
+}
+
+define void @main(i64 %n) {
+  %p = alloca i32, i64 64
+  %q = alloca i32, i64 64
+  call void @f(i32* %q, i32* %p, i32* %p, i64 %n)
+  ret void
+}
+
+; STATS: 2 afc - Number of CallInsts replaced by a runtime-guarded clone
+; STATS: 4 afc - Number of candidate CallInsts
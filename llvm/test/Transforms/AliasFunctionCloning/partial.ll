@@ -0,0 +1,56 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-max-partial-clones=0 -S | FileCheck %s --check-prefix=NONE
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Only %out is known to be disjoint from the other arguments, so the call
+; goes to a clone that is noalias on %out alone.
+; CHECK: define void @add_noalias.0(i32* noalias %out, i32* %x, i32* %y, i64 %n)
+; CHECK: load i32* %px, !noalias [[OUTSET:![0-9]+]]
+; CHECK: load i32* %py, !noalias [[OUTSET]]
+; CHECK: store i32 %s, i32* %po, !alias.scope [[OUTSET]]
+; NONE-NOT: @add_noalias.
+define void @add(i32* %out, i32* %x, i32* %y, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds i32* %x, i64 %i
+  %vx = load i32* %px
+  %py = getelementptr inbounds i32* %y, i64 %i
+  %vy = load i32* %py
+  %s = add i32 %vx, %vy
+  %po = getelementptr inbounds i32* %out, i64 %i
+  store i32 %s, i32* %po
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define void @twice(
+; CHECK: call void @add_noalias.0(i32* %buf, i32* %p, i32* %p, i64 %n)
+; CHECK-LABEL: define void @disjoint(
+; CHECK: call void @add_noalias(i32* %buf, i32* %x, i32* %y, i64 %n)
+define void @twice(i32* %p, i64 %n) {
+  %buf = alloca i32, i64 64
+  call void @add(i32* %buf, i32* %p, i32* %p, i64 %n)
+  ret void
+}
+
+define void @disjoint(i64 %n) {
+  %buf = alloca i32, i64 64
+  %x = alloca i32, i64 64
+  %y = alloca i32, i64 64
+  call void @add(i32* %buf, i32* %x, i32* %y, i64 %n)
+  ret void
+}
+
+; CHECK: [[OUTSET]] = !{[[OUT:![0-9]+]]}
+; CHECK: [[OUT]] = distinct !{[[OUT]], {{![0-9]+}}, !"add_noalias.0: %out"}
@@ -0,0 +1,89 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -afc-sample-profile=%p/Inputs/profile.prof -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-dynamic -S | FileCheck %s --check-prefix=NOPROF
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; With the profile, @cold_axpy is too cold to be cloned, and only the hot call
+; to @hot_axpy is worth an overlap check.
+; CHECK-NOT: define void @cold_axpy_noalias(
+; NOPROF: define void @cold_axpy_noalias(
+define void @hot_axpy(float* %x, float* %y, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float* %x, i64 %i
+  %vx = load float* %px
+  %py = getelementptr inbounds float* %y, i64 %i
+  %vy = load float* %py
+  %s = fadd float %vx, %vy
+  store float %s, float* %py
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @cold_axpy(float* %x, float* %y, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float* %x, i64 %i
+  %vx = load float* %px
+  %py = getelementptr inbounds float* %y, i64 %i
+  %vy = load float* %py
+  %s = fsub float %vx, %vy
+  store float %s, float* %py
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define void @caller(
+; CHECK: br i1 %afc.disjoint
+; CHECK: call void @hot_axpy_noalias(float* %a, float* %b, i64 %n), !dbg
+; CHECK: call void @hot_axpy(float* %a, float* %b, i64 %n), !dbg
+; CHECK-NOT: afc.disjoint
+; CHECK: call void @hot_axpy(float* %b, float* %a, i64 %n), !dbg
+; CHECK: call void @cold_axpy(float* %a, float* %b, i64 %n), !dbg
+; CHECK: ret void
+; NOPROF-LABEL: define void @caller(
+; NOPROF: br i1 %afc.disjoint
+; NOPROF: br i1 %afc.disjoint
+; NOPROF: br i1 %afc.disjoint
+define void @caller(float* %a, float* %b, i64 %n) {
+  call void @hot_axpy(float* %a, float* %b, i64 %n), !dbg !10
+  call void @hot_axpy(float* %b, float* %a, i64 %n), !dbg !11
+  call void @cold_axpy(float* %a, float* %b, i64 %n), !dbg !12
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!7, !8}
+
+!0 = !{!"0x11\0012\00clang version 3.6.0\001\00\000\00\002", !1, !2, !2, !3, !2, !2} ; [ DW_TAG_compile_unit ] [./profile.c] [DW_LANG_C99]
+!1 = !{!"profile.c", !"."}
+!2 = !{}
+!3 = !{!4}
+!4 = !{!"0x2e\00caller\00caller\00\001\000\001\000\000\00256\000\001", !1, !9, !13, null, void (float*, float*, i64)* @caller, null, null, !2} ; [ DW_TAG_subprogram ] [line 1] [def] [caller]
+!7 = !{i32 2, !"Dwarf Version", i32 4}
+!8 = !{i32 2, !"Debug Info Version", i32 2}
+!9 = !{!"0x29", !1} ; [ DW_TAG_file_type ] [./profile.c]
+!10 = !MDLocation(line: 3, column: 3, scope: !4)
+!11 = !MDLocation(line: 5, column: 3, scope: !4)
+!12 = !MDLocation(line: 7, column: 3, scope: !4)
+!13 = !{!"0x15\00\000\000\000\000\000\000", null, null, null, !2, null, null, null} ; [ DW_TAG_subroutine_type ] [line 0, size 0, align 0, offset 0] [from ]
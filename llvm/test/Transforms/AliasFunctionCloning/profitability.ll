@@ -0,0 +1,108 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-clone-all -S | FileCheck %s --check-prefix=ALL
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The store to %dst in the loop may clobber %src, so this one is cloned.
+; CHECK: define void @copy_noalias(
+; ALL: define void @copy_noalias(
+define void @copy(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Only reads: aliasing cannot block anything.
+; CHECK-NOT: define i32 @sum_noalias(
+; ALL: define i32 @sum_noalias(
+define i32 @sum(i32* %a, i32* %b) {
+  %x = load i32* %a
+  %y = load i32* %b
+  %s = add i32 %x, %y
+  ret i32 %s
+}
+
+; A single possibly aliasing pair outside of loops is not enough.
+; CHECK-NOT: define i32 @single_noalias(
+; ALL: define i32 @single_noalias(
+define i32 @single(i32* %a, i32* %b) {
+  store i32 0, i32* %a
+  %y = load i32* %b
+  ret i32 %y
+}
+
+; Cloned, but no call can use the clone, so it is removed again, unless
+; every clone is kept.
+; CHECK-NOT: define void @orphan_noalias(
+; ALL: define void @orphan_noalias(
+define void @orphan(i32* %a, i32* %b) {
+  store i32 0, i32* %a
+  store i32 1, i32* %b
+  %x = load i32* %a
+  store i32 %x, i32* %b
+  ret void
+}
+
+define void @caller(i32* %p, i32* %q, i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  call void @copy(i32* %a, i32* %b, i64 %n)
+  call i32 @sum(i32* %a, i32* %b)
+  call i32 @single(i32* %a, i32* %b)
+  call void @orphan(i32* %p, i32* %q)
+  ret void
+}
+
+; A clone that was already in the module may be called from other modules,
+; so it stays even though nothing here calls it.
+; CHECK: define linkonce_odr void @shared_noalias.47e038723547f6fc(
+define linkonce_odr void @shared(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define linkonce_odr void @shared_noalias.47e038723547f6fc(i32* noalias %dst, i32* noalias %src, i64 %n) unnamed_addr {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %v, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
@@ -0,0 +1,79 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -pass-remarks=afc -pass-remarks-missed=afc \
+; RUN:   -afc-remarks-output=%t -disable-output 2>&1 | FileCheck %s
+; RUN: FileCheck %s --check-prefix=JSON < %t
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The call in @unknown is restrictified in its clone, but not in @unknown
+; itself, where nothing is known about the arguments.
+; CHECK: remark: remarks.c:8:3: call to 'add' replaced by its noalias clone
+; CHECK: remark: remarks.c:13:3: call to 'add' replaced by its noalias clone
+; CHECK: remark: remarks.c:8:3: call to 'add' not restrictified: arguments 0 and 1 may alias
+; CHECK: remark: remarks.c:3:3: call to 'add' only partially restrictified: arguments 1 and 2 must alias according to basicaa
+
+; JSON: [
+; JSON-NEXT: {"Pass": "afc", "Kind": "Passed", "Name": "Restrictified", "Caller": "unknown_noalias", "Callee": "add", "DebugLoc": {"File": "remarks.c", "Line": 8, "Column": 3}, "AliasingArgs": []},
+; JSON-NEXT: {"Pass": "afc", "Kind": "Passed", "Name": "Restrictified", "Caller": "disjoint", "Callee": "add", "DebugLoc": {"File": "remarks.c", "Line": 13, "Column": 3}, "AliasingArgs": []},
+; JSON-NEXT: {"Pass": "afc", "Kind": "Missed", "Name": "NotRestrictified", "Caller": "unknown", "Callee": "add", "DebugLoc": {"File": "remarks.c", "Line": 8, "Column": 3}, "AliasingArgs": [{"ArgA": 0, "ArgB": 1, "Result": "MayAlias", "Analysis": null}, {"ArgA": 0, "ArgB": 2, "Result": "MayAlias", "Analysis": null}, {"ArgA": 1, "ArgB": 2, "Result": "MayAlias", "Analysis": null}]},
+; JSON-NEXT: {"Pass": "afc", "Kind": "Missed", "Name": "PartiallyRestrictified", "Caller": "twice", "Callee": "add", "DebugLoc": {"File": "remarks.c", "Line": 3, "Column": 3}, "AliasingArgs": [{"ArgA": 1, "ArgB": 2, "Result": "MustAlias", "Analysis": "basicaa"}]}
+; JSON-NEXT: ]
+
+define void @add(i32* %out, i32* %x, i32* %y, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds i32* %x, i64 %i
+  %vx = load i32* %px
+  %py = getelementptr inbounds i32* %y, i64 %i
+  %vy = load i32* %py
+  %s = add i32 %vx, %vy
+  %po = getelementptr inbounds i32* %out, i64 %i
+  store i32 %s, i32* %po
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @twice(i32* %p, i64 %n) {
+  %buf = alloca i32, i64 64
+  call void @add(i32* %buf, i32* %p, i32* %p, i64 %n), !dbg !10
+  ret void
+}
+
+define void @unknown(i32* %p, i32* %q, i32* %r, i64 %n) {
+  call void @add(i32* %p, i32* %q, i32* %r, i64 %n), !dbg !11
+  ret void
+}
+
+define void @disjoint(i64 %n) {
+  %buf = alloca i32, i64 64
+  %x = alloca i32, i64 64
+  %y = alloca i32, i64 64
+  call void @add(i32* %buf, i32* %x, i32* %y, i64 %n), !dbg !12
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!7, !8}
+
+!0 = !{!"0x11\0012\00clang version 3.6.0\001\00\000\00\002", !1, !2, !2, !3, !2, !2} ; [ DW_TAG_compile_unit ] [./remarks.c] [DW_LANG_C99]
+!1 = !{!"remarks.c", !"."}
+!2 = !{}
+!3 = !{!4, !5, !6}
+!4 = !{!"0x2e\00twice\00twice\00\001\000\001\000\000\00256\000\001", !1, !9, !13, null, void (i32*, i64)* @twice, null, null, !2} ; [ DW_TAG_subprogram ] [line 1] [def] [twice]
+!5 = !{!"0x2e\00unknown\00unknown\00\006\000\001\000\000\00256\000\006", !1, !9, !13, null, void (i32*, i32*, i32*, i64)* @unknown, null, null, !2} ; [ DW_TAG_subprogram ] [line 6] [def] [unknown]
+!6 = !{!"0x2e\00disjoint\00disjoint\00\0011\000\001\000\000\00256\000\0011", !1, !9, !13, null, void (i64)* @disjoint, null, null, !2} ; [ DW_TAG_subprogram ] [line 11] [def] [disjoint]
+!7 = !{i32 2, !"Dwarf Version", i32 4}
+!8 = !{i32 2, !"Debug Info Version", i32 2}
+!9 = !{!"0x29", !1} ; [ DW_TAG_file_type ] [./remarks.c]
+!10 = !MDLocation(line: 3, column: 3, scope: !4)
+!11 = !MDLocation(line: 8, column: 3, scope: !5)
+!12 = !MDLocation(line: 13, column: 3, scope: !6)
+!13 = !{!"0x15\00\000\000\000\000\000\000", null, null, null, !2, null, null, null} ; [ DW_TAG_subroutine_type ] [line 0, size 0, align 0, offset 0] [from ]
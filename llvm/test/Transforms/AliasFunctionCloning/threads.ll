@@ -0,0 +1,69 @@
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -S > %t.serial
+; RUN: opt < %s -load=%llvmshlibdir/AliasFunctionCloning%shlibext -basicaa \
+; RUN:   -afc -afc-threads=4 -S > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; REQUIRES: loadable_module
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Planning the alias scopes on several threads gives the same module.
+; CHECK: define void @scale_noalias(float* noalias %dst, float* noalias %src, i64 %n)
+; CHECK: load float* %ps, !alias.scope [[SRC:![0-9]+]], !noalias [[DST:![0-9]+]]
+; CHECK: store float %m, float* %pd, !alias.scope [[DST]], !noalias [[SRC]]
+; CHECK: define void @shift_noalias(
+; CHECK: define void @mix_noalias(
+
+define void @scale(float* %dst, float* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds float* %src, i64 %i
+  %v = load float* %ps
+  %m = fmul float %v, 2.0
+  %pd = getelementptr inbounds float* %dst, i64 %i
+  store float %m, float* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @shift(i32* %dst, i32* %src, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %ps = getelementptr inbounds i32* %src, i64 %i
+  %v = load i32* %ps
+  %s = shl i32 %v, 1
+  %pd = getelementptr inbounds i32* %dst, i64 %i
+  store i32 %s, i32* %pd
+  %i.next = add nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define void @mix(i32* %a, i32* %b, float* %c, float* %d, i64 %n) {
+  call void @shift(i32* %a, i32* %b, i64 %n)
+  call void @scale(float* %c, float* %d, i64 %n)
+  ret void
+}
+
+define void @top(i64 %n) {
+  %a = alloca i32, i64 64
+  %b = alloca i32, i64 64
+  %c = alloca float, i64 64
+  %d = alloca float, i64 64
+  call void @mix(i32* %a, i32* %b, float* %c, float* %d, i64 %n)
+  ret void
+}
@@ -0,0 +1,17 @@
+; RUN: opt < %s -basicaa -dse -memdep-block-scan-limit=2 -S | FileCheck %s --check-prefix=MEMDEP
+; RUN: opt < %s -basicaa -dse -memdep-block-scan-limit=2 -enable-dse-memoryssa -verify-memoryssa -S | FileCheck %s --check-prefix=MSSA
+target datalayout = "e-p:64:64:64-i32:32:32"
+
+; More instructions separate the stores than memory dependence analysis scans,
+; but they do not touch memory, so the memory SSA form links the stores.
+
+; MEMDEP: store i32 1, i32* %p
+; MSSA-NOT: store i32 1
+; MSSA: store i32 %a1, i32* %p
+define void @far_store(i32* %p, i32 %x) {
+  store i32 1, i32* %p
+  %a0 = add i32 %x, 1
+  %a1 = add i32 %a0, 1
+  store i32 %a1, i32* %p
+  ret void
+}
@@ -0,0 +1,18 @@
+; RUN: opt < %s -basicaa -gvn -memdep-block-scan-limit=2 -S | FileCheck %s --check-prefix=MEMDEP
+; RUN: opt < %s -basicaa -gvn -memdep-block-scan-limit=2 -enable-gvn-memoryssa -verify-memoryssa -S | FileCheck %s --check-prefix=MSSA
+
+; More instructions separate the load from the store than memory dependence
+; analysis scans, but they do not touch memory, so the memory SSA form links
+; the load straight to the store.
+
+; MEMDEP: %v = load i32* %p
+; MSSA-NOT: load
+; MSSA: %r = add i32 %a1, %x
+define i32 @far_store(i32* %p, i32 %x) {
+  store i32 %x, i32* %p
+  %a0 = add i32 %x, 1
+  %a1 = add i32 %a0, 1
+  %v = load i32* %p
+  %r = add i32 %a1, %v
+  ret i32 %r
+}
@@ -0,0 +1,26 @@
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -verify-memoryssa -S | FileCheck %s
+
+; Load PRE splits the critical edge from %entry to %join.  The memory SSA form
+; is updated for the new block rather than rebuilt, and the MemoryPhi of
+; %join then comes in through it.
+
+; CHECK: entry.join_crit_edge:
+; CHECK-NEXT: %v.pre = load i32* %p
+; CHECK: join:
+; CHECK-NEXT: [[V:%[a-z]+]] = phi i32 [ %v.pre, %entry.join_crit_edge ], [ 1, %store ]
+; CHECK-NOT: load
+; CHECK: ret i32 [[V]]
+define i32 @f(i1 %c, i32* %p) {
+entry:
+  br i1 %c, label %store, label %join
+
+store:
+  store i32 1, i32* %p
+  br label %join
+
+join:
+  %v = load i32* %p
+  %w = load i32* %p
+  %r = add i32 %v, %w
+  ret i32 %v
+}
@@ -0,0 +1,121 @@
+; RUN: opt < %s -basicaa -scoped-noalias -loop-vectorize \
+; RUN:   -force-vector-interleave=1 -force-vector-width=4 -dce -instcombine \
+; RUN:   -S | FileCheck %s
+; RUN: opt < %s -basicaa -scoped-noalias -loop-vectorize \
+; RUN:   -force-vector-interleave=1 -force-vector-width=4 -stats \
+; RUN:   -disable-output 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; STATS: 2 loop-vectorize - Number of loops vectorized
+; STATS: 1 loop-vectorize - Number of loops vectorized only because alias scopes removed runtime checks
+; STATS: 7 loop-vectorize - Number of runtime pointer checks removed by alias scopes
+
+; %a and %b are in distinct alias scopes, as in the body of a function with
+; noalias arguments, but both may alias %s and end up in its alias set.
+; Only the checks against %s are emitted.
+; CHECK-LABEL: @two_scopes(
+; CHECK: vector.memcheck:
+; CHECK: %found.conflict{{[0-9]*}} = and
+; CHECK: %found.conflict{{[0-9]*}} = and
+; CHECK-NOT: %found.conflict{{[0-9]*}} = and
+; CHECK: vector.ph:
+; CHECK: store <4 x float>
+define void @two_scopes(float* %a, float* %b, float* %s, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %ps = getelementptr inbounds float* %s, i64 %i
+  %v = load float* %ps, align 4
+  %pa = getelementptr inbounds float* %a, i64 %i
+  store float %v, float* %pa, align 4, !alias.scope !10, !noalias !11
+  %pb = getelementptr inbounds float* %b, i64 %i
+  store float %v, float* %pb, align 4, !alias.scope !11, !noalias !10
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; With four stores the 16 checks estimated for the alias set exceed the
+; limit. Once the pairs of stores are known to be disjoint, four are left.
+; CHECK-LABEL: @four_scopes(
+; CHECK: vector.memcheck:
+; CHECK: store <4 x float>
+define void @four_scopes(float* %a, float* %b, float* %c, float* %d,
+                         float* %s, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %ps = getelementptr inbounds float* %s, i64 %i
+  %v = load float* %ps, align 4
+  %pa = getelementptr inbounds float* %a, i64 %i
+  store float %v, float* %pa, align 4, !alias.scope !20, !noalias !21
+  %pb = getelementptr inbounds float* %b, i64 %i
+  store float %v, float* %pb, align 4, !alias.scope !22, !noalias !23
+  %pc = getelementptr inbounds float* %c, i64 %i
+  store float %v, float* %pc, align 4, !alias.scope !24, !noalias !25
+  %pd = getelementptr inbounds float* %d, i64 %i
+  store float %v, float* %pd, align 4, !alias.scope !26, !noalias !27
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Without scopes the same loop is still rejected.
+; CHECK-LABEL: @four_unscoped(
+; CHECK-NOT: <4 x float>
+; CHECK: ret void
+define void @four_unscoped(float* %a, float* %b, float* %c, float* %d,
+                           float* %s, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %ps = getelementptr inbounds float* %s, i64 %i
+  %v = load float* %ps, align 4
+  %pa = getelementptr inbounds float* %a, i64 %i
+  store float %v, float* %pa, align 4
+  %pb = getelementptr inbounds float* %b, i64 %i
+  store float %v, float* %pb, align 4
+  %pc = getelementptr inbounds float* %c, i64 %i
+  store float %v, float* %pc, align 4
+  %pd = getelementptr inbounds float* %d, i64 %i
+  store float %v, float* %pd, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+!0 = !{!0, !"domain"}
+!1 = !{!1, !0, !"a"}
+!2 = !{!2, !0, !"b"}
+!3 = !{!3, !0, !"c"}
+!4 = !{!4, !0, !"d"}
+
+!10 = !{!1}
+!11 = !{!2}
+
+!20 = !{!1}
+!21 = !{!2, !3, !4}
+!22 = !{!2}
+!23 = !{!1, !3, !4}
+!24 = !{!3}
+!25 = !{!1, !2, !4}
+!26 = !{!4}
+!27 = !{!1, !2, !3}
@@ -0,0 +1,22 @@
+; RUN: not opt < %s -verify -function-pass-threads=2 -disable-output 2>&1 | FileCheck %s
+
+; A function verified on another thread still stops compilation.
+
+; CHECK: Instruction does not dominate all uses!
+; CHECK: Broken function found, compilation aborted!
+
+define i32 @good(i32 %a) {
+  ret i32 %a
+}
+
+define i32 @bad(i32 %a) {
+entry:
+  %x = add i32 %y, 1
+  %y = add i32 %a, 1
+  ret i32 %x
+}
+
+define i32 @good2(i32 %a) {
+  %x = add i32 %a, 2
+  ret i32 %x
+}
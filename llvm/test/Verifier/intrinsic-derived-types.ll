@@ -0,0 +1,32 @@
+; RUN: not llvm-as < %s -o /dev/null 2>&1 | FileCheck %s
+
+; Arguments whose types are derived from an overloaded type have twice or half
+; its element width and as many elements.
+
+declare <8 x i8> @llvm.aarch64.neon.sqxtn.v8i8(<8 x i16>)
+declare i32 @llvm.aarch64.neon.sqxtn.i32(i64)
+declare <4 x i32> @llvm.aarch64.neon.smull.v4i32(<4 x i16>, <4 x i16>)
+declare <4 x i16> @llvm.aarch64.neon.sqxtn.v4i16(<4 x float>)
+declare <2 x i64> @llvm.aarch64.neon.smull.v2i64(<4 x i32>, <4 x i32>)
+
+; CHECK-NOT: incorrect
+define void @valid(<8 x i16> %v, i64 %s, <4 x i16> %w) {
+  call <8 x i8> @llvm.aarch64.neon.sqxtn.v8i8(<8 x i16> %v)
+  call i32 @llvm.aarch64.neon.sqxtn.i32(i64 %s)
+  call <4 x i32> @llvm.aarch64.neon.smull.v4i32(<4 x i16> %w, <4 x i16> %w)
+  ret void
+}
+
+; CHECK: Intrinsic has incorrect argument type!
+; CHECK-NEXT: @llvm.aarch64.neon.sqxtn.v4i16
+define void @extended_float(<4 x float> %v) {
+  call <4 x i16> @llvm.aarch64.neon.sqxtn.v4i16(<4 x float> %v)
+  ret void
+}
+
+; CHECK: Intrinsic has incorrect argument type!
+; CHECK-NEXT: @llvm.aarch64.neon.smull.v2i64
+define void @truncated_count(<4 x i32> %v) {
+  call <2 x i64> @llvm.aarch64.neon.smull.v2i64(<4 x i32> %v, <4 x i32> %v)
+  ret void
+}
@@ -14,10 +14,12 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
@@ -60,6 +62,11 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<unsigned>
+CodeGenThreads("codegen-threads", cl::init(1u), cl::value_desc("N"),
+               cl::desc("Split the module in N parts compiled in parallel, "
+                        "writing part I to <output filename>.I"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -94,10 +101,13 @@ static cl::opt<bool> AsmVerbose("asm-verbose",
                                 cl::init(true));
 
 static int compileModule(char **, LLVMContext &);
+static int compileModuleInParallel(char **, Module &, const Target &,
+                                   const Triple &, StringRef,
+                                   const TargetOptions &, CodeGenOpt::Level);
 
 static std::unique_ptr<tool_output_file>
 GetOutputStream(const char *TargetName, Triple::OSType OS,
-                const char *ProgName) {
+                const char *ProgName, StringRef Suffix = StringRef()) {
   // If we don't yet have an output filename, make one.
   if (OutputFilename.empty()) {
     if (InputFilename == "-")
@@ -151,8 +161,8 @@ GetOutputStream(const char *TargetName, Triple::OSType OS,
   sys::fs::OpenFlags OpenFlags = sys::fs::F_None;
   if (!Binary)
     OpenFlags |= sys::fs::F_Text;
-  auto FDOut = llvm::make_unique<tool_output_file>(OutputFilename, EC,
-                                                   OpenFlags);
+  auto FDOut = llvm::make_unique<tool_output_file>(
+      (Twine(OutputFilename) + Suffix).str(), EC, OpenFlags);
   if (EC) {
     errs() << EC.message() << '\n';
     return nullptr;
@@ -287,6 +297,10 @@ static int compileModule(char **argv, LLVMContext &Context) {
   if (GenerateSoftFloatCalls)
     FloatABIForCalls = FloatABI::Soft;
 
+  if (CodeGenThreads > 1)
+    return compileModuleInParallel(argv, *M, *TheTarget, TheTriple,
+                                   FeaturesStr, Options, OLvl);
+
   // Figure out where we are going to send the output.
   std::unique_ptr<tool_output_file> Out =
       GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
@@ -353,3 +367,68 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   return 0;
 }
+
+/// compileModuleInParallel - Split M into -codegen-threads parts and compile
+/// them concurrently, each to an output file of its own.
+static int compileModuleInParallel(char **argv, Module &M,
+                                   const Target &TheTarget,
+                                   const Triple &TheTriple,
+                                   StringRef FeaturesStr,
+                                   const TargetOptions &Options,
+                                   CodeGenOpt::Level OLvl) {
+  if (OutputFilename == "-" ||
+      (OutputFilename.empty() && InputFilename == "-")) {
+    errs() << argv[0] << ": -codegen-threads needs an output file name\n";
+    return 1;
+  }
+  if (!StartAfter.empty() || !StopAfter.empty()) {
+    errs() << argv[0] << ": -codegen-threads cannot be combined with "
+           << "-start-after or -stop-after\n";
+    return 1;
+  }
+
+  auto CreateTargetMachine = [&]() {
+    return TheTarget.createTargetMachine(TheTriple.getTriple(), MCPU,
+                                         FeaturesStr, Options, RelocModel,
+                                         CMModel, OLvl);
+  };
+
+  // The partitions are laid out like the module, so take its data layout
+  // from the target before splitting.
+  std::unique_ptr<TargetMachine> Target(CreateTargetMachine());
+  if (const DataLayout *DL = Target->getSubtargetImpl()->getDataLayout())
+    M.setDataLayout(DL);
+
+  std::vector<std::unique_ptr<tool_output_file> > Outs;
+  std::vector<raw_ostream *> OSs;
+  for (unsigned I = 0; I != CodeGenThreads; ++I) {
+    Outs.push_back(GetOutputStream(TheTarget.getName(), TheTriple.getOS(),
+                                   argv[0], "." + utostr(I)));
+    if (!Outs.back())
+      return 1;
+    OSs.push_back(&Outs.back()->os());
+  }
+
+  auto AddPasses = [&](PassManagerBase &PM) {
+    TargetLibraryInfo *TLI = new TargetLibraryInfo(TheTriple);
+    if (DisableSimplifyLibCalls)
+      TLI->disableAllFunctions();
+    PM.add(TLI);
+  };
+
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
+
+  std::string ErrMsg;
+  if (splitCodeGen(M, OSs, CreateTargetMachine, FileType, NoVerify, AddPasses,
+                   ErrMsg)) {
+    errs() << argv[0] << ": " << ErrMsg << "\n";
+    return 1;
+  }
+
+  // Declare success.
+  for (std::unique_ptr<tool_output_file> &Out : Outs)
+    Out->keep();
+
+  return 0;
+}
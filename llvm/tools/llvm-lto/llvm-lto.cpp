@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -22,6 +23,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -42,6 +44,11 @@ static cl::opt<bool>
 DisableLTOVectorization("disable-lto-vectorization", cl::init(false),
   cl::desc("Do not run loop or slp vectorization during LTO"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::Prefix, cl::init(1),
+            cl::desc("Generate code on N threads, writing N objects named "
+                     "<output filename>.I"));
+
 static cl::opt<bool>
 UseDiagnosticHandler("use-diagnostic-handler", cl::init(false),
   cl::desc("Use a diagnostic handler to test the handler interface"));
@@ -227,7 +234,44 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  if (Parallelism > 1) {
+    if (OutputFilename.empty()) {
+      errs() << argv[0] << ": -j needs an output filename\n";
+      return 1;
+    }
+
+    std::string ErrorInfo;
+    if (!CodeGen.optimize(DisableOpt, DisableInline, DisableGVNLoadPRE,
+                          DisableLTOVectorization, ErrorInfo)) {
+      errs() << argv[0] << ": error optimizing the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    std::vector<std::unique_ptr<tool_output_file> > Outs;
+    std::vector<raw_ostream *> OSs;
+    for (unsigned I = 0; I != Parallelism; ++I) {
+      std::string PartFilename = OutputFilename + "." + utostr(I);
+      std::error_code EC;
+      Outs.push_back(llvm::make_unique<tool_output_file>(PartFilename, EC,
+                                                         sys::fs::F_None));
+      if (EC) {
+        errs() << argv[0] << ": error opening the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      OSs.push_back(&Outs.back()->os());
+    }
+
+    if (!CodeGen.compileOptimized(OSs, ErrorInfo)) {
+      errs() << argv[0] << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    for (std::unique_ptr<tool_output_file> &Out : Outs)
+      Out->keep();
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code =
@@ -97,6 +97,13 @@ NoVerify("disable-verify", cl::desc("Do not verify result module"), cl::Hidden);
 static cl::opt<bool>
 VerifyEach("verify-each", cl::desc("Verify after each transform"));
 
+static cl::opt<bool>
+LazyLoad("lazy-load",
+         cl::desc("Read function bodies from bitcode input only when a pass "
+                  "needs them. This only saves memory for pipelines of "
+                  "function passes: a module pass reads every body, and "
+                  "bodies that passes change are kept"));
+
 static cl::opt<bool>
 StripDebug("strip-debug",
            cl::desc("Strip debugger symbol info from translation unit"));
@@ -338,7 +345,11 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
 
   // Load the input module...
-  std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
+  std::unique_ptr<Module> M;
+  if (LazyLoad)
+    M = getLazyIRFileModule(InputFilename, Err, Context);
+  else
+    M = parseIRFile(InputFilename, Err, Context);
 
   if (!M) {
     Err.print(argv[0], errs());
@@ -386,6 +397,13 @@ int main(int argc, char **argv) {
     else if (VerifyEach)
       VK = VK_VerifyEachPass;
 
+    // The new pass manager does not read function bodies on demand.
+    if (std::error_code EC = M->materializeAllPermanently()) {
+      errs() << argv[0] << ": " << InputFilename << ": " << EC.message()
+             << '\n';
+      return 1;
+    }
+
     // The user has asked to use the new pass manager and provided a pipeline
     // string. Hand off the rest of the functionality to the new code for that
     // layer.
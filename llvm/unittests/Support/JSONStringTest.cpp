@@ -0,0 +1,33 @@
+//===- llvm/unittest/Support/JSONStringTest.cpp - JSON string tests -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/JSONString.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+std::string toJSON(StringRef S) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  writeJSONString(OS, S);
+  return OS.str();
+}
+
+TEST(JSONStringTest, Escapes) {
+  EXPECT_EQ("\"\"", toJSON(""));
+  EXPECT_EQ("\"foo.c\"", toJSON("foo.c"));
+  EXPECT_EQ("\"a\\\"b\\\\c\"", toJSON("a\"b\\c"));
+  EXPECT_EQ("\"\\u000a\\u0000\"", toJSON(StringRef("\n\0", 2)));
+  EXPECT_EQ("\"\xc3\xa9\"", toJSON("\xc3\xa9"));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,61 @@
+/*============================================================================
+ *  Shared driver code for the AFC benchmark kernels
+ *
+ *  Every benchmark times its kernels and prints a single line
+ *  "<seconds> <checksum>" that run.sh parses. The kernels are external and
+ *  kept out of line, so their call sites survive until AFC runs and no
+ *  interprocedural pass sees the arguments they are called with. Buffers
+ *  come straight from malloc, which alias analysis knows to be disjoint.
+ *
+ *===========================================================================*/
+#ifndef AFC_BENCH_H
+#define AFC_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KERNEL __attribute__((noinline))
+
+#ifndef BENCH_REPS
+#define BENCH_REPS 5
+#endif
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double bench_min(double best, double elapsed) {
+  return best < 0 || elapsed < best ? elapsed : best;
+}
+
+/* Deterministic pseudo-random values in [0, 1) */
+static void bench_fill(float *a, long n, unsigned seed) {
+  long i;
+  for (i = 0; i < n; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    a[i] = (float)((seed >> 8) & 0xffff) / 65536.0f;
+  }
+}
+
+static double bench_checksum(const float *a, long n) {
+  double sum = 0;
+  long i;
+  for (i = 0; i < n; ++i)
+    sum += a[i] * (double)((i % 7) + 1);
+  return sum;
+}
+
+static int bench_report(double best, double checksum) {
+  printf("%.6f %.6e\n", best, checksum);
+  return 0;
+}
+
+static int bench_oom(void) {
+  fprintf(stderr, "out of memory\n");
+  return 1;
+}
+
+#endif
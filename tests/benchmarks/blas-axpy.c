@@ -0,0 +1,31 @@
+/* y += a * x, the BLAS level 1 update */
+#include "bench.h"
+
+#define N 4096
+#define ITERS 20000
+
+KERNEL void axpy(float *y, const float *x, float a, long n) {
+  long i;
+  for (i = 0; i < n; ++i)
+    y[i] += a * x[i];
+}
+
+int main(void) {
+  float *x = malloc(N * sizeof(float));
+  float *y = malloc(N * sizeof(float));
+  double best = -1;
+  int rep, k;
+
+  if (!x || !y)
+    return bench_oom();
+  bench_fill(x, N, 1);
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(y, N, 2);
+    start = bench_now();
+    for (k = 0; k < ITERS; ++k)
+      axpy(y, x, 1e-4f, N);
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(y, N));
+}
@@ -0,0 +1,35 @@
+/* C += A * B for square row-major matrices, in i-k-j order */
+#include "bench.h"
+
+#define N 256
+#define ITERS 4
+
+KERNEL void gemm(float *C, const float *A, const float *B, long n) {
+  long i, j, k;
+  for (i = 0; i < n; ++i)
+    for (k = 0; k < n; ++k)
+      for (j = 0; j < n; ++j)
+        C[i * n + j] += A[i * n + k] * B[k * n + j];
+}
+
+int main(void) {
+  float *A = malloc(N * N * sizeof(float));
+  float *B = malloc(N * N * sizeof(float));
+  float *C = malloc(N * N * sizeof(float));
+  double best = -1;
+  int rep, k;
+
+  if (!A || !B || !C)
+    return bench_oom();
+  bench_fill(A, N * N, 1);
+  bench_fill(B, N * N, 2);
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(C, N * N, 3);
+    start = bench_now();
+    for (k = 0; k < ITERS; ++k)
+      gemm(C, A, B, N);
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(C, N * N));
+}
@@ -0,0 +1,35 @@
+/* y += A * x for a row-major m x n matrix A */
+#include "bench.h"
+
+#define M 512
+#define N 512
+#define ITERS 400
+
+KERNEL void gemv(float *y, const float *A, const float *x, long m, long n) {
+  long i, j;
+  for (i = 0; i < m; ++i)
+    for (j = 0; j < n; ++j)
+      y[i] += A[i * n + j] * x[j];
+}
+
+int main(void) {
+  float *A = malloc(M * N * sizeof(float));
+  float *x = malloc(N * sizeof(float));
+  float *y = malloc(M * sizeof(float));
+  double best = -1;
+  int rep, k;
+
+  if (!A || !x || !y)
+    return bench_oom();
+  bench_fill(A, M * N, 1);
+  bench_fill(x, N, 2);
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(y, M, 3);
+    start = bench_now();
+    for (k = 0; k < ITERS; ++k)
+      gemv(y, A, x, M, N);
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(y, M));
+}
@@ -0,0 +1,44 @@
+/* Byte copy and scaled word copy. Through char pointers, and through a
+ * scalar read from memory, aliasing blocks vectorization and hoisting. */
+#include "bench.h"
+
+#define N 16384
+#define ITERS 2000
+
+KERNEL void copy_bytes(char *dst, const char *src, long n) {
+  long i;
+  for (i = 0; i < n; ++i)
+    dst[i] = src[i];
+}
+
+KERNEL void copy_scaled(float *dst, const float *src, const float *scale,
+                        long n) {
+  long i;
+  for (i = 0; i < n; ++i)
+    dst[i] = src[i] * *scale;
+}
+
+int main(void) {
+  float *src = malloc(N * sizeof(float));
+  float *tmp = malloc(N * sizeof(float));
+  float *dst = malloc(N * sizeof(float));
+  float *scale = malloc(sizeof(float));
+  double best = -1;
+  int rep, k;
+
+  if (!src || !tmp || !dst || !scale)
+    return bench_oom();
+  bench_fill(src, N, 1);
+  *scale = 0.5f;
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(dst, N, 2);
+    start = bench_now();
+    for (k = 0; k < ITERS; ++k) {
+      copy_bytes((char *)tmp, (const char *)src, N * sizeof(float));
+      copy_scaled(dst, tmp, scale, N);
+    }
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(dst, N));
+}
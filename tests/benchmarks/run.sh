@@ -0,0 +1,162 @@
+#!/usr/bin/env bash
+##===- run.sh - AFC benchmark harness ------------------------------------===##
+#
+# Builds every kernel of this directory twice, with and without -afc, runs
+# both binaries and writes one CSV row per benchmark with the run time, the
+# .text size and the compile time (opt + llc) of each build.
+#
+# Usage:
+#     LLVM_BIN=<build>/bin tests/benchmarks/run.sh [benchmark...]
+#
+# Environment:
+#     LLVM_BIN         directory holding clang, opt and llc (required)
+#     AFC_LIB          the AFC plugin (default: $LLVM_BIN/../lib/
+#                      AliasFunctionCloning.so)
+#     AA_FLAGS         alias analyses scheduled before -afc (default: the
+#                      ones of the -O3 pipeline)
+#     AFC_FLAGS        extra options for -afc, e.g. -afc-dynamic
+#     CC               compiler used to link the objects (default: cc)
+#     RUNS             times each binary is run, keeping the fastest (3)
+#     OUT              CSV file to write (default: tests/results/
+#                      afc-benchmarks.csv)
+#     MIN_SPEEDUP      fail if a benchmark gets slower than this ratio
+#     MAX_TEXT_GROWTH  fail if a benchmark's .text grows past this ratio
+#     KEEP             keep the build directory if set
+#
+# The script exits with a non-zero status if a build fails, if the two
+# builds of a benchmark disagree on its checksum, or if a threshold is hit.
+#
+##===----------------------------------------------------------------------===##
+
+set -e -o pipefail
+
+SRC_DIR=$(cd "$(dirname "$0")" && pwd)
+
+if [ -z "$LLVM_BIN" ]; then
+  echo "error: set LLVM_BIN to the bin directory of an LLVM build" >&2
+  exit 1
+fi
+
+CLANG=${CLANG:-$LLVM_BIN/clang}
+OPT=${OPT:-$LLVM_BIN/opt}
+LLC=${LLC:-$LLVM_BIN/llc}
+AFC_LIB=${AFC_LIB:-$LLVM_BIN/../lib/AliasFunctionCloning.so}
+AA_FLAGS=${AA_FLAGS:-"-tbaa -scoped-noalias -basicaa"}
+CC=${CC:-cc}
+RUNS=${RUNS:-3}
+OUT=${OUT:-$SRC_DIR/../results/afc-benchmarks.csv}
+
+for tool in "$CLANG" "$OPT" "$LLC" "$AFC_LIB"; do
+  if [ ! -e "$tool" ]; then
+    echo "error: $tool not found" >&2
+    exit 1
+  fi
+done
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/afc-bench.XXXXXX")
+if [ -z "$KEEP" ]; then
+  trap 'rm -rf "$WORK"' EXIT
+else
+  echo "keeping build files in $WORK" >&2
+fi
+
+if [ $# -eq 0 ]; then
+  set -- $(cd "$SRC_DIR" && ls *.c | sed 's/\.c$//')
+fi
+
+now() {
+  date +%s.%N
+}
+
+# Prints the time elapsed since $1, in seconds
+since() {
+  awk -v start="$1" -v end="$(now)" 'BEGIN { printf "%.3f", end - start }'
+}
+
+# Builds $WORK/$1.bc into the $2 variant. Prints "<compile seconds> <text>"
+build() {
+  local bench=$1 variant=$2 start
+  local flags="-mem2reg -O3"
+  if [ "$variant" = afc ]; then
+    flags="-mem2reg -load $AFC_LIB $AA_FLAGS -afc $AFC_FLAGS -O3"
+  fi
+
+  start=$(now)
+  "$OPT" $flags "$WORK/$bench.bc" -o "$WORK/$bench.$variant.bc"
+  # PIC objects link on distributions that default to PIE executables
+  "$LLC" -O3 -relocation-model=pic -filetype=obj \
+    "$WORK/$bench.$variant.bc" -o "$WORK/$bench.$variant.o"
+  echo "$(since "$start") $(size "$WORK/$bench.$variant.o" | awk 'NR == 2 { print $1 }')"
+
+  "$CC" "$WORK/$bench.$variant.o" -o "$WORK/$bench.$variant" -lm
+}
+
+# Runs $1 $RUNS times. Prints "<fastest seconds> <checksum>"
+measure() {
+  local i
+  for i in $(seq "$RUNS"); do
+    "$1"
+  done | sort -g | head -n 1
+}
+
+ratio() {
+  awk -v a="$1" -v b="$2" 'BEGIN { if (b > 0) printf "%.3f", a / b; else print "nan" }'
+}
+
+# Succeeds if $1 > $2
+above() {
+  awk -v a="$1" -v b="$2" 'BEGIN { exit !(a > b) }'
+}
+
+status=0
+echo "benchmark,base_seconds,afc_seconds,speedup,base_text_bytes,\
+afc_text_bytes,text_growth,base_compile_seconds,afc_compile_seconds,\
+compile_overhead" > "$WORK/results.csv"
+
+for bench in "$@"; do
+  echo "$bench" >&2
+  "$CLANG" -O3 -Xclang -disable-llvm-optzns -emit-llvm -c \
+    "$SRC_DIR/$bench.c" -o "$WORK/$bench.bc"
+
+  out=$(build "$bench" base)
+  read base_compile base_text <<< "$out"
+  out=$(build "$bench" afc)
+  read afc_compile afc_text <<< "$out"
+  out=$(measure "$WORK/$bench.base")
+  read base_time base_sum <<< "$out"
+  out=$(measure "$WORK/$bench.afc")
+  read afc_time afc_sum <<< "$out"
+
+  speedup=$(ratio "$base_time" "$afc_time")
+  growth=$(ratio "$afc_text" "$base_text")
+  overhead=$(ratio "$afc_compile" "$base_compile")
+  echo "$bench,$base_time,$afc_time,$speedup,$base_text,$afc_text,$growth,\
+$base_compile,$afc_compile,$overhead" >> "$WORK/results.csv"
+
+  # Both builds run the same computation, only their speed may differ
+  if ! awk -v a="$base_sum" -v b="$afc_sum" 'BEGIN {
+         d = a - b; if (d < 0) d = -d; m = a < 0 ? -a : a;
+         exit !(d <= m * 1e-5) }'; then
+    echo "error: $bench: checksum $afc_sum with -afc, $base_sum without" >&2
+    status=1
+  fi
+  if [ -n "$MIN_SPEEDUP" ] && above "$MIN_SPEEDUP" "$speedup"; then
+    echo "error: $bench: speedup $speedup is below $MIN_SPEEDUP" >&2
+    status=1
+  fi
+  if [ -n "$MAX_TEXT_GROWTH" ] && above "$growth" "$MAX_TEXT_GROWTH"; then
+    echo "error: $bench: text growth $growth is above $MAX_TEXT_GROWTH" >&2
+    status=1
+  fi
+done
+
+# Geometric means of the ratio columns
+awk -F, 'NR > 1 { s += log($4); t += log($7); c += log($10); n++ }
+         END { if (n) printf "geomean,,,%.3f,,,%.3f,,,%.3f\n",
+                             exp(s / n), exp(t / n), exp(c / n) }' \
+  "$WORK/results.csv" >> "$WORK/results.csv"
+
+mkdir -p "$(dirname "$OUT")"
+cp "$WORK/results.csv" "$OUT"
+cat "$OUT"
+exit $status
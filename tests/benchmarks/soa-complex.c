@@ -0,0 +1,42 @@
+/* Pointwise complex multiply-accumulate on split real/imaginary arrays */
+#include "bench.h"
+
+#define N 8192
+#define ITERS 4000
+
+KERNEL void cmac(float *re, float *im, const float *are, const float *aim,
+                 const float *bre, const float *bim, long n) {
+  long i;
+  for (i = 0; i < n; ++i) {
+    re[i] += are[i] * bre[i] - aim[i] * bim[i];
+    im[i] += are[i] * bim[i] + aim[i] * bre[i];
+  }
+}
+
+int main(void) {
+  float *re = malloc(N * sizeof(float));
+  float *im = malloc(N * sizeof(float));
+  float *are = malloc(N * sizeof(float));
+  float *aim = malloc(N * sizeof(float));
+  float *bre = malloc(N * sizeof(float));
+  float *bim = malloc(N * sizeof(float));
+  double best = -1;
+  int rep, k;
+
+  if (!re || !im || !are || !aim || !bre || !bim)
+    return bench_oom();
+  bench_fill(are, N, 1);
+  bench_fill(aim, N, 2);
+  bench_fill(bre, N, 3);
+  bench_fill(bim, N, 4);
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(re, N, 5);
+    bench_fill(im, N, 6);
+    start = bench_now();
+    for (k = 0; k < ITERS; ++k)
+      cmac(re, im, are, aim, bre, bim, N);
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(re, N) + bench_checksum(im, N));
+}
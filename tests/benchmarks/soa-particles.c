@@ -0,0 +1,47 @@
+/* Struct-of-arrays particle update. With six arrays the runtime checks a
+ * vectorizer would need to rule out overlap exceed what it is willing to
+ * emit. */
+#include "bench.h"
+
+#define N 8192
+#define STEPS 4000
+
+KERNEL void advance(float *x, float *y, float *z, float *vx, float *vy,
+                    float *vz, float dt, long n) {
+  long i;
+  for (i = 0; i < n; ++i) {
+    vz[i] -= 9.81f * dt;
+    x[i] += vx[i] * dt;
+    y[i] += vy[i] * dt;
+    z[i] += vz[i] * dt;
+  }
+}
+
+int main(void) {
+  float *x = malloc(N * sizeof(float));
+  float *y = malloc(N * sizeof(float));
+  float *z = malloc(N * sizeof(float));
+  float *vx = malloc(N * sizeof(float));
+  float *vy = malloc(N * sizeof(float));
+  float *vz = malloc(N * sizeof(float));
+  double best = -1;
+  int rep, t;
+
+  if (!x || !y || !z || !vx || !vy || !vz)
+    return bench_oom();
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(x, N, 1);
+    bench_fill(y, N, 2);
+    bench_fill(z, N, 3);
+    bench_fill(vx, N, 4);
+    bench_fill(vy, N, 5);
+    bench_fill(vz, N, 6);
+    start = bench_now();
+    for (t = 0; t < STEPS; ++t)
+      advance(x, y, z, vx, vy, vz, 1e-4f, N);
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(x, N) + bench_checksum(y, N) +
+                                bench_checksum(z, N));
+}
@@ -0,0 +1,33 @@
+/* Three-point Jacobi relaxation, ping-ponging between two buffers */
+#include "bench.h"
+
+#define N 8192
+#define STEPS 10000
+
+KERNEL void jacobi1d(float *out, const float *in, long n) {
+  long i;
+  for (i = 1; i < n - 1; ++i)
+    out[i] = (in[i - 1] + in[i] + in[i + 1]) * (1.0f / 3.0f);
+}
+
+int main(void) {
+  float *a = malloc(N * sizeof(float));
+  float *b = malloc(N * sizeof(float));
+  double best = -1;
+  int rep, t;
+
+  if (!a || !b)
+    return bench_oom();
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(a, N, 1);
+    bench_fill(b, N, 1);
+    start = bench_now();
+    for (t = 0; t < STEPS; t += 2) {
+      jacobi1d(b, a, N);
+      jacobi1d(a, b, N);
+    }
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(a, N));
+}
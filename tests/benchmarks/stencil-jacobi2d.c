@@ -0,0 +1,36 @@
+/* Five-point Jacobi relaxation on an n x n grid */
+#include "bench.h"
+
+#define N 512
+#define STEPS 200
+
+KERNEL void jacobi2d(float *out, const float *in, long n) {
+  long i, j;
+  for (i = 1; i < n - 1; ++i)
+    for (j = 1; j < n - 1; ++j)
+      out[i * n + j] = (in[i * n + j] + in[(i - 1) * n + j] +
+                        in[(i + 1) * n + j] + in[i * n + j - 1] +
+                        in[i * n + j + 1]) * 0.2f;
+}
+
+int main(void) {
+  float *a = malloc(N * N * sizeof(float));
+  float *b = malloc(N * N * sizeof(float));
+  double best = -1;
+  int rep, t;
+
+  if (!a || !b)
+    return bench_oom();
+  for (rep = 0; rep < BENCH_REPS; ++rep) {
+    double start;
+    bench_fill(a, N * N, 1);
+    bench_fill(b, N * N, 1);
+    start = bench_now();
+    for (t = 0; t < STEPS; t += 2) {
+      jacobi2d(b, a, N);
+      jacobi2d(a, b, N);
+    }
+    best = bench_min(best, bench_now() - start);
+  }
+  return bench_report(best, bench_checksum(a, N * N));
+}